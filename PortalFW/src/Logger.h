@@ -80,6 +80,7 @@ public:
 	void printRaw(const char *);
 
 	void reportStatus(msgpack::Serializer&);
+	bool hasMessages() const { return !this->messageOutbox.empty(); }
 	bool directActive() const { return this->directMode; }
 	void sendDirectLog(const LogMessage&);
 
@@ -353,12 +353,205 @@ namespace Modules
 		}
 	}
 
+	//----------
+	size_t
+	App::packCompactStatus(uint8_t * buffer, size_t bufferSize, bool changedOnly)
+	{
+		// Layout v1 (little-endian) :
+		//	version u8, flags u8 (bit 0 = changedOnly, bit 1 = log messages waiting), fields u8, upTime u32
+		//	then each group whose bit is set in fields, in bit order :
+		//	0 : positions i32 x 4 (a, b, targetA, targetB)
+		//	1 : health u8 (measureCycle, switches, backlash, home in bits 0-3 for A and 4-7 for B)
+		//	2 : motion profiles i32 x 6 (maximumSpeed, acceleration, minimumSpeed for A then B)
+		//	3 : optical i16 threshold, i32 width for A then B
+		//	4 : fast home failure u8 x 2
+		//	5 : settings u16 operatingCurrentMa, u8 fullCurrentHomeRecovery, u8 source, u16 opticalCalibrationVersion
+		//	6 : provision serial u32
+		//	7 : version string u8 length + bytes
+		if(bufferSize < compactStatusMaxSize) {
+			return 0;
+		}
+
+		CompactStatus status;
+		{
+			MotionControl * axes[2] = { this->motionControlA, this->motionControlB };
+
+			status.health = 0;
+			for(uint8_t i=0; i<2; i++) {
+				auto axis = axes[i];
+				status.positions[i] = axis->getPosition();
+				status.positions[i + 2] = axis->getTargetPosition();
+
+				const auto & healthStatus = axis->getHealthStatus();
+				status.health |= ((healthStatus.measureCycleOK ? 1 : 0)
+					| (healthStatus.switchesOK ? 2 : 0)
+					| (healthStatus.backlashOK ? 4 : 0)
+					| (healthStatus.homeOK ? 8 : 0)) << (i * 4);
+
+				const auto & motionProfile = axis->getMotionProfile();
+				status.motionProfiles[i * 3 + 0] = motionProfile.maximumSpeed;
+				status.motionProfiles[i * 3 + 1] = motionProfile.acceleration;
+				status.motionProfiles[i * 3 + 2] = motionProfile.minimumSpeed;
+
+#ifndef HOME_SWITCH_LEGACY
+				status.opticalThresholds[i] = axis->getOpticalThreshold();
+				status.opticalWidths[i] = axis->getOpticalWidth();
+				status.fastHomeFailures[i] = (uint8_t) axis->getLastFastHomeFailure();
+#else
+				status.opticalThresholds[i] = 0;
+				status.opticalWidths[i] = 0;
+				status.fastHomeFailures[i] = 0;
+#endif
+			}
+
+			status.operatingCurrentMa = this->getOperatingCurrentMa();
+			status.fullCurrentHomeRecovery = this->getFullCurrentHomeRecovery() ? 1 : 0;
+			status.settingsSource = (uint8_t) this->persistentSettings.source;
+			status.opticalCalibrationVersion = this->persistentSettings.opticalCalibrationVersion;
+			status.provisionSerial = this->getProvisionSerial();
+		}
+
+		// Only send the changes if the other side has seen a report from us before
+		changedOnly &= this->compactStatusSent;
+		const auto & last = this->lastCompactStatus;
+
+		uint8_t fields = 0;
+		if(!changedOnly || memcmp(status.positions, last.positions, sizeof(status.positions)) != 0) {
+			fields |= 1 << 0;
+		}
+		if(!changedOnly || status.health != last.health) {
+			fields |= 1 << 1;
+		}
+		if(!changedOnly || memcmp(status.motionProfiles, last.motionProfiles, sizeof(status.motionProfiles)) != 0) {
+			fields |= 1 << 2;
+		}
+#ifndef HOME_SWITCH_LEGACY
+		if(!changedOnly
+			|| memcmp(status.opticalThresholds, last.opticalThresholds, sizeof(status.opticalThresholds)) != 0
+			|| memcmp(status.opticalWidths, last.opticalWidths, sizeof(status.opticalWidths)) != 0) {
+			fields |= 1 << 3;
+		}
+		if(!changedOnly || memcmp(status.fastHomeFailures, last.fastHomeFailures, sizeof(status.fastHomeFailures)) != 0) {
+			fields |= 1 << 4;
+		}
+#endif
+		if(!changedOnly
+			|| status.operatingCurrentMa != last.operatingCurrentMa
+			|| status.fullCurrentHomeRecovery != last.fullCurrentHomeRecovery
+			|| status.settingsSource != last.settingsSource
+			|| status.opticalCalibrationVersion != last.opticalCalibrationVersion) {
+			fields |= 1 << 5;
+		}
+		if(!changedOnly || status.provisionSerial != last.provisionSerial) {
+			fields |= 1 << 6;
+		}
+		if(!changedOnly) {
+			// The version can't change whilst we're running
+			fields |= 1 << 7;
+		}
+
+		size_t size = 0;
+		auto write = [&](uint32_t value, uint8_t byteCount) {
+			for(uint8_t i=0; i<byteCount; i++) {
+				buffer[size++] = (uint8_t) (value >> (i * 8));
+			}
+		};
+
+		write(1, 1);
+		write((changedOnly ? 1 : 0) | (Logger::X().hasMessages() ? 2 : 0), 1);
+		write(fields, 1);
+		write(millis(), 4);
+
+		if(fields & (1 << 0)) {
+			for(auto position : status.positions) {
+				write((uint32_t) position, 4);
+			}
+		}
+		if(fields & (1 << 1)) {
+			write(status.health, 1);
+		}
+		if(fields & (1 << 2)) {
+			for(auto value : status.motionProfiles) {
+				write((uint32_t) value, 4);
+			}
+		}
+		if(fields & (1 << 3)) {
+			for(uint8_t i=0; i<2; i++) {
+				write((uint16_t) status.opticalThresholds[i], 2);
+				write((uint32_t) status.opticalWidths[i], 4);
+			}
+		}
+		if(fields & (1 << 4)) {
+			write(status.fastHomeFailures[0], 1);
+			write(status.fastHomeFailures[1], 1);
+		}
+		if(fields & (1 << 5)) {
+			write(status.operatingCurrentMa, 2);
+			write(status.fullCurrentHomeRecovery, 1);
+			write(status.settingsSource, 1);
+			write(status.opticalCalibrationVersion, 2);
+		}
+		if(fields & (1 << 6)) {
+			write(status.provisionSerial, 4);
+		}
+		if(fields & (1 << 7)) {
+			const char * version = PORTAL_VERSION_STRING;
+			auto length = strlen(version);
+			length = length < bufferSize - size - 1 ? length : bufferSize - size - 1;
+			write(length, 1);
+			memcpy(buffer + size, version, length);
+			size += length;
+		}
+
+		this->lastCompactStatus = status;
+		this->compactStatusSent = true;
+
+		return size;
+	}
+
 	//----------
 	bool
 	App::processIncomingByKey(const char *key, Stream &stream)
 	{
 		if (strcmp(key, "poll") == 0)
 		{
+			// Expecting Nil (addressed poll) or [slot_us, firstID] (broadcast poll)
+			msgpack::DataType dataType;
+			if (!msgpack::getNextDataType(stream, dataType))
+			{
+				return false;
+			}
+
+			if (dataType == msgpack::DataType::Array)
+			{
+				// Broadcast poll : we reply in slot (ourID - firstID) so that the whole
+				// column can answer in one window without collisions.
+				size_t arraySize;
+				uint32_t slot_us;
+				ID::Value firstID;
+				if (!msgpack::readArraySize(stream, arraySize) || arraySize != 2
+					|| !msgpack::readInt<uint32_t>(stream, slot_us)
+					|| !msgpack::readInt<ID::Value>(stream, firstID))
+				{
+					return false;
+				}
+
+				const auto ourID = this->id->get();
+				if(ourID < firstID) {
+					return true;
+				}
+
+				// Verifying also sets the seq which our reply will echo
+				if(!RS485::checkChecksum()) {
+					return false;
+				}
+
+#ifndef POLL_DISABLED
+				rs485->scheduleReply(RS485::ScheduledReply::StatusReport, (uint32_t) (ourID - firstID) * slot_us);
+#endif
+				return true;
+			}
+
 			// Fully read the input stream
 			if (!msgpack::readNil(stream))
 			{
@@ -426,6 +619,72 @@ namespace Modules
 			return true;
 		}
 
+		else if (strcmp(key, "mm") == 0)
+		{
+			// Batched move, broadcast : [slot_us, [id, a, b], [id, a, b], ...]
+			// We take our own entry and reply with our positions in the slot matching
+			// the entry's index, so replies from the whole batch don't collide.
+			// Inside a routine the move is ignored, but we still answer in our slot
+			// (with where we actually are), otherwise the Router counts the empty slot
+			// as a timeout.
+			size_t arraySize;
+			if (!msgpack::readArraySize(stream, arraySize) || arraySize < 1)
+			{
+				return false;
+			}
+
+			uint32_t slot_us;
+			if (!msgpack::readInt<uint32_t>(stream, slot_us))
+			{
+				return false;
+			}
+
+			const auto ourID = this->id->get();
+			bool found = false;
+			size_t ourSlot = 0;
+			Steps positionA = 0, positionB = 0;
+
+			// The array is the entire body, so we read all of it to arrive at the trailer
+			for(size_t i=1; i<arraySize; i++) {
+				size_t entrySize;
+				if (!msgpack::readArraySize(stream, entrySize) || entrySize != 3)
+				{
+					return false;
+				}
+
+				ID::Value entryID;
+				Steps entryA, entryB;
+				if (!msgpack::readInt<ID::Value>(stream, entryID)
+					|| !msgpack::readInt<int32_t>(stream, entryA)
+					|| !msgpack::readInt<int32_t>(stream, entryB))
+				{
+					return false;
+				}
+
+				if(entryID == ourID && !found) {
+					found = true;
+					ourSlot = i - 1;
+					positionA = entryA;
+					positionB = entryB;
+				}
+			}
+
+			if(!found) {
+				return true;
+			}
+
+			if(!RS485::checkChecksum()) {
+				return false;
+			}
+			if(!this->isInsideRoutine) {
+				this->motionControlA->setTargetPositionWithMotionFiltering(positionA);
+				this->motionControlB->setTargetPositionWithMotionFiltering(positionB);
+			}
+
+			rs485->scheduleReply(RS485::ScheduledReply::Positions, ourSlot * slot_us);
+			return true;
+		}
+
 		else if (strcmp(key, "id") == 0)
 		{
 			return this->id->processIncoming(stream);
@@ -490,6 +749,69 @@ namespace Modules
 			return true;
 		}
 
+		else if (strcmp(key, "s") == 0)
+		{
+			// Compact status report. Expecting Nil (everything), flags (bit 0 = changed fields only)
+			// or [slot_us, firstID(, flags)] (broadcast, reply in slot (ourID - firstID) as for "poll")
+			msgpack::DataType dataType;
+			if (!msgpack::getNextDataType(stream, dataType))
+			{
+				return false;
+			}
+
+			uint8_t flags = 0;
+			if (dataType == msgpack::DataType::Array)
+			{
+				size_t arraySize;
+				uint32_t slot_us;
+				ID::Value firstID;
+				if (!msgpack::readArraySize(stream, arraySize) || arraySize < 2 || arraySize > 3
+					|| !msgpack::readInt<uint32_t>(stream, slot_us)
+					|| !msgpack::readInt<ID::Value>(stream, firstID))
+				{
+					return false;
+				}
+				if (arraySize == 3 && !msgpack::readInt<uint8_t>(stream, flags))
+				{
+					return false;
+				}
+
+				const auto ourID = this->id->get();
+				if(ourID < firstID) {
+					return true;
+				}
+
+				if(!RS485::checkChecksum()) {
+					return false;
+				}
+
+#ifndef POLL_DISABLED
+				rs485->scheduleReply((flags & 1) ? RS485::ScheduledReply::CompactStatusChanges : RS485::ScheduledReply::CompactStatus
+					, (uint32_t) (ourID - firstID) * slot_us);
+#endif
+				return true;
+			}
+
+			if (dataType == msgpack::DataType::Nil)
+			{
+				if (!msgpack::readNil(stream))
+				{
+					return false;
+				}
+			}
+			else if (!msgpack::readInt<uint8_t>(stream, flags))
+			{
+				return false;
+			}
+
+#ifndef POLL_DISABLED
+			if(RS485::replyAllowed()) {
+				rs485->sendCompactStatusReport(flags & 1);
+			}
+#endif
+			return true;
+		}
+
 		else if (strcmp(key, "init") == 0)
 		{
 			// Can't do whilst already inside routine
@@ -683,6 +1005,25 @@ namespace Modules
 			return true;
 		}
 
+		else if (strcmp(key, "baud") == 0) {
+			// [baudRate, delay_ms] (broadcast). Everybody moves together once the frame has finished,
+			// and RS485 falls back to 115200 by itself if the Router stops talking at the new rate
+			size_t arraySize;
+			if(!msgpack::readArraySize(stream, arraySize) || arraySize != 2) {
+				return false;
+			}
+			uint32_t baudRate;
+			uint16_t delay_ms;
+			if(!msgpack::readInt<uint32_t>(stream, baudRate)
+				|| !msgpack::readInt<uint16_t>(stream, delay_ms)) {
+				return false;
+			}
+			if(!RS485::checkChecksum()) {
+				return false;
+			}
+			return this->rs485->scheduleBaudRate(baudRate, delay_ms);
+		}
+
 		else if (strcmp(key, "keyframe") == 0)
 		{
 			if(this->isInsideRoutine) {
@@ -692,6 +1033,15 @@ namespace Modules
 			return this->keyframeMotionControl->processIncoming(stream);
 		}
 
+		else if (strcmp(key, "kf") == 0)
+		{
+			if(this->isInsideRoutine) {
+				return true;
+			}
+
+			return this->keyframeMotionControl->processIncomingBinary(stream);
+		}
+
 		return false;
 	}
 }
@@ -29,6 +29,13 @@ namespace Modules {
 		void setup();
 		void update();
 		void reportStatus(msgpack::Serializer&);
+
+		// Compact status report (the "s" key) : a fixed-layout little-endian struct for a msgpack bin, about a
+		// fifth of the size of reportStatus. With changedOnly, field groups which haven't changed since the last
+		// compact report we packed are left out. Log messages aren't included, only a flag that some are waiting.
+		// Returns the number of bytes written
+		static const size_t compactStatusMaxSize = 160;
+		size_t packCompactStatus(uint8_t * buffer, size_t bufferSize, bool changedOnly);
 		
 		// Use this update if you're doing a routine that's blocking the mainloop
 		// e.g. to send a reboot / FW announce
@@ -80,5 +87,21 @@ namespace Modules {
 		bool shouldEscapeFromRoutine = false;
 		PersistentStorage::Identity persistentIdentity;
 		PersistentStorage::Settings persistentSettings;
+
+		// What we last sent in a compact status report (for changedOnly)
+		struct CompactStatus {
+			int32_t positions[4];
+			uint8_t health;
+			int32_t motionProfiles[6];
+			int16_t opticalThresholds[2];
+			int32_t opticalWidths[2];
+			uint8_t fastHomeFailures[2];
+			uint16_t operatingCurrentMa;
+			uint8_t fullCurrentHomeRecovery;
+			uint8_t settingsSource;
+			uint16_t opticalCalibrationVersion;
+			uint32_t provisionSerial;
+		} lastCompactStatus;
+		bool compactStatusSent = false;
 	};
 }
@@ -216,25 +216,142 @@ namespace Modules {
 			
 			// Apply the values if the ID matches
 			if(i + blockStartIndex == ourID) {
-				this->keyframes[0].position = positionA;
-				this->keyframes[1].position = positionB;
-				this->keyframes[0].velocity = velocityA;
-				this->keyframes[1].velocity = velocityB;
+				this->applyKeyframe(positionA, positionB, velocityA, velocityB);
 
-				auto wasActive = this->active;
-				App::X().motionControlA->setTargetPosition(positionA);
-				App::X().motionControlB->setTargetPosition(positionB);
+				// The json format doesn't carry a seq, so any binary deltas which follow need an absolute block first
+				this->synced = false;
 
-				if(wasActive) {
-					// This flag is cleared by setTargetPosition on the motionControl
-					this->active = true;
+				return true;
+			}
+		}
+
+		return true;
+	}
+
+	//----------
+	bool
+	KeyframeMotionControl::processIncomingBinary(Stream & stream)
+	{
+		// The incoming message is a bin (see KeyframeEncoder in the Router):
+		/*
+			flags, seq, startIndex, count,
+			bitmap[(count + 7) / 8],
+			for each set bit: posA, posB (, velA, velB)
+				int32 LE if KEYFRAME_FLAG_ABSOLUTE, else int16 LE deltas
+		*/
+
+		auto ourID = Modules::App::X().id->get();
+
+		uint16_t binarySize;
+		if(!msgpack::readBinarySize(stream, binarySize)) {
+			return false;
+		}
+		if(binarySize < 4) {
+			return false;
+		}
+
+		uint8_t flags, seq, startIndex, count;
+		if(!msgpack::readRaw(stream, flags)
+			|| !msgpack::readRaw(stream, seq)
+			|| !msgpack::readRaw(stream, startIndex)
+			|| !msgpack::readRaw(stream, count)) {
+			return false;
+		}
+
+		if(ourID < startIndex || ourID >= (Modules::ID::Value) startIndex + count) {
+			// This data block is not for us. Jump to next packet
+			return true;
+		}
+
+		const bool isAbsolute = flags & KEYFRAME_FLAG_ABSOLUTE;
+		const bool hasVelocities = flags & KEYFRAME_FLAG_VELOCITIES;
+
+		// Check we haven't missed a block (deltas would be against the wrong values)
+		if(!isAbsolute && (!this->synced || seq != (uint8_t) (this->lastSeq + 1))) {
+			this->synced = false;
+			return true;
+		}
+		this->lastSeq = seq;
+		this->synced = true;
+
+		// Read the bitmap
+		uint8_t bitmap[32];
+		const size_t bitmapSize = ((size_t) count + 7) / 8;
+		if(bitmapSize > sizeof(bitmap)) {
+			return false;
+		}
+		if(!msgpack::readRaw(stream, (char *) bitmap, bitmapSize)) {
+			return false;
+		}
+
+		const uint8_t ourIndex = ourID - startIndex;
+		if(!(bitmap[ourIndex / 8] & (1 << (ourIndex % 8)))) {
+			// Our values haven't changed
+			return true;
+		}
+
+		// Skip the entries before ours
+		const uint8_t valueCount = hasVelocities ? 4 : 2;
+		const uint8_t valueSize = isAbsolute ? 4 : 2;
+		{
+			size_t entriesBefore = 0;
+			for(uint8_t i=0; i<ourIndex; i++) {
+				if(bitmap[i / 8] & (1 << (i % 8))) {
+					entriesBefore++;
 				}
-				this->lastTimestamp = millis();
+			}
+			for(size_t i=0; i<entriesBefore * valueCount * valueSize; i++) {
+				uint8_t _;
+				if(!msgpack::readRaw(stream, _)) {
+					return false;
+				}
+			}
+		}
 
-				return true;
+		// Read our values (both sides are little-endian)
+		int32_t values[4] = { 0, 0, 0, 0 };
+		for(uint8_t i=0; i<valueCount; i++) {
+			if(isAbsolute) {
+				if(!msgpack::readRaw(stream, values[i])) {
+					return false;
+				}
+			}
+			else {
+				int16_t delta;
+				if(!msgpack::readRaw(stream, delta)) {
+					return false;
+				}
+				values[i] = (i < 2 ? this->keyframes[i].position : this->keyframes[i - 2].velocity) + delta;
 			}
 		}
 
+		if(hasVelocities) {
+			// Enable velocity interpolation
+			this->active = true;
+		}
+
+		this->applyKeyframe(values[0], values[1], values[2], values[3]);
+
 		return true;
 	}
+
+	//----------
+	void
+	KeyframeMotionControl::applyKeyframe(Steps positionA, Steps positionB, StepsPerSecond velocityA, StepsPerSecond velocityB)
+	{
+		this->keyframes[0].position = positionA;
+		this->keyframes[1].position = positionB;
+		this->keyframes[0].velocity = velocityA;
+		this->keyframes[1].velocity = velocityB;
+
+		auto wasActive = this->active;
+		App::X().motionControlA->setTargetPosition(positionA);
+		App::X().motionControlB->setTargetPosition(positionB);
+
+		if(wasActive) {
+			// This flag is cleared by setTargetPosition on the motionControl
+			this->active = true;
+		}
+		this->lastTimestamp = millis();
+	}
 }
\ No newline at end of file
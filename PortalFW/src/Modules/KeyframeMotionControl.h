@@ -3,6 +3,9 @@
 #include "Base.h"
 #include "Types.h"
 
+#define KEYFRAME_FLAG_ABSOLUTE (1 << 0)
+#define KEYFRAME_FLAG_VELOCITIES (1 << 1)
+
 namespace Modules {
 	class KeyframeMotionControl : public Base{
 	public:
@@ -12,7 +15,10 @@ namespace Modules {
 		void clear();
 
 		bool processIncoming(Stream &) override;
+		bool processIncomingBinary(Stream &);
 	protected:
+		void applyKeyframe(Steps positionA, Steps positionB, StepsPerSecond velocityA, StepsPerSecond velocityB);
+
 		struct Keyframe {
 			Steps position = 0;
 			StepsPerSecond velocity = 0;
@@ -20,6 +26,11 @@ namespace Modules {
 
 		Keyframe keyframes[2];
 
+		// Binary keyframes carry deltas against the previous block, so we track
+		// the block seq and wait for an absolute block whenever we miss one
+		uint8_t lastSeq = 0;
+		bool synced = false;
+
 		uint32_t lastTimestamp = 0;
 		uint32_t keyframeLifetime = 1000;
 		bool active = false;
@@ -56,7 +56,7 @@ namespace Modules {
 	void
 	RS485::setup()
 	{
-		serialRS485.begin(115200);
+		serialRS485.begin(RS485::bootBaudRate);
 
 		// Setup the DE pin
 		pinMode(PIN_DE, OUTPUT);
@@ -68,6 +68,31 @@ namespace Modules {
 	RS485::update()
 	{
 		this->processIncoming();
+
+		this->updateBaudRate();
+
+		// Send any reply which is waiting for its slot
+		if(this->scheduledReply != ScheduledReply::None && (int32_t) (micros() - this->scheduledReplyTime) >= 0) {
+			auto reply = this->scheduledReply;
+			this->scheduledReply = ScheduledReply::None;
+
+			switch(reply) {
+			case ScheduledReply::Positions:
+				this->sendPositions();
+				break;
+			case ScheduledReply::StatusReport:
+				this->sendStatusReport();
+				break;
+			case ScheduledReply::CompactStatus:
+				this->sendCompactStatusReport(false);
+				break;
+			case ScheduledReply::CompactStatusChanges:
+				this->sendCompactStatusReport(true);
+				break;
+			default:
+				break;
+			}
+		}
 	}
 
 	//---------
@@ -128,6 +153,48 @@ namespace Modules {
 		this->finishFrame();
 	}
 
+	//---------
+	void
+	RS485::sendCompactStatusReport(bool changedOnly)
+	{
+		// If we're doing this in response to a message, then no other ACK is required
+		RS485::noACKRequired();
+
+		uint8_t report[App::compactStatusMaxSize];
+		auto reportSize = this->app->packCompactStatus(report, sizeof(report), changedOnly);
+
+		this->beginTransmission();
+
+		const auto ourID = this->app->id->get();
+
+		// Packer [target, sender, message, seq, crc16]
+		msgpack::writeArraySize4(cobsStream, 5);
+		{
+			msgpack::writeInt8(cobsStream, 0);
+			msgpack::writeInt8(cobsStream, ourID);
+
+			msgpack::writeMapSize4(cobsStream, 1);
+			{
+				msgpack::writeString5(cobsStream, "s", 1);
+
+				// bin 8 (msgpack-arduino's writeBinary8 is declared for char * but defined for uint8_t *, so it doesn't link)
+				cobsStream.write((uint8_t) 0xC4);
+				cobsStream.write((uint8_t) reportSize);
+				cobsStream.write(report, reportSize);
+			}
+		}
+
+		this->finishFrame();
+	}
+
+	//---------
+	void
+	RS485::scheduleReply(ScheduledReply reply, uint32_t delay_us)
+	{
+		this->scheduledReply = reply;
+		this->scheduledReplyTime = micros() + delay_us;
+	}
+
 	//---------
 	void
 	RS485::sendACKEarly(bool success)
@@ -186,6 +253,73 @@ namespace Modules {
 		return this->anySignalReceived;
 	}
 
+	//---------
+	bool
+	RS485::scheduleBaudRate(uint32_t baudRate, uint16_t delay_ms)
+	{
+		switch(baudRate) {
+		case 115200:
+		case 230400:
+		case 460800:
+		case 921600:
+		case 1000000:
+			break;
+		default:
+			return false;
+		}
+
+		this->pendingBaudRate = baudRate;
+		this->pendingBaudRateTime = millis() + delay_ms;
+		return true;
+	}
+
+	//---------
+	uint32_t
+	RS485::getBaudRate() const
+	{
+		return this->baudRate;
+	}
+
+	//---------
+	void
+	RS485::updateBaudRate()
+	{
+		if(this->pendingBaudRate != 0 && (int32_t) (millis() - this->pendingBaudRateTime) >= 0) {
+			auto baudRate = this->pendingBaudRate;
+			this->pendingBaudRate = 0;
+			this->setBaudRate(baudRate);
+			return;
+		}
+
+		// Watchdog : if the Router has gone (or we missed it moving the bus), go back to where it will look for us
+		if(this->baudRate != RS485::bootBaudRate
+			&& millis() - this->lastValidFrameTime > RS485::baudFallbackTimeout_ms) {
+			this->setBaudRate(RS485::bootBaudRate);
+			log(LogLevel::Warning, "RS485", "No valid frames, baud rate back to 115200");
+		}
+	}
+
+	//---------
+	void
+	RS485::setBaudRate(uint32_t baudRate)
+	{
+		if(baudRate == this->baudRate) {
+			return;
+		}
+
+		// Anything we're still sending goes out at the old rate
+		serialRS485.flush();
+		serialRS485.end();
+		serialRS485.begin(baudRate);
+
+		this->baudRate = baudRate;
+		this->lastValidFrameTime = millis();
+
+		char message[64];
+		sprintf(message, "Baud rate : %lu", (unsigned long) baudRate);
+		log(LogLevel::Status, "RS485", message);
+	}
+
 	//---------
 	void
 	RS485::processIncoming()
@@ -213,6 +347,7 @@ namespace Modules {
 			}
 			else {
 				this->anySignalReceived = true;
+				this->lastValidFrameTime = millis();
 			}
 
 			// disable ACK is handled inside sendACK function
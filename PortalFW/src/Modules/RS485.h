@@ -15,6 +15,20 @@ namespace Modules {
 		void sendStatusReport();
 		void sendPositions();
 
+		// {"s" : bin(App::packCompactStatus)}. Log messages stay in the outbox for the next full status report
+		void sendCompactStatusReport(bool changedOnly);
+
+		enum class ScheduledReply : uint8_t {
+			None,
+			Positions,
+			StatusReport,
+			CompactStatus,
+			CompactStatusChanges
+		};
+
+		// Send a reply after a delay (e.g. in our reply slot after a broadcast "mm" or "poll")
+		void scheduleReply(ScheduledReply, uint32_t delay_us);
+
 		// Use this function if you want to manually send an ACK
 		// e.g. if the message starts a routine which takes time (init/home/etc)
 		static void sendACKEarly(bool success);
@@ -52,6 +66,18 @@ namespace Modules {
 		static bool getVerifyChecksumEnabled();
 
 		bool hasAnySignalBeenReceived() const;
+
+		// The rate we (and the bootloader) come up at
+		static const uint32_t bootBaudRate = 115200;
+
+		// At any other rate, if no valid frame arrives for this long we go back to bootBaudRate
+		// (the Router sends a broadcast ping every second whilst the bus is fast)
+		static const uint32_t baudFallbackTimeout_ms = 3000;
+
+		// Move to baudRate after delay_ms, i.e. once the Router's "baud" broadcast has reached everybody
+		// on the bus. Returns false for a rate we don't support
+		bool scheduleBaudRate(uint32_t baudRate, uint16_t delay_ms);
+		uint32_t getBaudRate() const;
 	protected:
 		App * app;
 		static RS485 * instance;
@@ -69,11 +95,22 @@ namespace Modules {
 
 		void sendACK(bool success);
 
+		void updateBaudRate();
+		void setBaudRate(uint32_t);
+
 		bool disableACK = false;
 		bool sentACKEarly = false;
 
+		ScheduledReply scheduledReply = ScheduledReply::None;
+		uint32_t scheduledReplyTime = 0;
+
 		bool anySignalReceived = false;
 
+		uint32_t baudRate = bootBaudRate;
+		uint32_t pendingBaudRate = 0;
+		uint32_t pendingBaudRateTime = 0;
+		uint32_t lastValidFrameTime = 0;
+
 		// The most recently verified (checkChecksum()-passed) request's seq, echoed in every
 		// outgoing frame's trailer. 0 until the first successful verification, or forever if
 		// the Router hasn't started sending seq numbers yet (Stage 3) -- either way this stays
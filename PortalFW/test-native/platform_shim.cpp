@@ -0,0 +1,582 @@
+// The host side of the STM32 Arduino core, and the handful of firmware symbols MotionControl and
+// KeyframeMotionControl reach for outside themselves.
+//
+// Simulated time: millis() / micros() read a nanosecond clock which only moves in
+// Simulation::advance (or in delay / HAL_Delay, which advance it). Each running HardwareTimer
+// fires its update interrupt at the exact times its period falls due. The overflow frequency is
+// quantised the way STM32duino's setOverflow(HERTZ_FORMAT) quantises it against the 64 MHz timer
+// clock (prescaler, then a 16-bit ARR), so the step rate seen here is the step rate the pin
+// produces, not the rate MotionControl asked for.
+//
+// Compiled for real against this: MotionControl, KeyframeMotionControl, MotorDriver,
+// MotorDriverSettings, Base and Exception. Stubbed here, because they own hardware the
+// simulation does not model: App (only the pointers the two modules use), ID, RS485, the
+// optical home switch (never active, which is correct outside routines since switchesArmed is
+// only set by them) and Logger (messages go to stdout).
+//
+// `msgpack::delay` and `msgpack::String`'s constructors are here for the same reason as in
+// PortalBootloader/test-native/platform_shim.cpp.
+
+#include "Arduino.h"
+#include "Simulation.h"
+
+#include "Modules/App.h"
+#include "Logger.h"
+
+#include <vector>
+#include <algorithm>
+
+namespace {
+	const uint64_t timerClock_Hz = 64000000; // APB timer clock at the 64 MHz SYSCLK set up in main.cpp
+
+	uint64_t now_ns = 0;
+	std::vector<HardwareTimer*> timers;
+
+	TIM_TypeDef TIM1 { 1 };
+	TIM_TypeDef TIM16 { 16 };
+}
+
+const PinMap PinMap_TIM[] = {
+	{ PA_6_ALT1, &TIM16, 1 } // MotorDriver::Config::MotorA
+	, { PA_10, &TIM1, 3 } // MotorDriver::Config::MotorB
+	, { 0xFFFFFFFF, nullptr, 0 }
+};
+
+#pragma mark Simulation
+//----------
+std::function<void(const TIM_TypeDef *, uint64_t)> Simulation::onTimerUpdate;
+
+//----------
+void
+Simulation::reset()
+{
+	now_ns = 0;
+	onTimerUpdate = nullptr;
+}
+
+//----------
+uint64_t
+Simulation::getTime_ns()
+{
+	return now_ns;
+}
+
+//----------
+void
+Simulation::advance(uint32_t us)
+{
+	const auto end_ns = now_ns + (uint64_t) us * 1000;
+
+	// Fire the timers' updates in time order across all timers, so the clock read from inside
+	// an interrupt is the time that interrupt fired at
+	while(true) {
+		HardwareTimer * next = nullptr;
+		auto nextTime_ns = end_ns;
+		for(auto timer : timers) {
+			if(timer->getNextUpdate_ns() <= nextTime_ns) {
+				next = timer;
+				nextTime_ns = timer->getNextUpdate_ns();
+			}
+		}
+		if(!next) {
+			break;
+		}
+		now_ns = nextTime_ns;
+		next->fireUpdate();
+	}
+
+	now_ns = end_ns;
+}
+
+//----------
+TIM_TypeDef *
+Simulation::getTimerForPin(uint32_t pin)
+{
+	return (TIM_TypeDef *) pinmap_peripheral(pin, PinMap_TIM);
+}
+
+//----------
+void
+Simulation::addTimer(HardwareTimer * timer)
+{
+	timers.push_back(timer);
+}
+
+//----------
+void
+Simulation::removeTimer(HardwareTimer * timer)
+{
+	timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+}
+
+#pragma mark Time
+//----------
+uint32_t
+millis()
+{
+	return (uint32_t) (now_ns / 1000000);
+}
+
+//----------
+uint32_t
+micros()
+{
+	return (uint32_t) (now_ns / 1000);
+}
+
+//----------
+void
+delay(uint32_t ms)
+{
+	Simulation::advance(ms * 1000);
+}
+
+//----------
+void
+delayMicroseconds(uint32_t us)
+{
+	Simulation::advance(us);
+}
+
+//----------
+// As the HAL's: waits for (ms + 1) SysTick edges, so HAL_Delay(1) in the main loop lasts
+// between 1 and 2 ms depending on where in the tick it was called
+void
+HAL_Delay(uint32_t ms)
+{
+	const auto tickStart = millis();
+	const auto wait = ms + 1;
+	const auto end_ns = (uint64_t) (tickStart + wait) * 1000000;
+	if(end_ns > now_ns) {
+		Simulation::advance((uint32_t) ((end_ns - now_ns + 999) / 1000));
+	}
+}
+
+#pragma mark GPIO
+//----------
+void pinMode(uint32_t, uint32_t) { }
+void digitalWrite(uint32_t, uint32_t) { }
+int digitalRead(uint32_t) { return LOW; }
+void analogWrite(uint32_t, int) { }
+void analogWriteResolution(int) { }
+void analogWriteFrequency(uint32_t) { }
+uint32_t analogRead(uint32_t) { return 0; }
+
+#pragma mark HardwareTimer
+//----------
+void *
+pinmap_peripheral(PinName pin, const PinMap * map)
+{
+	for(; map->peripheral; map++) {
+		if(map->pin == pin) {
+			return map->peripheral;
+		}
+	}
+	return nullptr;
+}
+
+//----------
+uint32_t
+pinmap_function(PinName pin, const PinMap * map)
+{
+	for(; map->peripheral; map++) {
+		if(map->pin == pin) {
+			return map->function;
+		}
+	}
+	return 0;
+}
+
+//----------
+HardwareTimer::HardwareTimer(TIM_TypeDef * instance)
+: instance(instance)
+{
+	Simulation::addTimer(this);
+}
+
+//----------
+HardwareTimer::~HardwareTimer()
+{
+	Simulation::removeTimer(this);
+}
+
+//----------
+void
+HardwareTimer::setMode(uint32_t, TimerModes_t, PinName)
+{
+}
+
+//----------
+void
+HardwareTimer::setOverflow(uint32_t value, TimerFormat_t format)
+{
+	uint64_t ticks;
+	switch(format) {
+	case MICROSEC_FORMAT:
+		ticks = (uint64_t) value * timerClock_Hz / 1000000;
+		break;
+	case HERTZ_FORMAT:
+		ticks = value > 0 ? timerClock_Hz / value : 0x10000;
+		break;
+	case TICK_FORMAT:
+	default:
+		ticks = value;
+		break;
+	}
+
+	// As STM32duino: the smallest prescaler that fits the period into a 16-bit ARR
+	const auto prescaler = ticks / 0x10000 + 1;
+	const auto reload = std::max<uint64_t>(ticks / prescaler, 1);
+	const auto period_ns = prescaler * reload * 1000000000 / timerClock_Hz;
+
+	if(this->running) {
+		// ARR and PSC are preloaded, so the period in progress completes at the old length
+		this->pendingPeriod_ns = period_ns;
+	}
+	else {
+		this->period_ns = period_ns;
+		this->pendingPeriod_ns = 0;
+	}
+}
+
+//----------
+void
+HardwareTimer::setCaptureCompare(uint32_t, uint32_t, TimerCompareFormat_t)
+{
+}
+
+//----------
+void
+HardwareTimer::pause()
+{
+	this->running = false;
+	if(this->pendingPeriod_ns) {
+		this->period_ns = this->pendingPeriod_ns;
+		this->pendingPeriod_ns = 0;
+	}
+}
+
+//----------
+void
+HardwareTimer::resume()
+{
+	if(this->running) {
+		return;
+	}
+	this->running = true;
+	this->nextUpdate_ns = Simulation::getTime_ns() + this->period_ns;
+}
+
+//----------
+bool
+HardwareTimer::isRunning() const
+{
+	return this->running;
+}
+
+//----------
+void
+HardwareTimer::attachInterrupt(callback_function_t callback)
+{
+	this->callback = callback;
+}
+
+//----------
+void
+HardwareTimer::detachInterrupt()
+{
+	this->callback = nullptr;
+}
+
+//----------
+TIM_TypeDef *
+HardwareTimer::getHandle() const
+{
+	return this->instance;
+}
+
+//----------
+uint64_t
+HardwareTimer::getNextUpdate_ns() const
+{
+	return this->running
+		? this->nextUpdate_ns
+		: UINT64_MAX;
+}
+
+//----------
+void
+HardwareTimer::fireUpdate()
+{
+	const auto updateTime = this->nextUpdate_ns;
+
+	if(this->pendingPeriod_ns) {
+		this->period_ns = this->pendingPeriod_ns;
+		this->pendingPeriod_ns = 0;
+	}
+	this->nextUpdate_ns += this->period_ns;
+
+	if(Simulation::onTimerUpdate) {
+		Simulation::onTimerUpdate(this->instance, updateTime);
+	}
+	if(this->callback) {
+		this->callback();
+	}
+}
+
+#pragma mark msgpack
+namespace msgpack {
+	//----------
+	void delay(uint32_t)
+	{
+	}
+
+	//----------
+	String::String()
+	{
+	}
+
+	//----------
+	String::String(const char*)
+	{
+	}
+}
+
+#pragma mark Logger
+//----------
+void
+log(const LogLevel& level, const char* module, const char* message, bool)
+{
+	printf("  [%s] %s : %s\n"
+		, level == LogLevel::Error ? "error" : level == LogLevel::Warning ? "warning" : "status"
+		, module
+		, message);
+}
+
+//----------
+void
+log(const LogMessage& message)
+{
+	log(message.level, message.module.c_str(), message.message.c_str(), message.sendToServer);
+}
+
+//----------
+void
+log(const Exception& exception)
+{
+	log(LogLevel::Error, exception.getModule().c_str(), exception.getMessage().c_str());
+}
+
+//----------
+Logger::Logger()
+{
+}
+
+//----------
+Logger &
+Logger::X()
+{
+	static Logger logger;
+	return logger;
+}
+
+//----------
+void
+Logger::printRaw(const char * text)
+{
+	printf("%s", text);
+}
+
+namespace Modules {
+#pragma mark App
+	App * App::instance = nullptr;
+
+	//----------
+	App::App()
+	{
+		App::instance = this;
+
+		this->id = nullptr;
+		this->rs485 = nullptr;
+		this->leds = nullptr;
+		this->motorDriverSettings = nullptr;
+		this->motorDriverA = nullptr;
+		this->motorDriverB = nullptr;
+		this->homeSwitchA = nullptr;
+		this->homeSwitchB = nullptr;
+		this->motionControlA = nullptr;
+		this->motionControlB = nullptr;
+		this->routines = nullptr;
+		this->keyframeMotionControl = nullptr;
+	}
+
+	//----------
+	App &
+	App::X()
+	{
+		return * App::instance;
+	}
+
+	//----------
+	const char *
+	App::getTypeName() const
+	{
+		return "App";
+	}
+
+	//----------
+	void
+	App::setup()
+	{
+	}
+
+	//----------
+	void
+	App::update()
+	{
+	}
+
+	//----------
+	void
+	App::reportStatus(msgpack::Serializer&)
+	{
+	}
+
+	//----------
+	bool
+	App::processIncomingByKey(const char *, Stream &)
+	{
+		return false;
+	}
+
+	//----------
+	bool
+	App::updateFromRoutine()
+	{
+		return false;
+	}
+
+	//----------
+	bool
+	App::getShouldEscapeFromRoutine()
+	{
+		return false;
+	}
+
+	//----------
+	MotionControl *
+	App::getMotionControl(uint8_t axis)
+	{
+		return axis == 0
+			? this->motionControlA
+			: this->motionControlB;
+	}
+
+#pragma mark ID
+	//----------
+	ID::ID()
+	{
+	}
+
+	//----------
+	const char *
+	ID::getTypeName() const
+	{
+		return "ID";
+	}
+
+	//----------
+	void
+	ID::setup()
+	{
+	}
+
+	//----------
+	void
+	ID::update()
+	{
+	}
+
+	//----------
+	ID::Value
+	ID::get() const
+	{
+		return this->value;
+	}
+
+#pragma mark RS485
+	//----------
+	void
+	RS485::noACKRequired()
+	{
+	}
+
+#pragma mark HomeSwitchOptical
+	std::set<HomeSwitchOptical*> HomeSwitchOptical::allHomeSwitches;
+
+	//----------
+	HomeSwitchOptical::Config
+	HomeSwitchOptical::Config::A()
+	{
+		return Config { PC13 };
+	}
+
+	//----------
+	HomeSwitchOptical::Config
+	HomeSwitchOptical::Config::B()
+	{
+		return Config { PC14 };
+	}
+
+	//----------
+	HomeSwitchOptical::HomeSwitchOptical(const Config& config)
+	: config(config)
+	{
+		HomeSwitchOptical::allHomeSwitches.insert(this);
+	}
+
+	//----------
+	const char *
+	HomeSwitchOptical::getTypeName() const
+	{
+		return "HomeSwitchOptical";
+	}
+
+	//----------
+	void
+	HomeSwitchOptical::setup()
+	{
+	}
+
+	//----------
+	bool
+	HomeSwitchOptical::getForwardsActive() const
+	{
+		return false;
+	}
+
+	//----------
+	bool
+	HomeSwitchOptical::getBackwardsActive() const
+	{
+		return false;
+	}
+
+	namespace {
+		uint8_t homeSwitchThreshold = HOMESWITCHOPTICAL_DEFAULT_THRESHOLD;
+	}
+
+	//----------
+	void
+	HomeSwitchOptical::setThreshold(uint8_t duty)
+	{
+		homeSwitchThreshold = duty;
+	}
+
+	//----------
+	uint8_t
+	HomeSwitchOptical::getThreshold()
+	{
+		return homeSwitchThreshold;
+	}
+}
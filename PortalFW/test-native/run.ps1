@@ -0,0 +1,95 @@
+# Build and run the PortalFW motion trajectory bench with MSVC.
+#
+# This compiles the real MotionControl, KeyframeMotionControl, MotorDriver and
+# MotorDriverSettings sources from ..\src against the host shim in .\shim (simulated time, step
+# timers which fire at their quantised rates) and the msgpack-arduino submodule on its
+# non-Arduino path. Any arguments are passed through to the bench, e.g.
+#   powershell -File run.ps1 --acceleration 20000 --period-ms 100 --trace traces
+#
+# MSVC for the same reason as PortalBootloader\test-native\run.ps1. If you have gcc, see
+# README.md for the equivalent g++ line.
+
+Set-StrictMode -Version Latest
+$ErrorActionPreference = "Stop"
+
+$testDir = $PSScriptRoot
+$firmwareRoot = (Resolve-Path (Join-Path $testDir "..")).Path
+$firmwareSrc = Join-Path $firmwareRoot "src"
+$libSrc = Join-Path $firmwareRoot "lib\msgpack-arduino\src"
+$shimDir = Join-Path $testDir "shim"
+
+if (-not (Test-Path -LiteralPath (Join-Path $libSrc "msgpack.hpp"))) {
+    throw "msgpack-arduino sources not found at $libSrc. Run: git submodule update --init --recursive"
+}
+
+# Locate MSVC. vswhere ships with any VS 2017+ installer.
+$vswhere = Join-Path ${env:ProgramFiles(x86)} "Microsoft Visual Studio\Installer\vswhere.exe"
+if (-not (Test-Path -LiteralPath $vswhere)) {
+    throw "vswhere.exe not found; a Visual Studio C++ toolchain is required."
+}
+$vsPath = (& $vswhere -latest -products * `
+    -requires Microsoft.VisualStudio.Component.VC.Tools.x86.x64 `
+    -property installationPath | Out-String).Trim()
+if ([string]::IsNullOrWhiteSpace($vsPath)) {
+    throw "No Visual Studio installation with the C++ toolchain was found."
+}
+$vcvars = Join-Path $vsPath "VC\Auxiliary\Build\vcvars64.bat"
+if (-not (Test-Path -LiteralPath $vcvars)) {
+    throw "vcvars64.bat not found at $vcvars"
+}
+
+$buildDir = Join-Path $testDir "build"
+$objDir = Join-Path $buildDir "trajectory_bench"
+New-Item -ItemType Directory -Force -Path $objDir | Out-Null
+$exe = Join-Path $buildDir "trajectory_bench.exe"
+
+$librarySources = @(
+    "msgpack\COBSRWStream.cpp"
+    "msgpack\DataType.cpp"
+    "msgpack\deserialize.cpp"
+    "msgpack\logError.cpp"
+    "msgpack\Messaging.cpp"
+    "msgpack\NotArduino.cpp"
+    "msgpack\serialize.cpp"
+    "msgpack\Serializer.cpp"
+    "msgpack\lwrb.c"
+) | ForEach-Object { '"' + (Join-Path $libSrc $_) + '"' }
+
+# Only the modules under test are compiled for real. Everything else they reach (App, ID, RS485,
+# HomeSwitchOptical, Logger) is stubbed in platform_shim.cpp.
+$firmwareSources = @(
+    "Modules\MotionControl.cpp"
+    "Modules\KeyframeMotionControl.cpp"
+    "Modules\MotorDriver.cpp"
+    "Modules\MotorDriverSettings.cpp"
+    "Modules\Base.cpp"
+    "Exception.cpp"
+) | ForEach-Object { '"' + (Join-Path $firmwareSrc $_) + '"' }
+
+# The shim directory comes first so that <Arduino.h>, <HardwareTimer.h> and friends resolve to
+# the host stand-ins. GUI_DISABLED keeps U8g2 out of App.h, as the debug env does. /wd4068
+# silences the firmware's #pragma mark.
+$clArgs = @(
+    "/nologo", "/std:c++17", "/EHsc", "/O2", "/W3", "/wd4068",
+    "/DGUI_DISABLED",
+    "/I`"$shimDir`"",
+    "/I`"$libSrc`"",
+    "/I`"$firmwareSrc`"",
+    "/Fo:`"$objDir\\`"",
+    "/Fe:`"$exe`"",
+    "`"$(Join-Path $testDir 'trajectory_bench.cpp')`"",
+    "`"$(Join-Path $testDir 'platform_shim.cpp')`""
+) + $firmwareSources + $librarySources
+
+Write-Host "=== building trajectory_bench ===" -ForegroundColor Cyan
+$command = "`"$vcvars`" >nul 2>&1 && cl $($clArgs -join ' ')"
+& cmd /c $command
+if ($LASTEXITCODE -ne 0) {
+    throw "trajectory_bench (build)"
+}
+
+Write-Host "=== running trajectory_bench ===" -ForegroundColor Cyan
+& $exe @args
+if ($LASTEXITCODE -ne 0) {
+    throw "trajectory_bench (run)"
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// Host stand-in for the parts of the STM32 Arduino core that MotionControl and
+// KeyframeMotionControl touch. Time is simulated (see Simulation.h): millis() and micros() only
+// move when the harness advances the clock, and HardwareTimer fires its update interrupt at the
+// overflow rate while the clock moves, which is what turns MotionControl's speed into steps.
+//
+// Everything here mirrors the signature the firmware calls, nothing more. Pins, GPIO and the
+// HAL are inert.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <functional>
+
+#include <msgpack.hpp>
+
+using msgpack::Print;
+using msgpack::Stream;
+
+// Pins ---------------------------------------------------------------------------------------
+
+typedef uint32_t PinName;
+
+enum : uint32_t {
+	PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+	PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15,
+	PC0, PC1, PC2, PC3, PC4, PC5, PC6, PC7, PC8, PC9, PC10, PC11, PC12, PC13, PC14, PC15,
+	PD0, PD1, PD2, PD3,
+	PA_0 = PA0, PA_1, PA_2, PA_3, PA_4, PA_5, PA_6, PA_7, PA_8, PA_9, PA_10, PA_11, PA_12, PA_13, PA_14, PA_15,
+	PB_0, PB_1, PB_2, PB_3, PB_4, PB_5, PB_6, PB_7, PB_8, PB_9, PB_10, PB_11, PB_12, PB_13, PB_14, PB_15,
+	PC_0, PC_1, PC_2, PC_3, PC_4, PC_5, PC_6, PC_7, PC_8, PC_9, PC_10, PC_11, PC_12, PC_13, PC_14, PC_15,
+	PA_6_ALT1 = PA_6 | 0x100
+};
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+#define LOW 0x0
+#define HIGH 0x1
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWrite(uint32_t pin, uint32_t value);
+int digitalRead(uint32_t pin);
+void analogWrite(uint32_t pin, int value);
+void analogWriteResolution(int bits);
+void analogWriteFrequency(uint32_t frequency);
+uint32_t analogRead(uint32_t pin);
+
+// Time ---------------------------------------------------------------------------------------
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void HAL_Delay(uint32_t ms);
+
+// Timers -------------------------------------------------------------------------------------
+
+struct TIM_TypeDef {
+	int index;
+};
+
+struct PinMap {
+	PinName pin;
+	TIM_TypeDef * peripheral;
+	uint32_t function;
+};
+
+extern const PinMap PinMap_TIM[];
+
+void * pinmap_peripheral(PinName, const PinMap *);
+uint32_t pinmap_function(PinName, const PinMap *);
+#define STM_PIN_CHANNEL(X) ((uint32_t) (X))
+
+enum TimerModes_t {
+	TIMER_DISABLED,
+	TIMER_OUTPUT_COMPARE,
+	TIMER_OUTPUT_COMPARE_ACTIVE,
+	TIMER_OUTPUT_COMPARE_INACTIVE,
+	TIMER_OUTPUT_COMPARE_TOGGLE,
+	TIMER_OUTPUT_COMPARE_PWM1,
+	TIMER_OUTPUT_COMPARE_PWM2,
+	TIMER_OUTPUT_COMPARE_FORCED_ACTIVE,
+	TIMER_OUTPUT_COMPARE_FORCED_INACTIVE
+};
+
+enum TimerFormat_t {
+	TICK_FORMAT,
+	MICROSEC_FORMAT,
+	HERTZ_FORMAT
+};
+
+enum TimerCompareFormat_t {
+	TICK_COMPARE_FORMAT = 0x80,
+	MICROSEC_COMPARE_FORMAT,
+	HERTZ_COMPARE_FORMAT,
+	PERCENT_COMPARE_FORMAT,
+	RESOLUTION_1B_COMPARE_FORMAT,
+	RESOLUTION_8B_COMPARE_FORMAT = RESOLUTION_1B_COMPARE_FORMAT + 7,
+	RESOLUTION_16B_COMPARE_FORMAT = RESOLUTION_1B_COMPARE_FORMAT + 15
+};
+
+typedef std::function<void()> callback_function_t;
+
+// The update interrupt fires once per overflow period of simulated time while resumed. As on
+// the part, a new overflow written while running takes effect from the next update event
+// (ARR and PSC preload). Written while paused it applies immediately, and resume() starts a
+// fresh period.
+class HardwareTimer {
+public:
+	HardwareTimer(TIM_TypeDef *);
+	~HardwareTimer();
+
+	void setMode(uint32_t channel, TimerModes_t mode, PinName pin = 0);
+	void setOverflow(uint32_t value, TimerFormat_t format = TICK_FORMAT);
+	void setCaptureCompare(uint32_t channel, uint32_t value, TimerCompareFormat_t format = TICK_COMPARE_FORMAT);
+
+	void pause();
+	void resume();
+	bool isRunning() const;
+
+	void attachInterrupt(callback_function_t);
+	void detachInterrupt();
+
+	TIM_TypeDef * getHandle() const;
+
+	// Simulation (called from Simulation::advance)
+	uint64_t getNextUpdate_ns() const;
+	void fireUpdate();
+protected:
+	TIM_TypeDef * instance;
+	callback_function_t callback;
+	bool running = false;
+
+	uint64_t period_ns = 1000000;
+	uint64_t pendingPeriod_ns = 0;
+	uint64_t nextUpdate_ns = 0;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+class HardwareTimer;
+struct TIM_TypeDef;
+
+// Simulated time for the host build. Nothing moves until advance() is called: the clock steps
+// forward and every running HardwareTimer fires its interrupts at the times they fall due, in
+// time order, so step counts seen by MotionControl::updateStepsAndSwitches are exact.
+namespace Simulation {
+	void reset();
+
+	uint64_t getTime_ns();
+	void advance(uint32_t us);
+
+	// Called for every timer update event (i.e. every step pulse on the step pins), with the
+	// simulated time it fired at. Runs before the firmware's own interrupt callback.
+	extern std::function<void(const TIM_TypeDef *, uint64_t time_ns)> onTimerUpdate;
+
+	// The timer peripheral which drives a step pin (as MotionControl::initTimer looks it up)
+	TIM_TypeDef * getTimerForPin(uint32_t pin);
+
+	void addTimer(HardwareTimer *);
+	void removeTimer(HardwareTimer *);
+}
@@ -0,0 +1,664 @@
+// Trajectories of the real MotionControl and KeyframeMotionControl, on the host.
+//
+// Both modules are compiled from PortalFW/src unchanged and driven the way main.cpp drives them:
+// one App::update() pass (motionControlA, motionControlB, then keyframeMotionControl, in that
+// order), a stand-in for the rest of the pass, then HAL_Delay(1). Time is simulated (see
+// shim/Simulation.h), and the step timers fire at their quantised rates as that time passes, so
+// every step MotionControl counts has a timestamp.
+//
+// For each scenario this reports:
+//   - peak step rate on the pin, checked against MOTION_MAX_SPEED
+//   - tracking error of the firmware's position against the reference motion (streams), or
+//     time to settle and overshoot (moves)
+//   - host CPU cost of MotionControl::update() and KeyframeMotionControl::update()
+//
+// The CPU figures are host nanoseconds. They are for comparing one revision of the motion code
+// with another, not a prediction of the Cortex-M0+ (which has no FPU, so calculateMotionState's
+// float deceleration check is soft-float there).
+//
+// Options (for tuning without a wall):
+//   --speed N              maximumSpeed [steps/s] for the stream scenarios (default MOTION_DEFAULT_SPEED)
+//   --acceleration N       acceleration [steps/s^2] for the stream scenarios (default 10000)
+//   --period-ms N          message period of the streams (default 500, the Router's "Period [s]")
+//   --absolute-interval N  keyframe blocks between absolute blocks (default 10, as the Router)
+//   --loss P               packet loss for the lossy keyframe scenario (default 0.1)
+//   --update-us N          time the rest of App::update() takes on target (default 100)
+//   --only NAME            run only the scenarios whose name contains NAME
+//   --trace DIR            write NAME.csv (one row per main loop) and NAME_steps.csv (one row
+//                          per step pulse) for each scenario into DIR
+//
+// Exits non-zero if any check fails.
+//
+// Run: powershell -File run.ps1
+
+#include "Arduino.h"
+#include "Simulation.h"
+
+#include "Modules/App.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Modules;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+int failures = 0;
+int checks = 0;
+
+void check(bool ok, const std::string& scenario, const char* what)
+{
+	checks++;
+	if (!ok) {
+		failures++;
+		std::printf("  FAIL  %s : %s\n", scenario.c_str(), what);
+	}
+}
+
+struct Options {
+	StepsPerSecond maximumSpeed = MOTION_DEFAULT_SPEED;
+	StepsPerSecondPerSecond acceleration = 10000;
+	uint32_t period_ms = 500;
+	int absoluteInterval = 10;
+	double packetLoss = 0.1;
+	uint32_t updateDuration_us = 100;
+	std::string only;
+	std::string traceDirectory;
+};
+
+/// Hands back whatever was written to it (as in PortalBootloader/test-native).
+class LoopbackStream : public msgpack::Stream {
+public:
+	size_t write(uint8_t value) override
+	{
+		data.push_back(value);
+		return 1;
+	}
+
+	size_t write(const uint8_t* buffer, size_t size) override
+	{
+		for (size_t i = 0; i < size; i++) {
+			data.push_back(buffer[i]);
+		}
+		return size;
+	}
+
+	void flush() override {}
+
+	int available() override { return (int)data.size(); }
+
+	int read() override
+	{
+		if (data.empty()) {
+			return -1;
+		}
+		const auto value = data.front();
+		data.pop_front();
+		return value;
+	}
+
+	int peek() override { return data.empty() ? -1 : data.front(); }
+
+private:
+	std::deque<uint8_t> data;
+};
+
+/// The Router's KeyframeEncoder::encodeBlock for a block holding just this portal: int32 LE
+/// absolute values every absoluteInterval blocks (or when a delta doesn't fit), int16 LE
+/// deltas otherwise.
+class KeyframeEncoder {
+public:
+	std::vector<uint8_t> encode(const int32_t values[4], bool velocities, int absoluteInterval)
+	{
+		const int valueCount = velocities ? 4 : 2;
+
+		bool absolute = !this->hasBeenSent || this->blocksSinceAbsolute + 1 >= absoluteInterval;
+		for (int i = 0; i < valueCount && !absolute; i++) {
+			const auto delta = (int64_t)values[i] - (int64_t)this->lastSent[i];
+			absolute = delta < INT16_MIN || delta > INT16_MAX;
+		}
+
+		this->seq++;
+
+		std::vector<uint8_t> data;
+		data.push_back((absolute ? KEYFRAME_FLAG_ABSOLUTE : 0) | (velocities ? KEYFRAME_FLAG_VELOCITIES : 0));
+		data.push_back(this->seq);
+		data.push_back(1); // startIndex (our ID)
+		data.push_back(1); // count
+		data.push_back(1); // bitmap
+		for (int i = 0; i < valueCount; i++) {
+			if (absolute) {
+				const auto raw = (uint32_t)values[i];
+				for (int b = 0; b < 4; b++) {
+					data.push_back((uint8_t)(raw >> (8 * b)));
+				}
+			}
+			else {
+				const auto raw = (uint16_t)(int16_t)(values[i] - this->lastSent[i]);
+				data.push_back((uint8_t)raw);
+				data.push_back((uint8_t)(raw >> 8));
+			}
+			this->lastSent[i] = values[i];
+		}
+		if (!velocities) {
+			this->lastSent[2] = 0;
+			this->lastSent[3] = 0;
+		}
+
+		this->blocksSinceAbsolute = absolute ? 0 : this->blocksSinceAbsolute + 1;
+		this->hasBeenSent = true;
+
+		// msgpack bin8 header, as the body of a "kf" message
+		data.insert(data.begin(), (uint8_t)(data.size()));
+		data.insert(data.begin(), 0xc4);
+		return data;
+	}
+
+private:
+	uint8_t seq = 0;
+	int blocksSinceAbsolute = 0;
+	bool hasBeenSent = false;
+	int32_t lastSent[4] = { 0, 0, 0, 0 };
+};
+
+struct Statistics {
+	std::vector<uint32_t> values;
+
+	void add(uint32_t value) { values.push_back(value); }
+
+	double mean() const
+	{
+		if (values.empty()) {
+			return 0.0;
+		}
+		double sum = 0.0;
+		for (auto value : values) {
+			sum += value;
+		}
+		return sum / values.size();
+	}
+
+	uint32_t percentile(double p)
+	{
+		if (values.empty()) {
+			return 0;
+		}
+		auto index = (size_t)(p * (values.size() - 1));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+};
+
+/// The modules App owns which matter to motion, wired up as App::setup does.
+class Rig {
+public:
+	Rig(const std::string& name, const Options& options)
+	: motorDriverSettings(MotorDriverSettings::Config())
+	, motorDriverA(MotorDriver::Config::MotorA())
+	, motorDriverB(MotorDriver::Config::MotorB())
+	, homeSwitchA(HomeSwitch::Config::A())
+	, homeSwitchB(HomeSwitch::Config::B())
+	, motionControlA(motorDriverSettings, motorDriverA, homeSwitchA)
+	, motionControlB(motorDriverSettings, motorDriverB, homeSwitchB)
+	, options(options)
+	{
+		this->app.id = &this->id;
+		this->app.motorDriverSettings = &this->motorDriverSettings;
+		this->app.motorDriverA = &this->motorDriverA;
+		this->app.motorDriverB = &this->motorDriverB;
+		this->app.homeSwitchA = &this->homeSwitchA;
+		this->app.homeSwitchB = &this->homeSwitchB;
+		this->app.motionControlA = &this->motionControlA;
+		this->app.motionControlB = &this->motionControlB;
+		this->app.keyframeMotionControl = &this->keyframeMotionControl;
+
+		this->timers[0] = Simulation::getTimerForPin(this->motorDriverA.getConfig().StepTimerPin);
+		this->timers[1] = Simulation::getTimerForPin(this->motorDriverB.getConfig().StepTimerPin);
+
+		if (!options.traceDirectory.empty()) {
+			auto path = options.traceDirectory + "/" + name + ".csv";
+			this->trace = std::fopen(path.c_str(), "w");
+			if (this->trace) {
+				std::fprintf(this->trace, "time_us,referenceA,targetA,positionA,referenceB,targetB,positionB\n");
+			}
+
+			path = options.traceDirectory + "/" + name + "_steps.csv";
+			this->stepTrace = std::fopen(path.c_str(), "w");
+			if (this->stepTrace) {
+				std::fprintf(this->stepTrace, "time_ns,axis,motorSteps\n");
+			}
+		}
+
+		Simulation::onTimerUpdate = [this](const TIM_TypeDef* timer, uint64_t time_ns) {
+			this->onStep(timer == this->timers[0] ? 0 : 1, time_ns);
+		};
+	}
+
+	~Rig()
+	{
+		Simulation::onTimerUpdate = nullptr;
+		this->motionControlA.deinitTimer();
+		this->motionControlB.deinitTimer();
+		if (this->trace) {
+			std::fclose(this->trace);
+		}
+		if (this->stepTrace) {
+			std::fclose(this->stepTrace);
+		}
+	}
+
+	MotionControl& axis(int index) { return index == 0 ? this->motionControlA : this->motionControlB; }
+
+	void setProfile(StepsPerSecond maximumSpeed, StepsPerSecondPerSecond acceleration)
+	{
+		for (int i = 0; i < 2; i++) {
+			auto profile = this->axis(i).getMotionProfile();
+			profile.maximumSpeed = maximumSpeed;
+			profile.acceleration = acceleration;
+			this->axis(i).setMotionProfile(profile);
+		}
+	}
+
+	/// One pass of main.cpp's loop()
+	void frame()
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		auto start = Clock::now();
+		this->motionControlA.update();
+		auto afterA = Clock::now();
+		this->motionControlB.update();
+		auto afterB = Clock::now();
+		this->keyframeMotionControl.update();
+		auto end = Clock::now();
+
+		this->motionControlCost.add((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(afterA - start).count());
+		this->motionControlCost.add((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(afterB - afterA).count());
+		this->keyframeCost.add((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - afterB).count());
+
+		Simulation::advance(this->options.updateDuration_us);
+		HAL_Delay(1);
+	}
+
+	void sendKeyframe(const int32_t values[4], bool velocities)
+	{
+		auto data = this->keyframeEncoder.encode(values, velocities, this->options.absoluteInterval);
+		LoopbackStream stream;
+		stream.write(data.data(), data.size());
+		this->keyframeMotionControl.processIncomingBinary(stream);
+	}
+
+	void writeTrace(const double reference[2])
+	{
+		if (!this->trace) {
+			return;
+		}
+		std::fprintf(this->trace, "%llu,%.1f,%d,%d,%.1f,%d,%d\n"
+			, (unsigned long long)(Simulation::getTime_ns() / 1000)
+			, reference[0]
+			, (int)this->motionControlA.getTargetPosition()
+			, (int)this->motionControlA.getPosition()
+			, reference[1]
+			, (int)this->motionControlB.getTargetPosition()
+			, (int)this->motionControlB.getPosition());
+	}
+
+	bool isSettled(int index, Steps target)
+	{
+		return this->axis(index).getPosition() == target && !this->axis(index).getIsRunning();
+	}
+
+	App app;
+	ID id;
+	MotorDriverSettings motorDriverSettings;
+	MotorDriver motorDriverA;
+	MotorDriver motorDriverB;
+	HomeSwitch homeSwitchA;
+	HomeSwitch homeSwitchB;
+	MotionControl motionControlA;
+	MotionControl motionControlB;
+	KeyframeMotionControl keyframeMotionControl;
+
+	struct {
+		int64_t motorSteps = 0;
+		uint64_t lastStep_ns = 0;
+		uint32_t peakRate = 0;
+		size_t stepsOverMaximum = 0;
+	} steps[2];
+
+	Statistics motionControlCost;
+	Statistics keyframeCost;
+protected:
+	void onStep(int index, uint64_t time_ns)
+	{
+		auto& axisSteps = this->steps[index];
+		axisSteps.motorSteps += (index == 0 ? this->motorDriverA : this->motorDriverB).getDirection() ? 1 : -1;
+
+		if (axisSteps.lastStep_ns != 0) {
+			const auto interval_ns = time_ns - axisSteps.lastStep_ns;
+			const auto rate = (uint32_t)((1000000000ULL + interval_ns / 2) / interval_ns);
+			axisSteps.peakRate = std::max(axisSteps.peakRate, rate);
+			if (rate > MOTION_MAX_SPEED) {
+				axisSteps.stepsOverMaximum++;
+			}
+		}
+		axisSteps.lastStep_ns = time_ns;
+
+		if (this->stepTrace) {
+			std::fprintf(this->stepTrace, "%llu,%d,%lld\n"
+				, (unsigned long long)time_ns
+				, index
+				, (long long)axisSteps.motorSteps);
+		}
+	}
+
+	const Options& options;
+	TIM_TypeDef* timers[2];
+	KeyframeEncoder keyframeEncoder;
+	FILE* trace = nullptr;
+	FILE* stepTrace = nullptr;
+};
+
+double seconds()
+{
+	return Simulation::getTime_ns() / 1e9;
+}
+
+void printHeader()
+{
+	std::printf("%-28s %9s %9s %9s %9s %9s %11s %11s\n"
+		, "scenario"
+		, "peak/s"
+		, "settle s"
+		, "overshoot"
+		, "rms err"
+		, "max err"
+		, "mc.update"
+		, "kf.update");
+	std::printf("%-28s %9s %9s %9s %9s %9s %11s %11s\n"
+		, ""
+		, "(steps)"
+		, ""
+		, "(steps)"
+		, "(steps)"
+		, "(steps)"
+		, "ns avg/p99"
+		, "ns avg/p99");
+}
+
+void printRow(const std::string& name, Rig& rig, const char* settle, const char* overshoot, const char* rms, const char* maxError)
+{
+	char mcCost[32];
+	char kfCost[32];
+	std::snprintf(mcCost, sizeof(mcCost), "%.0f/%u", rig.motionControlCost.mean(), rig.motionControlCost.percentile(0.99));
+	std::snprintf(kfCost, sizeof(kfCost), "%.0f/%u", rig.keyframeCost.mean(), rig.keyframeCost.percentile(0.99));
+
+	std::printf("%-28s %9u %9s %9s %9s %9s %11s %11s\n"
+		, name.c_str()
+		, std::max(rig.steps[0].peakRate, rig.steps[1].peakRate)
+		, settle
+		, overshoot
+		, rms
+		, maxError
+		, mcCost
+		, kfCost);
+}
+
+void checkStepRate(const std::string& name, Rig& rig)
+{
+	check(rig.steps[0].stepsOverMaximum == 0 && rig.steps[1].stepsOverMaximum == 0
+		, name
+		, "step rate exceeded MOTION_MAX_SPEED");
+}
+
+/// A point to point move on axis A (optionally retargeted part way through)
+void runMove(const std::string& name
+	, const Options& options
+	, StepsPerSecond maximumSpeed
+	, StepsPerSecondPerSecond acceleration
+	, Steps target
+	, double retargetTime = 0.0
+	, Steps retarget = 0)
+{
+	if (!options.only.empty() && name.find(options.only) == std::string::npos) {
+		return;
+	}
+
+	Simulation::reset();
+	Rig rig(name, options);
+	rig.setProfile(maximumSpeed, acceleration);
+
+	rig.motionControlA.setTargetPosition(target);
+	auto finalTarget = target;
+	Steps legStart = 0;
+	bool retargetPending = retargetTime > 0.0;
+
+	const double timeout = 120.0;
+	double settleTime = -1.0;
+	Steps overshoot = 0;
+	while (seconds() < timeout) {
+		if (retargetPending && seconds() >= retargetTime) {
+			retargetPending = false;
+			finalTarget = retarget;
+			legStart = rig.motionControlA.getPosition();
+			rig.motionControlA.setTargetPosition(retarget);
+		}
+
+		rig.frame();
+
+		const double reference[2] = { (double)finalTarget, 0.0 };
+		rig.writeTrace(reference);
+
+		// How far past the target we went, in the direction of travel
+		const auto direction = finalTarget >= legStart ? 1 : -1;
+		overshoot = std::max(overshoot, (rig.motionControlA.getPosition() - finalTarget) * direction);
+
+		if (!retargetPending && rig.isSettled(0, finalTarget)) {
+			settleTime = seconds();
+			break;
+		}
+	}
+
+	char settle[16];
+	char overshootText[16];
+	std::snprintf(settle, sizeof(settle), settleTime < 0.0 ? "-" : "%.3f", settleTime);
+	std::snprintf(overshootText, sizeof(overshootText), "%d", (int)overshoot);
+	printRow(name, rig, settle, overshootText, "", "");
+
+	check(settleTime >= 0.0, name, "did not settle on the target");
+	if (retargetTime == 0.0) {
+		// Forwards only, so there's no backlash between the pin and MotionControl's position
+		check(rig.steps[0].motorSteps == rig.motionControlA.getPosition(), name, "steps on the pin disagree with MotionControl's position");
+	}
+	checkStepRate(name, rig);
+	check(rig.steps[1].motorSteps == 0, name, "axis B moved");
+}
+
+enum class StreamType {
+	MotionFiltering, // MotionControl::setTargetPositionWithMotionFiltering per message
+	KeyframePositions, // "kf" without velocities
+	KeyframeVelocities // "kf" with velocities (KeyframeMotionControl::update extrapolates)
+};
+
+/// Both axes following a sine (B a quarter cycle behind A), streamed at options.period_ms
+void runStream(const std::string& name, const Options& options, StreamType stream, double packetLoss = 0.0)
+{
+	if (!options.only.empty() && name.find(options.only) == std::string::npos) {
+		return;
+	}
+
+	Simulation::reset();
+	Rig rig(name, options);
+	rig.setProfile(options.maximumSpeed, options.acceleration);
+
+	// An eighth of a turn at 0.05 Hz peaks at ~7,400 steps/s and ~2,300 steps/s^2
+	const double amplitude = rig.motionControlA.getMicrostepsPerPrismRotation() / 8.0;
+	const double period = 20.0;
+	const double duration = 60.0;
+	const double warmup = 2.0;
+	const double omega = 2.0 * PI / period;
+
+	auto reference = [&](int axis, double t) {
+		return amplitude * std::sin(omega * t - axis * PI / 2.0);
+	};
+	auto velocity = [&](int axis, double t) {
+		return amplitude * omega * std::cos(omega * t - axis * PI / 2.0);
+	};
+
+	// Start on the reference
+	rig.motionControlA.setCurrentPosition((Steps)std::lround(reference(0, 0.0)));
+	rig.motionControlB.setCurrentPosition((Steps)std::lround(reference(1, 0.0)));
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+	double nextMessage = 0.0;
+	double sumSquaredError = 0.0;
+	double maxError = 0.0;
+	size_t errorCount = 0;
+
+	while (seconds() < duration) {
+		// Messages are handled by RS485::update(), which App::update() runs before the motion
+		if (seconds() >= nextMessage) {
+			const auto t = nextMessage;
+			nextMessage += options.period_ms / 1000.0;
+
+			if (uniform(random) >= packetLoss) {
+				switch (stream) {
+				case StreamType::MotionFiltering:
+					rig.motionControlA.setTargetPositionWithMotionFiltering((Steps)std::lround(reference(0, t)));
+					rig.motionControlB.setTargetPositionWithMotionFiltering((Steps)std::lround(reference(1, t)));
+					break;
+				case StreamType::KeyframePositions:
+				case StreamType::KeyframeVelocities:
+				{
+					const int32_t values[4] = {
+						(int32_t)std::lround(reference(0, t))
+						, (int32_t)std::lround(reference(1, t))
+						, (int32_t)std::lround(velocity(0, t))
+						, (int32_t)std::lround(velocity(1, t))
+					};
+					rig.sendKeyframe(values, stream == StreamType::KeyframeVelocities);
+					break;
+				}
+				}
+			}
+		}
+
+		rig.frame();
+
+		const double now = seconds();
+		const double references[2] = { reference(0, now), reference(1, now) };
+		rig.writeTrace(references);
+
+		if (now >= warmup) {
+			for (int i = 0; i < 2; i++) {
+				const auto error = std::abs(references[i] - rig.axis(i).getPosition());
+				sumSquaredError += error * error;
+				maxError = std::max(maxError, error);
+				errorCount++;
+			}
+		}
+	}
+
+	char rms[16];
+	char maxErrorText[16];
+	std::snprintf(rms, sizeof(rms), "%.0f", std::sqrt(sumSquaredError / std::max<size_t>(errorCount, 1)));
+	std::snprintf(maxErrorText, sizeof(maxErrorText), "%.0f", maxError);
+	printRow(name, rig, "", "", rms, maxErrorText);
+
+	checkStepRate(name, rig);
+
+	// The planner always trails a moving target (it brakes as though the target were fixed, so
+	// at speed v it runs about v^2 / 2a behind). This bound only catches a stream that stops
+	// being followed at all, it doesn't grade the tuning.
+	check(maxError < amplitude / 2.0, name, "lost the reference");
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--speed" && hasValue) {
+			options.maximumSpeed = std::atoi(argv[++i]);
+		}
+		else if (arg == "--acceleration" && hasValue) {
+			options.acceleration = std::atoi(argv[++i]);
+		}
+		else if (arg == "--period-ms" && hasValue) {
+			options.period_ms = (uint32_t)std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (arg == "--absolute-interval" && hasValue) {
+			options.absoluteInterval = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (arg == "--loss" && hasValue) {
+			options.packetLoss = std::atof(argv[++i]);
+		}
+		else if (arg == "--update-us" && hasValue) {
+			options.updateDuration_us = (uint32_t)std::max(std::atoi(argv[++i]), 0);
+		}
+		else if (arg == "--only" && hasValue) {
+			options.only = argv[++i];
+		}
+		else if (arg == "--trace" && hasValue) {
+			options.traceDirectory = argv[++i];
+		}
+		else {
+			std::printf("Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		return 2;
+	}
+
+	// The profile MotionControl starts with, and fastHomeRoutine's seek profile (24000 / 100000)
+	const MotionControl::MotionProfile defaultProfile;
+	const StepsPerSecond seekSpeed = 24000;
+	const StepsPerSecondPerSecond seekAcceleration = 100000;
+
+	std::printf("Stream scenarios: maximumSpeed %d, acceleration %d, period %u ms, update %u us\n\n"
+		, (int)options.maximumSpeed
+		, (int)options.acceleration
+		, options.period_ms
+		, options.updateDuration_us);
+	printHeader();
+
+	const Steps rotation = 189704; // MotionControl::getMicrostepsPerPrismRotation at 32 microsteps
+
+	runMove("move_quarter_turn", options, defaultProfile.maximumSpeed, defaultProfile.acceleration, rotation / 4);
+	runMove("move_one_turn", options, defaultProfile.maximumSpeed, defaultProfile.acceleration, rotation);
+	runMove("move_short", options, defaultProfile.maximumSpeed, defaultProfile.acceleration, 500);
+	runMove("move_reverse_midway", options, defaultProfile.maximumSpeed, defaultProfile.acceleration, rotation, 3.0, -rotation / 4);
+	runMove("move_seek_profile", options, seekSpeed, seekAcceleration, rotation * 2);
+	runMove("move_max_speed", options, MOTION_MAX_SPEED, seekAcceleration, rotation * 4);
+
+	// update() clamps maximumSpeed to MOTION_MAX_SPEED, so this must not step any faster
+	runMove("move_over_max_speed", options, MOTION_MAX_SPEED * 3 / 2, seekAcceleration, rotation * 4);
+
+	runStream("stream_filtered", options, StreamType::MotionFiltering);
+	runStream("stream_kf_positions", options, StreamType::KeyframePositions);
+	runStream("stream_kf_velocities", options, StreamType::KeyframeVelocities);
+	runStream("stream_kf_velocities_loss", options, StreamType::KeyframeVelocities, options.packetLoss);
+
+	std::printf("\n%d checks, %d failures\n", checks, failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include "pch_App.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Hardware/WorkerPool.h"
+#include "Hardware/KeyframeEncoder.h"
+#include "Hardware/PerPortal/Kinematics.h"
+
+using namespace Modules;
+
+namespace {
+	const size_t columnCount = 32;
+	const size_t portalsPerColumn = 24;
+
+	// Stands in for one Column's share of Installation::update (its Pilots' kinematics and its keyframe blocks)
+	struct ColumnWork {
+		PerPortal::Kinematics::Batch input;
+		PerPortal::Kinematics::Batch batch;
+		KeyframeEncoder encoder;
+		size_t byteCount = 0;
+
+		//----------
+		void
+			fill(uint32_t seed)
+		{
+			this->input.resize(portalsPerColumn);
+
+			uint32_t state = seed;
+			auto random = [&state](float low, float high) {
+				state = state * 1664525u + 1013904223u;
+				return low + (high - low) * (float)(state >> 8) / (float)0x00FFFFFF;
+			};
+
+			for (size_t i = 0; i < portalsPerColumn; i++) {
+				this->input.positionX[i] = random(-1.0f, 1.0f);
+				this->input.positionY[i] = random(-1.0f, 1.0f);
+				this->input.currentA[i] = random(-2.0f, 2.0f);
+				this->input.offset[i] = 0.0f;
+				this->input.microstepsPerPrismRotation[i] = 189696.0f;
+				this->input.cyclic[i] = true;
+			}
+		}
+
+		//----------
+		void
+			update()
+		{
+			this->batch = this->input;
+			PerPortal::Kinematics::solvePositions(this->batch);
+
+			vector<KeyframeEncoder::Values> values(portalsPerColumn);
+			for (size_t i = 0; i < portalsPerColumn; i++) {
+				values[i].values[0] = (int32_t)this->batch.stepsA[i];
+				values[i].values[1] = (int32_t)this->batch.stepsB[i];
+				values[i].values[2] = 0;
+				values[i].values[3] = 0;
+			}
+			auto block = this->encoder.encodeBlock(1, values, false, 10);
+			this->byteCount += block.size();
+		}
+	};
+}
+
+//----------
+// state.range(0) = worker threads (0 = every column on the calling thread, as before)
+static void
+	ColumnsUpdate(benchmark::State& state)
+{
+	vector<ColumnWork> columns(columnCount);
+	for (size_t i = 0; i < columnCount; i++) {
+		columns[i].fill(0x12345678u + (uint32_t)i);
+	}
+
+	WorkerPool workerPool;
+	workerPool.setThreadCount((size_t)state.range(0));
+
+	for (auto _ : state) {
+		workerPool.parallelFor(columns.size(), [&columns](size_t columnIndex) {
+			columns[columnIndex].update();
+			});
+	}
+
+	size_t byteCount = 0;
+	for (const auto& column : columns) {
+		byteCount += column.byteCount;
+	}
+	benchmark::DoNotOptimize(byteCount);
+
+	state.SetItemsProcessed(state.iterations() * columnCount * portalsPerColumn);
+}
+BENCHMARK(ColumnsUpdate)->Arg(0)->Arg(1)->Arg(3)->Arg(7)->UseRealTime();
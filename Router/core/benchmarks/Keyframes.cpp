@@ -0,0 +1,68 @@
+#include "pch_App.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Hardware/KeyframeEncoder.h"
+
+using namespace Modules;
+
+namespace {
+	//----------
+	vector<KeyframeEncoder::Values>
+		makeValues(size_t count, int frame)
+	{
+		vector<KeyframeEncoder::Values> values(count);
+		for (size_t i = 0; i < count; i++) {
+			// Slow drift, so that most entries are deltas
+			values[i].values[0] = (int32_t)(i * 1000 + frame * 7);
+			values[i].values[1] = -(int32_t)(i * 1000 + frame * 5);
+			values[i].values[2] = 7;
+			values[i].values[3] = -5;
+		}
+		return values;
+	}
+}
+
+//----------
+// state.range(0) = absolute interval (1 = every block absolute)
+static void
+	KeyframeBuild(benchmark::State& state)
+{
+	const size_t portalCount = 24;
+	KeyframeEncoder encoder;
+
+	int frame = 0;
+	size_t byteCount = 0;
+	for (auto _ : state) {
+		auto values = makeValues(portalCount, frame++);
+		auto block = encoder.encodeBlock(1, values, true, (int)state.range(0));
+		byteCount += block.size();
+		benchmark::DoNotOptimize(block.data());
+	}
+	state.counters["bytesPerBlock"] = (double)byteCount / (double)state.iterations();
+}
+BENCHMARK(KeyframeBuild)->Arg(1)->Arg(10);
+
+//----------
+// Wrapping the block for the wire, as Column::transmitKeyframe's lazy renderer does
+static void
+	KeyframePacketBuild(benchmark::State& state)
+{
+	const size_t portalCount = 24;
+	KeyframeEncoder encoder;
+
+	int frame = 0;
+	for (auto _ : state) {
+		auto values = makeValues(portalCount, frame++);
+		msgpack11::MsgPack message = msgpack11::MsgPack::array{
+			(int8_t)-1
+			, (int8_t)0
+			, msgpack11::MsgPack::object{
+				{ "kf", encoder.encodeBlock(1, values, true, 10) }
+			}
+		};
+		auto dataString = message.dump();
+		benchmark::DoNotOptimize(dataString.data());
+	}
+}
+BENCHMARK(KeyframePacketBuild);
@@ -0,0 +1,120 @@
+#include "pch_App.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Hardware/PerPortal/Kinematics.h"
+
+using namespace Modules::PerPortal;
+
+namespace {
+	//----------
+	void
+		fillBatch(Kinematics::Batch& batch, size_t count)
+	{
+		batch.resize(count);
+
+		uint32_t state = 0x12345678u;
+		auto random = [&state](float low, float high) {
+			state = state * 1664525u + 1013904223u;
+			return low + (high - low) * (float)(state >> 8) / (float)0x00FFFFFF;
+		};
+
+		for (size_t i = 0; i < count; i++) {
+			batch.positionX[i] = random(-1.0f, 1.0f);
+			batch.positionY[i] = random(-1.0f, 1.0f);
+			batch.currentA[i] = random(-2.0f, 2.0f);
+			batch.offset[i] = 0.0f;
+			batch.microstepsPerPrismRotation[i] = 189696.0f;
+			batch.cyclic[i] = true;
+		}
+	}
+}
+
+//----------
+// state.range(0) = portal count (one column, a 32 column installation, a large wall)
+static void
+	KinematicsSolve(benchmark::State& state)
+{
+	Kinematics::Batch input;
+	fillBatch(input, (size_t)state.range(0));
+
+	Kinematics::Batch batch;
+	for (auto _ : state) {
+		state.PauseTiming();
+		batch = input;
+		state.ResumeTiming();
+
+		Kinematics::solvePositions(batch);
+		benchmark::DoNotOptimize(batch.stepsA.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.SetLabel(Kinematics::isAVX2Enabled() ? "AVX2" : "scalar");
+}
+BENCHMARK(KinematicsSolve)->Arg(24)->Arg(768)->Arg(4096);
+
+namespace {
+	// Mirrors Pilot::Values and its cachedSentValues (the Pilot itself needs openFrameworks)
+	struct PilotValues {
+		float position[2] = { 0, 0 };
+		float polar[2] = { 0, 0 };
+		float axes[2] = { 0, 0 };
+		float sentA = -2;
+		float sentB = -2;
+	};
+}
+
+//----------
+// One frame of Installation::applyPositions then pushStale over plain per-portal values : gather, solve, hand
+// back to the Pilots, then find the stale ones and mark them sent. state.range(0) = portal count
+static void
+	KinematicsFrame(benchmark::State& state)
+{
+	const auto count = (size_t)state.range(0);
+
+	Kinematics::Batch input;
+	fillBatch(input, count);
+
+	vector<PilotValues> pilots(count);
+	Kinematics::Batch batch;
+	size_t staleCount = 0;
+	for (auto _ : state) {
+		// Gather
+		batch.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			batch.positionX[i] = input.positionX[i];
+			batch.positionY[i] = input.positionY[i];
+			batch.currentA[i] = pilots[i].axes[0];
+			batch.offset[i] = input.offset[i];
+			batch.microstepsPerPrismRotation[i] = input.microstepsPerPrismRotation[i];
+			batch.cyclic[i] = input.cyclic[i];
+		}
+
+		Kinematics::solvePositions(batch);
+
+		// Apply and push the stale ones
+		for (size_t i = 0; i < count; i++) {
+			auto& pilot = pilots[i];
+			pilot.position[0] = batch.positionX[i];
+			pilot.position[1] = batch.positionY[i];
+			pilot.polar[0] = batch.r[i];
+			pilot.polar[1] = batch.theta[i];
+			pilot.axes[0] = batch.a[i];
+			pilot.axes[1] = batch.b[i];
+
+			if (pilot.axes[0] != pilot.sentA || pilot.axes[1] != pilot.sentB) {
+				pilot.sentA = pilot.axes[0];
+				pilot.sentB = pilot.axes[1];
+				staleCount++;
+			}
+		}
+
+		// Move the targets along a little so that the next frame is stale again
+		for (size_t i = 0; i < count; i++) {
+			input.positionX[i] = -input.positionX[i];
+		}
+	}
+	benchmark::DoNotOptimize(staleCount);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.SetLabel(Kinematics::isAVX2Enabled() ? "AVX2" : "scalar");
+}
+BENCHMARK(KinematicsFrame)->Arg(24)->Arg(768);
@@ -0,0 +1,32 @@
+#include "pch_App.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Reports/EventRing.h"
+
+using namespace Modules::Reports;
+
+//----------
+// What the serial thread pays per recorded event (push), plus the writer's pop to keep the ring from filling
+static void
+	RecordEvent(benchmark::State& state)
+{
+	EventRing ring(0);
+
+	Event event;
+	event.type = Event::Type::PacketTx;
+	event.portal = 5;
+	event.setAddress("mca/move", 8);
+	event.bytes = 24;
+	event.flag = true;
+
+	Event popped;
+	for (auto _ : state) {
+		event.timestamp_ms = 0;
+		ring.push(event);
+		ring.pop(popped);
+		benchmark::DoNotOptimize(popped.bytes);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RecordEvent);
@@ -0,0 +1,244 @@
+#include "pch_App.h"
+
+#include <benchmark/benchmark.h>
+
+#include "Hardware/RS485Protocol.h"
+#include "Hardware/FrameArena.h"
+#include "Hardware/ReplyDecoder.h"
+#include "Hardware/BusMetrics.h"
+
+using namespace Modules;
+
+namespace {
+	//----------
+	// As Pilot::pushLazy / Portal::sendToPortal
+	RS485Protocol::Packet
+		makeMovePacket(int8_t target, int32_t a, int32_t b)
+	{
+		RS485Protocol::Packet packet(msgpack11::MsgPack::array{
+			target
+			, (int8_t)0
+			, msgpack11::MsgPack::object{
+				{ "m", msgpack11::MsgPack::array{ a, b } }
+			}
+			});
+		packet.target = target;
+		packet.address = "m";
+		return packet;
+	}
+
+	//----------
+	// As RS485::sendPositions in PortalFW
+	RS485Protocol::MsgpackBinary
+		makePositionsReply(int8_t source)
+	{
+		msgpack11::MsgPack message = msgpack11::MsgPack::array{
+			(int8_t)0
+			, source
+			, msgpack11::MsgPack::object{
+				{ "p", msgpack11::MsgPack::array{ (int32_t)94848, (int32_t)-1234, (int32_t)94848, (int32_t)0 } }
+			}
+		};
+		auto dataString = message.dump();
+		RS485Protocol::MsgpackBinary binary(dataString.begin(), dataString.end());
+		RS485Protocol::appendSeqAndCRC(binary, 42);
+		return binary;
+	}
+
+	//----------
+	// As RS485::sendCompactStatusReport in PortalFW (a full report, every field group present)
+	RS485Protocol::MsgpackBinary
+		makeCompactStatusReply(int8_t source)
+	{
+		msgpack11::MsgPack::binary report;
+		auto write = [&report](uint32_t value, size_t byteCount) {
+			for (size_t i = 0; i < byteCount; i++) {
+				report.push_back((uint8_t)(value >> (i * 8)));
+			}
+		};
+
+		write(1, 1); // format version
+		write(0, 1); // flags
+		write(0xFF, 1); // fields
+		write(123456, 4); // upTime
+		for (int i = 0; i < 4; i++) {
+			write(94848, 4); // positions
+		}
+		write(0xFF, 1); // health
+		for (int i = 0; i < 6; i++) {
+			write(10000, 4); // motion profiles
+		}
+		for (int i = 0; i < 2; i++) {
+			write(512, 2); // optical threshold
+			write(3200, 4); // optical width
+		}
+		write(0, 2); // fast home failures
+		write(900, 2); // operating current
+		write(1, 1); // full current home recovery
+		write(1, 1); // settings source
+		write(3, 2); // optical calibration version
+		write(1001, 4); // provision serial
+		string version = "Portal v2024-01-01_12.00 0123abc";
+		write((uint32_t)version.size(), 1);
+		report.insert(report.end(), version.begin(), version.end());
+
+		msgpack11::MsgPack message = msgpack11::MsgPack::array{
+			(int8_t)0
+			, source
+			, msgpack11::MsgPack::object{
+				{ "s", report }
+			}
+		};
+		auto dataString = message.dump();
+		RS485Protocol::MsgpackBinary binary(dataString.begin(), dataString.end());
+		RS485Protocol::appendSeqAndCRC(binary, 42);
+		return binary;
+	}
+}
+
+//----------
+static void
+	PacketBuild(benchmark::State& state)
+{
+	int32_t position = 0;
+	for (auto _ : state) {
+		const auto a = position++;
+		const auto b = -position;
+		auto packet = makeMovePacket(7, a, b);
+		RS485Protocol::appendSeqAndCRC(packet.msgpackBinary, 1);
+		benchmark::DoNotOptimize(packet.msgpackBinary.data());
+	}
+}
+BENCHMARK(PacketBuild);
+
+//----------
+static void
+	COBSEncode(benchmark::State& state)
+{
+	RS485Protocol::MsgpackBinary envelope(state.range(0));
+	for (size_t i = 0; i < envelope.size(); i++) {
+		envelope[i] = (uint8_t)(i * 37);
+	}
+
+	vector<uint8_t> frame;
+	for (auto _ : state) {
+		RS485Protocol::encodeFrame(envelope, frame);
+		benchmark::DoNotOptimize(frame.data());
+	}
+	state.SetBytesProcessed(state.iterations() * envelope.size());
+}
+BENCHMARK(COBSEncode)->Arg(16)->Arg(128)->Arg(1024);
+
+//----------
+// Bytes in, through the rx arena (in place COBS decode), to a peeked envelope
+static void
+	COBSDecode(benchmark::State& state)
+{
+	vector<uint8_t> frame;
+	RS485Protocol::encodeFrame(makePositionsReply(3), frame);
+
+	FrameArena arena;
+	for (auto _ : state) {
+		for (auto byte : frame) {
+			if (byte == 0) {
+				FrameArena::View view;
+				if (arena.decodePending(view) == FrameArena::Result::OK) {
+					int source, seq;
+					RS485Protocol::peekEnvelope(view.data, view.size, source, seq);
+					benchmark::DoNotOptimize(seq);
+					arena.publishPending();
+				}
+			}
+			else {
+				arena.pushByte(byte);
+			}
+		}
+		arena.pop();
+	}
+	state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(COBSDecode);
+
+//----------
+static void
+	DecodeHotReply(benchmark::State& state)
+{
+	auto reply = makePositionsReply(3);
+	for (auto _ : state) {
+		HotReply hotReply;
+		benchmark::DoNotOptimize(decodeHotReply(reply.data(), reply.size(), hotReply));
+	}
+}
+BENCHMARK(DecodeHotReply);
+
+//----------
+static void
+	DecodeCompactStatusReply(benchmark::State& state)
+{
+	auto reply = makeCompactStatusReply(3);
+	for (auto _ : state) {
+		HotReply hotReply;
+		benchmark::DoNotOptimize(decodeHotReply(reply.data(), reply.size(), hotReply));
+	}
+	state.counters["bytes"] = (double)reply.size();
+}
+BENCHMARK(DecodeCompactStatusReply);
+
+//----------
+// The same reply through msgpack11 for comparison
+static void
+	DecodeReplyMsgpack11(benchmark::State& state)
+{
+	auto reply = makePositionsReply(3);
+	string replyString(reply.begin(), reply.end());
+	for (auto _ : state) {
+		string error;
+		auto message = msgpack11::MsgPack::parse(replyString, error);
+		benchmark::DoNotOptimize(message);
+	}
+}
+BENCHMARK(DecodeReplyMsgpack11);
+
+//----------
+// Every portal in a column pushes state.range(0) moves before the serial thread drains the outbox
+static void
+	Collation(benchmark::State& state)
+{
+	const int portalCount = 24;
+	const auto updatesPerPortal = (int)state.range(0);
+
+	RS485Protocol::TxScheduler scheduler;
+	for (auto _ : state) {
+		for (int update = 0; update < updatesPerPortal; update++) {
+			for (int portal = 1; portal <= portalCount; portal++) {
+				scheduler.send(makeMovePacket((int8_t)portal, update, -update));
+			}
+		}
+
+		RS485Protocol::Packet packet;
+		while (scheduler.tryReceive(packet)) {
+			benchmark::DoNotOptimize(packet.msgpackBinary.data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * portalCount * updatesPerPortal);
+}
+BENCHMARK(Collation)->Arg(1)->Arg(10);
+
+//----------
+// What the serial thread pays to record an ACK (column and target histograms) and the send it answers
+static void
+	RecordBusMetrics(benchmark::State& state)
+{
+	auto metrics = make_unique<BusMetrics>();
+
+	uint32_t latency_us = 1000;
+	for (auto _ : state) {
+		latency_us = latency_us * 1664525u + 1013904223u;
+		auto latency = chrono::microseconds(latency_us % 50000);
+		metrics->recordTx(24, latency);
+		metrics->recordACK((int)(latency_us % 32) + 1, latency);
+	}
+	benchmark::DoNotOptimize(metrics->getACKs());
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RecordBusMetrics);
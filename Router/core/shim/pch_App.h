@@ -0,0 +1,52 @@
+#pragma once
+
+// Stand-in for Router/src/pch_App.h when building RouterCore without openFrameworks.
+// Provides the small part of ofMain.h which the core sources use.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// ofConstants.h
+#ifndef TWO_PI
+#	define TWO_PI 6.28318530717958647693
+#endif
+
+// ofMath.h
+inline float
+	ofMap(float value, float inputMin, float inputMax, float outputMin, float outputMax, bool clamp = false)
+{
+	if (fabs(inputMin - inputMax) < numeric_limits<float>::epsilon()) {
+		return outputMin;
+	}
+
+	float outVal = ((value - inputMin) / (inputMax - inputMin) * (outputMax - outputMin) + outputMin);
+
+	if (clamp) {
+		if (outputMax < outputMin) {
+			if (outVal < outputMax) outVal = outputMax;
+			else if (outVal > outputMin) outVal = outputMin;
+		}
+		else {
+			if (outVal > outputMax) outVal = outputMax;
+			else if (outVal < outputMin) outVal = outputMin;
+		}
+	}
+	return outVal;
+}
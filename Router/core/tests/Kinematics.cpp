@@ -0,0 +1,305 @@
+#include "pch_App.h"
+
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Hardware/PerPortal/Kinematics.h"
+
+using namespace Modules;
+using namespace Modules::PerPortal;
+
+// Runs every row of RouterRS/tests-fixtures/pilot-vectors.csv (Pilot.cpp's math built with MSVC, see
+// pilot_oracle.cpp) through the Kinematics stages, once on the scalar path and once on the AVX2 path.
+// Outputs must match bit for bit. The only exception is theta in the positionToPolar rows listed in
+// atan2Exceptions, where atan2f itself differs by 1 ulp between C runtimes.
+//
+// axesToPolar and polarToPosition rows are skipped (Kinematics has no batched form of them).
+
+namespace {
+	struct Row {
+		string line;
+		vector<string> columns;
+	};
+
+	// positionToPolar inputs (x, y as bit patterns) whose theta may be 1 ulp away from the MSVC value.
+	// These are the rows where glibc's atan2f rounds the other way
+	const pair<uint32_t, uint32_t> atan2Exceptions[] = {
+		{ 0xBF800000, 0xBF400000 },
+		{ 0xBF800000, 0x3F400000 },
+		{ 0xBF000000, 0xC0200000 },
+		{ 0xBF000000, 0x3F7FBE77 },
+		{ 0xBF000000, 0x40000000 },
+		{ 0xBE800000, 0xBF800000 },
+		{ 0xBE800000, 0x3F800000 },
+		{ 0x3DCCCCCD, 0x3EAAAA9F },
+		{ 0x3EAAAA9F, 0x40000000 },
+		{ 0x3F000000, 0x3F7FBE77 },
+		{ 0x3F400000, 0x3EAAAA9F },
+		{ 0x3FC00000, 0x3EAAAA9F },
+		{ 0x3FC00000, 0x40500000 },
+		{ 0x40500000, 0xC0200000 },
+	};
+
+	size_t failures = 0;
+
+	//----------
+	float
+		toFloat(const string& hex)
+	{
+		auto bits = (uint32_t)stoul(hex, nullptr, 16);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	//----------
+	uint32_t
+		toBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	//----------
+	// Distance in representable floats (0 if identical)
+	uint32_t
+		ulpDistance(float a, float b)
+	{
+		auto ordered = [](float value) {
+			auto bits = (int32_t)toBits(value);
+			return bits < 0 ? (int64_t)INT32_MIN - bits : (int64_t)bits;
+		};
+		auto distance = ordered(a) - ordered(b);
+		return (uint32_t)(distance < 0 ? -distance : distance);
+	}
+
+	//----------
+	void
+		expect(bool pass, const string& path, const Row& row, const string& what)
+	{
+		if (!pass) {
+			if (failures < 20) {
+				cerr << "[" << path << "] " << what << " : " << row.line << endl;
+			}
+			failures++;
+		}
+	}
+
+	//----------
+	void
+		expectBits(float actual, const string& expectedHex, const string& path, const Row& row, const string& what)
+	{
+		expect(toBits(actual) == toBits(toFloat(expectedHex)), path, row, what);
+	}
+
+	//----------
+	bool
+		isAtan2Exception(const Row& row)
+	{
+		const auto x = toBits(toFloat(row.columns[1]));
+		const auto y = toBits(toFloat(row.columns[2]));
+		for (const auto& exception : atan2Exceptions) {
+			if (exception.first == x && exception.second == y) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//----------
+	void
+		checkPositionToPolar(const vector<Row>& rows, const string& path)
+	{
+		vector<float> x, y;
+		for (const auto& row : rows) {
+			x.push_back(toFloat(row.columns[1]));
+			y.push_back(toFloat(row.columns[2]));
+		}
+
+		vector<float> r(rows.size()), theta(rows.size());
+		Kinematics::positionToPolar(x.data(), y.data(), r.data(), theta.data(), rows.size());
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			const auto& row = rows[i];
+			expectBits(r[i], row.columns[4], path, row, "r");
+			if (isAtan2Exception(row)) {
+				expect(ulpDistance(theta[i], toFloat(row.columns[5])) <= 1, path, row, "theta (1 ulp allowed)");
+			}
+			else {
+				expectBits(theta[i], row.columns[5], path, row, "theta");
+			}
+		}
+	}
+
+	//----------
+	void
+		checkPolarToAxes(const vector<Row>& rows, const string& path)
+	{
+		vector<float> r, theta, offset;
+		for (const auto& row : rows) {
+			r.push_back(toFloat(row.columns[1]));
+			theta.push_back(toFloat(row.columns[2]));
+			offset.push_back(toFloat(row.columns[3]));
+		}
+
+		vector<float> a(rows.size()), b(rows.size());
+		Kinematics::polarToAxes(r.data(), theta.data(), offset.data(), a.data(), b.data(), rows.size());
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			expectBits(a[i], rows[i].columns[4], path, rows[i], "a");
+			expectBits(b[i], rows[i].columns[5], path, rows[i], "b");
+		}
+	}
+
+	//----------
+	void
+		checkFindClosestAxesCycle(const vector<Row>& rows, const string& path)
+	{
+		vector<float> a, b, currentA;
+		for (const auto& row : rows) {
+			a.push_back(toFloat(row.columns[1]));
+			b.push_back(toFloat(row.columns[2]));
+			currentA.push_back(toFloat(row.columns[3]));
+		}
+		vector<uint8_t> cyclic(rows.size(), 1);
+
+		Kinematics::findClosestAxesCycle(a.data(), b.data(), currentA.data(), cyclic.data(), rows.size());
+
+		for (size_t i = 0; i < rows.size(); i++) {
+			expectBits(a[i], rows[i].columns[4], path, rows[i], "a");
+			expectBits(b[i], rows[i].columns[5], path, rows[i], "b");
+		}
+	}
+
+	//----------
+	// axisToSteps rows are [axis, axisIndex, microsteps, steps], stepsToAxis rows are [steps, axisIndex, microsteps, axis]
+	void
+		checkSteps(const vector<Row>& axisToStepsRows, const vector<Row>& stepsToAxisRows, const string& path)
+	{
+		for (int axisIndex = 0; axisIndex < 2; axisIndex++) {
+			{
+				vector<const Row*> rows;
+				vector<float> axis, microsteps;
+				for (const auto& row : axisToStepsRows) {
+					if (stoi(row.columns[2]) == axisIndex) {
+						rows.push_back(&row);
+						axis.push_back(toFloat(row.columns[1]));
+						microsteps.push_back((float)stoi(row.columns[3]));
+					}
+				}
+
+				vector<Steps> steps(rows.size());
+				Kinematics::axisToSteps(axis.data(), microsteps.data(), axisIndex, steps.data(), rows.size());
+
+				for (size_t i = 0; i < rows.size(); i++) {
+					expect(steps[i] == (Steps)stoi(rows[i]->columns[4]), path, *rows[i], "steps");
+				}
+			}
+			{
+				vector<const Row*> rows;
+				vector<Steps> steps;
+				vector<float> microsteps;
+				for (const auto& row : stepsToAxisRows) {
+					if (stoi(row.columns[2]) == axisIndex) {
+						rows.push_back(&row);
+						steps.push_back((Steps)stoi(row.columns[1]));
+						microsteps.push_back((float)stoi(row.columns[3]));
+					}
+				}
+
+				vector<float> axis(rows.size());
+				Kinematics::stepsToAxis(steps.data(), microsteps.data(), axisIndex, axis.data(), rows.size());
+
+				for (size_t i = 0; i < rows.size(); i++) {
+					expectBits(axis[i], rows[i]->columns[4], path, *rows[i], "axis");
+				}
+			}
+		}
+	}
+}
+
+//----------
+int
+	main(int argc, char** argv)
+{
+	if (argc < 2) {
+		cerr << "Usage : RouterCoreTests path/to/pilot-vectors.csv" << endl;
+		return 2;
+	}
+
+	ifstream file(argv[1]);
+	if (!file) {
+		cerr << "Could not open " << argv[1] << endl;
+		return 2;
+	}
+
+	map<string, vector<Row>> rowsByFunction;
+	size_t rowCount = 0;
+	{
+		string line;
+		getline(file, line); // header
+		while (getline(file, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (line.empty()) {
+				continue;
+			}
+
+			Row row;
+			row.line = line;
+			stringstream stream(line);
+			string column;
+			while (getline(stream, column, ',')) {
+				row.columns.push_back(column);
+			}
+			row.columns.resize(6);
+
+			rowsByFunction[row.columns[0]].push_back(row);
+			rowCount++;
+		}
+	}
+
+	if (rowCount < 6000) {
+		cerr << "Expected the full golden table, got " << rowCount << " rows" << endl;
+		return 1;
+	}
+
+	vector<pair<string, bool>> paths{ { "scalar", false } };
+	{
+		Kinematics::setAVX2Enabled(true);
+		if (Kinematics::isAVX2Enabled()) {
+			paths.push_back({ "AVX2", true });
+		}
+		else {
+			cout << "AVX2 isn't available, only checking the scalar path" << endl;
+		}
+	}
+
+	size_t checkedCount = 0;
+	for (const auto& function : { "positionToPolar", "polarToAxes", "findClosestAxesCycle", "axisToSteps", "stepsToAxis" }) {
+		checkedCount += rowsByFunction[function].size();
+	}
+
+	for (const auto& path : paths) {
+		Kinematics::setAVX2Enabled(path.second);
+
+		checkPositionToPolar(rowsByFunction["positionToPolar"], path.first);
+		checkPolarToAxes(rowsByFunction["polarToAxes"], path.first);
+		checkFindClosestAxesCycle(rowsByFunction["findClosestAxesCycle"], path.first);
+		checkSteps(rowsByFunction["axisToSteps"], rowsByFunction["stepsToAxis"], path.first);
+	}
+	Kinematics::setAVX2Enabled(true);
+
+	if (failures > 0) {
+		cerr << failures << " mismatches" << endl;
+		return 1;
+	}
+
+	cout << checkedCount << " of " << rowCount << " rows checked on the " << paths.size() << " path(s)" << endl;
+	return 0;
+}
@@ -69,6 +69,7 @@ namespace Modules {
 			this->installation = make_shared<Hardware::Installation>();
 			this->oscReceiver = make_shared<OSC::Receiver>();
 			this->restServer = make_shared<REST::Server>();
+			this->recorder = make_shared<Reports::Recorder>();
 
 			// Add them to the modules list
 			this->modules = {
@@ -76,6 +77,7 @@ namespace Modules {
 				, this->installation
 				, this->oscReceiver
 				, this->restServer
+				, this->recorder
 			};
 		}
 
@@ -243,4 +245,11 @@ namespace Modules {
 	{
 		return this->renderer;
 	}
+
+	//----------
+	shared_ptr<Reports::Recorder>
+		App::getRecorder()
+	{
+		return this->recorder;
+	}
 }
\ No newline at end of file
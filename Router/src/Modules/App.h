@@ -7,6 +7,7 @@
 #include "Hardware/Installation.h"
 #include "OSC/Receiver.h"
 #include "REST/Server.h"
+#include "Reports/Recorder.h"
 
 #include "ofxNetwork.h"
 
@@ -30,6 +31,7 @@ namespace Modules {
 
 		shared_ptr<Hardware::Installation> getInstallation();
 		shared_ptr<Image::Renderer> getImageRenderer();
+		shared_ptr<Reports::Recorder> getRecorder();
 	protected:
 		static shared_ptr<App> instance;
 
@@ -38,6 +40,7 @@ namespace Modules {
 		shared_ptr<Hardware::Installation> installation;
 		shared_ptr<OSC::Receiver> oscReceiver;
 		shared_ptr<REST::Server> restServer;
+		shared_ptr<Reports::Recorder> recorder;
 
 		ofxCvGui::PanelGroupPtr placeholderView;
 	};
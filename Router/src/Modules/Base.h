@@ -1,12 +1,9 @@
 #pragma once
 
 #include "ofxCvGui.h"
+#include "Types.h"
 
 namespace Modules {
-	typedef int32_t Steps;
-	typedef int32_t StepsPerSecond;
-	typedef int32_t StepsPerSecondPerSecond;
-
 	class Base : public ofxCvGui::IInspectable
 	{
 	public:
@@ -0,0 +1,524 @@
+#include "pch_App.h"
+#include "BusMetrics.h"
+
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Modules {
+	namespace {
+		//----------
+		int
+			floorLog2(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return (int)index;
+#else
+			return 63 - __builtin_clzll(value);
+#endif
+		}
+
+		//----------
+		void
+			atomicMax(std::atomic<uint64_t>& target, uint64_t value)
+		{
+			auto current = target.load(std::memory_order_relaxed);
+			while (value > current
+				&& !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+			}
+		}
+
+		//----------
+		void
+			appendSample(std::string& out, const char* name, const std::string& labels, double value)
+		{
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "%.9g", value);
+			out += name;
+			out += "{" + labels + "} ";
+			out += buffer;
+			out += "\n";
+		}
+
+		//----------
+		void
+			appendFamily(std::string& out, const char* name, const char* type, const char* help)
+		{
+			out += "# HELP ";
+			out += name;
+			out += " ";
+			out += help;
+			out += "\n# TYPE ";
+			out += name;
+			out += " ";
+			out += type;
+			out += "\n";
+		}
+
+		//----------
+		void
+			appendSummary(std::string& out, const char* name, const std::string& labels, const LatencyHistogram& histogram)
+		{
+			const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+			for (auto quantile : quantiles) {
+				char quantileLabel[32];
+				snprintf(quantileLabel, sizeof(quantileLabel), ",quantile=\"%g\"", quantile);
+				appendSample(out, name, labels + quantileLabel, (double)histogram.getPercentile_us(quantile) / 1e6);
+			}
+			appendSample(out, (std::string(name) + "_sum").c_str(), labels, (double)histogram.getSum_us() / 1e6);
+			appendSample(out, (std::string(name) + "_count").c_str(), labels, (double)histogram.getCount());
+		}
+
+		//----------
+		std::string
+			columnLabel(size_t column)
+		{
+			return "column=\"" + std::to_string(column) + "\"";
+		}
+	}
+
+#pragma mark LatencyHistogram
+	//----------
+	void
+		LatencyHistogram::record(std::chrono::steady_clock::duration duration)
+	{
+		auto value_us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		this->record_us(value_us > 0 ? (uint64_t)value_us : 0);
+	}
+
+	//----------
+	void
+		LatencyHistogram::record_us(uint64_t value_us)
+	{
+		this->counts[LatencyHistogram::getBucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+		this->count.fetch_add(1, std::memory_order_relaxed);
+		this->sum_us.fetch_add(value_us, std::memory_order_relaxed);
+		atomicMax(this->max_us, value_us);
+	}
+
+	//----------
+	void
+		LatencyHistogram::clear()
+	{
+		for (auto& count : this->counts) {
+			count.store(0, std::memory_order_relaxed);
+		}
+		this->count = 0;
+		this->sum_us = 0;
+		this->max_us = 0;
+	}
+
+	//----------
+	uint64_t
+		LatencyHistogram::getCount() const
+	{
+		return this->count.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		LatencyHistogram::getSum_us() const
+	{
+		return this->sum_us.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		LatencyHistogram::getMax_us() const
+	{
+		return this->max_us.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		LatencyHistogram::getPercentile_us(double p) const
+	{
+		// Total from the buckets themselves, since count may run ahead of them whilst we read
+		uint64_t counts[bucketCount];
+		uint64_t total = 0;
+		for (size_t i = 0; i < bucketCount; i++) {
+			counts[i] = this->counts[i].load(std::memory_order_relaxed);
+			total += counts[i];
+		}
+		if (total == 0) {
+			return 0;
+		}
+
+		auto rank = (uint64_t)ceil(p * (double)total);
+		rank = max<uint64_t>(min<uint64_t>(rank, total), 1);
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < bucketCount; i++) {
+			seen += counts[i];
+			if (seen >= rank) {
+				auto upperEdge = i + 1 < bucketCount
+					? LatencyHistogram::getBucketLowerEdge_us(i + 1) - 1
+					: this->getMax_us();
+				return min(upperEdge, this->getMax_us());
+			}
+		}
+		return this->getMax_us();
+	}
+
+	//----------
+	size_t
+		LatencyHistogram::getBucketIndex(uint64_t value_us)
+	{
+		// Values below subBucketCount get a bucket each
+		if (value_us < subBucketCount) {
+			return (size_t)value_us;
+		}
+
+		auto exponent = floorLog2(value_us);
+		if (exponent >= maxExponent) {
+			return bucketCount - 1;
+		}
+
+		// The bits just below the leading one pick the sub-bucket
+		auto subBucket = (size_t)(value_us >> (exponent - subBucketBits)) & (subBucketCount - 1);
+		return (size_t)(exponent - subBucketBits + 1) * subBucketCount + subBucket;
+	}
+
+	//----------
+	uint64_t
+		LatencyHistogram::getBucketLowerEdge_us(size_t index)
+	{
+		if (index < subBucketCount) {
+			return index;
+		}
+
+		auto exponent = (int)(index / subBucketCount) + subBucketBits - 1;
+		auto subBucket = (uint64_t)(index % subBucketCount);
+		return (subBucketCount + subBucket) << (exponent - subBucketBits);
+	}
+
+#pragma mark BusMetrics
+	//----------
+	void
+		BusMetrics::recordTx(size_t bytes, std::chrono::steady_clock::duration outboxDwell)
+	{
+		this->txPackets.fetch_add(1, std::memory_order_relaxed);
+		this->txBytes.fetch_add(bytes, std::memory_order_relaxed);
+		this->outboxDwell.record(outboxDwell);
+	}
+
+	//----------
+	void
+		BusMetrics::recordRxBytes(size_t bytes)
+	{
+		this->rxBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	//----------
+	void
+		BusMetrics::recordRxFrame()
+	{
+		this->rxPackets.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//----------
+	void
+		BusMetrics::recordACK(int target, std::chrono::steady_clock::duration latency)
+	{
+		this->acks.fetch_add(1, std::memory_order_relaxed);
+		this->ackLatency.record(latency);
+
+		if (target >= 0 && target < (int)targetCount) {
+			auto& targetMetrics = this->targets[target];
+			targetMetrics.acks.fetch_add(1, std::memory_order_relaxed);
+			targetMetrics.ackLatency.record(latency);
+		}
+	}
+
+	//----------
+	void
+		BusMetrics::recordTimeout(int target)
+	{
+		this->timeouts.fetch_add(1, std::memory_order_relaxed);
+
+		if (target >= 0 && target < (int)targetCount) {
+			this->targets[target].timeouts.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	//----------
+	void
+		BusMetrics::recordCOBSError()
+	{
+		this->cobsErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//----------
+	void
+		BusMetrics::recordCRCError()
+	{
+		this->crcErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//----------
+	void
+		BusMetrics::recordMsgpackError()
+	{
+		this->msgpackErrors.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//----------
+	void
+		BusMetrics::updateRates()
+	{
+		auto now = std::chrono::steady_clock::now();
+		auto window_s = std::chrono::duration<float>(now - this->lastSample.time).count();
+		if (window_s <= 0.0f) {
+			return;
+		}
+
+		auto txBytes = this->getTxBytes();
+		auto rxBytes = this->getRxBytes();
+		auto acks = this->getACKs();
+		auto timeouts = this->getTimeouts();
+
+		// Counters can go backwards if they were cleared since the last sample
+		auto delta = [](uint64_t current, uint64_t last) {
+			return current >= last ? current - last : current;
+		};
+
+		this->txBytesPerSecond = (float)delta(txBytes, this->lastSample.txBytes) / window_s;
+		this->rxBytesPerSecond = (float)delta(rxBytes, this->lastSample.rxBytes) / window_s;
+		{
+			auto windowACKs = delta(acks, this->lastSample.acks);
+			auto windowTimeouts = delta(timeouts, this->lastSample.timeouts);
+			this->timeoutRate = windowACKs + windowTimeouts > 0
+				? (float)windowTimeouts / (float)(windowACKs + windowTimeouts)
+				: 0.0f;
+		}
+
+		this->lastSample.time = now;
+		this->lastSample.txBytes = txBytes;
+		this->lastSample.rxBytes = rxBytes;
+		this->lastSample.acks = acks;
+		this->lastSample.timeouts = timeouts;
+	}
+
+	//----------
+	void
+		BusMetrics::clear()
+	{
+		this->ackLatency.clear();
+		this->outboxDwell.clear();
+		for (auto& target : this->targets) {
+			target.ackLatency.clear();
+			target.acks = 0;
+			target.timeouts = 0;
+		}
+
+		this->txPackets = 0;
+		this->txBytes = 0;
+		this->rxPackets = 0;
+		this->rxBytes = 0;
+		this->acks = 0;
+		this->timeouts = 0;
+		this->cobsErrors = 0;
+		this->crcErrors = 0;
+		this->msgpackErrors = 0;
+	}
+
+	//----------
+	const LatencyHistogram&
+		BusMetrics::getACKLatency() const
+	{
+		return this->ackLatency;
+	}
+
+	//----------
+	const LatencyHistogram&
+		BusMetrics::getOutboxDwell() const
+	{
+		return this->outboxDwell;
+	}
+
+	//----------
+	const BusMetrics::TargetMetrics&
+		BusMetrics::getTarget(int target) const
+	{
+		return this->targets[(size_t)target % targetCount];
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getTxPackets() const
+	{
+		return this->txPackets.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getTxBytes() const
+	{
+		return this->txBytes.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getRxPackets() const
+	{
+		return this->rxPackets.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getRxBytes() const
+	{
+		return this->rxBytes.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getACKs() const
+	{
+		return this->acks.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getTimeouts() const
+	{
+		return this->timeouts.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getCOBSErrors() const
+	{
+		return this->cobsErrors.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getCRCErrors() const
+	{
+		return this->crcErrors.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	uint64_t
+		BusMetrics::getMsgpackErrors() const
+	{
+		return this->msgpackErrors.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	float
+		BusMetrics::getTxBytesPerSecond() const
+	{
+		return this->txBytesPerSecond.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	float
+		BusMetrics::getRxBytesPerSecond() const
+	{
+		return this->rxBytesPerSecond.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	float
+		BusMetrics::getTimeoutRate() const
+	{
+		return this->timeoutRate.load(std::memory_order_relaxed);
+	}
+
+	//----------
+	std::string
+		BusMetrics::toPrometheus(const std::vector<std::pair<size_t, std::shared_ptr<const BusMetrics>>>& buses)
+	{
+		std::string out;
+
+		// Each family's samples must be together, so we go family by family across the buses
+		appendFamily(out, "router_ack_latency_seconds", "summary", "Time from a packet leaving on the bus to its ACK");
+		for (const auto& bus : buses) {
+			appendSummary(out, "router_ack_latency_seconds", columnLabel(bus.first), bus.second->getACKLatency());
+		}
+
+		appendFamily(out, "router_target_ack_latency_seconds", "summary", "ACK latency of each target which has replied");
+		for (const auto& bus : buses) {
+			for (size_t target = 0; target < targetCount; target++) {
+				const auto& targetMetrics = bus.second->getTarget((int)target);
+				if (targetMetrics.ackLatency.getCount() == 0) {
+					continue;
+				}
+				appendSummary(out, "router_target_ack_latency_seconds"
+					, columnLabel(bus.first) + ",target=\"" + std::to_string(target) + "\""
+					, targetMetrics.ackLatency);
+			}
+		}
+
+		appendFamily(out, "router_outbox_dwell_seconds", "summary", "Time from transmit() to the packet going out on the bus");
+		for (const auto& bus : buses) {
+			appendSummary(out, "router_outbox_dwell_seconds", columnLabel(bus.first), bus.second->getOutboxDwell());
+		}
+
+		struct Counter {
+			const char* name;
+			const char* help;
+			uint64_t(BusMetrics::* get)() const;
+		};
+		const Counter counters[] = {
+			{ "router_tx_packets_total", "Packets sent on the bus", &BusMetrics::getTxPackets }
+			, { "router_tx_bytes_total", "Bytes sent on the bus (COBS encoded)", &BusMetrics::getTxBytes }
+			, { "router_rx_packets_total", "Frames received from the bus which passed COBS and CRC checks", &BusMetrics::getRxPackets }
+			, { "router_rx_bytes_total", "Bytes received from the bus (COBS encoded)", &BusMetrics::getRxBytes }
+			, { "router_acks_total", "Packets which were ACKed", &BusMetrics::getACKs }
+			, { "router_ack_timeouts_total", "Packets whose ACK never came", &BusMetrics::getTimeouts }
+		};
+		for (const auto& counter : counters) {
+			appendFamily(out, counter.name, "counter", counter.help);
+			for (const auto& bus : buses) {
+				appendSample(out, counter.name, columnLabel(bus.first), (double)((*bus.second).*counter.get)());
+			}
+		}
+
+		appendFamily(out, "router_target_ack_timeouts_total", "counter", "Packets to each target whose ACK never came");
+		for (const auto& bus : buses) {
+			for (size_t target = 0; target < targetCount; target++) {
+				auto timeouts = bus.second->getTarget((int)target).timeouts.load(std::memory_order_relaxed);
+				if (timeouts == 0) {
+					continue;
+				}
+				appendSample(out, "router_target_ack_timeouts_total"
+					, columnLabel(bus.first) + ",target=\"" + std::to_string(target) + "\""
+					, (double)timeouts);
+			}
+		}
+
+		appendFamily(out, "router_decode_errors_total", "counter", "Frames from the bus which couldn't be decoded");
+		for (const auto& bus : buses) {
+			auto labels = columnLabel(bus.first);
+			appendSample(out, "router_decode_errors_total", labels + ",kind=\"cobs\"", (double)bus.second->getCOBSErrors());
+			appendSample(out, "router_decode_errors_total", labels + ",kind=\"crc\"", (double)bus.second->getCRCErrors());
+			appendSample(out, "router_decode_errors_total", labels + ",kind=\"msgpack\"", (double)bus.second->getMsgpackErrors());
+		}
+
+		struct Gauge {
+			const char* name;
+			const char* help;
+			float(BusMetrics::* get)() const;
+		};
+		const Gauge gauges[] = {
+			{ "router_tx_bytes_per_second", "Bytes sent per second over the last second", &BusMetrics::getTxBytesPerSecond }
+			, { "router_rx_bytes_per_second", "Bytes received per second over the last second", &BusMetrics::getRxBytesPerSecond }
+			, { "router_ack_timeout_ratio", "Timeouts / (ACKs + timeouts) over the last second", &BusMetrics::getTimeoutRate }
+		};
+		for (const auto& gauge : gauges) {
+			appendFamily(out, gauge.name, "gauge", gauge.help);
+			for (const auto& bus : buses) {
+				appendSample(out, gauge.name, columnLabel(bus.first), (double)((*bus.second).*gauge.get)());
+			}
+		}
+
+		return out;
+	}
+}
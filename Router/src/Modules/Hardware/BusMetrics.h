@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Modules {
+	/// <summary>
+	/// HDR-style histogram of durations in microseconds. Each power of two is split into 16 linear sub-buckets
+	/// (so any value is within 1/16 of its bucket's edges) from 1us up to 2^24us (~17s), above which values
+	/// land in the last bucket. record() is a handful of relaxed atomic adds, so any thread can record
+	/// whilst any other reads.
+	/// </summary>
+	class LatencyHistogram {
+	public:
+		static const int subBucketBits = 4;
+		static const int maxExponent = 24;
+		static const size_t subBucketCount = (size_t)1 << subBucketBits;
+		static const size_t bucketCount = (maxExponent - subBucketBits + 1) * subBucketCount;
+
+		void record(std::chrono::steady_clock::duration);
+		void record_us(uint64_t);
+		void clear();
+
+		uint64_t getCount() const;
+		uint64_t getSum_us() const;
+		uint64_t getMax_us() const;
+
+		// Upper edge of the bucket holding the p'th value (0 if empty), never more than the max seen
+		uint64_t getPercentile_us(double p) const;
+
+		static size_t getBucketIndex(uint64_t value_us);
+		static uint64_t getBucketLowerEdge_us(size_t index);
+	protected:
+		std::atomic<uint32_t> counts[bucketCount] = {};
+		std::atomic<uint64_t> count{ 0 };
+		std::atomic<uint64_t> sum_us{ 0 };
+		std::atomic<uint64_t> max_us{ 0 };
+	};
+
+	/// <summary>
+	/// Timing and throughput of one bus (a column's RS485) and of each target on it. The serial thread records
+	/// as it sends / receives, the main thread records msgpack failures and samples the rates, and anybody
+	/// (e.g. the REST server's thread for GET /metrics) can read.
+	/// </summary>
+	class BusMetrics {
+	public:
+		static const size_t targetCount = 128;
+
+		struct TargetMetrics {
+			LatencyHistogram ackLatency;
+			std::atomic<uint64_t> acks{ 0 };
+			std::atomic<uint64_t> timeouts{ 0 };
+		};
+
+		// Recording
+		void recordTx(size_t bytes, std::chrono::steady_clock::duration outboxDwell);
+		void recordRxBytes(size_t bytes);
+		void recordRxFrame();
+		void recordACK(int target, std::chrono::steady_clock::duration latency);
+		void recordTimeout(int target);
+		void recordCOBSError();
+		void recordCRCError();
+		void recordMsgpackError();
+
+		// Call about once a second (main thread) to update the rates
+		void updateRates();
+
+		void clear();
+
+		const LatencyHistogram& getACKLatency() const;
+		const LatencyHistogram& getOutboxDwell() const;
+		const TargetMetrics& getTarget(int target) const;
+
+		uint64_t getTxPackets() const;
+		uint64_t getTxBytes() const;
+		uint64_t getRxPackets() const;
+		uint64_t getRxBytes() const;
+		uint64_t getACKs() const;
+		uint64_t getTimeouts() const;
+		uint64_t getCOBSErrors() const;
+		uint64_t getCRCErrors() const;
+		uint64_t getMsgpackErrors() const;
+
+		// Over the last updateRates window
+		float getTxBytesPerSecond() const;
+		float getRxBytesPerSecond() const;
+		float getTimeoutRate() const; // timeouts / (ACKs + timeouts)
+
+		// Prometheus text exposition format for a set of buses, labelled by column
+		static std::string toPrometheus(const std::vector<std::pair<size_t, std::shared_ptr<const BusMetrics>>>&);
+	protected:
+		LatencyHistogram ackLatency;
+		LatencyHistogram outboxDwell;
+		TargetMetrics targets[targetCount];
+
+		std::atomic<uint64_t> txPackets{ 0 };
+		std::atomic<uint64_t> txBytes{ 0 };
+		std::atomic<uint64_t> rxPackets{ 0 };
+		std::atomic<uint64_t> rxBytes{ 0 };
+		std::atomic<uint64_t> acks{ 0 };
+		std::atomic<uint64_t> timeouts{ 0 };
+		std::atomic<uint64_t> cobsErrors{ 0 };
+		std::atomic<uint64_t> crcErrors{ 0 };
+		std::atomic<uint64_t> msgpackErrors{ 0 };
+
+		std::atomic<float> txBytesPerSecond{ 0.0f };
+		std::atomic<float> rxBytesPerSecond{ 0.0f };
+		std::atomic<float> timeoutRate{ 0.0f };
+
+		// Only used by updateRates
+		struct {
+			std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+			uint64_t txBytes = 0;
+			uint64_t rxBytes = 0;
+			uint64_t acks = 0;
+			uint64_t timeouts = 0;
+		} lastSample;
+	};
+}
@@ -53,6 +53,13 @@ namespace Modules {
 		return ofToString(this->columnIndex);
 	}
 
+	//----------
+	size_t
+		Column::getIndex() const
+	{
+		return this->columnIndex;
+	}
+
 	//----------
 	void
 		Column::deserialise(const nlohmann::json& json)
@@ -83,16 +90,22 @@ namespace Modules {
 
 	//----------
 	void
-		Column::update()
+		Column::updateBus()
 	{
 		if (this->portalsByIDDirty) {
 			this->refreshPortalsByID();
 		}
 
+		// The inbox is processed here (replies set the portals' parameters)
 		for (auto module : this->submodules) {
 			module->update();
 		}
+	}
 
+	//----------
+	void
+		Column::update()
+	{
 		for (auto portal : this->portals) {
 			portal->update();
 		}
@@ -106,14 +119,79 @@ namespace Modules {
 		}
 	}
 
+	//----------
+	void
+		Column::updateGUI()
+	{
+		for (auto portal : this->portals) {
+			portal->updateGUI();
+		}
+	}
+
 	//----------
 	void
 		Column::pushStale()
 	{
+		auto installation = App::X()->getInstallation();
+
+		// Gather the stale portals into broadcast "mm" messages
+		if (installation->getBatchMovesEnabled()) {
+			// Anything still waiting in the outbox is re-batched below (values are only marked as sent when rendered)
+			this->rs485->removePacketsFromOutbox("mm", -1);
+
+			auto batchSize = (size_t)max(installation->getMoveBatchSize(), 1);
+			auto replySlot_us = this->rs485->scaleReplySlot_us((uint32_t)max(installation->getReplySlot_us(), 0));
+
+			vector<shared_ptr<Portal>> batch;
+			auto transmitBatch = [&]() {
+				RS485::Packet packet([batch, replySlot_us]() {
+					msgpack11::MsgPack::array entries;
+					entries.push_back((int32_t)replySlot_us);
+					for (auto portal : batch) {
+						entries.push_back(portal->getPilot()->renderBatchedMove());
+					}
+
+					return msgpack11::MsgPack::array{
+						-1
+						, (int8_t)0
+						, msgpack11::MsgPack::object{
+							{ "mm", entries }
+						}
+					};
+					});
+				packet.address = "mm";
+				packet.needsACK = false;
+				packet.collateable = false;
+
+				// Each portal replies in the slot matching its index in the batch
+				for (size_t i = 0; i < batch.size(); i++) {
+					packet.replySlots.push_back({ batch[i]->getTarget(), (int)i });
+				}
+				packet.replySlot_us = replySlot_us;
+
+				this->rs485->transmit(packet);
+				batch.clear();
+			};
+
+			for (auto portal : this->portals) {
+				if (portal->getPilot()->needsPush()) {
+					batch.push_back(portal);
+					if (batch.size() >= batchSize) {
+						transmitBatch();
+					}
+				}
+			}
+			if (!batch.empty()) {
+				transmitBatch();
+			}
+		}
+
 		// Check them individually and just push the ones that are stale
-		for (auto portal : this->portals) {
-			if (portal->getPilot()->needsPush()) {
-				portal->getPilot()->pushLazy();
+		else {
+			for (auto portal : this->portals) {
+				if (portal->getPilot()->needsPush()) {
+					portal->getPilot()->pushLazy();
+				}
 			}
 		}
 	}
@@ -285,6 +363,19 @@ namespace Modules {
 	}
 
 
+	//----------
+	void
+		Column::processIncoming(const HotReply& reply)
+	{
+		// Route message to portal
+		if (reply.target == 0) {
+			auto findPortal = this->portalsByID.find(reply.source);
+			if (findPortal != this->portalsByID.end()) {
+				findPortal->second->processIncoming(reply);
+			}
+		}
+	}
+
 	//----------
 	void
 		Column::rebuildPortals()
@@ -367,8 +458,56 @@ namespace Modules {
 	void
 		Column::pollAll()
 	{
-		for (auto portal : this->portals) {
-			portal->poll();
+		const auto& scheduledPoll = this->parameters.scheduledPoll;
+		const auto compact = scheduledPoll.compact.get();
+		const auto changedOnly = compact
+			&& scheduledPoll.changedOnly.get()
+			&& this->pollAllCount % (size_t)max(scheduledPoll.fullEvery.get(), 1) != 0;
+		this->pollAllCount++;
+
+		if (this->parameters.scheduledPoll.broadcast.get() && !this->portals.empty()) {
+			// One broadcast, each portal replies in slot (ID - firstID)
+			auto firstID = this->portals.front()->getTarget();
+			for (auto portal : this->portals) {
+				firstID = min(firstID, portal->getTarget());
+			}
+			auto slot_us = this->rs485->scaleReplySlot_us((uint32_t)max(compact
+				? scheduledPoll.compactSlot_us.get()
+				: scheduledPoll.slot_us.get(), 0));
+
+			auto message = compact
+				? msgpack11::MsgPack::object{
+					{ "s", msgpack11::MsgPack::array{ (int32_t)slot_us, (int8_t)firstID, (uint8_t)(changedOnly ? 1 : 0) } }
+				}
+				: msgpack11::MsgPack::object{
+					{ "poll", msgpack11::MsgPack::array{ (int32_t)slot_us, (int8_t)firstID } }
+				};
+
+			RS485::Packet packet(msgpack11::MsgPack::array{
+				-1
+				, (int8_t)0
+				, message
+				});
+			packet.address = compact ? "s" : "poll";
+			packet.needsACK = false;
+			packet.collateable = false;
+			packet.priority = RS485::Priority::Poll;
+			for (auto portal : this->portals) {
+				packet.replySlots.push_back({ portal->getTarget(), portal->getTarget() - firstID });
+			}
+			packet.replySlot_us = slot_us;
+
+			this->rs485->transmit(packet);
+		}
+		else {
+			for (auto portal : this->portals) {
+				if (compact) {
+					portal->pollCompact(changedOnly);
+				}
+				else {
+					portal->poll();
+				}
+			}
 		}
 		this->lastPollAll = chrono::system_clock::now();
 	}
@@ -480,59 +619,99 @@ namespace Modules {
 	}
 
 	//----------
-	void
-		Column::updatePositionsFromImage(const ofFloatPixels& pixels)
+	bool
+		Column::gatherPositionsFromImage(const ofFloatPixels& pixels, PerPortal::Kinematics::Batch& batch)
 	{
 		// For logging
-		string moduleName = "Column " + ofToString(this->columnIndex) + "::updatePositionsFromImage";
+		string moduleName = "Column " + ofToString(this->columnIndex) + "::gatherPositionsFromImage";
 
 		// Check we have the correct number of local portals
 		if (this->portals.size() != this->countX * this->countY) {
 			ofLogError(moduleName) << "Portals not allocated correctly";
-			return;
+			return false;
 		}
 
-		// Get target position vectors from the pixels
-		vector<glm::vec2> targetPositions;
+		// Check that the pixels is the correct resolution
 		{
-			// Check that the pixels is the correct resolution
-			{
-				if (pixels.getWidth() < (this->columnIndex + 1) * this->countX) {
-					ofLogError(moduleName) << "Image resolution is not wide enough for this column";
-					return;
-				}
-				if (pixels.getHeight() < this->countY) {
-					ofLogError(moduleName) << "Image resolution is not tall enough for this column";
-					return;
+			if (pixels.getWidth() < (this->columnIndex + 1) * this->countX) {
+				ofLogError(moduleName) << "Image resolution is not wide enough for this column";
+				return false;
+			}
+			if (pixels.getHeight() < this->countY) {
+				ofLogError(moduleName) << "Image resolution is not tall enough for this column";
+				return false;
+			}
+		}
+
+		// Get the pixels for this column (in the same order as this->portals)
+		const auto batchIndex = batch.size();
+		batch.resize(batchIndex + this->portals.size());
+		{
+			const auto flipped = this->parameters.arrangement.flipped.get();
+			const auto data = (glm::vec3*)pixels.getData();
+			const auto pixelWidth = pixels.getWidth();
+
+			for (int j = 0; j < this->countY; j++) {
+				for (int i = 0; i < this->countX; i++) {
+					auto x = this->columnIndex * this->countX + i;
+					auto y = j;
+
+					if (!flipped) {
+						// Default is bottom to top indexed
+						y = this->countY - 1 - j;
+					}
+
+					const auto targetPosition = data[x + y * pixelWidth];
+					this->gatherPortal(i + j * this->countX, glm::vec2(targetPosition), batch, batchIndex);
 				}
 			}
+		}
 
-			// Get the pixels for this column
-			{
-				const auto flipped = this->parameters.arrangement.flipped.get();
-				const auto data = (glm::vec3*)pixels.getData();
-				const auto pixelWidth = pixels.getWidth();
-
-				for (int j = 0; j < this->countY; j++) {
-					for (int i = 0; i < this->countX; i++) {
-						auto x = this->columnIndex * this->countX + i;
-						auto y = j;
-
-						if (!flipped) {
-							// Default is bottom to top indexed
-							y = this->countY - 1 - j;
-						}
+		return true;
+	}
 
+	//----------
+	bool
+		Column::gatherPositions(const glm::vec2* positions, size_t count, PerPortal::Kinematics::Batch& batch)
+	{
+		if (count != this->portals.size()) {
+			ofLogError("Column " + ofToString(this->columnIndex) + "::gatherPositions") << "Received " << count << " positions for " << this->portals.size() << " portals";
+			return false;
+		}
 
-						const auto targetPosition = data[x + y * pixelWidth];
+		const auto batchIndex = batch.size();
+		batch.resize(batchIndex + this->portals.size());
+		for (size_t i = 0; i < this->portals.size(); i++) {
+			this->gatherPortal(i, positions[i], batch, batchIndex);
+		}
 
-						auto pilot = this->portals[i + j * this->countX]->getPilot();
-						pilot->setPosition(targetPosition);
-						pilot->update(); // calculate the other values with the new position
+		return true;
+	}
 
-					}
-				}
-			}
+	//----------
+	void
+		Column::gatherPortal(size_t portalIndex, const glm::vec2& targetPosition, PerPortal::Kinematics::Batch& batch, size_t batchIndex)
+	{
+		auto index = batchIndex + portalIndex;
+		auto pilot = this->portals[portalIndex]->getPilot();
+		batch.positionX[index] = targetPosition.x;
+		batch.positionY[index] = targetPosition.y;
+		batch.currentA[index] = pilot->getAxes()[0];
+		batch.offset[index] = pilot->getAxesOffset();
+		batch.microstepsPerPrismRotation[index] = (float) pilot->getMicrostepsPerPrismRotation();
+		batch.cyclic[index] = pilot->getCyclic();
+	}
+
+	//----------
+	void
+		Column::applyKinematics(const PerPortal::Kinematics::Batch& batch, size_t batchIndex)
+	{
+		for (size_t i = 0; i < this->portals.size(); i++) {
+			auto index = batchIndex + i;
+			this->portals[i]->getPilot()->applyKinematics({ batch.positionX[index], batch.positionY[index] }
+				, { batch.r[index], batch.theta[index] }
+				, { batch.a[index], batch.b[index] }
+				, { batch.stepsA[index], batch.stepsB[index] });
 		}
 	}
 
@@ -592,8 +771,58 @@ namespace Modules {
 		// Clear any existing keyframes from outbox
 		this->rs485->removePacketsFromOutbox("keyframe", -1);
 
+		// Transmit binary keyframe message (in blocks)
+		if (App::X()->getInstallation()->getBinaryKeyframesEnabled()) {
+			auto maxBlockSize = (size_t) max(App::X()->getInstallation()->getTransmitKeyframeBatchSize(), 1);
+			auto absoluteInterval = App::X()->getInstallation()->getKeyframeAbsoluteInterval();
+
+			for (size_t blockStart = 0; blockStart < this->portals.size(); blockStart += maxBlockSize) {
+				auto blockEnd = min(blockStart + maxBlockSize, this->portals.size());
+
+				vector<KeyframeEncoder::Values> blockValues;
+				for (size_t i = blockStart; i < blockEnd; i++) {
+					KeyframeEncoder::Values values;
+					values.values[0] = (int32_t)axisValues[i].x;
+					values.values[1] = (int32_t)axisValues[i].y;
+					values.values[2] = velocitiesEnabled ? (int32_t)velocities[i].x : 0;
+					values.values[3] = velocitiesEnabled ? (int32_t)velocities[i].y : 0;
+					blockValues.push_back(values);
+				}
+
+				// Encoded when sent, so that deltas are against what actually went out (stale blocks get removed above)
+				auto startIndex = (uint8_t)(blockStart + 1);
+				auto keyframeEncoder = this->keyframeEncoder;
+				RS485::Packet packet([keyframeEncoder, startIndex, blockValues, velocitiesEnabled, absoluteInterval]() {
+					return msgpack11::MsgPack::array{
+						-1
+						, (int8_t)0
+						, msgpack11::MsgPack::object{
+							{
+								"kf"
+								, keyframeEncoder->encodeBlock(startIndex
+									, blockValues
+									, velocitiesEnabled
+									, absoluteInterval)
+							}
+						}
+					};
+					});
+				packet.address = "keyframe";
+				packet.needsACK = false;
+				packet.collateable = false;
+
+				// Blocks of one keyframe go out back to back (so one segment to a TCP gateway), with the
+				// usual gap between broadcasts after the last of them
+				if (blockEnd < this->portals.size()) {
+					packet.customWaitTime_ms = 0;
+				}
+
+				this->rs485->transmit(packet);
+			}
+		}
+
 		// Transmit keyframe message (in blocks)
-		{
+		else {
 			auto maxBlockSize = App::X()->getInstallation()->getTransmitKeyframeBatchSize();
 
 			size_t blockStartIndex = 1;
@@ -3,6 +3,8 @@
 #include "RS485.h"
 #include "FWUpdate.h"
 #include "Portal.h"
+#include "KeyframeEncoder.h"
+#include "PerPortal/Kinematics.h"
 
 #include "../Base.h"
 
@@ -22,15 +24,23 @@ namespace Modules {
 
 		string getTypeName() const override;
 		string getName() const override;
+		size_t getIndex() const;
 
 		void deserialise(const nlohmann::json&) override;
 
 		void init() override;
+
+		// Installation calls these in order each frame. update runs on a worker (alongside the other columns),
+		// so anything which dispatches into ofParameters or the GUI happens in updateBus or updateGUI on the main thread
+		void updateBus();
 		void update() override;
+		void updateGUI();
+
 		void pushStale();
 
 		void populateInspector(ofxCvGui::InspectArguments& args);
 		void processIncoming(const nlohmann::json&) override;
+		void processIncoming(const HotReply&);
 
 		void rebuildPortals();
 
@@ -54,11 +64,20 @@ namespace Modules {
 
 		ofxCvGui::PanelPtr getMiniView(float width);
 
-		void updatePositionsFromImage(const ofFloatPixels&);
+		// Append our portals' target positions (and Pilot settings) from the image to the batch
+		bool gatherPositionsFromImage(const ofFloatPixels&, PerPortal::Kinematics::Batch&);
+
+		// As above, but with the target positions given in the same order as our portals
+		bool gatherPositions(const glm::vec2* positions, size_t count, PerPortal::Kinematics::Batch&);
+
+		// Take the solved values back into our Pilots (our portals start at batchIndex)
+		void applyKinematics(const PerPortal::Kinematics::Batch&, size_t batchIndex);
+
 		void transmitKeyframe();
 
 	protected:
 		void refreshPortalsByID();
+		void gatherPortal(size_t portalIndex, const glm::vec2& targetPosition, PerPortal::Kinematics::Batch&, size_t batchIndex);
 
 		shared_ptr<RS485> rs485;
 		shared_ptr<FWUpdate> fwUpdate;
@@ -84,13 +103,25 @@ namespace Modules {
 			struct : ofParameterGroup {
 				ofParameter<bool> enabled{ "Enabled", false };
 				ofParameter<float> period_s{ "Period [s]", 60.0f, 0.01f, 100.0f };
-				PARAM_DECLARE("Scheduled poll", enabled, period_s);
+				ofParameter<bool> broadcast{ "Broadcast", false };
+				// Both shrink with the negotiated baud rate
+				ofParameter<int> slot_us{ "Slot [us]", 65000 }; // a full status report is ~700 bytes (~61ms at 115200)
+				ofParameter<int> compactSlot_us{ "Compact slot [us]", (int)RS485Protocol::compactStatusSlot_us }; // sized for the largest compact one
+
+				// Compact status reports ({"s" : ...}) instead of the full report. With changedOnly, each portal only
+				// sends the fields which changed since its last compact report, and every fullEvery'th poll asks for
+				// everything (so that a lost reply doesn't leave us out of date for long)
+				ofParameter<bool> compact{ "Compact", false };
+				ofParameter<bool> changedOnly{ "Changed only", true };
+				ofParameter<int> fullEvery{ "Full every", 10, 1, 1000 };
+				PARAM_DECLARE("Scheduled poll", enabled, period_s, broadcast, slot_us, compactSlot_us, compact, changedOnly, fullEvery);
 			} scheduledPoll;
 
 			PARAM_DECLARE("Column", arrangement, scheduledPoll);
 		} parameters;
 
 		chrono::system_clock::time_point lastPollAll = chrono::system_clock::now();
+		size_t pollAllCount = 0;
 
 		std::string name;
 
@@ -100,5 +131,8 @@ namespace Modules {
 
 			vector<glm::vec2> axisValues;
 		} lastKeyframe;
+
+		// Shared with the lazy keyframe packets (only used on the serial thread)
+		shared_ptr<KeyframeEncoder> keyframeEncoder = make_shared<KeyframeEncoder>();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "pch_App.h"
+#include "FWImage.h"
+#include "../../Utils.h"
+
+namespace Modules {
+	//----------
+	bool
+		FWImage::load(const string& path, size_t frameSize, bool truncate)
+	{
+		this->frames.clear();
+		this->dataSize = 0;
+		this->frameSize = max(frameSize, (size_t) 1);
+
+		vector<uint8_t> data;
+		{
+			// Read contents from file
+			{
+				auto file = ofFile(path);
+				auto fileBuffer = file.readToBuffer();
+				file.close();
+
+				if (fileBuffer.size() == 0) {
+					ofLogError("FWImage") << "Couldn't read file contents";
+					return false;
+				}
+
+				auto rawData = (uint8_t*)fileBuffer.getData();
+				data.assign(rawData, rawData + fileBuffer.size());
+			}
+
+			// Truncate all 0xFFs from end of firmware
+			if (truncate) {
+				auto lastFF = data.size();
+				while (lastFF > 0 && data[lastFF - 1] == 0xFF) {
+					lastFF--;
+				}
+
+				data.resize(lastFF);
+			}
+		}
+
+		// Encode every frame once. Offsets advance by exactly the frame size (the bootloader rejects any gap)
+		for (size_t frameOffset = 0; frameOffset < data.size(); frameOffset += this->frameSize) {
+			auto packetSize = min(this->frameSize, data.size() - frameOffset);
+
+			Frame frame;
+			frame.offset = (uint32_t)frameOffset;
+			frame.encoded = FWImage::encodeFrame(frame.offset
+				, data.data() + frameOffset
+				, packetSize);
+			if (!frame.encoded) {
+				ofLogError("FWImage") << "Failed to encode frame at " << frameOffset;
+				this->frames.clear();
+				return false;
+			}
+			this->frames.push_back(frame);
+		}
+
+		this->dataSize = data.size();
+		return true;
+	}
+
+	//----------
+	const vector<FWImage::Frame>&
+		FWImage::getFrames() const
+	{
+		return this->frames;
+	}
+
+	//----------
+	size_t
+		FWImage::getDataSize() const
+	{
+		return this->dataSize;
+	}
+
+	//----------
+	int32_t
+		FWImage::getSafeFrameGap_ms(const BootloaderModel& bootloader) const
+	{
+		size_t largestFrame = 0;
+		for (const auto& frame : this->frames) {
+			largestFrame = max(largestFrame, frame.encoded->size());
+		}
+
+		// 10 bits per byte on the wire
+		auto wireTime_ms = (float)largestFrame * 10.0f * 1000.0f / (float)BAUD_RATE;
+
+		// Bytes we allow to arrive per pass of the bootloader's loop
+		auto bytesPerLoop = max((float)bootloader.rxBufferSize * bootloader.rxBufferMargin, (float)largestFrame);
+		auto ringTime_ms = (float)largestFrame * bootloader.loopPeriod_ms / bytesPerLoop;
+
+		return (int32_t)ceil(max(wireTime_ms, ringTime_ms));
+	}
+
+	//----------
+	FWImage::StreamSettings
+		FWImage::getStreamSettings(const Pacing& pacing
+			, int legacyRepetitions
+			, int legacyFrameGap_ms) const
+	{
+		StreamSettings settings;
+		if (pacing.adaptive.get()) {
+			BootloaderModel bootloader;
+			bootloader.loopPeriod_ms = pacing.bootloaderLoopPeriod.get();
+			bootloader.rxBufferSize = (size_t) max(pacing.bootloaderRxBuffer.get(), 1);
+
+			settings.repetitions = 1;
+			settings.passes = (size_t) max(pacing.passes.get(), 1);
+			settings.frameGap_ms = this->getSafeFrameGap_ms(bootloader);
+		}
+		else {
+			settings.repetitions = (size_t) max(legacyRepetitions, 1);
+			settings.passes = 1;
+			settings.frameGap_ms = legacyFrameGap_ms;
+		}
+		return settings;
+	}
+
+	//----------
+	vector<shared_ptr<RS485>>
+		FWImage::stream(const vector<shared_ptr<RS485>>& rs485s
+			, const StreamSettings& settings
+			, const function<void(const string&)>& progressAction) const
+	{
+		auto moduleName = "FWImage::stream";
+
+		const auto repetitions = max(settings.repetitions, (size_t)1);
+		const auto passes = max(settings.passes, (size_t)1);
+		const auto framesInFlight = max(settings.framesInFlight, (size_t)1);
+		const auto sendsPerPass = this->frames.size() * repetitions;
+		const auto sendCount = sendsPerPass * passes;
+
+		struct Stream {
+			shared_ptr<RS485> rs485;
+			size_t queued = 0;
+			shared_ptr<std::atomic<size_t>> sent; // counted by the serial thread
+			size_t lastSent = 0;
+			chrono::steady_clock::time_point lastProgress;
+			bool failed = false;
+		};
+
+		vector<Stream> streams;
+		for (auto rs485 : rs485s) {
+			Stream stream;
+			stream.rs485 = rs485;
+			stream.sent = make_shared<std::atomic<size_t>>(0);
+			stream.lastProgress = chrono::steady_clock::now();
+			streams.push_back(stream);
+		}
+
+		auto lastProgressNotice = chrono::steady_clock::time_point();
+
+		while (true) {
+			auto now = chrono::steady_clock::now();
+			bool finished = true;
+			size_t slowestSent = sendCount;
+
+			for (auto& stream : streams) {
+				if (stream.failed) {
+					continue;
+				}
+
+				auto sent = stream.sent->load();
+
+				// Give up on a bus which has stopped sending (e.g. disconnected, or its outbox was cleared)
+				if (sent != stream.lastSent) {
+					stream.lastSent = sent;
+					stream.lastProgress = now;
+				}
+				else if (sent < sendCount && now - stream.lastProgress > settings.stallTimeout) {
+					ofLogError(moduleName) << "Bus stalled after " << sent << " of " << sendCount << " frames. Giving up on it";
+					stream.failed = true;
+					continue;
+				}
+
+				// Keep the bus fed
+				while (stream.queued < sendCount && stream.queued - sent < framesInFlight) {
+					const auto& frame = this->frames[(stream.queued % sendsPerPass) / repetitions];
+					auto sentCounter = stream.sent;
+					FWImage::send(stream.rs485
+						, frame.encoded
+						, settings.frameGap_ms
+						, [sentCounter]() {
+							(*sentCounter)++;
+						});
+					stream.queued++;
+				}
+
+				if (sent < sendCount) {
+					finished = false;
+				}
+				slowestSent = min(slowestSent, sent);
+			}
+
+			if (finished) {
+				break;
+			}
+
+			if (progressAction && now - lastProgressNotice > chrono::milliseconds(100)) {
+				auto pass = slowestSent / sendsPerPass;
+				auto remainingFrames = (sendsPerPass - slowestSent % sendsPerPass) / repetitions;
+				auto remainingSize = remainingFrames * this->frameSize;
+				auto notice = "Uploading : " + ofToString(remainingSize / 1024, 1) + "kB remaining";
+				if (passes > 1) {
+					notice += " (pass " + ofToString(pass + 1) + " of " + ofToString(passes) + ")";
+				}
+				progressAction(notice);
+				lastProgressNotice = now;
+			}
+
+			ofSleepMillis(1);
+		}
+
+		vector<shared_ptr<RS485>> completed;
+		for (const auto& stream : streams) {
+			if (!stream.failed) {
+				completed.push_back(stream.rs485);
+			}
+		}
+		return completed;
+	}
+
+	//----------
+	FWImage::EncodedFrame
+		FWImage::encodeMagicWord(const string& magicWord)
+	{
+		msgpack_sbuffer messageBuffer;
+		msgpack_packer packer;
+		msgpack_sbuffer_init(&messageBuffer);
+		msgpack_packer_init(&packer
+			, &messageBuffer
+			, msgpack_sbuffer_write);
+
+		msgpack_pack_array(&packer, 3);
+		{
+			// First element is target address
+			msgpack_pack_fix_int8(&packer, -1);
+
+			// Second element is source address
+			msgpack_pack_fix_int8(&packer, 0);
+
+			// Third element is the message body
+			msgpack_pack_str(&packer, magicWord.size());
+			msgpack_pack_str_body(&packer, magicWord.c_str(), magicWord.size());
+		}
+
+		auto frame = make_shared<vector<uint8_t>>();
+		auto success = RS485::encodeFrame(RS485::Packet(messageBuffer).msgpackBinary, *frame);
+
+		msgpack_sbuffer_destroy(&messageBuffer);
+
+		return success ? frame : EncodedFrame();
+	}
+
+	//----------
+	FWImage::EncodedFrame
+		FWImage::encodeFrame(uint32_t frameOffset
+			, const uint8_t* packetData
+			, size_t packetSize)
+	{
+		// Prepend the data with checksum
+		auto checksum = Utils::calcCheckSum((uint8_t*)packetData, packetSize);
+		auto checksumBytes = (uint8_t*)&checksum;
+		vector<uint8_t> packetBody;
+		for (int i = 0; i < sizeof(Utils::CRCType); i++) {
+			packetBody.push_back(checksumBytes[i]);
+		}
+
+		// Add the data to the packet
+		packetBody.insert(packetBody.end()
+			, packetData
+			, packetData + packetSize);
+
+		// Encode via msgpack
+		msgpack_sbuffer messageBuffer;
+		msgpack_packer packer;
+		msgpack_sbuffer_init(&messageBuffer);
+		msgpack_packer_init(&packer
+			, &messageBuffer
+			, msgpack_sbuffer_write);
+
+		// The broadcast packet header
+		msgpack_pack_array(&packer, 3);
+		{
+			// First element is target address
+			msgpack_pack_fix_int8(&packer, -1);
+
+			// Second element is source address
+			msgpack_pack_fix_int8(&packer, 0);
+
+			// Third element is the message body
+			msgpack_pack_map(&packer, 1);
+			{
+				// Key is the packet index
+				msgpack_pack_uint32(&packer, frameOffset);
+
+				// Value is the data
+				msgpack_pack_bin(&packer, packetBody.size());
+				msgpack_pack_bin_body(&packer, packetBody.data(), packetBody.size());
+			}
+		}
+
+		// Then COBS
+		auto frame = make_shared<vector<uint8_t>>();
+		auto success = RS485::encodeFrame(RS485::Packet(messageBuffer).msgpackBinary, *frame);
+
+		msgpack_sbuffer_destroy(&messageBuffer);
+
+		return success ? frame : EncodedFrame();
+	}
+
+	//----------
+	void
+		FWImage::send(shared_ptr<RS485> rs485
+			, EncodedFrame frame
+			, int32_t waitTime_ms
+			, const function<void()>& onSent)
+	{
+		if (!rs485) {
+			ofLogError("FWImage") << "No RS485";
+			return;
+		}
+		if (!rs485->isConnected() || !frame) {
+			return;
+		}
+
+		RS485::Packet packet;
+		packet.encodedFrame = frame;
+		packet.needsACK = false;
+		packet.collateable = false;
+		packet.customWaitTime_ms = waitTime_ms;
+		packet.onSent = onSent;
+		rs485->transmit(packet);
+	}
+}
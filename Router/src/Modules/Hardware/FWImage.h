@@ -0,0 +1,93 @@
+#pragma once
+
+#include "RS485.h"
+
+namespace Modules {
+	/// <summary>
+	/// A firmware image split into frames for the bootloader. Each frame is COBS encoded once, so that the same
+	/// frames can be streamed to any number of buses.
+	///
+	/// The bootloader never transmits, so there is nothing to pace by or to ask for its write position. It writes
+	/// frames strictly in order : a frame below its write position is ignored and one above it is rejected. So a
+	/// lost frame stalls that board (and only that board) until the frame comes round again, and a second pass of
+	/// the image resumes it from where it stopped while the boards which are already past each frame skip it.
+	/// </summary>
+	class FWImage {
+	public:
+		typedef shared_ptr<const vector<uint8_t>> EncodedFrame;
+
+		struct Frame {
+			uint32_t offset;
+			EncodedFrame encoded;
+		};
+
+		struct StreamSettings {
+			// Each frame back to back (the legacy scheme)
+			size_t repetitions = 1;
+
+			// The whole image
+			size_t passes = 1;
+
+			// After each frame (see getSafeFrameGap_ms)
+			int32_t frameGap_ms = 10;
+
+			// How far ahead of each serial thread we queue
+			size_t framesInFlight = 8;
+
+			chrono::milliseconds stallTimeout{ 5000 };
+		};
+
+		// What the bootloader can absorb. Its main loop reads the receive ring once per pass (HAL_Delay(10) plus the
+		// flash writes), so no more than the ring can hold should arrive within a pass
+		struct BootloaderModel {
+			float loopPeriod_ms = 12.0f;
+			size_t rxBufferSize = 256;
+			float rxBufferMargin = 0.5f; // fraction of the ring we allow ourselves to fill
+		};
+
+		// Each frame once per pass, spaced by what the bootloader can absorb (instead of the legacy repetitions
+		// and wait). Shared by FWUpdate and MassFWUpdate
+		struct Pacing : ofParameterGroup {
+			ofParameter<bool> adaptive{ "Adaptive", true };
+			ofParameter<int> passes{ "Passes", 2 };
+			ofParameter<float> bootloaderLoopPeriod{ "Bootloader loop [ms]", 12.0f };
+			ofParameter<int> bootloaderRxBuffer{ "Bootloader rx buffer", 256 };
+			PARAM_DECLARE("Pacing", adaptive, passes, bootloaderLoopPeriod, bootloaderRxBuffer);
+		};
+
+		bool load(const string& path, size_t frameSize, bool truncate);
+
+		const vector<Frame>& getFrames() const;
+		size_t getDataSize() const;
+
+		// The spacing for the largest frame at BAUD_RATE : its wire time, or its share of the bootloader's
+		// receive ring per loop, whichever is longer
+		int32_t getSafeFrameGap_ms(const BootloaderModel&) const;
+
+		// The adaptive pacing if it's enabled, otherwise the legacy repetitions and wait
+		StreamSettings getStreamSettings(const Pacing&
+			, int legacyRepetitions
+			, int legacyFrameGap_ms) const;
+
+		// Stream to every bus at once and block until each has sent everything (or stalled). Returns the buses which
+		// completed
+		vector<shared_ptr<RS485>> stream(const vector<shared_ptr<RS485>>&
+			, const StreamSettings&
+			, const function<void(const string&)>& progressAction) const;
+
+		static EncodedFrame encodeMagicWord(const string&);
+		static EncodedFrame encodeFrame(uint32_t frameOffset
+			, const uint8_t* packetData
+			, size_t packetSize);
+
+		// Broadcast without an ACK, spaced by waitTime_ms (see RS485::Packet::customWaitTime_ms)
+		static void send(shared_ptr<RS485>
+			, EncodedFrame
+			, int32_t waitTime_ms
+			, const function<void()>& onSent = nullptr);
+	protected:
+		vector<Frame> frames;
+		size_t dataSize = 0;
+		size_t frameSize = 0;
+	};
+}
@@ -7,7 +7,8 @@ namespace Modules {
 	FWUpdate::FWUpdate(shared_ptr<RS485> rs485)
 		: rs485(rs485)
 	{
-
+		this->parameters.upload.pacing.adaptive.set(false);
+		this->parameters.upload.pacing.passes.set(1);
 	}
 
 	//----------
@@ -86,33 +87,12 @@ namespace Modules {
 			}
 		}
 
-		vector<uint8_t> data;
-		{
-			// Read contents from file
-			{
-				auto file = ofFile(path);
-				auto fileBuffer = file.readToBuffer();
-				file.close();
-				auto size = fileBuffer.size();
-
-				if (fileBuffer.size() == 0) {
-					ofLogError("FWUpdate") << "Couldn't read file contents";
-					return;
-				}
-
-				auto rawData = (uint8_t*)fileBuffer.getData();
-				data.assign(rawData, rawData + fileBuffer.size());
-			}
-
-			// Truncate all 0xFFs from end of firmware
-			if(this->parameters.upload.truncate.get()) {
-				auto lastFF = data.size();
-				while (data[lastFF - 1] == 0xFF) {
-					lastFF--;
-				}
-
-				data.resize(lastFF);
-			}
+		// Encode every frame of the image once
+		FWImage image;
+		if (!image.load(path
+			, (size_t) this->parameters.upload.frameSize.get()
+			, this->parameters.upload.truncate.get())) {
+			return;
 		}
 
 		// 0. Clear any existing messages in outbox
@@ -147,49 +127,11 @@ namespace Modules {
 		// 3. Upload
 		{
 			progressAction("Uploading");
-
-			auto dataPosition = data.data();
-			auto dataEnd = dataPosition + data.size();
-			uint32_t packetIndex = 0;
-			// Snapshot the value rather than copying the ofParameter, so the frame size cannot
-			// change under the loop if the inspector is touched mid-upload.
-			const int frameSize = this->parameters.upload.frameSize.get();
-			uint32_t frameOffset = 0;
-
-			while (dataPosition < dataEnd) {
-				auto remainingSize = dataEnd - dataPosition;
-				{
-					progressAction("Uploading : " + ofToString(remainingSize / 1024, 1) + "kB remaining");
-				}
-
-				
-				if (remainingSize > frameSize) {
-					for (int i = 0; i < this->parameters.upload.frameRepetitions.get(); i++) {
-						// Must be frameSize, not FW_FRAME_SIZE: the pointer and frameOffset below
-						// advance by the parameter. Sending a fixed 32 bytes whilst striding by N
-						// makes the bootloader's continuity check reject frame 2 with
-						// "FW : Write position is ahead of ours" - which reads as "large images
-						// don't upload", since raising the frame size is what you try on a large
-						// image. RouterRS's fw_update.rs never had this bug.
-						uploadFirmwarePacket(frameOffset
-							, dataPosition
-							, frameSize);
-					}
-
-
-					dataPosition += frameSize;
-					frameOffset += frameSize;
-				}
-				else {
-					for (int i = 0; i < this->parameters.upload.frameRepetitions.get(); i++) {
-						uploadFirmwarePacket(frameOffset
-							, dataPosition
-							, remainingSize);
-					}
-					dataPosition += remainingSize;
-					frameOffset += remainingSize;
-				}
-
+			auto completed = image.stream({ rs485 }, image.getStreamSettings(this->parameters.upload.pacing
+				, this->parameters.upload.frameRepetitions.get()
+				, this->parameters.upload.waitBetweenFrames.get()), progressAction);
+			if (completed.empty()) {
+				ofLogError("FWUpdate") << "Upload didn't complete";
 			}
 		}
 
@@ -207,10 +149,16 @@ namespace Modules {
 	// decode as a 2-byte match can't bounce a device mid-move -- see protocol-hardening.md
 	// Finding 4. The bootloader itself is frozen (field-burned, only re-flashable via
 	// ST-Link) and still expects exactly "FW"; announceFirmwareLegacy() below is for it.
+	// The bootloader only speaks BAUD_RATE, so our end of the bus follows once the word is out.
 	void
 		FWUpdate::announceFirmware()
 	{
-		this->sendMagicWord(string("FW!KC79"));
+		auto rs485 = this->rs485.lock();
+		this->sendMagicWord(string("FW!KC79"), [rs485]() {
+			if (rs485) {
+				rs485->serialThreadFallBackToBootBaudRate();
+			}
+			});
 	}
 
 	//----------
@@ -250,7 +198,7 @@ namespace Modules {
 
 	//----------
 	void
-		FWUpdate::sendMagicWord(const string & magicWord)
+		FWUpdate::sendMagicWord(const string & magicWord, const function<void()>& onSent)
 	{
 		auto rs485 = this->rs485.lock();
 		if (!rs485) {
@@ -291,7 +239,10 @@ namespace Modules {
 			// send and wait for complete
 			{
 				std::promise<void> promise;
-				packet.onSent = [&promise]() {
+				packet.onSent = [&promise, onSent]() {
+					if (onSent) {
+						onSent();
+					}
 					promise.set_value();
 				};
 				rs485->transmit(packet);
@@ -305,87 +256,4 @@ namespace Modules {
 
 		this->announce.lastSend = chrono::system_clock::now();
 	}
-
-	//----------
-	void
-		FWUpdate::uploadFirmwarePacket(uint32_t frameOffset
-			, uint8_t * packetData
-			, size_t packetSize)
-	{
-		auto rs485 = this->rs485.lock();
-		if (!rs485) {
-			ofLogError() << "No RS485";
-		}
-
-		// Prepend the data with checksum
-		auto checksum = Utils::calcCheckSum((uint8_t*) packetData, packetSize);
-		auto checksumBytes = (uint8_t*)&checksum;
-		vector<uint8_t> packetBody;
-		for (int i = 0; i < sizeof(Utils::CRCType); i++) {
-			packetBody.push_back(checksumBytes[i]);
-		}
-		
-
-		// Add the data to the packet
-		packetBody.insert(packetBody.end()
-			, packetData
-			, packetData + packetSize);
-
-		// Transmit via msgpack
-		{
-			msgpack_sbuffer messageBuffer;
-			msgpack_packer packer;
-			msgpack_sbuffer_init(&messageBuffer);
-			msgpack_packer_init(&packer
-				, &messageBuffer
-				, msgpack_sbuffer_write);
-
-			// The broadcast packet header
-			msgpack_pack_array(&packer, 3);
-			{
-				// First element is target address
-				msgpack_pack_fix_int8(&packer, -1);
-
-				// Second element is source address
-				msgpack_pack_fix_int8(&packer, 0);
-
-				// Third element is the message body
-				msgpack_pack_map(&packer, 1);
-				{
-					// Key is the packet index
-					if (sizeof(Utils::CRCType) == 2) {
-						msgpack_pack_uint32(&packer, frameOffset);
-					}
-					else if (sizeof(Utils::CRCType) == 4) {
-						msgpack_pack_uint32(&packer, frameOffset);
-					}
-
-					// Value is the data
-					msgpack_pack_bin(&packer, packetBody.size());
-					msgpack_pack_bin_body(&packer, packetBody.data(), packetBody.size());
-				}
-				
-			}
-
-			// Send packet
-			{
-				auto packet = RS485::Packet(messageBuffer);
-				packet.needsACK = false;
-				packet.customWaitTime_ms = this->parameters.upload.waitBetweenFrames.get();
-				packet.collateable = false;
-
-				// send and wait for complete
-				std::promise<void> promise;
-				packet.onSent = [&promise]() {
-					promise.set_value();
-				};
-				rs485->transmit(packet);
-
-				// wait for packet to be sent
-				promise.get_future().get();
-			}
-
-			msgpack_sbuffer_destroy(&messageBuffer);
-		}
-	}
 }
\ No newline at end of file
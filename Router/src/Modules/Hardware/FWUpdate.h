@@ -2,6 +2,7 @@
 
 #include "../Base.h"
 #include "RS485.h"
+#include "FWImage.h"
 
 #define FW_FRAME_SIZE 32
 
@@ -21,13 +22,10 @@ namespace Modules {
 		void announceFirmware();
 		void announceFirmwareLegacy();
 		void eraseFirmware();
-		void uploadFirmwarePacket(uint32_t frameOffset
-			, uint8_t* packetData
-			, size_t packetSize);
 		void runApplication();
 
 		void sendMagicWord(char, char);
-		void sendMagicWord(const string &);
+		void sendMagicWord(const string &, const function<void()>& onSent = nullptr);
 
 		weak_ptr<RS485> rs485;
 
@@ -43,7 +41,11 @@ namespace Modules {
 				ofParameter<int> frameSize{ "Frame size", FW_FRAME_SIZE };
 				ofParameter<int> waitBetweenFrames{ "Wait between frames [ms]", 5 };
 				ofParameter<int> frameRepetitions{ "Frame repetitions", 1 };
-				PARAM_DECLARE("Upload", truncate, frameSize, waitBetweenFrames, frameRepetitions);
+
+				// Off by default here (see constructor) : a single board keeps the 1 x 5ms above
+				FWImage::Pacing pacing;
+
+				PARAM_DECLARE("Upload", truncate, frameSize, waitBetweenFrames, frameRepetitions, pacing);
 			} upload;
 
 			PARAM_DECLARE("FWUpdate", announce, upload)
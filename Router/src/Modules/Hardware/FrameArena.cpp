@@ -0,0 +1,146 @@
+#include "pch_App.h"
+#include "FrameArena.h"
+
+#include "../cobs-c/cobs.h"
+
+namespace Modules {
+	//----------
+	FrameArena::FrameArena(size_t slotCount, size_t slotSize)
+		: slotCount(slotCount)
+		, slotSize(slotSize)
+	{
+		this->storage.resize(slotCount * slotSize);
+		this->frameSizes.resize(slotCount);
+	}
+
+	//----------
+	void
+		FrameArena::pushByte(uint8_t byte)
+	{
+		if (this->pendingDropped) {
+			return;
+		}
+
+		// Starting a new frame - check that the consumer has released a slot for us
+		if (this->pendingSize == 0) {
+			auto used = this->tail.load(std::memory_order_relaxed) - this->head.load(std::memory_order_acquire);
+			if (used >= this->slotCount) {
+				this->pendingDropped = true;
+				return;
+			}
+		}
+
+		if (this->pendingSize >= this->slotSize) {
+			this->pendingDropped = true;
+			return;
+		}
+
+		this->getSlot(this->tail.load(std::memory_order_relaxed))[this->pendingSize++] = byte;
+	}
+
+	//----------
+	FrameArena::Result
+		FrameArena::decodePending(View& view)
+	{
+		if (this->pendingDropped) {
+			this->discardPending();
+			this->droppedCount++;
+			return Result::Dropped;
+		}
+
+		if (this->pendingSize == 0) {
+			return Result::Empty;
+		}
+
+		// Decoding never writes ahead of where it reads, so we can decode in place
+		auto slot = this->getSlot(this->tail.load(std::memory_order_relaxed));
+		auto decodeResult = cobs_decode(slot
+			, this->pendingSize
+			, slot
+			, this->pendingSize);
+
+		if (decodeResult.status != COBS_DECODE_OK) {
+			this->discardPending();
+			return Result::DecodeError;
+		}
+
+		this->pendingSize = decodeResult.out_len;
+		this->pendingDecoded = true;
+
+		view.data = slot;
+		view.size = this->pendingSize;
+		return Result::OK;
+	}
+
+	//----------
+	void
+		FrameArena::publishPending()
+	{
+		if (!this->pendingDecoded) {
+			return;
+		}
+
+		auto tail = this->tail.load(std::memory_order_relaxed);
+		this->frameSizes[tail % this->slotCount] = this->pendingSize;
+		this->tail.store(tail + 1, std::memory_order_release);
+
+		this->pendingSize = 0;
+		this->pendingDecoded = false;
+	}
+
+	//----------
+	void
+		FrameArena::discardPending()
+	{
+		this->pendingSize = 0;
+		this->pendingDropped = false;
+		this->pendingDecoded = false;
+	}
+
+	//----------
+	size_t
+		FrameArena::getDroppedCount() const
+	{
+		return this->droppedCount.load();
+	}
+
+	//----------
+	bool
+		FrameArena::front(View& view) const
+	{
+		auto head = this->head.load(std::memory_order_relaxed);
+		if (head == this->tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		auto index = head % this->slotCount;
+		view.data = this->storage.data() + index * this->slotSize;
+		view.size = this->frameSizes[index];
+		return true;
+	}
+
+	//----------
+	void
+		FrameArena::pop()
+	{
+		auto head = this->head.load(std::memory_order_relaxed);
+		if (head == this->tail.load(std::memory_order_acquire)) {
+			return;
+		}
+		this->head.store(head + 1, std::memory_order_release);
+	}
+
+	//----------
+	size_t
+		FrameArena::size() const
+	{
+		return this->tail.load(std::memory_order_acquire) - this->head.load(std::memory_order_acquire);
+	}
+
+	//----------
+	uint8_t*
+		FrameArena::getSlot(size_t index)
+	{
+		return this->storage.data() + (index % this->slotCount) * this->slotSize;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace Modules {
+	/// <summary>
+	/// A preallocated ring of rx frames shared between the serial thread (producer)
+	/// and the main thread (consumer). COBS bytes are written straight into the next
+	/// free slot, decoded in place when the delimiter arrives, then published.
+	/// The consumer reads the decoded msgpack through a View and releases the slot
+	/// with pop(). Nothing is allocated after construction.
+	/// </summary>
+	class FrameArena {
+	public:
+		struct View {
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+		};
+
+		enum class Result {
+			Empty,
+			OK,
+			DecodeError,
+			Dropped // the inbox was full or the frame was larger than a slot
+		};
+
+		FrameArena(size_t slotCount = 64, size_t slotSize = 2048);
+
+		// Producer (serial thread)
+		void pushByte(uint8_t);
+		Result decodePending(View&);
+		void publishPending();
+		void discardPending();
+		size_t getDroppedCount() const;
+
+		// Consumer (main thread)
+		bool front(View&) const;
+		void pop();
+		size_t size() const;
+	protected:
+		uint8_t* getSlot(size_t index);
+
+		const size_t slotCount;
+		const size_t slotSize;
+		std::vector<uint8_t> storage;
+		std::vector<size_t> frameSizes;
+
+		std::atomic<size_t> head{ 0 }; // next slot to be read (written by consumer)
+		std::atomic<size_t> tail{ 0 }; // next slot to be written (written by producer)
+
+		// Frame under construction at tail
+		size_t pendingSize = 0;
+		bool pendingDropped = false;
+		bool pendingDecoded = false;
+
+		std::atomic<size_t> droppedCount{ 0 };
+	};
+}
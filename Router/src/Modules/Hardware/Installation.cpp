@@ -43,8 +43,22 @@ namespace Modules {
 		void
 			Installation::update()
 		{
-			if (this->parameters.image.enabled.get()) {
-				this->takeImage();
+			this->updateWorkerPool();
+
+			// Frames posted from other threads (e.g. POST /frame) hold off the image until none has arrived for
+			// postedFrameHold
+			{
+				auto frame = this->frameMailbox.take();
+				if (frame) {
+					this->applyPositions(frame->positions);
+					this->lastPostedFrame = chrono::system_clock::now();
+				}
+				else if (this->parameters.image.enabled.get()) {
+					auto hold = chrono::milliseconds((int64_t)(this->parameters.image.postedFrameHold_s.get() * 1000.0f));
+					if (chrono::system_clock::now() - this->lastPostedFrame > hold) {
+						this->takeImage();
+					}
+				}
 			}
 
 			this->transmitFrame();
@@ -53,14 +67,25 @@ namespace Modules {
 				this->rebuildColumns();
 			}
 
-			// update columns
-			for (const auto& column : this->columns) {
-				column->update();
+			// update columns (each on one worker, all done before we carry on). Only the bus inboxes before and the
+			// GUI after run on the main thread
+			for (auto column : this->columns) {
+				column->updateBus();
+			}
+			this->workerPool.parallelFor(this->columns.size(), [this](size_t columnIndex) {
+				this->columns[columnIndex]->update();
+				});
+			for (auto column : this->columns) {
+				column->updateGUI();
 			}
 
 			if (this->needsRebuildPanel) {
 				this->rebuildPanel();
 			}
+
+			this->massFWUpdate->update();
+
+			this->updateState();
 		}
 
 		//----------
@@ -89,11 +114,20 @@ namespace Modules {
 					Utils::deserialize(json["messaging"], this->parameters.messaging.periodS);
 					Utils::deserialize(json["messaging"], this->parameters.messaging.keyframeBatchSize);
 					Utils::deserialize(json["messaging"], this->parameters.messaging.keyframeVelocities);
+					Utils::deserialize(json["messaging"], this->parameters.messaging.binaryKeyframes);
+					Utils::deserialize(json["messaging"], this->parameters.messaging.keyframeAbsoluteInterval);
+					Utils::deserialize(json["messaging"], this->parameters.messaging.batchMoves);
+					Utils::deserialize(json["messaging"], this->parameters.messaging.moveBatchSize);
+					Utils::deserialize(json["messaging"], this->parameters.messaging.replySlot_us);
 				}
 
 				if (json.contains("image")) {
 					Utils::deserialize(json["image"], this->parameters.image.enabled);
 				}
+
+				if (json.contains("threading")) {
+					Utils::deserialize(json["threading"], this->parameters.threading.workerThreads);
+				}
 			}
 
 			this->rebuildColumns();
@@ -229,7 +263,7 @@ namespace Modules {
 		shared_ptr<Column>
 			Installation::getColumnByID(size_t columnID) const
 		{
-			if (columnID > this->columns.size()) {
+			if (columnID >= this->columns.size()) {
 				return shared_ptr<Column>();
 			}
 			return this->columns[columnID];
@@ -385,17 +419,130 @@ namespace Modules {
 			Installation::takeImage()
 		{
 			auto imageRendererModule = App::X()->getImageRenderer();
-			const auto& pixels = imageRendererModule->getPixels();
+			this->applyPositions(imageRendererModule->getPixels());
+		}
+
+		//----------
+		void
+			Installation::postFrame(unique_ptr<PositionFrame>&& frame)
+		{
+			this->frameMailbox.post(move(frame));
+		}
+
+		//----------
+		const PositionFrameMailbox&
+			Installation::getFrameMailbox() const
+		{
+			return this->frameMailbox;
+		}
 
+		//----------
+		shared_ptr<const Installation::State>
+			Installation::getState() const
+		{
+			return atomic_load(&this->state);
+		}
+
+		//----------
+		void
+			Installation::applyPositions(const ofFloatPixels& pixels)
+		{
 			auto resolution = this->getResolution();
 			if (resolution.x != pixels.getWidth() || resolution.y != pixels.getHeight()) {
-				ofLogError("Installation::transmitImage") << "Resolution mismatch";
+				ofLogError("Installation::applyPositions") << "Resolution mismatch";
 				return;
 			}
 
+			// Gather the target positions for the whole installation
+			auto& batch = this->kinematicsBatch;
+			batch.resize(0);
+			vector<pair<shared_ptr<Column>, size_t>> gatheredColumns;
 			for (auto column : this->columns) {
-				column->updatePositionsFromImage(pixels);
+				auto batchIndex = batch.size();
+				if (column->gatherPositionsFromImage(pixels, batch)) {
+					gatheredColumns.emplace_back(column, batchIndex);
+				}
+			}
+
+			// Solve them in one pass
+			PerPortal::Kinematics::solvePositions(batch);
+
+			// Give the results back to the Pilots
+			this->workerPool.parallelFor(gatheredColumns.size(), [&](size_t i) {
+				gatheredColumns[i].first->applyKinematics(batch, gatheredColumns[i].second);
+				});
+		}
+
+		//----------
+		void
+			Installation::applyColumnPositions(const map<size_t, vector<glm::vec2>>& positionsByColumn)
+		{
+			auto& batch = this->kinematicsBatch;
+			batch.resize(0);
+			vector<pair<shared_ptr<Column>, size_t>> gatheredColumns;
+			for (const auto& it : positionsByColumn) {
+				auto column = this->getColumnByID(it.first);
+				if (!column) {
+					ofLogError("Installation::applyColumnPositions") << "Column " << it.first << " not found";
+					continue;
+				}
+
+				auto batchIndex = batch.size();
+				if (column->gatherPositions(it.second.data(), it.second.size(), batch)) {
+					gatheredColumns.emplace_back(column, batchIndex);
+				}
+			}
+
+			PerPortal::Kinematics::solvePositions(batch);
+
+			this->workerPool.parallelFor(gatheredColumns.size(), [&](size_t i) {
+				gatheredColumns[i].first->applyKinematics(batch, gatheredColumns[i].second);
+				});
+		}
+
+		//----------
+		void
+			Installation::updateState()
+		{
+			auto state = make_shared<State>();
+			state->frameIndex = ofGetFrameNum();
+			state->resolution = this->getResolution();
+
+			for (size_t columnIndex = 0; columnIndex < this->columns.size(); columnIndex++) {
+				state->busMetrics.emplace_back(columnIndex, this->columns[columnIndex]->getRS485()->getMetrics());
+
+				for (const auto& portal : this->columns[columnIndex]->getAllPortals()) {
+					auto pilot = portal->getPilot();
+
+					State::PortalState portalState;
+					{
+						portalState.column = columnIndex;
+						portalState.target = portal->getTarget();
+						portalState.position = pilot->getPosition();
+						portalState.livePosition = pilot->getLivePosition();
+						portalState.inPosition = pilot->isInTargetPosition();
+					}
+					state->portals.push_back(portalState);
+				}
+			}
+
+			// Readers keep whichever snapshot they loaded for as long as they need it
+			atomic_store(&this->state, shared_ptr<const State>(state));
+		}
+
+		//----------
+		void
+			Installation::updateWorkerPool()
+		{
+			auto threadCount = this->parameters.threading.workerThreads.get();
+			if (threadCount < 0) {
+				threadCount = max((int)thread::hardware_concurrency(), 1) - 1;
 			}
+
+			// More workers than columns would only sit idle
+			threadCount = min(threadCount, max((int)this->columns.size() - 1, 0));
+
+			this->workerPool.setThreadCount((size_t)threadCount);
 		}
 
 		//----------
@@ -412,18 +559,18 @@ namespace Modules {
 				auto now = chrono::system_clock::now();
 				auto doSend = this->lastTransmitKeyframe + sendInterval <= now;
 				if (doSend) {
-					for (auto column : this->columns) {
-						column->transmitKeyframe();
-					}
+					this->workerPool.parallelFor(this->columns.size(), [this](size_t columnIndex) {
+						this->columns[columnIndex]->transmitKeyframe();
+						});
 					this->lastTransmitKeyframe = chrono::system_clock::now();
 				}
 				break;
 			}
 			case ImageTransmit::Inidividual:
 			{
-				for (auto column : this->columns) {
-					column->pushStale();
-				}
+				this->workerPool.parallelFor(this->columns.size(), [this](size_t columnIndex) {
+					this->columns[columnIndex]->pushStale();
+					});
 				break;
 			}
 			case ImageTransmit::Disabled:
@@ -454,6 +601,41 @@ namespace Modules {
 			return this->parameters.messaging.keyframeVelocities.get();
 		}
 
+		//----------
+		bool
+			Installation::getBinaryKeyframesEnabled() const
+		{
+			return this->parameters.messaging.binaryKeyframes.get();
+		}
+
+		//----------
+		int
+			Installation::getKeyframeAbsoluteInterval() const
+		{
+			return this->parameters.messaging.keyframeAbsoluteInterval.get();
+		}
+
+		//----------
+		bool
+			Installation::getBatchMovesEnabled() const
+		{
+			return this->parameters.messaging.batchMoves.get();
+		}
+
+		//----------
+		int
+			Installation::getMoveBatchSize() const
+		{
+			return this->parameters.messaging.moveBatchSize.get();
+		}
+
+		//----------
+		int
+			Installation::getReplySlot_us() const
+		{
+			return this->parameters.messaging.replySlot_us.get();
+		}
+
 		//----------
 		void
 			Installation::homeHardwareAndZeroPositions()
@@ -4,6 +4,8 @@
 
 #include "Column.h"
 #include "MassFWUpdate.h"
+#include "PositionFrame.h"
+#include "WorkerPool.h"
 
 namespace Modules {
 	namespace Hardware {
@@ -14,6 +16,22 @@ namespace Modules {
 				, (Inidividual, Keyframe, Disabled)
 				, ("Inidividual", "Keyframe", "Disabled"));
 
+			// Snapshot of the installation for other threads (e.g. GET /state), taken at the end of each update
+			struct State {
+				struct PortalState {
+					size_t column;
+					Portal::Target target;
+					glm::vec2 position; // target position on the Pilot
+					glm::vec2 livePosition; // as last reported by the portal
+					bool inPosition;
+				};
+
+				uint64_t frameIndex = 0;
+				glm::tvec2<size_t> resolution; // columns, rows
+				vector<PortalState> portals; // columns in order, then each column's portals in order
+				vector<pair<size_t, shared_ptr<const BusMetrics>>> busMetrics; // by column index
+			};
+
 			Installation();
 			~Installation();
 
@@ -44,19 +62,53 @@ namespace Modules {
 			void takeImage();
 			void transmitFrame();
 
+			// Thread safe. The frame is applied at the start of the next update and stays in force (the image isn't
+			// taken) until a newer frame arrives or Image/Posted frame hold expires
+			void postFrame(unique_ptr<PositionFrame>&&);
+			const PositionFrameMailbox& getFrameMailbox() const;
+
+			// Thread safe
+			shared_ptr<const State> getState() const;
+
+			// Main thread. Target positions for any set of columns (by index), each in the column's portal order.
+			// Solved together in one pass
+			void applyColumnPositions(const map<size_t, vector<glm::vec2>>& positionsByColumn);
+
 			chrono::system_clock::duration getTransmitKeyframeInterval() const;
 			int getTransmitKeyframeBatchSize() const;
 			bool getKeyframeVelocitiesEnabled() const;
+			bool getBinaryKeyframesEnabled() const;
+			int getKeyframeAbsoluteInterval() const;
+			bool getBatchMovesEnabled() const;
+			int getMoveBatchSize() const;
+			int getReplySlot_us() const;
 
 			void homeHardwareAndZeroPositions();
 		protected:
 			void rebuildPanel();
+			void applyPositions(const ofFloatPixels&);
+			void updateState();
+			void updateWorkerPool();
 
 			vector<shared_ptr<Column>> columns;
 			bool needsRebuildColumns = true;
 
 			shared_ptr<MassFWUpdate> massFWUpdate;
 
+			// Reused between frames in applyPositions
+			PerPortal::Kinematics::Batch kinematicsBatch;
+
+			// Columns share nothing but their Installation's (read only) settings, so their per-frame work runs
+			// here. Each parallelFor returns once every column is done, so the rest of update() (and the GUI) sees
+			// the columns as a whole frame. Tasks only compute and queue packets : nothing which touches ofxCvGui or
+			// fires ofParameter events runs on a worker (see Column::updateBus / updateGUI)
+			WorkerPool workerPool;
+
+			PositionFrameMailbox frameMailbox;
+
+			// Only accessed through atomic_load / atomic_store
+			shared_ptr<const State> state;
+
 			shared_ptr<ofxCvGui::Panels::Widgets> panel;
 			bool needsRebuildPanel = true;
 
@@ -66,12 +118,18 @@ namespace Modules {
 					ofParameter<float> periodS{ "Period [s]", 0.5, 0, 10 };
 					ofParameter<int> keyframeBatchSize{ "Keyframe batch size", 8 };
 					ofParameter<bool> keyframeVelocities{ "Keyframe velocities", true };
-					PARAM_DECLARE("Messaging", transmit, periodS, keyframeBatchSize, keyframeVelocities);
+					ofParameter<bool> binaryKeyframes{ "Binary keyframes", false };
+					ofParameter<int> keyframeAbsoluteInterval{ "Keyframe absolute interval", 10, 1, 100 };
+					ofParameter<bool> batchMoves{ "Batch moves", false };
+					ofParameter<int> moveBatchSize{ "Move batch size", 16 };
+					ofParameter<int> replySlot_us{ "Reply slot [us]", 4000 }; // at 115200 (shrinks with the negotiated baud rate)
+					PARAM_DECLARE("Messaging", transmit, periodS, keyframeBatchSize, keyframeVelocities, binaryKeyframes, keyframeAbsoluteInterval, batchMoves, moveBatchSize, replySlot_us);
 				} messaging;
 
 				struct : ofParameterGroup {
 					ofParameter<bool> enabled{ "Enabled", false };
-					PARAM_DECLARE("Image", enabled)
+					ofParameter<float> postedFrameHold_s{ "Posted frame hold [s]", 5.0f, 0.0f, 60.0f };
+					PARAM_DECLARE("Image", enabled, postedFrameHold_s)
 				} image;
 
 				struct : ofParameterGroup {
@@ -82,10 +140,16 @@ namespace Modules {
 					PARAM_DECLARE("Arrangement", columns, rows, columnWidth, flipped);
 				} arrangement;
 
-				PARAM_DECLARE("Installation", messaging, image, arrangement);
+				struct : ofParameterGroup {
+					ofParameter<int> workerThreads{ "Worker threads", -1 }; // -1 = one per core (besides the main thread), 0 = main thread only
+					PARAM_DECLARE("Threading", workerThreads);
+				} threading;
+
+				PARAM_DECLARE("Installation", messaging, image, arrangement, threading);
 			} parameters;
 
 			chrono::system_clock::time_point lastTransmitKeyframe = chrono::system_clock::now();
+			chrono::system_clock::time_point lastPostedFrame{}; // initialise to 0
 		};
 	}
 }
\ No newline at end of file
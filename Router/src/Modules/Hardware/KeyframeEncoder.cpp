@@ -0,0 +1,120 @@
+#include "pch_App.h"
+#include "KeyframeEncoder.h"
+
+namespace Modules {
+	//----------
+	msgpack11::MsgPack::binary
+		KeyframeEncoder::encodeBlock(uint8_t startIndex
+			, const vector<Values>& values
+			, bool velocities
+			, int absoluteInterval)
+	{
+		auto count = min(values.size(), (size_t)(256 - startIndex));
+		auto valueCount = velocities ? 4 : 2;
+
+		auto& block = this->blocks[startIndex];
+
+		// Decide if this block needs to be absolute
+		bool absolute = !block.hasBeenSent
+			|| block.count != count
+			|| block.velocities != velocities
+			|| block.blocksSinceAbsolute + 1 >= absoluteInterval;
+
+		// Find which portals have changed (and check that their deltas fit in int16)
+		vector<bool> changed(count, true);
+		if (!absolute) {
+			for (size_t i = 0; i < count && !absolute; i++) {
+				const auto& portal = this->portals[startIndex + i];
+				if (!portal.hasBeenSent) {
+					absolute = true;
+					break;
+				}
+
+				bool isChanged = false;
+				for (int j = 0; j < valueCount; j++) {
+					auto delta = (int64_t)values[i].values[j] - (int64_t)portal.lastSent.values[j];
+					if (delta < INT16_MIN || delta > INT16_MAX) {
+						absolute = true;
+						break;
+					}
+					if (delta != 0) {
+						isChanged = true;
+					}
+				}
+
+				// A moving portal is always sent (otherwise its extrapolation would stall)
+				if (velocities && (values[i].values[2] != 0 || values[i].values[3] != 0)) {
+					isChanged = true;
+				}
+
+				changed[i] = isChanged;
+			}
+		}
+		if (absolute) {
+			changed.assign(count, true);
+		}
+
+		// Header
+		msgpack11::MsgPack::binary data;
+		data.reserve(4 + (count + 7) / 8 + count * valueCount * 4);
+
+		block.seq++;
+
+		data.push_back((absolute ? KEYFRAME_FLAG_ABSOLUTE : 0)
+			| (velocities ? KEYFRAME_FLAG_VELOCITIES : 0));
+		data.push_back(block.seq);
+		data.push_back(startIndex);
+		data.push_back((uint8_t)count);
+
+		// Bitmap
+		{
+			auto bitmapOffset = data.size();
+			data.resize(bitmapOffset + (count + 7) / 8, 0);
+			for (size_t i = 0; i < count; i++) {
+				if (changed[i]) {
+					data[bitmapOffset + i / 8] |= (uint8_t)(1 << (i % 8));
+				}
+			}
+		}
+
+		// Entries
+		for (size_t i = 0; i < count; i++) {
+			if (!changed[i]) {
+				continue;
+			}
+
+			auto& portal = this->portals[startIndex + i];
+			for (int j = 0; j < valueCount; j++) {
+				auto value = values[i].values[j];
+				if (absolute) {
+					auto raw = (uint32_t)value;
+					data.push_back((uint8_t)(raw));
+					data.push_back((uint8_t)(raw >> 8));
+					data.push_back((uint8_t)(raw >> 16));
+					data.push_back((uint8_t)(raw >> 24));
+				}
+				else {
+					auto raw = (uint16_t)(int16_t)(value - portal.lastSent.values[j]);
+					data.push_back((uint8_t)(raw));
+					data.push_back((uint8_t)(raw >> 8));
+				}
+			}
+
+			portal.lastSent = values[i];
+			if (!velocities) {
+				// the firmware clears velocities when none are sent
+				portal.lastSent.values[2] = 0;
+				portal.lastSent.values[3] = 0;
+			}
+			portal.hasBeenSent = true;
+		}
+
+		// Update the block state
+		block.blocksSinceAbsolute = absolute ? 0 : block.blocksSinceAbsolute + 1;
+		block.count = count;
+		block.velocities = velocities;
+		block.hasBeenSent = true;
+
+		return data;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../msgpack11/msgpack11.hpp"
+
+namespace Modules {
+	/// <summary>
+	/// Encodes keyframe blocks in the compact binary format consumed by
+	/// KeyframeMotionControl::processIncomingBinary in PortalFW :
+	///
+	///   [0] flags (KEYFRAME_FLAG_*)
+	///   [1] seq (per block, increments on every block sent)
+	///   [2] startIndex (ID of the first portal in the block)
+	///   [3] count (number of IDs covered by the block)
+	///   [4..] bitmap, (count + 7) / 8 bytes, bit i set = ID startIndex + i has an entry
+	///   then for each set bit : posA, posB (, velA, velB)
+	///     as int32 LE if the block is absolute, otherwise int16 LE deltas against the last values sent
+	///
+	/// Portals whose values haven't changed since the last block are left out.
+	/// Every absoluteInterval blocks (or whenever a delta doesn't fit) the whole block
+	/// is sent absolute so that any portal which missed a block can resync.
+	///
+	/// This is only ever called from the serial thread (from a lazy packet renderer),
+	/// so that the deltas are always against what actually went out on the bus.
+	/// </summary>
+	class KeyframeEncoder {
+	public:
+		struct Values {
+			int32_t values[4]; // posA, posB, velA, velB
+		};
+
+		msgpack11::MsgPack::binary encodeBlock(uint8_t startIndex
+			, const vector<Values>&
+			, bool velocities
+			, int absoluteInterval);
+	protected:
+		struct PortalState {
+			Values lastSent;
+			bool hasBeenSent = false;
+		};
+
+		struct BlockState {
+			uint8_t seq = 0;
+			int blocksSinceAbsolute = 0;
+			size_t count = 0;
+			bool velocities = false;
+			bool hasBeenSent = false;
+		};
+
+		PortalState portals[256];
+		map<uint8_t, BlockState> blocks;
+	};
+}
+
+#define KEYFRAME_FLAG_ABSOLUTE (1 << 0)
+#define KEYFRAME_FLAG_VELOCITIES (1 << 1)
@@ -41,6 +41,9 @@ namespace Modules {
 				}
 			}
 
+			if (this->verification.active) {
+				this->updateVerification();
+			}
 		}
 
 		//----------
@@ -92,33 +95,12 @@ namespace Modules {
 			// Gather RS485 connections
 			auto rs485s = this->getRS485s();
 
-			vector<uint8_t> data;
-			{
-				// Read contents from file
-				{
-					auto file = ofFile(path);
-					auto fileBuffer = file.readToBuffer();
-					file.close();
-					auto size = fileBuffer.size();
-
-					if (fileBuffer.size() == 0) {
-						ofLogError("MassFWUpdate") << "Couldn't read file contents";
-						return;
-					}
-
-					auto rawData = (uint8_t*)fileBuffer.getData();
-					data.assign(rawData, rawData + fileBuffer.size());
-				}
-
-				// Truncate all 0xFFs from end of firmware
-				if (this->parameters.upload.truncate.get()) {
-					auto lastFF = data.size();
-					while (data[lastFF - 1] == 0xFF) {
-						lastFF--;
-					}
-
-					data.resize(lastFF);
-				}
+			// Encode every frame of the image once (the same frames go to every bus)
+			FWImage image;
+			if (!image.load(path
+				, (size_t) this->parameters.upload.frameSize.get()
+				, this->parameters.upload.truncate.get())) {
+				return;
 			}
 
 			// 0. Clear any existing messages in outboxs
@@ -148,63 +130,22 @@ namespace Modules {
 					}
 				}
 
-				// Send announcements whilst we're waiting for erase to finish
+				// Send announcements whilst we're waiting for erase to finish (by now the applications have rebooted,
+				// so this is the bootloader's own word, see FWUpdate::announceFirmwareLegacy)
 				for (int i = 0; i < 50; i++) {
 					for (auto rs485 : rs485s) {
-						this->announceFirmware(rs485);
+						this->announceFirmwareLegacy(rs485);
 					}
 					ofSleepMillis(100);
 				}
 			}
 
-			// 3. Upload
+			// 3. Upload (all buses at once)
 			{
 				progressAction("Uploading");
-
-				auto dataPosition = data.data();
-				auto dataEnd = dataPosition + data.size();
-				uint32_t packetIndex = 0;
-				const auto frameSize = this->parameters.upload.frameSize;
-				uint32_t frameOffset = 0;
-
-				while (dataPosition < dataEnd) {
-					auto remainingSize = dataEnd - dataPosition;
-					{
-						progressAction("Uploading : " + ofToString(remainingSize / 1024, 1) + "kB remaining");
-					}
-
-
-					if (remainingSize > frameSize) {
-						// Normal packets
-
-						for (int i = 0; i < this->parameters.upload.frameRepetitions.get(); i++) {
-							for (auto rs485 : rs485s) {
-								uploadFirmwarePacket(rs485
-									, frameOffset
-									, dataPosition
-									, FW_FRAME_SIZE);
-							}
-						}
-
-
-						dataPosition += frameSize;
-						frameOffset += frameSize;
-					}
-					else {
-						// Last packet
-
-						for (int i = 0; i < this->parameters.upload.frameRepetitions.get(); i++) {
-							for (auto rs485 : rs485s) {
-								uploadFirmwarePacket(rs485
-									, frameOffset
-									, dataPosition
-									, remainingSize);
-							}
-						}
-						dataPosition += remainingSize;
-						frameOffset += remainingSize;
-					}
-
+				auto completed = image.stream(rs485s, this->getStreamSettings(image), progressAction);
+				if (completed.size() < rs485s.size()) {
+					ofLogError(moduleName) << rs485s.size() - completed.size() << " of " << rs485s.size() << " buses didn't complete the upload";
 				}
 			}
 
@@ -214,6 +155,32 @@ namespace Modules {
 			{
 				this->parameters.announce.enabled = false;
 			}
+
+			// 5. Check that everybody comes back (see update)
+			if (this->parameters.verify.enabled.get()) {
+				this->startVerification();
+			}
+		}
+
+		//----------
+		bool
+			MassFWUpdate::isVerifying() const
+		{
+			return this->verification.active;
+		}
+
+		//----------
+		FWImage::StreamSettings
+			MassFWUpdate::getStreamSettings(const FWImage& image) const
+		{
+			const auto& upload = this->parameters.upload;
+
+			auto settings = image.getStreamSettings(upload.pacing
+				, upload.frameRepetitions.get()
+				, upload.waitBetweenFrames.get());
+			settings.framesInFlight = (size_t) max(upload.framesInFlight.get(), 1);
+			settings.stallTimeout = chrono::milliseconds((int)(upload.stallTimeout.get() * 1000.0f));
+			return settings;
 		}
 
 		//----------
@@ -239,164 +206,126 @@ namespace Modules {
 		}
 
 		//----------
+		// Reboots running applications into their bootloader (see FWUpdate::announceFirmware), and our end of the
+		// bus follows them to BAUD_RATE. A raw pointer, since the packet lives in this RS485's own outbox
 		void
 			MassFWUpdate::announceFirmware(shared_ptr<RS485> rs485)
 		{
-			this->sendMagicWord(rs485, 'F', 'W');
+			auto rs485Pointer = rs485.get();
+			this->sendMagicWord(rs485, "FW!KC79", [rs485Pointer]() {
+				rs485Pointer->serialThreadFallBackToBootBaudRate();
+				});
+		}
+
+		//----------
+		// The bootloader's own announce word (see FWUpdate::announceFirmwareLegacy)
+		void
+			MassFWUpdate::announceFirmwareLegacy(shared_ptr<RS485> rs485)
+		{
+			this->sendMagicWord(rs485, "FW");
 		}
 
 		//----------
 		void
 			MassFWUpdate::eraseFirmware(shared_ptr<RS485> rs485)
 		{
-			this->sendMagicWord(rs485, 'E', 'R');
+			this->sendMagicWord(rs485, "ER");
 		}
 
 		//----------
 		void
 			MassFWUpdate::runApplication(shared_ptr<RS485> rs485)
 		{
-			this->sendMagicWord(rs485, 'R', 'U');
+			this->sendMagicWord(rs485, "RU");
 		}
 
 		//----------
 		void
-			MassFWUpdate::sendMagicWord(shared_ptr<RS485> rs485, char a, char b)
+			MassFWUpdate::sendMagicWord(shared_ptr<RS485> rs485, const string& magicWord, const function<void()>& onSent)
 		{
-			if (!rs485) {
-				ofLogError("No RS485");
-				return;
-			}
-			if (!rs485->isConnected()) {
-				// No connection
-				return;
-			}
-
-			msgpack_sbuffer messageBuffer;
-			msgpack_packer packer;
-			msgpack_sbuffer_init(&messageBuffer);
-			msgpack_packer_init(&packer
-				, &messageBuffer
-				, msgpack_sbuffer_write);
-
-			msgpack_pack_array(&packer, 3);
-			{
-				// First element is target address
-				msgpack_pack_fix_int8(&packer, -1);
-
-				// Second element is source address
-				msgpack_pack_fix_int8(&packer, 0);
-
-				// Third element is the message body
-				string magicWord;
-				magicWord.resize(2);
-				magicWord[0] = a;
-				magicWord[1] = b;
-				msgpack_pack_str(&packer, magicWord.size());
-				msgpack_pack_str_body(&packer, magicWord.c_str(), magicWord.size());
-			}
-
-			// Send packet
-			{
-				auto packet = RS485::Packet(messageBuffer);
-				packet.needsACK = false;
-				packet.customWaitTime_ms = this->parameters.upload.waitBetweenFrames.get();
-
-				// send and wait for complete
-				{
-					std::promise<void> promise;
-					packet.onSent = [&promise]() {
-						promise.set_value();
-						};
-					rs485->transmit(packet);
-
-					// wait for packet to be sent
-					promise.get_future().get();
-				}
-			}
-
-			msgpack_sbuffer_destroy(&messageBuffer);
+			FWImage::send(rs485
+				, FWImage::encodeMagicWord(magicWord)
+				, this->parameters.upload.waitBetweenFrames.get()
+				, onSent);
 
 			this->announce.lastSend = chrono::system_clock::now();
 		}
 
 		//----------
 		void
-			MassFWUpdate::uploadFirmwarePacket(shared_ptr<RS485> rs485
-				, uint32_t frameOffset
-				, uint8_t* packetData
-				, size_t packetSize)
+			MassFWUpdate::startVerification()
+		{
+			auto now = chrono::system_clock::now();
+			auto delay = chrono::milliseconds((int)(this->parameters.verify.delay.get() * 1000.0f));
+			auto timeout = chrono::milliseconds((int)(this->parameters.verify.timeout.get() * 1000.0f));
+
+			this->verification.active = true;
+			this->verification.start = now;
+			this->verification.nextPoll = now + delay;
+			this->verification.deadline = now + delay + timeout;
+		}
+
+		//----------
+		void
+			MassFWUpdate::updateVerification()
 		{
-			// Prepend the data with checksum
-			auto checksum = Utils::calcCheckSum((uint8_t*)packetData, packetSize);
-			auto checksumBytes = (uint8_t*)&checksum;
-			vector<uint8_t> packetBody;
-			for (int i = 0; i < sizeof(Utils::CRCType); i++) {
-				packetBody.push_back(checksumBytes[i]);
+			auto now = chrono::system_clock::now();
+			if (now < this->verification.nextPoll && now < this->verification.deadline) {
+				return;
 			}
 
+			// Find who hasn't replied since the upload
+			auto columns = App::X()->getInstallation()->getAllColumns();
+			vector<pair<shared_ptr<Column>, shared_ptr<Portal>>> waiting;
+			size_t portalCount = 0;
+			for (auto column : columns) {
+				for (auto portal : column->getAllPortals()) {
+					portalCount++;
+					if (portal->getLastIncomingTime() <= this->verification.start) {
+						waiting.emplace_back(column, portal);
+					}
+				}
+			}
 
-			// Add the data to the packet
-			packetBody.insert(packetBody.end()
-				, packetData
-				, packetData + packetSize);
+			if (!waiting.empty() && now < this->verification.deadline) {
+				// Poll them again
+				for (const auto& it : waiting) {
+					it.second->poll();
+				}
+				this->verification.nextPoll = now + chrono::milliseconds((int)(this->parameters.verify.pollPeriod.get() * 1000.0f));
+				return;
+			}
 
-			// Transmit via msgpack
+			// Report
 			{
-				msgpack_sbuffer messageBuffer;
-				msgpack_packer packer;
-				msgpack_sbuffer_init(&messageBuffer);
-				msgpack_packer_init(&packer
-					, &messageBuffer
-					, msgpack_sbuffer_write);
-
-				// The broadcast packet header
-				msgpack_pack_array(&packer, 3);
-				{
-					// First element is target address
-					msgpack_pack_fix_int8(&packer, -1);
-
-					// Second element is source address
-					msgpack_pack_fix_int8(&packer, 0);
-
-					// Third element is the message body
-					msgpack_pack_map(&packer, 1);
-					{
-						// Key is the packet index
-						if (sizeof(Utils::CRCType) == 2) {
-							msgpack_pack_uint32(&packer, frameOffset);
-						}
-						else if (sizeof(Utils::CRCType) == 4) {
-							msgpack_pack_uint32(&packer, frameOffset);
-						}
+				auto moduleName = "MassFWUpdate::verify";
 
-						// Value is the data
-						msgpack_pack_bin(&packer, packetBody.size());
-						msgpack_pack_bin_body(&packer, packetBody.data(), packetBody.size());
+				map<string, size_t> versionCounts;
+				for (auto column : columns) {
+					for (auto portal : column->getAllPortals()) {
+						if (portal->getLastIncomingTime() > this->verification.start) {
+							auto version = portal->getVersion();
+							versionCounts[version.empty() ? "[unknown]" : version]++;
+						}
 					}
+				}
 
+				stringstream versions;
+				for (const auto& versionCount : versionCounts) {
+					versions << " " << versionCount.first << " (" << versionCount.second << ")";
 				}
+				ofLogNotice(moduleName) << (portalCount - waiting.size()) << " of " << portalCount << " portals replied. Versions :" << versions.str();
 
-				// Send packet
-				{
-					auto packet = RS485::Packet(messageBuffer);
-					packet.needsACK = false;
-					packet.customWaitTime_ms = this->parameters.upload.waitBetweenFrames.get();
-					packet.collateable = false;
-
-					// send and wait for complete
-					std::promise<void> promise;
-					packet.onSent = [&promise]() {
-						promise.set_value();
-						};
-					rs485->transmit(packet);
-
-					// wait for packet to be sent
-					promise.get_future().get();
+				if (versionCounts.size() > 1) {
+					ofLogWarning(moduleName) << "Portals report more than one version";
 				}
 
-				msgpack_sbuffer_destroy(&messageBuffer);
+				for (const auto& it : waiting) {
+					ofLogError(moduleName) << "Column " << it.first->getName() << " portal " << (int) it.second->getTarget() << " didn't reply";
+				}
 			}
+
+			this->verification.active = false;
 		}
 	}
 }
@@ -2,6 +2,7 @@
 
 #include "../Base.h"
 #include "RS485.h"
+#include "FWImage.h"
 
 #define FW_FRAME_SIZE 32
 
@@ -18,18 +19,22 @@ namespace Modules {
 
 			void populateInspector(ofxCvGui::InspectArguments&);
 			void uploadFirmware(const string& path, const function<void(const string&)>& onProgress = nullptr);
+			bool isVerifying() const;
 		protected:
 			vector<shared_ptr<RS485>> getRS485s() const;
 
 			void announceFirmware(shared_ptr<RS485>);
+			void announceFirmwareLegacy(shared_ptr<RS485>);
 			void eraseFirmware(shared_ptr<RS485>);
-			void uploadFirmwarePacket(shared_ptr<RS485>
-				, uint32_t frameOffset
-				, uint8_t* packetData
-				, size_t packetSize);
 			void runApplication(shared_ptr<RS485>);
 
-			void sendMagicWord(shared_ptr<RS485>, char, char);
+			void sendMagicWord(shared_ptr<RS485>, const string&, const function<void()>& onSent = nullptr);
+
+			// From the upload parameters
+			FWImage::StreamSettings getStreamSettings(const FWImage&) const;
+
+			void startVerification();
+			void updateVerification();
 
 			struct : ofParameterGroup {
 				struct : ofParameterGroup {
@@ -43,15 +48,36 @@ namespace Modules {
 					ofParameter<int> frameSize{ "Frame size", FW_FRAME_SIZE };
 					ofParameter<int> waitBetweenFrames{ "Wait between frames [ms]", 10 };
 					ofParameter<int> frameRepetitions{ "Frame repetitions", 6 };
-					PARAM_DECLARE("Upload", truncate, frameSize, waitBetweenFrames, frameRepetitions);
+					ofParameter<int> framesInFlight{ "Frames in flight per bus", 8 };
+					ofParameter<float> stallTimeout{ "Stall timeout [s]", 5.0f };
+
+					FWImage::Pacing pacing;
+
+					PARAM_DECLARE("Upload", truncate, frameSize, waitBetweenFrames, frameRepetitions, framesInFlight, stallTimeout, pacing);
 				} upload;
 
-				PARAM_DECLARE("MassFWUpdate", announce, upload)
+				struct : ofParameterGroup {
+					ofParameter<bool> enabled{ "Enabled", true };
+					ofParameter<float> delay{ "Delay [s]", 5.0f }; // for the bootloader to give up waiting and run the application
+					ofParameter<float> pollPeriod{ "Poll period [s]", 1.0f };
+					ofParameter<float> timeout{ "Timeout [s]", 20.0f };
+					PARAM_DECLARE("Verify", enabled, delay, pollPeriod, timeout);
+				} verify;
+
+				PARAM_DECLARE("MassFWUpdate", announce, upload, verify)
 			} parameters;
 
 			struct {
 				chrono::system_clock::time_point lastSend{}; // initalise to 0
 			} announce;
+
+			// Poll every portal after an upload until each has replied (with its version) or we time out
+			struct {
+				bool active = false;
+				chrono::system_clock::time_point start;
+				chrono::system_clock::time_point nextPoll;
+				chrono::system_clock::time_point deadline;
+			} verification;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "pch_App.h"
+#include "Kinematics.h"
+
+#include <atomic>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#	include <intrin.h>
+#	define KINEMATICS_AVX2
+#	define KINEMATICS_AVX2_TARGET
+#elif defined(__GNUC__) && defined(__x86_64__)
+#	include <immintrin.h>
+#	define KINEMATICS_AVX2
+#	define KINEMATICS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace Modules {
+	namespace PerPortal {
+		namespace {
+			// How many portals we process at a time in solvePositions (keeps scratch on the stack)
+			const size_t chunkSize = 256;
+
+			// See Kinematics::setAVX2Enabled
+			std::atomic<bool> avx2Allowed{ true };
+
+#pragma mark Scalar
+			// These are the same expressions as in Pilot.cpp, kept in the same form so that the
+			// float/double promotions (and therefore the results) are identical
+
+			//----------
+			inline void
+				polarToAxesScalar(float r, float theta, float offset, float& a, float& b)
+			{
+				// Special case for see-through
+				if (r == 0) {
+					a = 0.5f;
+					b = 0.0f;
+					return;
+				}
+
+				const auto thetaNorm = theta / TWO_PI - 0.5f;
+				a = (float)(thetaNorm - (1 - r) * 0.25 + 0.5 - offset);
+				b = (float)(thetaNorm + (1 - r) * 0.25 + 0.5 + offset);
+			}
+
+			//----------
+			inline Steps
+				axisToStepsScalar(float axisValue, float microstepsPerPrismRotation, int axisIndex)
+			{
+				float invert = axisIndex == 1 ? -1.0f : 1.0f;
+				return (Steps) ofMap(axisValue
+					, 0
+					, 1
+					, 0
+					, invert * microstepsPerPrismRotation);
+			}
+
+			//----------
+			inline float
+				stepsToAxisScalar(Steps stepsValue, float microstepsPerPrismRotation, int axisIndex)
+			{
+				float invert = axisIndex == 1 ? -1.0f : 1.0f;
+				return ofMap(stepsValue
+					, 0
+					, invert * microstepsPerPrismRotation
+					, 0
+					, 1);
+			}
+
+#pragma mark AVX2
+#ifdef KINEMATICS_AVX2
+			//----------
+			bool
+				detectAVX2()
+			{
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7) {
+					return false;
+				}
+
+				// AVX needs to be supported by the CPU and enabled by the OS
+				__cpuid(info, 1);
+				const bool osxsave = (info[2] & (1 << 27)) != 0;
+				const bool avx = (info[2] & (1 << 28)) != 0;
+				if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+					return false;
+				}
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#else
+				return __builtin_cpu_supports("avx2");
+#endif
+			}
+
+			//----------
+			KINEMATICS_AVX2_TARGET inline __m256
+				combine(__m128 low, __m128 high)
+			{
+				return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+			}
+
+			//----------
+			// 4 lanes of the double precision part of polarToAxes
+			KINEMATICS_AVX2_TARGET inline void
+				polarToAxesHalf(__m128 theta, __m128 oneMinusR, __m128 offset, __m128& a, __m128& b)
+			{
+				const auto thetaNorm = _mm256_sub_pd(_mm256_div_pd(_mm256_cvtps_pd(theta), _mm256_set1_pd(TWO_PI))
+					, _mm256_set1_pd(0.5));
+				const auto lens = _mm256_mul_pd(_mm256_cvtps_pd(oneMinusR), _mm256_set1_pd(0.25));
+				const auto offsetD = _mm256_cvtps_pd(offset);
+				const auto half = _mm256_set1_pd(0.5);
+
+				a = _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_add_pd(_mm256_sub_pd(thetaNorm, lens), half), offsetD));
+				b = _mm256_cvtpd_ps(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(thetaNorm, lens), half), offsetD));
+			}
+
+			//----------
+			KINEMATICS_AVX2_TARGET size_t
+				polarToAxesAVX2(const float* r, const float* theta, const float* offset, float* a, float* b, size_t count)
+			{
+				size_t i = 0;
+				for (; i + 8 <= count; i += 8) {
+					const auto r8 = _mm256_loadu_ps(r + i);
+					const auto theta8 = _mm256_loadu_ps(theta + i);
+					const auto offset8 = _mm256_loadu_ps(offset + i);
+					const auto oneMinusR = _mm256_sub_ps(_mm256_set1_ps(1.0f), r8);
+
+					__m128 aLow, bLow, aHigh, bHigh;
+					polarToAxesHalf(_mm256_castps256_ps128(theta8)
+						, _mm256_castps256_ps128(oneMinusR)
+						, _mm256_castps256_ps128(offset8)
+						, aLow
+						, bLow);
+					polarToAxesHalf(_mm256_extractf128_ps(theta8, 1)
+						, _mm256_extractf128_ps(oneMinusR, 1)
+						, _mm256_extractf128_ps(offset8, 1)
+						, aHigh
+						, bHigh);
+
+					// Special case for see-through
+					const auto seeThrough = _mm256_cmp_ps(r8, _mm256_setzero_ps(), _CMP_EQ_OQ);
+					_mm256_storeu_ps(a + i, _mm256_blendv_ps(combine(aLow, aHigh), _mm256_set1_ps(0.5f), seeThrough));
+					_mm256_storeu_ps(b + i, _mm256_blendv_ps(combine(bLow, bHigh), _mm256_setzero_ps(), seeThrough));
+				}
+				return i;
+			}
+
+			//----------
+			// std::round (i.e. half away from zero, keeping the sign of zero)
+			KINEMATICS_AVX2_TARGET inline __m256
+				roundAVX2(__m256 x)
+			{
+				const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+				const auto truncated = _mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+				const auto fraction = _mm256_and_ps(_mm256_sub_ps(x, truncated), absMask);
+				const auto needsStep = _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+				const auto step = _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_andnot_ps(absMask, x));
+				return _mm256_blendv_ps(truncated, _mm256_add_ps(truncated, step), needsStep);
+			}
+
+			//----------
+			KINEMATICS_AVX2_TARGET size_t
+				findClosestAxesCycleAVX2(float* a, float* b, const float* currentA, const uint8_t* cyclic, size_t count)
+			{
+				size_t i = 0;
+				for (; i + 8 <= count; i += 8) {
+					const auto cyclicMask = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+						_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(cyclic + i)))
+						, _mm256_setzero_si256()));
+
+					const auto a8 = _mm256_loadu_ps(a + i);
+					const auto b8 = _mm256_loadu_ps(b + i);
+					const auto current8 = _mm256_loadu_ps(currentA + i);
+
+					const auto adjustedA = _mm256_add_ps(a8, roundAVX2(_mm256_sub_ps(current8, a8)));
+					const auto adjustedB = _mm256_add_ps(b8, roundAVX2(_mm256_sub_ps(current8, b8)));
+
+					_mm256_storeu_ps(a + i, _mm256_blendv_ps(a8, adjustedA, cyclicMask));
+					_mm256_storeu_ps(b + i, _mm256_blendv_ps(b8, adjustedB, cyclicMask));
+				}
+				return i;
+			}
+
+			//----------
+			KINEMATICS_AVX2_TARGET size_t
+				axisToStepsAVX2(const float* axis, const float* microstepsPerPrismRotation, int axisIndex, Steps* steps, size_t count)
+			{
+				const auto invert = _mm256_set1_ps(axisIndex == 1 ? -1.0f : 1.0f);
+				const auto zero = _mm256_setzero_ps();
+				const auto one = _mm256_set1_ps(1.0f);
+
+				size_t i = 0;
+				for (; i + 8 <= count; i += 8) {
+					// ofMap(axisValue, 0, 1, 0, outputMax)
+					const auto outputMax = _mm256_mul_ps(invert, _mm256_loadu_ps(microstepsPerPrismRotation + i));
+					auto value = _mm256_sub_ps(_mm256_loadu_ps(axis + i), zero);
+					value = _mm256_div_ps(value, _mm256_sub_ps(one, zero));
+					value = _mm256_mul_ps(value, _mm256_sub_ps(outputMax, zero));
+					value = _mm256_add_ps(value, zero);
+					_mm256_storeu_si256((__m256i*)(steps + i), _mm256_cvttps_epi32(value));
+				}
+				return i;
+			}
+
+			//----------
+			KINEMATICS_AVX2_TARGET size_t
+				stepsToAxisAVX2(const Steps* steps, const float* microstepsPerPrismRotation, int axisIndex, float* axis, size_t count)
+			{
+				const auto invert = _mm256_set1_ps(axisIndex == 1 ? -1.0f : 1.0f);
+				const auto zero = _mm256_setzero_ps();
+				const auto one = _mm256_set1_ps(1.0f);
+				const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+				const auto epsilon = _mm256_set1_ps(numeric_limits<float>::epsilon());
+
+				size_t i = 0;
+				for (; i + 8 <= count; i += 8) {
+					// ofMap(stepsValue, 0, inputMax, 0, 1)
+					const auto inputMax = _mm256_mul_ps(invert, _mm256_loadu_ps(microstepsPerPrismRotation + i));
+					const auto degenerate = _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(zero, inputMax), absMask), epsilon, _CMP_LT_OQ);
+
+					auto value = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(steps + i)));
+					value = _mm256_sub_ps(value, zero);
+					value = _mm256_div_ps(value, _mm256_sub_ps(inputMax, zero));
+					value = _mm256_mul_ps(value, _mm256_sub_ps(one, zero));
+					value = _mm256_add_ps(value, zero);
+					_mm256_storeu_ps(axis + i, _mm256_blendv_ps(value, zero, degenerate));
+				}
+				return i;
+			}
+#endif
+		}
+
+		//----------
+		void
+			Kinematics::Batch::resize(size_t size)
+		{
+			this->positionX.resize(size);
+			this->positionY.resize(size);
+			this->currentA.resize(size);
+			this->offset.resize(size);
+			this->microstepsPerPrismRotation.resize(size);
+			this->cyclic.resize(size);
+
+			this->r.resize(size);
+			this->theta.resize(size);
+			this->a.resize(size);
+			this->b.resize(size);
+			this->stepsA.resize(size);
+			this->stepsB.resize(size);
+		}
+
+		//----------
+		size_t
+			Kinematics::Batch::size() const
+		{
+			return this->positionX.size();
+		}
+
+		//----------
+		void
+			Kinematics::solvePositions(Batch& batch)
+		{
+			const auto count = batch.size();
+
+			// position to polar
+			positionToPolar(batch.positionX.data()
+				, batch.positionY.data()
+				, batch.r.data()
+				, batch.theta.data()
+				, count);
+
+			// clamp max r value
+			for (size_t i = 0; i < count; i++) {
+				if (batch.r[i] > 1.0f) {
+					batch.r[i] = 1.0f;
+					batch.positionX[i] = batch.r[i] * cos(batch.theta[i]);
+					batch.positionY[i] = batch.r[i] * sin(batch.theta[i]);
+				}
+			}
+
+			// polar to axes
+			polarToAxes(batch.r.data()
+				, batch.theta.data()
+				, batch.offset.data()
+				, batch.a.data()
+				, batch.b.data()
+				, count);
+
+			// cyclical
+			findClosestAxesCycle(batch.a.data()
+				, batch.b.data()
+				, batch.currentA.data()
+				, batch.cyclic.data()
+				, count);
+
+			// alias the axis values to whole steps, then take the steps of the aliased values
+			// (which is what Pilot::getAxisSteps will return afterwards)
+			float aliased[chunkSize];
+			for (size_t chunkStart = 0; chunkStart < count; chunkStart += chunkSize) {
+				const auto chunkCount = min(chunkSize, count - chunkStart);
+				const auto microsteps = batch.microstepsPerPrismRotation.data() + chunkStart;
+
+				for (int axisIndex = 0; axisIndex < 2; axisIndex++) {
+					auto axis = (axisIndex == 0 ? batch.a.data() : batch.b.data()) + chunkStart;
+					auto steps = (axisIndex == 0 ? batch.stepsA.data() : batch.stepsB.data()) + chunkStart;
+
+					axisToSteps(axis, microsteps, axisIndex, steps, chunkCount);
+					stepsToAxis(steps, microsteps, axisIndex, aliased, chunkCount);
+					for (size_t i = 0; i < chunkCount; i++) {
+						if (axis[i] != aliased[i]) {
+							axis[i] = aliased[i];
+						}
+					}
+					axisToSteps(axis, microsteps, axisIndex, steps, chunkCount);
+				}
+			}
+		}
+
+		//----------
+		void
+			Kinematics::positionToPolar(const float* x, const float* y, float* r, float* theta, size_t count)
+		{
+			// glm::length
+			for (size_t i = 0; i < count; i++) {
+				r[i] = sqrt(x[i] * x[i] + y[i] * y[i]);
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				theta[i] = atan2(y[i], x[i]);
+			}
+		}
+
+		//----------
+		void
+			Kinematics::polarToAxes(const float* r, const float* theta, const float* offset, float* a, float* b, size_t count)
+		{
+			size_t i = 0;
+#ifdef KINEMATICS_AVX2
+			if (isAVX2Enabled()) {
+				i = polarToAxesAVX2(r, theta, offset, a, b, count);
+			}
+#endif
+			for (; i < count; i++) {
+				polarToAxesScalar(r[i], theta[i], offset[i], a[i], b[i]);
+			}
+		}
+
+		//----------
+		void
+			Kinematics::findClosestAxesCycle(float* a, float* b, const float* currentA, const uint8_t* cyclic, size_t count)
+		{
+			size_t i = 0;
+#ifdef KINEMATICS_AVX2
+			if (isAVX2Enabled()) {
+				i = findClosestAxesCycleAVX2(a, b, currentA, cyclic, count);
+			}
+#endif
+			for (; i < count; i++) {
+				if (cyclic[i]) {
+					// Note that both axes are cycled relative to current A (as in Pilot::findClosestAxesCycle)
+					const auto targetA = a[i];
+					const auto targetB = b[i];
+					a[i] = targetA + std::round(currentA[i] - targetA);
+					b[i] = targetB + std::round(currentA[i] - targetB);
+				}
+			}
+		}
+
+		//----------
+		void
+			Kinematics::axisToSteps(const float* axis, const float* microstepsPerPrismRotation, int axisIndex, Steps* steps, size_t count)
+		{
+			size_t i = 0;
+#ifdef KINEMATICS_AVX2
+			if (isAVX2Enabled()) {
+				i = axisToStepsAVX2(axis, microstepsPerPrismRotation, axisIndex, steps, count);
+			}
+#endif
+			for (; i < count; i++) {
+				steps[i] = axisToStepsScalar(axis[i], microstepsPerPrismRotation[i], axisIndex);
+			}
+		}
+
+		//----------
+		void
+			Kinematics::stepsToAxis(const Steps* steps, const float* microstepsPerPrismRotation, int axisIndex, float* axis, size_t count)
+		{
+			size_t i = 0;
+#ifdef KINEMATICS_AVX2
+			if (isAVX2Enabled()) {
+				i = stepsToAxisAVX2(steps, microstepsPerPrismRotation, axisIndex, axis, count);
+			}
+#endif
+			for (; i < count; i++) {
+				axis[i] = stepsToAxisScalar(steps[i], microstepsPerPrismRotation[i], axisIndex);
+			}
+		}
+
+		//----------
+		bool
+			Kinematics::isAVX2Enabled()
+		{
+#ifdef KINEMATICS_AVX2
+			static const bool supported = detectAVX2();
+			return supported && avx2Allowed;
+#else
+			return false;
+#endif
+		}
+
+		//----------
+		void
+			Kinematics::setAVX2Enabled(bool enabled)
+		{
+			avx2Allowed = enabled;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../../Types.h"
+
+namespace Modules {
+	namespace PerPortal {
+		/// <summary>
+		/// Batched (structure of arrays) version of the Pilot's Position -> Polar -> Axes -> Steps
+		/// chain, so that a whole image frame can be solved in one pass rather than through
+		/// Pilot::setPosition / Pilot::update per portal.
+		///
+		/// Results are bit-exact with the scalar functions in Pilot.cpp (see
+		/// RouterRS/tests-fixtures/pilot_oracle.cpp), including the double promotion through TWO_PI
+		/// and findClosestAxesCycle using current[0] for both axes. Router/core/tests/Kinematics.cpp
+		/// checks both paths against the golden vectors.
+		///
+		/// The arithmetic stages (polarToAxes, cyclic, steps, aliasing) run 8-wide with AVX2 when
+		/// the CPU supports it. positionToPolar stays scalar since atan2f has no bit-exact vector form.
+		/// </summary>
+		class Kinematics {
+		public:
+			struct Batch {
+				void resize(size_t);
+				size_t size() const;
+
+				// Inputs (per portal)
+				vector<float> positionX;
+				vector<float> positionY;
+				vector<float> currentA; // current axis A value (used for cyclic navigation)
+				vector<float> offset;
+				vector<float> microstepsPerPrismRotation;
+				vector<uint8_t> cyclic;
+
+				// Outputs (position is clamped in place to r <= 1)
+				vector<float> r;
+				vector<float> theta;
+				vector<float> a;
+				vector<float> b;
+				vector<Steps> stepsA;
+				vector<Steps> stepsB;
+			};
+
+			// Solve the whole chain as Pilot::update does with LeadingControl::Position
+			static void solvePositions(Batch&);
+
+			// Individual stages (exposed for checking against the golden vectors)
+			static void positionToPolar(const float* x, const float* y, float* r, float* theta, size_t count);
+			static void polarToAxes(const float* r, const float* theta, const float* offset, float* a, float* b, size_t count);
+			static void findClosestAxesCycle(float* a, float* b, const float* currentA, const uint8_t* cyclic, size_t count);
+			static void axisToSteps(const float* axis, const float* microstepsPerPrismRotation, int axisIndex, Steps* steps, size_t count);
+			static void stepsToAxis(const Steps* steps, const float* microstepsPerPrismRotation, int axisIndex, float* axis, size_t count);
+
+			static bool isAVX2Enabled();
+
+			// Disabling forces the scalar path (e.g. to check it against the AVX2 one). Enabling has no effect if
+			// the CPU doesn't support AVX2
+			static void setAVX2Enabled(bool);
+		};
+	}
+}
@@ -125,6 +125,14 @@ namespace Modules {
 		//----------
 		void
 			Logger::update()
+		{
+			// Limit max message count
+			this->limitMaxMessages();
+		}
+
+		//----------
+		void
+			Logger::updatePanels()
 		{
 			// Clear out panels that are not being used
 			for (auto it = this->panels.begin(); it != this->panels.end();) {
@@ -137,9 +145,6 @@ namespace Modules {
 				}
 			}
 
-			// Limit max message count
-			this->limitMaxMessages();
-
 			// Refresh panels if stale
 			if(this->panelsStale) {
 				this->refreshPanels();
@@ -187,6 +192,18 @@ namespace Modules {
 						message.timetamp = (float)((uint32_t)jsonMessage["timestamp_ms"]) / 1000.0f;
 					}
 
+					// Add to the session report
+					{
+						Reports::Event event;
+						event.type = Reports::Event::Type::PortalLog;
+						event.level = (uint8_t)message.level;
+						event.setText(message.message.c_str(), message.message.size());
+						if (jsonMessage.contains("timestamp_ms")) {
+							event.value = (uint32_t)jsonMessage["timestamp_ms"];
+						}
+						this->portal->record(event);
+					}
+
 					// Check if should add to existing
 					bool foundExisting = false;
 					if (!this->logMessages.empty()) {
@@ -38,6 +38,9 @@ namespace Modules {
 
 			void init();
 			void update();
+
+			// Main thread only (update may run on a worker) : the panels are ofxCvGui widgets
+			void updatePanels();
 			void populateInspector(ofxCvGui::InspectArguments& args);
 			ofxCvGui::PanelPtr getPanel();
 
@@ -365,7 +365,7 @@ namespace Modules {
 					}
 				}
 			};
-			this->portal->sendToPortal(message, this->getFWModuleName() + "/testTimer");
+			this->portal->sendToPortal(message, this->getFWModuleName() + "/testTimer", RS485::Priority::Diagnostic);
 		}
 
 		//----------
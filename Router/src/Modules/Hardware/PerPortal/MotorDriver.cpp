@@ -74,7 +74,7 @@ namespace Modules {
 					}
 				}
 			};
-			this->portal->sendToPortal(message, "motorDriver/testRoutine");
+			this->portal->sendToPortal(message, "motorDriver/testRoutine", RS485::Priority::Diagnostic);
 		}
 
 		//----------
@@ -102,7 +102,7 @@ namespace Modules {
 					}
 				}
 			};
-			this->portal->sendToPortal(message, "motorDriver/testTimer");
+			this->portal->sendToPortal(message, "motorDriver/testTimer", RS485::Priority::Diagnostic);
 		}
 	}
 }
\ No newline at end of file
@@ -42,11 +42,19 @@ namespace Modules {
 		void
 			Pilot::update()
 		{
+			// A batched solve has already done the whole chain (and the aliasing) for this frame
+			if (this->solved.solvedByBatch && this->values.leadingControl.get() == LeadingControl::Position) {
+				this->solved.solvedByBatch = false;
+				this->updateLiveAxisValues();
+				return;
+			}
+			this->solved.solvedByBatch = false;
+
 			// Calculate other values from the leading control
-			switch (this->parameters.leadingControl.get().get()) {
+			switch (this->values.leadingControl.get()) {
 			case LeadingControl::Position:
 			{
-				auto position = this->getPosition();
+				auto position = this->values.position;
 
 				// position to polar
 				auto polar = this->positionToPolar(position);
@@ -54,14 +62,10 @@ namespace Modules {
 					// clamp max r value
 					if (polar[0] > 1.0f) {
 						polar[0] = 1.0f;
-						position = this->polarToPosition({ polar[0], polar[1] });
-						this->setPosition(position);
+						this->values.position = this->polarToPosition({ polar[0], polar[1] });
 					}
 
-					{
-						this->parameters.polar.r.set(polar[0]);
-						this->parameters.polar.theta.set(polar[1]);
-					}
+					this->values.polar = polar;
 				}
 
 				// polar to axes
@@ -73,25 +77,16 @@ namespace Modules {
 						axes = this->findClosestAxesCycle(axes);
 					}
 
-					{
-						this->parameters.axes.a.set(axes[0]);
-						this->parameters.axes.b.set(axes[1]);
-					}
+					this->values.axes = axes;
 				}
 				break;
 			}
 			case LeadingControl::Polar:
 			{
-				auto polar = this->getPolar();
+				auto polar = this->values.polar;
 
 				// polar to position
-				{
-					auto position = this->polarToPosition(polar);
-					{
-						this->parameters.position.x.set(position[0]);
-						this->parameters.position.y.set(position[1]);
-					}
-				}
+				this->values.position = this->polarToPosition(polar);
 
 				// polar to axes
 				{
@@ -102,30 +97,18 @@ namespace Modules {
 						axes = this->findClosestAxesCycle(axes);
 					}
 
-					{
-						this->parameters.axes.a.set(axes[0]);
-						this->parameters.axes.b.set(axes[1]);
-					}
+					this->values.axes = axes;
 				}
 				break;
 			}
 			case LeadingControl::Axes:
 			{
-				auto axes = this->getAxes();
-
 				// axes to polar
-				auto polar = this->axesToPolar(axes);
-				{
-					this->parameters.polar.r.set(polar[0]);
-					this->parameters.polar.theta.set(polar[1]);
-				}
+				auto polar = this->axesToPolar(this->values.axes);
+				this->values.polar = polar;
 
 				// polar to position
-				auto position = this->polarToPosition(polar);
-				{
-					this->parameters.position.x.set(position[0]);
-					this->parameters.position.y.set(position[1]);
-				}
+				this->values.position = this->polarToPosition(polar);
 
 				break;
 			}
@@ -134,56 +117,105 @@ namespace Modules {
 			}
 
 			// alias the axis values
-			{
-				{
-					auto priorValue = this->parameters.axes.a.get();
-					auto roundedValue = this->stepsToAxis(
-						this->axisToSteps(
-							priorValue
-							, 0
-						)
-						, 0);
-
-					if (priorValue != roundedValue) {
-						this->parameters.axes.a.set(roundedValue);
-					}
-				}
+			for (int i = 0; i < 2; i++) {
+				this->values.axes[i] = this->stepsToAxis(
+					this->axisToSteps(
+						this->values.axes[i]
+						, i
+					)
+					, i);
+				this->solved.steps[i] = this->axisToSteps(this->values.axes[i], i);
+			}
+			this->solved.valid = true;
 
-				{
-					auto priorValue = this->parameters.axes.b.get();
-					auto roundedValue = this->stepsToAxis(
-						this->axisToSteps(
-							priorValue
-							, 1
-						)
-						, 1);
-
-					if (priorValue != roundedValue) {
-						this->parameters.axes.b.set(roundedValue);
-					}
+			this->updateLiveAxisValues();
+		}
+
+		//----------
+		void
+			Pilot::updateInspector()
+		{
+			// The parameters are only on screen whilst we're inspected. Anything changed in the GUI is taken into the
+			// values here and solved on the next update
+			if (ofxCvGui::isBeingInspected(this)) {
+				this->pullParameters();
+				this->pushParameters();
+			}
+		}
+
+		//----------
+		void
+			Pilot::pullParameters()
+		{
+			const auto& parameters = this->parameters;
+			auto& synced = this->syncedValues;
+
+			if (parameters.leadingControl.get().get() != synced.leadingControl.get()) {
+				this->values.leadingControl = parameters.leadingControl.get();
+				this->invalidateSolved();
+			}
+
+			auto pull = [this](const ofParameter<float>& parameter, float syncedValue, float& value) {
+				if (parameter.get() != syncedValue) {
+					value = parameter.get();
+					this->invalidateSolved();
 				}
+			};
+			pull(parameters.position.x, synced.position.x, this->values.position.x);
+			pull(parameters.position.y, synced.position.y, this->values.position.y);
+			pull(parameters.polar.r, synced.polar[0], this->values.polar[0]);
+			pull(parameters.polar.theta, synced.polar[1], this->values.polar[1]);
+			pull(parameters.axes.a, synced.axes[0], this->values.axes[0]);
+			pull(parameters.axes.b, synced.axes[1], this->values.axes[1]);
+		}
+
+		//----------
+		void
+			Pilot::pushParameters()
+		{
+			auto& parameters = this->parameters;
+
+			// Only set what has changed (each set fires the parameter's events)
+			if (parameters.leadingControl.get().get() != this->values.leadingControl.get()) {
+				parameters.leadingControl.set(this->values.leadingControl);
 			}
 
-			// Update live axis values
-			{
-				for (int i = 0; i < 2; i++) {
-					auto axis = this->portal->getAxis(i);
-
-					if (axis->getMotionControl()->getCurrentPositionKnown()) {
-						this->liveAxisValues[i] = this->stepsToAxis(
-							axis->getMotionControl()->getCurrentPosition()
-							, i
-						);
-						this->liveAxisValuesKnown[i] = true;
-					}
+			auto push = [](ofParameter<float>& parameter, float value) {
+				if (parameter.get() != value) {
+					parameter.set(value);
+				}
+			};
+			push(parameters.position.x, this->values.position.x);
+			push(parameters.position.y, this->values.position.y);
+			push(parameters.polar.r, this->values.polar[0]);
+			push(parameters.polar.theta, this->values.polar[1]);
+			push(parameters.axes.a, this->values.axes[0]);
+			push(parameters.axes.b, this->values.axes[1]);
+
+			this->syncedValues = this->values;
+		}
 
-					if (axis->getMotionControl()->getTargetPositionKnown()) {
-						this->liveAxisTargetValues[i] = this->stepsToAxis(
-							axis->getMotionControl()->getTargetPosition()
-							, i
-						);
-						this->liveAxisTargetValuesKnown[i] = true;
-					}
+		//----------
+		void
+			Pilot::updateLiveAxisValues()
+		{
+			for (int i = 0; i < 2; i++) {
+				auto axis = this->portal->getAxis(i);
+
+				if (axis->getMotionControl()->getCurrentPositionKnown()) {
+					this->liveAxisValues[i] = this->stepsToAxis(
+						axis->getMotionControl()->getCurrentPosition()
+						, i
+					);
+					this->liveAxisValuesKnown[i] = true;
+				}
+
+				if (axis->getMotionControl()->getTargetPositionKnown()) {
+					this->liveAxisTargetValues[i] = this->stepsToAxis(
+						axis->getMotionControl()->getTargetPosition()
+						, i
+					);
+					this->liveAxisTargetValuesKnown[i] = true;
 				}
 			}
 		}
@@ -203,8 +235,8 @@ namespace Modules {
 				}
 
 				// Send if stale
-				if (this->parameters.axes.a != this->cachedSentValues.a
-					|| this->parameters.axes.b != this->cachedSentValues.b) {
+				if (this->values.axes[0] != this->cachedSentValues.a
+					|| this->values.axes[1] != this->cachedSentValues.b) {
 					needsSend = true;
 				}
 
@@ -221,8 +253,8 @@ namespace Modules {
 		void
 			Pilot::notifyValuesSent()
 		{
-			this->cachedSentValues.a = this->parameters.axes.a.get();
-			this->cachedSentValues.b = this->parameters.axes.b.get();
+			this->cachedSentValues.a = this->values.axes[0];
+			this->cachedSentValues.b = this->values.axes[1];
 			this->cachedSentValues.lastUpdateRequest = chrono::system_clock::now();
 		}
 
@@ -232,6 +264,9 @@ namespace Modules {
 		{
 			auto inspector = args.inspector;
 
+			// Show the current values from the start
+			this->pushParameters();
+
 			inspector->add(this->getPanel());
 			inspector->addButton("Reset local", [this]() {
 				this->resetLocal();
@@ -325,7 +360,7 @@ namespace Modules {
 					// Draw cursor
 					ofPushStyle();
 					{
-						if (this->parameters.leadingControl.get() == LeadingControl::Position) {
+						if (this->values.leadingControl.get() == LeadingControl::Position) {
 							ofFill();
 						}
 						else {
@@ -437,7 +472,7 @@ namespace Modules {
 
 			{
 				// Strip containing both axes
-				auto makeAxisControlPanel = [this](ofParameter<float>& axis, int axisIndex) {
+				auto makeAxisControlPanel = [this](const ofParameter<float>& axis, int axisIndex) {
 					auto strip3 = ofxCvGui::Panels::Groups::makeStrip(ofxCvGui::Panels::Groups::Strip::Direction::Horizontal);
 					strip3->setCellSizes({ -1, 80 });
 					{
@@ -494,11 +529,12 @@ namespace Modules {
 								// Draw line and circle
 								{
 
-									auto drawPosition = axisValueToPanelPosition(axis.get(), 0.75f);
+									const auto axisValue = this->values.axes[axisIndex];
+									auto drawPosition = axisValueToPanelPosition(axisValue, 0.75f);
 
 									ofPushStyle();
 									{
-										if (this->parameters.leadingControl.get() == LeadingControl::Axes) {
+										if (this->values.leadingControl.get() == LeadingControl::Axes) {
 											ofFill();
 										}
 										else {
@@ -516,7 +552,7 @@ namespace Modules {
 										ofxCvGui::Utils::drawText(axis.getName(), textBounds);
 
 										// Target position TL
-										ofxCvGui::Utils::drawText(ofToString(axis.get(), 3), 20, 20);
+										ofxCvGui::Utils::drawText(ofToString(axisValue, 3), 20, 20);
 
 										// Current position
 										ofxCvGui::Utils::drawText(ofToString(this->liveAxisValues[axisIndex], 3)
@@ -555,21 +591,23 @@ namespace Modules {
 									ofPopStyle();
 								}
 							};
-						panel->onMouse += [this, panel, &axis](ofxCvGui::MouseArguments& args)
+						panel->onMouse += [this, panel, &axis, axisIndex](ofxCvGui::MouseArguments& args)
 							{
 								args.takeMousePress(panel);
 
 								if (args.isDragging(panel)) {
 									auto movement = args.movement / glm::vec2(panel->getWidth(), panel->getHeight());
-									axis.set(axis.get() + movement.x / 10.0f);
-									this->parameters.leadingControl.set(LeadingControl::Axes);
+									auto axes = this->getAxes();
+									axes[axisIndex] += movement.x / 10.0f;
+									this->setAxes(axes);
 								}
 
 								if (args.isDoubleClicked(panel)) {
 									auto response = ofSystemTextBoxDialog("Value for " + axis.getName());
 									if (!response.empty()) {
-										axis.set(ofToFloat(response));
-										this->setAxes(this->getAxes()); // invoke set events
+										auto axes = this->getAxes();
+										axes[axisIndex] = ofToFloat(response);
+										this->setAxes(axes);
 									}
 								}
 							};
@@ -578,9 +616,10 @@ namespace Modules {
 
 					{
 						auto buttonStrip = ofxCvGui::Panels::makeWidgets();
-						auto go = [&axis, this](float position) {
-							axis.set(position);
-							this->setAxes(this->getAxes()); // invoke events
+						auto go = [axisIndex, this](float position) {
+							auto axes = this->getAxes();
+							axes[axisIndex] = position;
+							this->setAxes(axes);
 							};
 						map<float, string> positions;
 						{
@@ -620,66 +659,100 @@ namespace Modules {
 		void
 			Pilot::seeThrough()
 		{
-			this->parameters.axes.a.set(0.0f);
-			this->parameters.axes.b.set(0.5f);
-			this->parameters.leadingControl.set(LeadingControl::Axes);
+			this->setAxes({ 0.0f, 0.5f });
 		}
 
 		//----------
 		const glm::vec2
 			Pilot::getPosition() const
 		{
-			return {
-				this->parameters.position.x.get()
-				, this->parameters.position.y.get()
-			};
+			return this->values.position;
 		}
 
 		//----------
 		const glm::vec2
 			Pilot::getPolar() const
 		{
-			return {
-				this->parameters.polar.r.get()
-				, this->parameters.polar.theta.get()
-			};
+			return this->values.polar;
 		}
 
 		//----------
 		const glm::vec2
 			Pilot::getAxes() const
 		{
-			return {
-				this->parameters.axes.a.get()
-				, this->parameters.axes.b.get()
-			};
+			return this->values.axes;
 		}
 
 		//----------
 		void
 			Pilot::setPosition(const glm::vec2& position)
 		{
-			this->parameters.position.x.set(position.x);
-			this->parameters.position.y.set(position.y);
-			this->parameters.leadingControl.set(LeadingControl::Position);
+			this->values.position = position;
+			this->values.leadingControl = LeadingControl::Position;
+			this->invalidateSolved();
 		}
 
 		//----------
 		void
 			Pilot::setPolar(const glm::vec2& polar)
 		{
-			this->parameters.polar.r.set(polar[0]);
-			this->parameters.polar.theta.set(polar[1]);
-			this->parameters.leadingControl.set(LeadingControl::Polar);
+			this->values.polar = polar;
+			this->values.leadingControl = LeadingControl::Polar;
+			this->invalidateSolved();
 		}
 
 		//----------
 		void
 			Pilot::setAxes(const glm::vec2& axes)
 		{
-			this->parameters.axes.a.set(axes[0]);
-			this->parameters.axes.b.set(axes[1]);
-			this->parameters.leadingControl.set(LeadingControl::Axes);
+			this->values.axes = axes;
+			this->values.leadingControl = LeadingControl::Axes;
+			this->invalidateSolved();
+		}
+
+		//----------
+		void
+			Pilot::applyKinematics(const glm::vec2& position, const glm::vec2& polar, const glm::vec2& axes, const glm::tvec2<Steps>& steps)
+		{
+			this->values.position = position;
+			this->values.leadingControl = LeadingControl::Position;
+			this->values.polar = polar;
+			this->values.axes = axes;
+
+			this->solved.steps = steps;
+			this->solved.valid = true;
+			this->solved.solvedByBatch = true;
+
+			this->updateLiveAxisValues();
+		}
+
+		//----------
+		void
+			Pilot::invalidateSolved()
+		{
+			this->solved.valid = false;
+			this->solved.solvedByBatch = false;
+		}
+
+		//----------
+		float
+			Pilot::getAxesOffset() const
+		{
+			return this->parameters.axes.offset.get();
+		}
+
+		//----------
+		int
+			Pilot::getMicrostepsPerPrismRotation() const
+		{
+			return this->parameters.axes.microstepsPerPrismRotation.get();
+		}
+
+		//----------
+		bool
+			Pilot::getCyclic() const
+		{
+			return this->parameters.axes.cyclic.get();
 		}
 
 		//----------
@@ -704,12 +777,10 @@ namespace Modules {
 		void
 			Pilot::reset()
 		{
-			this->parameters.position.x.set(0);
-			this->parameters.position.y.set(0);
-			this->parameters.polar.r.set(0);
-			this->parameters.polar.theta.set(0);
-			this->parameters.axes.a.set(0);
-			this->parameters.axes.b.set(0);
+			this->values.position = { 0, 0 };
+			this->values.polar = { 0, 0 };
+			this->values.axes = { 0, 0 };
+			this->invalidateSolved();
 			this->liveAxisValuesKnown = { true, true };
 			this->liveAxisValues = { 0, 0 };
 			this->liveAxisTargetValuesKnown = { true, true };
@@ -877,8 +948,9 @@ namespace Modules {
 		void
 			Pilot::push()
 		{
-			Steps stepsA = this->axisToSteps(this->parameters.axes.a.get(), 0);
-			Steps stepsB = this->axisToSteps(this->parameters.axes.b.get(), 1);
+			auto axisSteps = this->getAxisSteps();
+			Steps stepsA = axisSteps[0];
+			Steps stepsB = axisSteps[1];
 
 			auto message = MsgPack::object{
 				{
@@ -918,6 +990,23 @@ namespace Modules {
 			}, "m");
 		}
 
+		//----------
+		MsgPack
+			Pilot::renderBatchedMove()
+		{
+			auto axisSteps = this->getAxisSteps();
+
+			auto entry = MsgPack::array{
+				(int8_t)this->portal->getTarget()
+				, (int32_t)axisSteps[0]
+				, (int32_t)axisSteps[1]
+			};
+
+			this->notifyValuesSent();
+
+			return entry;
+		}
+
 		//----------
 		void
 			Pilot::pollPosition()
@@ -929,15 +1018,19 @@ namespace Modules {
 				}
 			};
 
-			this->portal->sendToPortal(message, "p");
+			this->portal->sendToPortal(message, "p", RS485::Priority::Poll);
 		}
 
 		//----------
 		glm::tvec2<Steps>
 			Pilot::getAxisSteps() const
 		{
-			Steps stepsA = this->axisToSteps(this->parameters.axes.a.get(), 0);
-			Steps stepsB = this->axisToSteps(this->parameters.axes.b.get(), 1);
+			if (this->solved.valid) {
+				return this->solved.steps;
+			}
+
+			Steps stepsA = this->axisToSteps(this->values.axes[0], 0);
+			Steps stepsB = this->axisToSteps(this->values.axes[1], 1);
 			
 			return {
 				stepsA
@@ -980,8 +1073,8 @@ namespace Modules {
 			// we perform in steps to avoid rounding errors
 			return this->axisToSteps(this->liveAxisTargetValues[0], 0) == this->axisToSteps(this->liveAxisValues[0], 0)
 				&& this->axisToSteps(this->liveAxisTargetValues[1], 1) == this->axisToSteps(this->liveAxisValues[1], 1)
-				&& this->axisToSteps(this->parameters.axes.a.get(), 0) == this->axisToSteps(this->liveAxisValues[0], 0)
-				&& this->axisToSteps(this->parameters.axes.b.get(), 1) == this->axisToSteps(this->liveAxisValues[1], 1);
+				&& this->getAxisSteps()[0] == this->axisToSteps(this->liveAxisValues[0], 0)
+				&& this->getAxisSteps()[1] == this->axisToSteps(this->liveAxisValues[1], 1);
 		}
 
 		//----------
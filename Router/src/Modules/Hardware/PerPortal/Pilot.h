@@ -22,6 +22,9 @@ namespace Modules {
 			void init() override;
 			void update() override;
 
+			// Main thread only (update may run on a worker) : sync the parameters whilst we're being inspected
+			void updateInspector();
+
 			// Check if the sent values are stale and need push
 			bool needsPush();
 
@@ -44,6 +47,14 @@ namespace Modules {
 			void setAxes(const glm::vec2&);
 			void setAxesCyclic(const glm::vec2&); // we will perform cyclic navigation inside Pilot
 
+			/// Take the results of a batched Kinematics::solvePositions (equivalent to setPosition then update).
+			/// The next update then keeps these rather than solving the chain again
+			void applyKinematics(const glm::vec2& position, const glm::vec2& polar, const glm::vec2& axes, const glm::tvec2<Steps>& steps);
+
+			float getAxesOffset() const;
+			int getMicrostepsPerPrismRotation() const;
+			bool getCyclic() const;
+
 			/// Reset the local targets
 			void resetLocal();
 			void unwind();
@@ -67,6 +78,9 @@ namespace Modules {
 			void pushLazy();
 			void pollPosition();
 
+			// Render our [id, stepsA, stepsB] entry for a batched "mm" move (call when the message is sent)
+			msgpack11::MsgPack renderBatchedMove();
+
 			glm::tvec2<Steps> getAxisSteps() const;
 			glm::vec2 getLivePosition() const;
 			glm::vec2 getLiveTargetPosition() const;
@@ -75,9 +89,43 @@ namespace Modules {
 			void takeCurrentPosition();
 
 		protected:
+			void updateLiveAxisValues();
+
+			// Take any values changed in the GUI since the last sync, and show ours in the parameters
+			void pullParameters();
+			void pushParameters();
 
 			Portal * portal;
 
+			/// <summary>
+			/// The working values. update, applyKinematics and the transmit path only touch these, since every set
+			/// of an ofParameter fires its events for each portal on each frame. The position / polar / axes
+			/// parameters are a view of these, only synced whilst the Pilot is being inspected.
+			/// </summary>
+			struct Values {
+				LeadingControl leadingControl = LeadingControl::Axes;
+				glm::vec2 position{ 0, 0 };
+				glm::vec2 polar{ 0, 0 };
+				glm::vec2 axes{ 0, 0 };
+			};
+			Values values;
+
+			// What the parameters held after the last sync (anything different since was changed in the GUI)
+			Values syncedValues;
+
+			/// <summary>
+			/// The steps for values.axes (as getAxisSteps returns them), so that the transmit path doesn't convert
+			/// again. Any change to the values clears valid. solvedByBatch is set by applyKinematics and consumed
+			/// by the next update, which then has nothing left to solve for this frame.
+			/// </summary>
+			struct {
+				glm::tvec2<Steps> steps{ 0, 0 };
+				bool valid = false;
+				bool solvedByBatch = false;
+			} solved;
+
+			void invalidateSolved();
+
 			struct : ofParameterGroup {
 				ofParameter<LeadingControl> leadingControl{ "Leading control", LeadingControl::Axes };
 
@@ -352,11 +352,24 @@ namespace Modules {
 
 		if (this->parameters.poll.regularly) {
 			if (chrono::system_clock::now() - lastPoll > chrono::milliseconds((int) (this->parameters.poll.interval.get() * 1000.0f))) {
-				this->poll();
+				if (this->parameters.poll.compact.get()) {
+					this->pollCompact(false);
+				}
+				else {
+					this->poll();
+				}
 			}
 		}
 	}
 
+	//----------
+	void
+		Portal::updateGUI()
+	{
+		this->pilot->updateInspector();
+		this->logger->updatePanels();
+	}
+
 	//----------
 	void
 		Portal::populateInspectorPanelHeader(ofxCvGui::InspectArguments& args)
@@ -469,6 +482,40 @@ namespace Modules {
 				variable->processIncoming(json["app"]);
 			}
 		}
+
+		// Status for the session report
+		if (json.contains("app") || json.contains("mca") || json.contains("mcb")) {
+			Reports::Event event;
+			event.type = Reports::Event::Type::PortalStatus;
+			event.value = this->reportedState.upTime.hasBeenReported
+				? this->reportedState.upTime.value
+				: 0;
+
+			auto version = this->getVersion();
+			event.setText(version.c_str(), version.size());
+
+			const char* axisKeys[] = { "mca", "mcb" };
+			for (int i = 0; i < 2; i++) {
+				if (!json.contains(axisKeys[i]) || !json[axisKeys[i]].contains("healthStatus")) {
+					continue;
+				}
+				const auto& healthStatus = json[axisKeys[i]]["healthStatus"];
+
+				// Firmware sends SwitchesOK with a capital
+				const char* flagKeys[] = { "measureCycleOK", "SwitchesOK", "backlashOK", "homeOK" };
+				for (int j = 0; j < 4; j++) {
+					if (healthStatus.contains(flagKeys[j])) {
+						auto bit = (uint8_t)(1 << (i * 4 + j));
+						event.healthKnown |= bit;
+						if ((bool)healthStatus[flagKeys[j]]) {
+							event.health |= bit;
+						}
+					}
+				}
+			}
+
+			this->record(event);
+		}
 		if (json.contains("p")) {
 			// it's the succinct position report
 			auto motionControlA = this->getAxis(0)->getMotionControl();
@@ -489,11 +536,89 @@ namespace Modules {
 		}
 	}
 
+	//----------
+	void
+		Portal::processIncoming(const HotReply& reply)
+	{
+		this->lastIncoming = chrono::system_clock::now();
+		this->isFrameNew.rx.notify();
+
+		if (reply.type == HotReply::Type::Positions) {
+			// it's the succinct position report
+			auto motionControlA = this->getAxis(0)->getMotionControl();
+			auto motionControlB = this->getAxis(1)->getMotionControl();
+
+			if (reply.positionCount >= 1) {
+				motionControlA->setReportedCurrentPosition(reply.positions[0]);
+			}
+			if (reply.positionCount >= 2) {
+				motionControlB->setReportedCurrentPosition(reply.positions[1]);
+			}
+			if (reply.positionCount >= 3) {
+				motionControlA->setReportedTargetPosition(reply.positions[2]);
+			}
+			if (reply.positionCount >= 4) {
+				motionControlB->setReportedTargetPosition(reply.positions[3]);
+			}
+		}
+		else if (reply.type == HotReply::Type::CompactStatus) {
+			this->processIncoming(reply.compactStatus);
+		}
+	}
+
+	//----------
+	void
+		Portal::processIncoming(const CompactStatus& status)
+	{
+		this->reportedState.upTime.set(status.upTime);
+
+		if (status.has(CompactStatus::Version)) {
+			this->reportedState.version.set(status.version);
+		}
+
+		if (status.has(CompactStatus::Positions)) {
+			for (int i = 0; i < 2; i++) {
+				auto motionControl = this->getAxis(i)->getMotionControl();
+				motionControl->setReportedCurrentPosition(status.axes[i].position);
+				motionControl->setReportedTargetPosition(status.axes[i].targetPosition);
+			}
+		}
+
+		// Status for the session report
+		{
+			Reports::Event event;
+			event.type = Reports::Event::Type::PortalStatus;
+			event.value = status.upTime;
+
+			auto version = this->getVersion();
+			event.setText(version.c_str(), version.size());
+
+			if (status.has(CompactStatus::Health)) {
+				for (int i = 0; i < 2; i++) {
+					const auto& axis = status.axes[i];
+					auto health = (axis.measureCycleOK ? 1 : 0)
+						| (axis.switchesOK ? 2 : 0)
+						| (axis.backlashOK ? 4 : 0)
+						| (axis.homeOK ? 8 : 0);
+					event.health |= (uint8_t)(health << (i * 4));
+				}
+				event.healthKnown = 0xFF;
+			}
+
+			this->record(event);
+		}
+
+		// Log messages only come with the full report
+		if (status.logMessagesWaiting) {
+			this->poll();
+		}
+	}
+
 	//----------
 	void
 		Portal::ping()
 	{
-		this->sendToPortal(msgpack11::MsgPack(), "");
+		this->sendToPortal(msgpack11::MsgPack(), "", RS485::Priority::Diagnostic);
 	}
 
 	//----------
@@ -504,7 +629,19 @@ namespace Modules {
 				{
 					"poll", msgpack11::MsgPack()
 				}
-			}, "poll");
+			}, "poll", RS485::Priority::Poll);
+		this->lastPoll = chrono::system_clock::now();
+	}
+
+	//----------
+	void
+		Portal::pollCompact(bool changedOnly)
+	{
+		this->sendToPortal(msgpack11::MsgPack::object{
+				{
+					"s", changedOnly ? msgpack11::MsgPack((uint8_t)1) : msgpack11::MsgPack()
+				}
+			}, "s", RS485::Priority::Poll);
 		this->lastPoll = chrono::system_clock::now();
 	}
 
@@ -529,9 +666,25 @@ namespace Modules {
 		return this->rs485->isConnected();
 	}
 
+	//----------
+	string
+		Portal::getVersion() const
+	{
+		return this->reportedState.version.hasBeenReported
+			? this->reportedState.version.value
+			: string();
+	}
+
+	//----------
+	chrono::system_clock::time_point
+		Portal::getLastIncomingTime() const
+	{
+		return this->lastIncoming;
+	}
+
 	//----------
 	void
-		Portal::sendToPortal(const msgpack11::MsgPack& message, const string& address)
+		Portal::sendToPortal(const msgpack11::MsgPack& message, const string& address, RS485::Priority priority)
 	{
 		// [target, source, message]
 		auto packet = RS485::Packet(
@@ -545,6 +698,7 @@ namespace Modules {
 		// Info for collate
 		packet.target = this->parameters.targetID.get();
 		packet.address = address;
+		packet.priority = priority;
 
 		packet.onSent = [this]() {
 			this->isFrameNew.tx.notify();
@@ -556,7 +710,7 @@ namespace Modules {
 
 	//----------
 	void
-		Portal::sendToPortal(const function<msgpack11::MsgPack()>& lazyMessageRenderer, const string& address)
+		Portal::sendToPortal(const function<msgpack11::MsgPack()>& lazyMessageRenderer, const string& address, RS485::Priority priority)
 	{
 		// [target, source, message]
 		auto packet = RS485::Packet([lazyMessageRenderer, this]() {
@@ -570,6 +724,7 @@ namespace Modules {
 		// Info for collate
 		packet.target = this->parameters.targetID.get();
 		packet.address = address;
+		packet.priority = priority;
 
 		packet.onSent = [this]() {
 			this->isFrameNew.tx.notify();
@@ -578,6 +733,14 @@ namespace Modules {
 		this->rs485->transmit(packet);
 	}
 
+	//----------
+	void
+		Portal::record(Reports::Event& event)
+	{
+		event.portal = (int16_t)this->getTarget();
+		this->rs485->record(event);
+	}
+
 	//----------
 	void
 		Portal::performAction(shared_ptr<Action> action)
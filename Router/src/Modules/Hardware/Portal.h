@@ -2,6 +2,7 @@
 
 #include "../Base.h"
 #include "RS485.h"
+#include "ReplyDecoder.h"
 #include "Utils.h"
 
 #include "PerPortal/MotorDriverSettings.h"
@@ -39,21 +40,37 @@ namespace Modules {
 		void init() override;
 		void update() override;
 
+		// Main thread only, after update (which may run on a worker) : the parts of our submodules which touch the GUI
+		void updateGUI();
+
 		void ping();
 		void poll();
 
+		// Ask for the compact status report ({"s" : ...}), optionally with only the fields which changed since the
+		// previous compact report
+		void pollCompact(bool changedOnly);
+
 		void populateInspectorPanelHeader(ofxCvGui::InspectArguments&);
 		void populateInspector(ofxCvGui::InspectArguments&);
 		void processIncoming(const nlohmann::json&) override;
+		void processIncoming(const HotReply&);
+		void processIncoming(const CompactStatus&);
 
 		Target getTarget() const;
 		void setTarget(Target);
 
 		bool isRS485Open() const;
 
+		// As last reported in the app section of a poll reply (empty if never reported)
+		string getVersion() const;
+		chrono::system_clock::time_point getLastIncomingTime() const;
+
 		// Used by PerPortal classes to send out from module to RS485
-		void sendToPortal(const msgpack11::MsgPack&, const string& addressForCollate);
-		void sendToPortal(const function<msgpack11::MsgPack()>&, const string& addressForCollate);
+		void sendToPortal(const msgpack11::MsgPack&, const string& addressForCollate, RS485::Priority = RS485::Priority::Motion);
+		void sendToPortal(const function<msgpack11::MsgPack()>&, const string& addressForCollate, RS485::Priority = RS485::Priority::Motion);
+
+		// Used by PerPortal classes to add to the session report (stamped with our target)
+		void record(Reports::Event&);
 
 		void performAction(shared_ptr<Action>);
 
@@ -81,7 +98,8 @@ namespace Modules {
 			struct : ofParameterGroup {
 				ofParameter<bool> regularly{ "Regularly", false };
 				ofParameter<float> interval{ "Interval [s]", 1.0f, 0.01f, 60.0f };
-				PARAM_DECLARE("Poll", regularly, interval);
+				ofParameter<bool> compact{ "Compact", false };
+				PARAM_DECLARE("Poll", regularly, interval, compact);
 			} poll;
 
 			PARAM_DECLARE("Portal", targetID, poll);
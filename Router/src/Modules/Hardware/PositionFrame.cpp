@@ -0,0 +1,45 @@
+#include "pch_App.h"
+#include "PositionFrame.h"
+
+namespace Modules {
+	namespace Hardware {
+		//----------
+		PositionFrameMailbox::~PositionFrameMailbox()
+		{
+			delete this->slot.exchange(nullptr);
+		}
+
+		//----------
+		void
+			PositionFrameMailbox::post(unique_ptr<PositionFrame>&& frame)
+		{
+			auto replaced = this->slot.exchange(frame.release(), std::memory_order_acq_rel);
+			this->postedCount++;
+			if (replaced) {
+				delete replaced;
+				this->droppedCount++;
+			}
+		}
+
+		//----------
+		unique_ptr<PositionFrame>
+			PositionFrameMailbox::take()
+		{
+			return unique_ptr<PositionFrame>(this->slot.exchange(nullptr, std::memory_order_acq_rel));
+		}
+
+		//----------
+		size_t
+			PositionFrameMailbox::getPostedCount() const
+		{
+			return this->postedCount.load();
+		}
+
+		//----------
+		size_t
+			PositionFrameMailbox::getDroppedCount() const
+		{
+			return this->droppedCount.load();
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace Modules {
+	namespace Hardware {
+		/// <summary>
+		/// Target positions for the whole installation, laid out as the image Renderer's pixels are (resolution from
+		/// Installation::getResolution, row-major, x and y of each portal in the first two channels).
+		/// Built on whichever thread received it and never changed after it is posted.
+		/// </summary>
+		struct PositionFrame {
+			ofFloatPixels positions;
+			chrono::steady_clock::time_point received;
+		};
+
+		/// <summary>
+		/// Hands PositionFrames from other threads (e.g. the REST server's workers) to the main loop without locking.
+		/// The mailbox is a single atomic slot : posting swaps the new frame in, and the main loop swaps it out once per
+		/// update. A frame which is replaced before the main loop takes it is dropped, since only the latest positions
+		/// matter.
+		/// </summary>
+		class PositionFrameMailbox {
+		public:
+			~PositionFrameMailbox();
+
+			// Any thread
+			void post(unique_ptr<PositionFrame>&&);
+
+			// Main thread. Empty if nothing new has been posted since the last take
+			unique_ptr<PositionFrame> take();
+
+			size_t getPostedCount() const;
+			size_t getDroppedCount() const;
+		protected:
+			std::atomic<PositionFrame*> slot{ nullptr };
+			std::atomic<size_t> postedCount{ 0 };
+			std::atomic<size_t> droppedCount{ 0 };
+		};
+	}
+}
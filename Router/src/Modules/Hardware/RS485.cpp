@@ -6,6 +6,7 @@
 
 #include "../cobs-c/cobs.h"
 #include "msgpack.h"
+#include "../../crc16ccitt.h"
 
 // For debugging
 void printChar(int byte) {
@@ -16,75 +17,62 @@ void printChar(int byte) {
 	cout << ", ";
 };
 
-namespace Modules {
-#pragma mark Packet
-	//----------
-	RS485::Packet::Packet()
+namespace {
+	// What a frame from a portal carries, by the type of its body (as RouterRS classifies it)
+	Modules::Reports::Event::RxKind
+		classifyRx(const uint8_t* data, size_t size)
 	{
+		// [target, source, body, ...] with int8 addresses packed as fixint or as 0xd0 / 0xcc + byte
+		if (size < 4 || (data[0] & 0xF0) != 0x90) {
+			return Modules::Reports::Event::RxKind::Other;
+		}
+		size_t offset = 1;
+		for (int i = 0; i < 2 && offset < size; i++) {
+			offset += (data[offset] == 0xD0 || data[offset] == 0xCC) ? 2 : 1;
+		}
+		if (offset >= size) {
+			return Modules::Reports::Event::RxKind::Other;
+		}
 
+		auto body = data[offset];
+		if (body == 0xC2 || body == 0xC3) {
+			return Modules::Reports::Event::RxKind::ACK;
+		}
+		if ((body & 0xF0) == 0x80 || body == 0xDE || body == 0xDF) {
+			return Modules::Reports::Event::RxKind::Report;
+		}
+		return Modules::Reports::Event::RxKind::Other;
 	}
 
-	//----------
-	RS485::Packet::Packet(const MsgpackBinary& msgpackBinary)
-		: msgpackBinary(msgpackBinary)
+	template<size_t N>
+	void
+		copyTruncated(const string& value, char(&buffer)[N])
 	{
-
+		auto length = min(value.size(), N - 1);
+		std::copy(value.begin(), value.begin() + length, buffer);
+		buffer[length] = '\0';
 	}
 
-	//----------
-	RS485::Packet::Packet(const msgpack11::MsgPack& message)
+	// The session report's names for the transports
+	const char*
+		getTransportName(const string& deviceTypeName)
 	{
-		// take the first key as address
-		if (message.is_array()) {
-			const auto& root_array_items = message.array_items();
-			if (root_array_items.size() >= 3) {
-				// the third element might be an object
-				if (root_array_items[2].is_object()) {
-					const auto& object_items = root_array_items[2].object_items();
-					if (!object_items.empty()) {
-						const auto& firstItem = object_items.begin();
-						if (firstItem->first.is_string()) {
-							this->address = (string)firstItem->first.string_value();
-						}
-					}
-				}
-			}
-			
+		if (deviceTypeName == "Simulated") {
+			return "Sim";
 		}
-
-		auto dataString = message.dump();
-		auto dataBegin = (uint8_t*)dataString.data();
-		auto dataEnd = dataBegin + dataString.size();
-		this->msgpackBinary.assign(dataBegin, dataEnd);
+		return deviceTypeName == "TCP" ? "TCP" : "Serial";
 	}
+}
 
+namespace Modules {
+#pragma mark Packet
 	//----------
-	RS485::Packet::Packet(const msgpack_sbuffer& buffer)
+	RS485Protocol::Packet::Packet(const msgpack_sbuffer& buffer)
 	{
 		auto data = (uint8_t*)buffer.data;
 		this->msgpackBinary.assign(data, data + buffer.size);
 	}
 
-	//----------
-	RS485::Packet::Packet(const function<msgpack11::MsgPack()>& lazyMessageRenderer)
-		: lazyMessageRenderer(lazyMessageRenderer)
-	{
-
-	}
-
-	//----------
-	void
-		RS485::Packet::render()
-	{
-		if (this->lazyMessageRenderer) {
-			auto message = this->lazyMessageRenderer();
-			auto dataString = message.dump();
-			auto dataBegin = (uint8_t*)dataString.data();
-			auto dataEnd = dataBegin + dataString.size();
-			this->msgpackBinary.assign(dataBegin, dataEnd);
-		}
-	}
-
 #pragma mark RS485
 	//----------
 	RS485::RS485(Column* column)
@@ -96,7 +84,7 @@ namespace Modules {
 	//----------
 	RS485::~RS485()
 	{
-		this->closeSerial();
+		this->closeSerial("shutdown");
 	}
 
 	//----------
@@ -119,9 +107,17 @@ namespace Modules {
 	void
 		RS485::deserialise(const nlohmann::json& json)
 	{
+		if (json.contains("baud")) {
+			const auto& jsonBaud = json["baud"];
+			Utils::deserialize(jsonBaud, this->parameters.baud.target);
+			Utils::deserialize(jsonBaud, this->parameters.baud.switchDelay_ms);
+			Utils::deserialize(jsonBaud, this->parameters.baud.reannounce_s);
+			Utils::deserialize(jsonBaud, this->parameters.baud.fallBackAfter_s);
+		}
+
 		this->openSerial(json);
 		this->initilialisation.settings = json;
-		this->initilialisation.lastConnectionAttempt = chrono::system_clock::now();
+		this->initilialisation.lastConnectionAttempt = chrono::steady_clock::now();
 	}
 
 	//----------
@@ -133,25 +129,40 @@ namespace Modules {
 			// Close serial if disconnected
 			if (this->serialThread) {
 				if (!this->serialThread->serialDevice->isConnected()) {
-					this->closeSerial();
+					this->closeSerial("io_error");
 				}
 			}
 
 			// Check if can reconnect
 			if (!this->serialThread
 				&& !this->initilialisation.settings.empty()
-				&& chrono::system_clock::now() - this->initilialisation.lastConnectionAttempt > this->initilialisation.retryPeriod) {
+				&& chrono::steady_clock::now() - this->initilialisation.lastConnectionAttempt > this->initilialisation.retryPeriod) {
 				this->openSerial(this->initilialisation.settings);
-				this->initilialisation.lastConnectionAttempt = chrono::system_clock::now();
+				this->initilialisation.lastConnectionAttempt = chrono::steady_clock::now();
 			}
 		}
 
 		// Pull and process the inbox
 		this->updateInbox();
 
-		// Collate packets in the outbox
-		if (this->parameters.collatePackets) {
-			this->collateOutboxPackets();
+		// Rates in the metrics are per second
+		{
+			auto now = chrono::steady_clock::now();
+			if (now - this->lastMetricsUpdate >= chrono::seconds(1)) {
+				this->metrics->updateRates();
+				this->lastMetricsUpdate = now;
+			}
+		}
+
+		this->updateBaudRate();
+
+		// Collation now happens as packets enter the outbox
+		if (this->serialThread) {
+			auto& outbox = this->serialThread->outbox;
+			outbox.setCollate(this->parameters.collatePackets.get());
+			outbox.setBudget(Priority::Motion, this->parameters.scheduler.motionBudget.get());
+			outbox.setBudget(Priority::Poll, this->parameters.scheduler.pollBudget.get());
+			outbox.setBudget(Priority::Diagnostic, this->parameters.scheduler.diagnosticBudget.get());
 		}
 
 		// Update indicators
@@ -221,6 +232,22 @@ namespace Modules {
 						});
 					stack->add(widget);
 				}
+				{
+					auto widget = make_shared<ofxCvGui::Widgets::LiveValue<string>>("Baud rate", [this]() {
+						auto baudRate = ofToString(this->getBaudRate());
+						if (this->baudRateFixed) {
+							return baudRate + " (fixed)";
+						}
+						if (this->baudRateUnsupported == this->parameters.baud.target.get()) {
+							return baudRate + " (" + ofToString(this->parameters.baud.target.get()) + " unsupported)";
+						}
+						if (this->baudRate != this->parameters.baud.target.get()) {
+							return baudRate + " (negotiating " + ofToString(this->parameters.baud.target.get()) + ")";
+						}
+						return baudRate;
+						});
+					stack->add(widget);
+				}
 			}
 			inspector->addButton("Disconnect", [this]() {
 				this->closeSerial();
@@ -280,6 +307,88 @@ namespace Modules {
 			inspector->add(widget);
 		}
 
+		inspector->addTitle("Metrics", ofxCvGui::Widgets::Title::Level::H2);
+		{
+			auto toMs = [](uint64_t us) {
+				return (float)us / 1000.0f;
+			};
+			{
+				auto stack = inspector->addHorizontalStack();
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("ACK p50 [ms]", [this, toMs]() {
+					return toMs(this->metrics->getACKLatency().getPercentile_us(0.5));
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("ACK p99 [ms]", [this, toMs]() {
+					return toMs(this->metrics->getACKLatency().getPercentile_us(0.99));
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("ACK max [ms]", [this, toMs]() {
+					return toMs(this->metrics->getACKLatency().getMax_us());
+					}));
+			}
+			{
+				auto stack = inspector->addHorizontalStack();
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("Dwell p50 [ms]", [this, toMs]() {
+					return toMs(this->metrics->getOutboxDwell().getPercentile_us(0.5));
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("Dwell p99 [ms]", [this, toMs]() {
+					return toMs(this->metrics->getOutboxDwell().getPercentile_us(0.99));
+					}));
+			}
+			{
+				auto stack = inspector->addHorizontalStack();
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("Tx [B/s]", [this]() {
+					return this->metrics->getTxBytesPerSecond();
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("Rx [B/s]", [this]() {
+					return this->metrics->getRxBytesPerSecond();
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>("Timeout rate", [this]() {
+					return this->metrics->getTimeoutRate();
+					}));
+			}
+			{
+				auto stack = inspector->addHorizontalStack();
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<uint64_t>>("COBS errors", [this]() {
+					return this->metrics->getCOBSErrors();
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<uint64_t>>("CRC errors", [this]() {
+					return this->metrics->getCRCErrors();
+					}));
+				stack->add(make_shared<ofxCvGui::Widgets::LiveValue<uint64_t>>("Msgpack errors", [this]() {
+					return this->metrics->getMsgpackErrors();
+					}));
+			}
+			inspector->addLiveValue<string>("Slowest target (ACK p99)", [this]() {
+				int slowestTarget = -1;
+				uint64_t slowest_us = 0;
+				for (int target = 1; target < (int)BusMetrics::targetCount; target++) {
+					auto p99_us = this->metrics->getTarget(target).ackLatency.getPercentile_us(0.99);
+					if (p99_us > slowest_us) {
+						slowest_us = p99_us;
+						slowestTarget = target;
+					}
+				}
+				return slowestTarget < 0
+					? string("-")
+					: ofToString(slowestTarget) + " (" + ofToString((float)slowest_us / 1000.0f, 1) + "ms)";
+				});
+		}
+
+		inspector->addTitle("Scheduler", ofxCvGui::Widgets::Title::Level::H2);
+		for (size_t i = 0; i < (size_t)Priority::Count; i++) {
+			auto priority = (Priority)i;
+			auto stack = inspector->addHorizontalStack();
+			stack->add(make_shared<ofxCvGui::Widgets::LiveValue<size_t>>(RS485::toString(priority) + " queue", [this, priority]() {
+				return this->serialThread
+					? this->serialThread->outbox.size(priority)
+					: (size_t)0;
+				}));
+			stack->add(make_shared<ofxCvGui::Widgets::LiveValue<float>>(RS485::toString(priority) + " latency [ms]", [this, priority]() {
+				return this->serialThread
+					? this->serialThread->outbox.getLatency_ms(priority)
+					: 0.0f;
+				}));
+		}
+
 		inspector->addSpacer();
 
 		inspector->addParameterGroup(this->parameters);
@@ -332,21 +441,24 @@ namespace Modules {
 			return;
 		}
 
-		this->serialThread->outbox.send(packet);
+		this->serialThread->outbox.send(Packet(packet));
+		this->serialThread->serialDevice->wake();
 	}
 
 	//----------
 	void
 		RS485::transmitPing(const Target& target)
 	{
-		this->transmit(Packet(
+		Packet packet(
 			msgpack11::MsgPack::array{
 				(int8_t)target
 				, (int8_t)0
 				, msgpack11::MsgPack()
 				}
-			));
-		}
+			);
+		packet.priority = Priority::Diagnostic;
+		this->transmit(packet);
+	}
 
 	//----------
 	void
@@ -398,11 +510,7 @@ namespace Modules {
 			return;
 		}
 
-		// just receive all the packets here
-		Packet _;
-		while (this->serialThread->outbox.tryReceive(_)) {
-			// do nothing with these messages, just clear them out
-		}
+		this->serialThread->outbox.clear();
 	}
 
 	//----------
@@ -411,6 +519,7 @@ namespace Modules {
 	{
 		this->debug.rxCount = 0;
 		this->debug.txCount = 0;
+		this->metrics->clear();
 	}
 
 	//----------
@@ -444,6 +553,11 @@ namespace Modules {
 			, make_shared<ofxCvGui::Widgets::LiveValue<size_t>>("Outbox count", [this]() {
 				return this->getOutboxCount();
 			})
+			, make_shared<ofxCvGui::Widgets::LiveValue<size_t>>("In flight", [this]() {
+				return this->serialThread
+					? this->serialThread->inFlightCount.load()
+					: (size_t)0;
+			})
 		};
 	}
 
@@ -455,80 +569,293 @@ namespace Modules {
 			return;
 		}
 
-		// Take all packets out of the queue
-		vector<RS485::Packet> allPackets;
-		{
-			Packet packet;
-			while (this->serialThread->outbox.tryReceive(packet)) {
-				allPackets.push_back(packet);
-			}
+		this->serialThread->outbox.remove(address, target);
+	}
+
+	//----------
+	bool
+		RS485::hasRxBeenReceived() const
+	{
+		return this->debug.hasRxBeenReceived;
+	}
+
+	//----------
+	void
+		RS485::setEventRings(shared_ptr<Reports::EventRing> serialThreadRing
+			, shared_ptr<Reports::EventRing> mainThreadRing)
+	{
+		this->serialThreadEventRing = serialThreadRing;
+		this->mainThreadEventRing = mainThreadRing;
+
+		if (this->serialThread) {
+			auto serialThread = this->serialThread;
+			this->serialThreadActions.send([serialThread, serialThreadRing]() {
+				serialThread->eventRing = serialThreadRing;
+				});
+			serialThread->serialDevice->wake();
+
+			// A device which was opened before recording started (e.g. from config.json) still belongs in the session
+			this->recordDeviceConnect(*serialThread->serialDevice);
 		}
+	}
 
-		// Put items back in that don't match the pattern
-		for (const auto& packet : allPackets) {
-			if (packet.address == address && packet.target == target) {
-				// Skip adding this packet
-				continue;
-			}
+	//----------
+	bool
+		RS485::hasEventRings() const
+	{
+		return (bool)this->mainThreadEventRing;
+	}
 
-			this->serialThread->outbox.send(packet);
+	//----------
+	void
+		RS485::record(Reports::Event& event)
+	{
+		if (this->mainThreadEventRing) {
+			this->mainThreadEventRing->push(event);
 		}
 	}
 
+	//----------
+	shared_ptr<const BusMetrics>
+		RS485::getMetrics() const
+	{
+		return this->metrics;
+	}
+
 	//----------
 	void
-		RS485::collateOutboxPackets()
+		RS485::negotiateBaudRate(int baudRate)
 	{
-		if (!this->serialThread) {
+		this->baudNegotiation.requested = baudRate;
+		this->baudNegotiation.lastAttempt = chrono::steady_clock::now();
+		this->baudNegotiation.timeoutsAtAttempt = this->metrics->getTimeouts();
+
+		if (!this->serialThread || this->baudRateFixed) {
 			return;
 		}
 
-		vector<RS485::Packet> allPackets;
-		{
-			Packet packet;
-			while (this->serialThread->outbox.tryReceive(packet)) {
-				allPackets.push_back(packet);
+		this->serialThreadActions.send([this, baudRate]() {
+			this->serialThreadNegotiateBaudRate(baudRate);
+			});
+		this->serialThread->serialDevice->wake();
+	}
+
+	//----------
+	int
+		RS485::getBaudRate() const
+	{
+		return this->baudRate;
+	}
+
+	//----------
+	uint32_t
+		RS485::scaleReplySlot_us(uint32_t replySlot_us) const
+	{
+		// The portal's main loop (which the slot also has to cover) doesn't get any faster
+		const auto loopAllowance_us = RS485Protocol::replyLoopAllowance_us;
+
+		auto baudRate = (uint64_t)this->getBaudRate();
+		if (replySlot_us <= loopAllowance_us || baudRate <= BAUD_RATE) {
+			return replySlot_us;
+		}
+		return loopAllowance_us + (uint32_t)((uint64_t)(replySlot_us - loopAllowance_us) * BAUD_RATE / baudRate);
+	}
+
+	//----------
+	void
+		RS485::serialThreadFallBackToBootBaudRate()
+	{
+		if (this->baudRate == BAUD_RATE) {
+			return;
+		}
+		if (this->serialThread->serialDevice->setBaudRate(BAUD_RATE)) {
+			this->baudRate = BAUD_RATE;
+		}
+	}
+
+	//----------
+	void
+		RS485::updateBaudRate()
+	{
+		if (!this->serialThread || this->baudRateFixed) {
+			return;
+		}
+
+		auto now = chrono::steady_clock::now();
+		auto target = this->parameters.baud.target.get();
+		auto baudRate = this->getBaudRate();
+
+		// Never announce a rate our device has refused (see serialThreadNegotiateBaudRate)
+		if (target == this->baudRateUnsupported) {
+			target = BAUD_RATE;
+		}
+
+		if (baudRate != BAUD_RATE) {
+			// Keep the portals' fallback watchdogs fed (they reset on any frame which parses)
+			if (now - this->lastKeepAlive >= chrono::seconds(1)) {
+				Packet packet(msgpack11::MsgPack::array{
+					-1
+					, (int8_t)0
+					, msgpack11::MsgPack()
+					});
+				packet.address = "keepAlive";
+				packet.needsACK = false;
+				packet.customWaitTime_ms = 0;
+				packet.priority = Priority::Diagnostic;
+				this->transmit(packet);
+				this->lastKeepAlive = now;
+			}
+
+			// Packets are timing out and nothing has come back for a while, so the portals have probably fallen back
+			// without us (e.g. they were power cycled). Follow them, and try again at the next re-announce
+			auto fallBackAfter = chrono::seconds(max(this->parameters.baud.fallBackAfter_s.get(), 1));
+			if (this->metrics->getTimeouts() != this->baudNegotiation.timeoutsAtAttempt
+				&& now - this->lastIncomingMessageTime > fallBackAfter
+				&& now - this->baudNegotiation.lastAttempt > fallBackAfter) {
+				ofLogWarning("RS485") << "No replies at " << baudRate << " baud, falling back to " << BAUD_RATE;
+				this->serialThreadActions.send([this]() {
+					this->serialThreadFallBackToBootBaudRate();
+					});
+				this->serialThread->serialDevice->wake();
+				this->baudNegotiation.timeoutsAtAttempt = this->metrics->getTimeouts();
 			}
 		}
-		
-		vector<RS485::Packet> filteredPackets;
 
-		for (const auto& packet : allPackets) {
-			// This is true for cases where we gave a msgpack object but no address (we try to find the address automatically in Packet constructor)
-			if (packet.address.empty()) {
-				filteredPackets.push_back(packet);
-				continue;
+		// Negotiate when asked for a new rate, and re-announce every so often for portals which have rebooted
+		// (they come up at BAUD_RATE and only hear the copy of the broadcast which is sent at that rate)
+		auto reannounce = chrono::seconds(max(this->parameters.baud.reannounce_s.get(), 1));
+		if (target != this->baudNegotiation.requested
+			|| ((target != baudRate || target != BAUD_RATE) && now - this->baudNegotiation.lastAttempt > reannounce)) {
+			this->negotiateBaudRate(target);
+		}
+	}
+
+	//----------
+	void
+		RS485::serialThreadNegotiateBaudRate(int baudRate)
+	{
+		auto& serialThread = *this->serialThread;
+		auto& serialDevice = *serialThread.serialDevice;
+
+		// Don't talk over replies which are still on their way
+		this->serialThreadWaitUntil([this]() {
+			return this->serialThread->inFlight.empty();
+			});
+		this->serialThreadWaitUntil([this]() {
+			auto timeSinceLastRx = chrono::steady_clock::now() - this->serialThread->lastRxTime;
+			return timeSinceLastRx > chrono::milliseconds(this->parameters.gapAfterLastRx_ms.get());
+			});
+		if (serialThread.joining) {
+			return;
+		}
+
+		// Our end has to be able to follow before anybody is told to move, otherwise every portal would go without
+		// us and the bus would be dead until their fallback watchdogs fire. So try the rate (nothing is on the wire)
+		if (baudRate != this->baudRate) {
+			const auto currentRate = this->baudRate.load();
+			if (!serialDevice.setBaudRate(baudRate)) {
+				if (!serialDevice.setBaudRate(currentRate)) {
+					ofLogNotice("RS485") << serialDevice.getTypeName() << " device can't change baud rate, staying at " << BAUD_RATE;
+					this->baudRateFixed = true;
+				}
+				else {
+					ofLogError("RS485") << serialDevice.getTypeName() << " device can't run at " << baudRate << " baud, not announcing it";
+					this->baudRateUnsupported = baudRate;
+				}
+				return;
+			}
+			if (!serialDevice.setBaudRate(currentRate)) {
+				ofLogError("RS485") << serialDevice.getTypeName() << " device can't return to " << currentRate << " baud";
+				this->baudRate = baudRate;
+				this->serialThreadFallBackToBootBaudRate();
+				return;
 			}
+		}
 
-			bool foundMatch = false;
-			for (auto& existingPacket : filteredPackets) {
-				if (packet.collateable
-					&& existingPacket.collateable
-					&& existingPacket.address == packet.address
-					&& existingPacket.target == packet.target)
-				{
-					// overwrite the packet
-					existingPacket = packet;
-					foundMatch = true;
-					break;
+		// [-1, 0, {"baud" : [rate, delay_ms]}]. Portals move delay_ms after they've processed it, which has to
+		// cover us sending the second copy
+		auto switchDelay_ms = max(this->parameters.baud.switchDelay_ms.get(), 1);
+		auto makeFrame = [this, &serialThread, switchDelay_ms](int rate, vector<uint8_t>& frame) {
+			Packet packet(msgpack11::MsgPack::array{
+				-1
+				, (int8_t)0
+				, msgpack11::MsgPack::object{
+					{ "baud", msgpack11::MsgPack::array{ (int32_t)rate, (int32_t)switchDelay_ms } }
 				}
+				});
+			if (this->parameters.ack.appendSeqCRC.get()) {
+				auto& txSeq = serialThread.txSeq[0];
+				txSeq++;
+				if (txSeq == 0) {
+					txSeq = 1;
+				}
+				RS485::appendSeqAndCRC(packet.msgpackBinary, txSeq);
 			}
-			if (!foundMatch) {
-				// add the packet
-				filteredPackets.push_back(packet);
+			if (!RS485::encodeFrame(packet.msgpackBinary, frame)) {
+				ofLogError("RS485") << "Failed to encode COBS";
+				return false;
 			}
+			return true;
+		};
+
+		// Once at the rate we're at (unless that's BAUD_RATE anyway), and once at BAUD_RATE
+		vector<int> sendRates;
+		if (this->baudRate != BAUD_RATE) {
+			sendRates.push_back(this->baudRate);
 		}
+		sendRates.push_back(BAUD_RATE);
+
+		auto announce = [&](int rate) {
+			vector<uint8_t> frame;
+			if (!makeFrame(rate, frame)) {
+				return false;
+			}
+			for (auto sendRate : sendRates) {
+				if (!serialDevice.setBaudRate(sendRate)) {
+					return false;
+				}
+				this->baudRate = sendRate;
+
+				serialDevice.transmit(frame);
+				serialDevice.flush();
+				this->metrics->recordTx(frame.size(), chrono::steady_clock::duration::zero());
+				this->debug.txCount++;
+			}
+			return true;
+		};
 
-		for (const auto& packet : filteredPackets) {
-			this->serialThread->outbox.send(packet);
+		if (!announce(baudRate)) {
+			return;
+		}
+		auto sentTime = chrono::steady_clock::now();
+
+		// Our end follows (setBaudRate lets the frame finish first)
+		if (!serialDevice.setBaudRate(baudRate)) {
+			// The portals haven't moved yet (they wait switchDelay_ms), so take it back straight away : a later
+			// "baud" replaces the pending one. Everybody meets at BAUD_RATE, and the rate isn't announced again
+			ofLogError("RS485") << "Could not follow the portals to " << baudRate << " baud, falling back to " << BAUD_RATE;
+			this->baudRateUnsupported = baudRate;
+			announce(BAUD_RATE);
+			this->serialThreadFallBackToBootBaudRate();
+			return;
 		}
+		this->baudRate = baudRate;
+
+		// Nobody talks until everybody has moved
+		auto waitUntil = sentTime + chrono::milliseconds(switchDelay_ms * 2);
+		this->serialThreadWaitUntil([waitUntil]() {
+			return chrono::steady_clock::now() >= waitUntil;
+			}, waitUntil);
 	}
 
 	//----------
-	bool
-		RS485::hasRxBeenReceived() const
+	void
+		RS485::serialThreadRecord(Reports::Event& event)
 	{
-		return this->debug.hasRxBeenReceived;
+		const auto& eventRing = this->serialThread->eventRing;
+		if (eventRing) {
+			eventRing->push(event);
+		}
 	}
 
 	//----------
@@ -537,7 +864,16 @@ namespace Modules {
 	{
 		auto serialDevice = listedDevice.createDevice();
 		if (!serialDevice) {
-			ofLogError() << "Could not open serial device " + listedDevice.type + "::" + listedDevice.name;
+			auto error = "Could not open serial device " + listedDevice.type + "::" + listedDevice.name;
+			ofLogError() << error;
+
+			Reports::Event event;
+			event.type = Reports::Event::Type::DeviceConnect;
+			event.flag = false;
+			auto transport = getTransportName(listedDevice.type);
+			event.setAddress(transport, strlen(transport));
+			event.setText(error.c_str(), error.size());
+			this->record(event);
 			return;
 		}
 
@@ -551,6 +887,17 @@ namespace Modules {
 		auto serialDevice = SerialDevices::createFromJson(json);
 		if (!serialDevice) {
 			ofLogError() << "Could not open serial device from json : " + json.dump(4);
+
+			Reports::Event event;
+			event.type = Reports::Event::Type::DeviceConnect;
+			event.flag = false;
+			auto transport = getTransportName(json.contains("deviceType") && json["deviceType"].is_string()
+				? (string)json["deviceType"]
+				: string());
+			event.setAddress(transport, strlen(transport));
+			auto error = "Could not open serial device from json : " + json.dump();
+			event.setText(error.c_str(), error.size());
+			this->record(event);
 			return;
 		}
 
@@ -568,25 +915,54 @@ namespace Modules {
 		auto serialThread = make_shared<SerialThread>();
 
 		serialThread->serialDevice = serialDevice;
+		serialThread->eventRing = this->serialThreadEventRing;
+
+		// Devices open at BAUD_RATE (update negotiates again)
+		this->baudRate = BAUD_RATE;
+		this->baudRateFixed = false;
+		this->baudRateUnsupported = 0;
+		this->baudNegotiation.requested = BAUD_RATE;
 
 		serialThread->thread = std::thread([this]() {
 			this->serialThreadedFunction();
 			});
 
 		this->serialThread = serialThread;
+
+		this->recordDeviceConnect(*serialDevice);
+	}
+
+	//----------
+	void
+		RS485::recordDeviceConnect(SerialDevices::IDevice& serialDevice)
+	{
+		Reports::Event event;
+		event.type = Reports::Event::Type::DeviceConnect;
+		event.flag = true;
+		auto transport = getTransportName(serialDevice.getTypeName());
+		event.setAddress(transport, strlen(transport));
+		auto endpoint = serialDevice.getAddressString();
+		event.setText(endpoint.c_str(), endpoint.size());
+		this->record(event);
 	}
 
 	//----------
 	void
-		RS485::closeSerial()
+		RS485::closeSerial(const char* reason)
 	{
 		if (!this->serialThread) {
 			return;
 		}
 
+		{
+			Reports::Event event;
+			event.type = Reports::Event::Type::DeviceDisconnect;
+			event.setAddress(reason, strlen(reason));
+			this->record(event);
+		}
+
 		this->serialThread->joining = true;
-		this->serialThread->inbox.close();
-		this->serialThread->outbox.close();
+		this->serialThread->serialDevice->wake();
 		this->serialThread->thread.join();
 		this->serialThread->serialDevice->close();
 		this->serialThread.reset();
@@ -607,22 +983,22 @@ namespace Modules {
 
 			auto didRx = this->serialThreadReceive();
 			if (didRx) {
-				this->serialThread->lastRxTime = chrono::system_clock::now();
+				this->serialThread->lastRxTime = chrono::steady_clock::now();
 			}
 
-			bool didTx = false;
-			
+			this->serialThreadRetireInFlight();
+
 			// check deadtime between last rx before we allow next tx
 			if (!didRx) {
-				auto timeSinceLastRx = chrono::system_clock::now() - this->serialThread->lastRxTime;
+				auto timeSinceLastRx = chrono::steady_clock::now() - this->serialThread->lastRxTime;
 				if (timeSinceLastRx > chrono::milliseconds(this->parameters.gapAfterLastRx_ms.get())) {
-					didTx = this->serialThreadSend();
+					this->serialThreadSend();
 				}
 			}
 
-			// Sleep if we didn't do any work this loop
-			if (!didRx || didTx) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			// Nothing came in, so block until something does (or the outbox wakes us, or a deadline passes)
+			if (!didRx) {
+				this->serialThreadWaitForData(chrono::steady_clock::time_point::max());
 			}
 		}
 	}
@@ -631,80 +1007,111 @@ namespace Modules {
 	bool
 		RS485::serialThreadReceive()
 	{
-		auto rxData = this->serialThread->serialDevice->receiveBytes();
+		auto& serialThread = *this->serialThread;
+
+		auto bytesReceived = serialThread.serialDevice->receiveBytes(serialThread.rxChunk
+			, sizeof(serialThread.rxChunk));
 
-		if (rxData.empty()) {
+		if (bytesReceived == 0) {
 			return false;
 		}
+		this->metrics->recordRxBytes(bytesReceived);
 
-		for(auto word : rxData) {
-			// If end of COB packet
-			if (word == 0) {
-				// If there's nothing to decode, don't do anything
-				if (this->serialThread->cobsIncoming.empty()) {
-					continue;
-				}
+		for (size_t i = 0; i < bytesReceived; i++) {
+			auto word = serialThread.rxChunk[i];
 
-				// Clear incoming buffer (and keep a copy for use here)
-				auto copyOfIncoming = this->serialThread->cobsIncoming;
-				this->serialThread->cobsIncoming.clear();
-
-				// Decode the COBS message
-				vector<uint8_t> binaryMessagePack(copyOfIncoming.size());
-				auto decodeResult = cobs_decode(binaryMessagePack.data(),
-					binaryMessagePack.size(),
-					copyOfIncoming.data(),
-					copyOfIncoming.size());
+			// Continuation of COB packet
+			if (word != 0) {
+				serialThread.inbox.pushByte(word);
+				continue;
+			}
 
-				// Check if decoded OK (should predictably be true)
-				if (decodeResult.status != COBS_DECODE_OK
-					&& this->parameters.debug.printMessageErrors) {
-					ofLogError("LaserSystem") << "COBS decode error " << (int)decodeResult.status;
-					this->debug.isFrameNewDeviceRxFail.notify();
-					continue;
+			// End of COB packet - decode it in place
+			FrameArena::View frame;
+			auto decodeResult = serialThread.inbox.decodePending(frame);
+			switch (decodeResult) {
+			case FrameArena::Result::Empty:
+				// If there's nothing to decode, don't do anything
+				continue;
+			case FrameArena::Result::Dropped:
+			{
+				if (this->parameters.debug.printMessageErrors) {
+					ofLogError("RS485") << "Rx frame dropped (inbox full or frame too large)";
 				}
-				binaryMessagePack.resize(decodeResult.out_len);
-
-				if (this->parameters.debug.printRx.get()) {
-					cout << "Rx : ";
-					for (const auto& byte : binaryMessagePack) {
-						printChar(byte);
-					}
-					cout << endl;
+				this->debug.isFrameNewDeviceRxFail.notify();
+				this->metrics->recordCOBSError();
+
+				Reports::Event event;
+				event.type = Reports::Event::Type::COBSError;
+				const char detail[] = "frame dropped (inbox full or frame too large)";
+				event.setText(detail, sizeof(detail) - 1);
+				this->serialThreadRecord(event);
+				continue;
+			}
+			case FrameArena::Result::DecodeError:
+			{
+				if (this->parameters.debug.printMessageErrors) {
+					ofLogError("RS485") << "COBS decode error";
 				}
+				this->debug.isFrameNewDeviceRxFail.notify();
+				this->metrics->recordCOBSError();
+
+				Reports::Event event;
+				event.type = Reports::Event::Type::COBSError;
+				const char detail[] = "COBS decode error";
+				event.setText(detail, sizeof(detail) - 1);
+				this->serialThreadRecord(event);
+				continue;
+			}
+			default:
+				break;
+			}
 
-				// Decode messagepack
-				nlohmann::json json;
-				try {
-					json = nlohmann::json::from_msgpack(binaryMessagePack);
-
-					if (json.size() >= 3) {
-						// note who has replied
-						this->repliesSeenFrom.push_back((int) json[1]);
-					}
+			if (this->parameters.debug.printRx.get()) {
+				cout << "Rx : ";
+				for (size_t j = 0; j < frame.size; j++) {
+					printChar(frame.data[j]);
 				}
-				catch (const std::exception& e) {
-					ofLogError("LaserSystem") << "msgpack deserialize error : " << e.what();
+				cout << endl;
+			}
 
-					if (this->parameters.debug.printBrokenMsgpack.get()) {
-						cout << "msgpack : ";
-						for (const auto& byte : binaryMessagePack) {
-							printChar(byte);
-						}
-						cout << endl;
-					}
+			// Note who has replied (and which of our packets they're replying to if they sent a trailer)
+			SerialThread::ReplySeen replySeen;
+			if (!RS485::peekEnvelope(frame.data, frame.size, replySeen.source, replySeen.seq)) {
+				if (this->parameters.debug.printMessageErrors) {
+					ofLogError("RS485") << "CRC mismatch in frame from " << replySeen.source;
+				}
+				this->debug.isFrameNewMessageRxError.notify();
 
-					this->debug.isFrameNewMessageRxError.notify();
+				this->metrics->recordCRCError();
 
-					continue;
-				}
+				// peekEnvelope only fails on a trailer whose CRC doesn't match
+				Reports::Event event;
+				event.type = Reports::Event::Type::CRCError;
+				event.portal = (int16_t)replySeen.source;
+				event.value = (int64_t)((frame.data[frame.size - 2] << 8) | frame.data[frame.size - 1]);
+				event.value2 = (int64_t)crc16ccitt(frame.data, frame.size - 3);
+				this->serialThreadRecord(event);
 
-				this->serialThread->inbox.send(json);
+				serialThread.inbox.discardPending();
+				continue;
 			}
-			// Continuation of COB packet
-			else {
-				this->serialThread->cobsIncoming.push_back(word);
+			if (replySeen.source >= 0) {
+				serialThread.repliesSeen.push_back(replySeen);
+			}
+
+			this->metrics->recordRxFrame();
+			{
+				Reports::Event event;
+				event.type = Reports::Event::Type::PacketRx;
+				event.portal = (int16_t)replySeen.source;
+				event.rxKind = classifyRx(frame.data, frame.size);
+				event.bytes = (uint32_t)frame.size;
+				this->serialThreadRecord(event);
 			}
+
+			// The msgpack body is decoded by the main thread in updateInbox
+			serialThread.inbox.publishPending();
 		}
 
 		return true;
@@ -722,46 +1129,91 @@ namespace Modules {
 		Packet packet;
 		while (this->serialThread->outbox.tryReceive(packet)) {
 			if (this->serialThread->joining) {
-				// if we're exiting, just serialThreadSendignore rest of packets in outbox
+				// if we're exiting, just ignore rest of packets in outbox
 				break;
 			}
 
 			// For lazy packets
 			packet.render();
 
-			const auto& msgpackBinary = packet.msgpackBinary;
+			// Wait for a free slot in the ACK window
+			{
+				auto window = (size_t)max(this->parameters.ack.window.get(), 1);
+				auto isUnicast = packet.needsACK && packet.target > 0 && packet.target < 128;
 
-			auto data = msgpackBinary.data();
-			auto size = msgpackBinary.size();
+				if (!isUnicast) {
+					// Broadcasts (and packets we don't expect replies to) could collide with replies still on their way
+					this->serialThreadWaitUntil([this]() {
+						return this->serialThread->inFlight.empty();
+						});
+				}
+				else {
+					// Keep at most one packet in flight per target, and at most window packets overall
+					auto target = packet.target;
+					this->serialThreadWaitUntil([this, target, window]() {
+						return !this->serialThreadIsInFlight(target)
+							&& this->serialThread->inFlight.size() < window;
+						});
+				}
 
-			// allocate buffer of max size for cobs
-			vector<uint8_t> binaryCOBS(size * 255 / 254 + 2);
+				// Respect the deadtime after the last rx before we talk on the bus
+				this->serialThreadWaitUntil([this]() {
+					auto timeSinceLastRx = chrono::steady_clock::now() - this->serialThread->lastRxTime;
+					return timeSinceLastRx > chrono::milliseconds(this->parameters.gapAfterLastRx_ms.get());
+					});
 
-			// Perform the encode
-			auto encodeResult = cobs_encode(binaryCOBS.data()
-				, binaryCOBS.size()
-				, data
-				, size);
+				if (this->serialThread->joining) {
+					break;
+				}
 
-			// Check we encoded OK
-			if (encodeResult.status != COBS_ENCODE_OK) {
-				ofLogError("RS485") << "Failed to encode COBS : " << encodeResult.status;
-				continue;
+				// Stamp the sequence number now (so that collation in the outbox never carries a stale one)
+				if (isUnicast && this->parameters.ack.appendSeqCRC.get()) {
+					auto& txSeq = this->serialThread->txSeq[packet.target];
+					txSeq++;
+					if (txSeq == 0) {
+						// 0 is what the firmware echoes when it hasn't captured a seq
+						txSeq = 1;
+					}
+					if (RS485::appendSeqAndCRC(packet.msgpackBinary, txSeq)) {
+						packet.seq = txSeq;
+					}
+				}
+
+				// Broadcasts with reply slots carry a trailer too (firmware verifies it before acting, and echoes the seq)
+				// Their seq comes from txSeq[0], since 0 is never a target
+				if (!packet.replySlots.empty() && this->parameters.ack.appendSeqCRC.get()) {
+					auto& txSeq = this->serialThread->txSeq[0];
+					txSeq++;
+					if (txSeq == 0) {
+						txSeq = 1;
+					}
+					if (RS485::appendSeqAndCRC(packet.msgpackBinary, txSeq)) {
+						packet.seq = txSeq;
+					}
+				}
 			}
 
-			// Crop the message to the correct number of bytes
-			binaryCOBS.resize(encodeResult.out_len);
+			const auto& msgpackBinary = packet.msgpackBinary;
 
-			// add a zero on the end
-			binaryCOBS.push_back(0);
+			auto data = msgpackBinary.data();
+			auto size = msgpackBinary.size();
 
-			// Clear the incoming ACKs
-			{
-				this->repliesSeenFrom.clear();
+			vector<uint8_t> encodedFrame;
+			if (!packet.encodedFrame) {
+				if (!RS485::encodeFrame(msgpackBinary, encodedFrame)) {
+					ofLogError("RS485") << "Failed to encode COBS";
+					continue;
+				}
 			}
+			const auto& binaryCOBS = packet.encodedFrame
+				? *packet.encodedFrame
+				: encodedFrame;
 
 			// Send the data to serial
 			auto bytesWritten = this->serialThread->serialDevice->transmit(binaryCOBS);
+			auto sentTime = chrono::steady_clock::now();
+			this->serialThread->outbox.notifySent(packet.priority, binaryCOBS.size());
+			this->metrics->recordTx(binaryCOBS.size(), sentTime - packet.enqueueTime);
 
 			{
 				if (this->parameters.debug.printTx.get()) {
@@ -794,6 +1246,17 @@ namespace Modules {
 			this->debug.isFrameNewMessageTx.notify();
 			this->debug.txCount++;
 
+			{
+				Reports::Event event;
+				event.type = Reports::Event::Type::PacketTx;
+				event.portal = (int16_t)packet.target;
+				event.setAddress(packet.address.c_str(), packet.address.size());
+				event.bytes = (uint32_t)binaryCOBS.size();
+				event.flag = packet.needsACK;
+				event.value = (int64_t)this->serialThread->outbox.size();
+				this->serialThreadRecord(event);
+			}
+
 			// Notify any listeners
 			{
 				if (packet.onSent) {
@@ -801,42 +1264,76 @@ namespace Modules {
 				}
 			}
 
-			// Function to wait to receive an ACK
-			auto waitForReceive = [this](int senderID, std::chrono::milliseconds& duration) {
-				auto startTime = chrono::system_clock::now();
-				auto responseWindowEnd = startTime + duration;
-				while (chrono::system_clock::now() < responseWindowEnd) {
-					this->serialThreadReceive();
-
-					// see if we got a message
-					{
-						for(const auto receivedMessageFrom : this->repliesSeenFrom) {
-							if (receivedMessageFrom == senderID) {
-								if (this->parameters.debug.printACKTime.get()) {
-									auto duration = chrono::system_clock::now() - startTime;
-									auto ms = chrono::duration_cast<chrono::milliseconds>(duration).count();
-									cout << "ACK received in " << ms << "ms" << endl;
-								}
-								return true;
-							}
-						}
-
-						this_thread::sleep_for(chrono::microseconds(100));
-					}
+			// After a broadcast with reply slots, each reply is expected in its own slot
+			if (!packet.replySlots.empty()) {
+				auto frameDuration = chrono::microseconds((uint64_t)binaryCOBS.size() * 10 * 1000000 / (uint64_t)this->getBaudRate());
+				auto slotDuration = chrono::microseconds(packet.replySlot_us);
+				auto turnaround = chrono::milliseconds(this->parameters.ack.turnaround_ms.get());
+
+				for (const auto& replySlot : packet.replySlots) {
+					SerialThread::InFlightPacket inFlightPacket;
+					inFlightPacket.target = replySlot.target;
+					inFlightPacket.seq = packet.seq;
+					inFlightPacket.commitGated = true; // the firmware verifies slotted broadcasts before scheduling its reply
+					copyTruncated(packet.address, inFlightPacket.address);
+					inFlightPacket.sentTime = sentTime;
+					inFlightPacket.deadline = sentTime
+						+ chrono::duration_cast<chrono::steady_clock::duration>(frameDuration + slotDuration * (int64_t)(replySlot.slot + 1) + turnaround);
+					this->serialThread->inFlight.push_back(inFlightPacket);
 				}
+				this->serialThread->inFlightCount = this->serialThread->inFlight.size();
 
-				return false;
-			};
+				// Collect the replies for the whole batch before we talk on the bus again
+				this->serialThreadWaitUntil([this]() {
+					return this->serialThread->inFlight.empty();
+					});
+			}
 
-			// After we send, we try to receive for up to the duration of the response window
-			if (packet.needsACK) {
+			// After we send, the ACK has up to the duration of the response window to arrive
+			else if (packet.needsACK) {
 				auto waitDuration = packet.customWaitTime_ms > 0
 					? chrono::milliseconds(packet.customWaitTime_ms)
 					: chrono::milliseconds(this->parameters.responseWindow_ms.get());
 
-				if (!waitForReceive(packet.target, waitDuration)
-					&& this->parameters.debug.printMessageErrors) {
-					ofLogError() << "ACK not seen from " << packet.target;
+				bool ackOnly;
+				SerialThread::InFlightPacket inFlightPacket;
+				inFlightPacket.target = packet.target;
+				inFlightPacket.seq = packet.seq;
+				RS485::peekCommand(data, size, inFlightPacket.commitGated, ackOnly);
+				copyTruncated(packet.address, inFlightPacket.address);
+				inFlightPacket.sentTime = sentTime;
+				inFlightPacket.deadline = sentTime + waitDuration;
+				this->serialThread->inFlight.push_back(inFlightPacket);
+				this->serialThread->inFlightCount = this->serialThread->inFlight.size();
+
+				if (this->parameters.ack.window.get() <= 1 || !ackOnly) {
+					// Stop-and-wait : hold the bus until the reply arrives or the window expires
+					// (a status report can be tens of ms on the wire, so there's no safe point to talk over it, and
+					// with only one bus there's nothing to gain by moving on before it's done)
+					auto target = packet.target;
+					this->serialThreadWaitUntil([this, target]() {
+						return !this->serialThreadIsInFlight(target);
+						});
+				}
+				else {
+					// Pipelined : move on once the ACK arrives, or once the whole of it would have been and gone (our
+					// frame, a pass of the portal's loop, then the ACK itself) and the bus has been quiet since
+					auto target = packet.target;
+					auto turnaround = chrono::milliseconds(this->parameters.ack.turnaround_ms.get());
+					auto frameDuration = chrono::microseconds((uint64_t)binaryCOBS.size() * 10 * 1000000 / (uint64_t)this->getBaudRate());
+					auto ackDuration = chrono::microseconds((uint64_t)RS485Protocol::ackFrameSize * 10 * 1000000 / (uint64_t)this->getBaudRate());
+					auto holdOff = chrono::duration_cast<chrono::steady_clock::duration>(frameDuration
+						+ chrono::microseconds(RS485Protocol::replyLoopAllowance_us)
+						+ ackDuration
+						+ turnaround);
+					this->serialThreadWaitUntil([this, target, sentTime, turnaround, holdOff]() {
+						if (!this->serialThreadIsInFlight(target)) {
+							return true;
+						}
+						auto now = chrono::steady_clock::now();
+						return now - sentTime > holdOff
+							&& now - this->serialThread->lastRxTime > turnaround;
+						}, sentTime + holdOff);
 				}
 			}
 			else if (packet.customWaitTime_ms == 0)
@@ -849,13 +1346,168 @@ namespace Modules {
 					? chrono::milliseconds(packet.customWaitTime_ms)
 					: chrono::milliseconds(this->parameters.gapBetweenBroadcastSends_ms.get());
 
-				this_thread::sleep_for(waitDuration);
+				// Keep reading while we wait, so that replies to the broadcast don't pile up in the device
+				auto waitUntil = sentTime + waitDuration;
+				this->serialThreadWaitUntil([waitUntil]() {
+					return chrono::steady_clock::now() >= waitUntil;
+					}, waitUntil);
 			}
 		}
 
+		// Anything the device has queued (e.g. a burst of broadcasts) goes out together
+		this->serialThread->serialDevice->flush();
+
 		return true;
 	}
 
+	//-----------
+	void
+		RS485::serialThreadRetireInFlight()
+	{
+		auto& inFlight = this->serialThread->inFlight;
+		auto& repliesSeen = this->serialThread->repliesSeen;
+
+		if (inFlight.empty()) {
+			// Nothing is waiting for these replies
+			repliesSeen.clear();
+			return;
+		}
+
+		auto now = chrono::steady_clock::now();
+
+		for (auto it = inFlight.begin(); it != inFlight.end(); ) {
+			// Look for the ACK
+			bool acked = false;
+			for (const auto& replySeen : repliesSeen) {
+				if (replySeen.source != it->target) {
+					continue;
+				}
+
+				// The firmware only echoes our seq for commit-gated commands, so for those anything else is a late
+				// reply to an earlier packet. Other replies carry whichever seq the portal last verified, as do all
+				// replies from a portal which isn't verifying (seq 0), so for those the source is all we can go on
+				if (it->commitGated && it->seq > 0 && replySeen.seq > 0) {
+					if (replySeen.seq == it->seq) {
+						acked = true;
+						break;
+					}
+					continue;
+				}
+
+				acked = true;
+				break;
+			}
+
+			if (acked) {
+				this->metrics->recordACK(it->target, now - it->sentTime);
+
+				auto latency_ms = chrono::duration<float, std::milli>(now - it->sentTime).count();
+				if (this->parameters.debug.printACKTime.get()) {
+					cout << "ACK received in " << (int)latency_ms << "ms" << endl;
+				}
+
+				Reports::Event event;
+				event.type = Reports::Event::Type::ACK;
+				event.portal = (int16_t)it->target;
+				event.latency_ms = latency_ms;
+				this->serialThreadRecord(event);
+
+				it = inFlight.erase(it);
+			}
+			else if (now > it->deadline) {
+				if (this->parameters.debug.printMessageErrors) {
+					ofLogError("RS485") << "ACK not seen from " << it->target;
+				}
+
+				this->metrics->recordTimeout(it->target);
+
+				Reports::Event event;
+				event.type = Reports::Event::Type::ACKTimeout;
+				event.portal = (int16_t)it->target;
+				event.setAddress(it->address, strlen(it->address));
+				event.value = chrono::duration_cast<chrono::milliseconds>(now - it->sentTime).count();
+				this->serialThreadRecord(event);
+
+				it = inFlight.erase(it);
+			}
+			else {
+				it++;
+			}
+		}
+
+		repliesSeen.clear();
+		this->serialThread->inFlightCount = inFlight.size();
+	}
+
+	//-----------
+	void
+		RS485::serialThreadWaitUntil(const function<bool()>& condition, chrono::steady_clock::time_point wakeAt)
+	{
+		// Whatever we are waiting for depends on what we have sent so far actually being sent
+		this->serialThread->serialDevice->flush();
+
+		while (!this->serialThread->joining) {
+			auto didRx = this->serialThreadReceive();
+			if (didRx) {
+				this->serialThread->lastRxTime = chrono::steady_clock::now();
+			}
+			this->serialThreadRetireInFlight();
+
+			if (condition()) {
+				return;
+			}
+
+			// Drain everything that's already arrived before we block
+			if (!didRx) {
+				this->serialThreadWaitForData(wakeAt);
+			}
+		}
+	}
+
+	//-----------
+	void
+		RS485::serialThreadWaitForData(chrono::steady_clock::time_point wakeAt)
+	{
+		// Upper bound on any wait, so that a device which never signals still gets checked
+		const auto idleWait = chrono::milliseconds(100);
+
+		auto now = chrono::steady_clock::now();
+		auto until = min(wakeAt, now + idleWait);
+
+		// ACK deadlines
+		for (const auto& inFlightPacket : this->serialThread->inFlight) {
+			until = min(until, inFlightPacket.deadline);
+		}
+
+		// The gap after the last rx (which gates sending) and the pipelined turnaround both run from the last rx
+		for (auto fromLastRx : { this->parameters.gapAfterLastRx_ms.get(), this->parameters.ack.turnaround_ms.get() }) {
+			auto end = this->serialThread->lastRxTime + chrono::milliseconds(fromLastRx);
+			if (end > now) {
+				until = min(until, end);
+			}
+		}
+
+		if (until <= now) {
+			return;
+		}
+
+		// Round up, so that we never wake just before the deadline and spin
+		auto timeout = chrono::duration_cast<chrono::microseconds>(until - now) + chrono::microseconds(1);
+		this->serialThread->serialDevice->waitForData(timeout);
+	}
+
+	//-----------
+	bool
+		RS485::serialThreadIsInFlight(int target) const
+	{
+		for (const auto& inFlightPacket : this->serialThread->inFlight) {
+			if (inFlightPacket.target == target) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 	//----------
 	void
 		RS485::updateInbox()
@@ -864,9 +1516,65 @@ namespace Modules {
 			return;
 		}
 
-		nlohmann::json json;
+		auto& inbox = this->serialThread->inbox;
+
+		FrameArena::View frame;
+		while (inbox.front(frame)) {
+			// Position reports and ACKs skip the json decode (unless we want to print them)
+			if (!this->parameters.debug.printRx.get()) {
+				HotReply hotReply;
+				if (decodeHotReply(frame.data, frame.size, hotReply)) {
+					inbox.pop();
+					this->column->processIncoming(hotReply);
+
+					this->lastIncomingMessageTime = std::chrono::steady_clock::now();
+					this->debug.isFrameNewMessageRx.notify();
+					this->debug.rxCount++;
+					this->debug.hasRxBeenReceived = true;
+					continue;
+				}
+			}
+
+			// Decode messagepack (the frame stays in the arena until we pop it)
+			nlohmann::json json;
+			try {
+				json = nlohmann::json::from_msgpack(frame.data, frame.data + frame.size);
+			}
+			catch (const std::exception& e) {
+				ofLogError("RS485") << "msgpack deserialize error : " << e.what();
+
+				if (this->parameters.debug.printBrokenMsgpack.get()) {
+					cout << "msgpack : ";
+					for (size_t i = 0; i < frame.size; i++) {
+						printChar(frame.data[i]);
+					}
+					cout << endl;
+				}
+
+				this->debug.isFrameNewMessageRxError.notify();
+				this->metrics->recordMsgpackError();
+
+				{
+					Reports::Event event;
+					event.type = Reports::Event::Type::MsgpackError;
+					event.setText(e.what(), strlen(e.what()));
+
+					// The first bytes of the frame, as hex
+					char hexPrefix[sizeof(event.address)];
+					size_t length = 0;
+					for (size_t i = 0; i < frame.size && length + 2 < sizeof(hexPrefix); i++) {
+						length += snprintf(hexPrefix + length, sizeof(hexPrefix) - length, "%02x", frame.data[i]);
+					}
+					event.setAddress(hexPrefix, length);
+
+					this->record(event);
+				}
+
+				inbox.pop();
+				continue;
+			}
+			inbox.pop();
 
-		while (this->serialThread->inbox.tryReceive(json)) {
 			// Perform deserialize on json
 			try {
 				this->processIncoming(json);
@@ -880,7 +1588,7 @@ namespace Modules {
 			catch (...) {
 				ofLogError() << "Process incoming error";
 			}
-			this->lastIncomingMessageTime = std::chrono::system_clock::now();
+			this->lastIncomingMessageTime = std::chrono::steady_clock::now();
 			this->debug.isFrameNewMessageRx.notify();
 			this->debug.rxCount++;
 			this->debug.hasRxBeenReceived = true;
@@ -5,47 +5,22 @@
 #include "../Base.h"
 #include "Utils.h"
 #include "../msgpack11/msgpack11.hpp"
+#include "FrameArena.h"
+#include "BusMetrics.h"
+#include "RS485Protocol.h"
 #include "../SerialDevices/IDevice.h"
 #include "../SerialDevices/ListedDevice.h"
+#include "../Reports/EventRing.h"
 
 namespace Modules {
 	class Column;
 
-	class RS485 : public Base {
+	class RS485 : public Base, public RS485Protocol {
 	public:
 		struct Config {
 			std::string comPort = "COM15";
 		};
 
-		// A messagepack encoded message (not COBS yet)
-		typedef vector<uint8_t> MsgpackBinary;
-
-		struct Packet {
-			Packet();
-			Packet(const MsgpackBinary&);
-			Packet(const msgpack11::MsgPack&);
-			Packet(const msgpack_sbuffer&);
-			Packet(const function<msgpack11::MsgPack()>&);
-
-			void render();
-
-			MsgpackBinary msgpackBinary;
-			bool needsACK = true;
-			int32_t customWaitTime_ms = -1;
-			int target = -1;
-			string address;
-			bool collateable = true;
-
-			function<msgpack11::MsgPack()> lazyMessageRenderer;
-
-			std::function<void()> onSent;
-		};
-
-		// -1 = Everybody
-		// 0 = Host
-		// 1-127 = Clients
-		typedef int8_t Target;
-
 		RS485(Column*);
 		~RS485();
 
@@ -79,50 +54,141 @@ namespace Modules {
 		vector<ofxCvGui::ElementPtr> getWidgets();
 
 		void removePacketsFromOutbox(string address, int target);
-		void collateOutboxPackets();
 
 		/// <summary>
 		/// Check if any packet has been received at all on this serial device
 		/// </summary>
 		/// <returns>true = any rx packet has been received</returns>
 		bool hasRxBeenReceived() const;
+
+		/// <summary>
+		/// Session recording (see Reports::Recorder). The serial thread pushes into one ring and the main thread
+		/// (or the column's worker during Installation::update) into the other, so that each ring keeps a single
+		/// producer. Pass nullptr to stop recording.
+		/// </summary>
+		void setEventRings(shared_ptr<Reports::EventRing> serialThreadRing
+			, shared_ptr<Reports::EventRing> mainThreadRing);
+		bool hasEventRings() const;
+
+		// Main thread only (or this column's worker during Installation::update)
+		void record(Reports::Event&);
+
+		// Safe to read from any thread (e.g. GET /metrics)
+		shared_ptr<const BusMetrics> getMetrics() const;
+
+		/// <summary>
+		/// Move the bus to another rate (the application firmware only, the bootloader stays at BAUD_RATE). update()
+		/// calls this as the Baud parameters ask. The "baud" broadcast goes out at the current rate and again at
+		/// BAUD_RATE (for portals which have just booted), then our end follows. Portals fall back to BAUD_RATE by
+		/// themselves if they stop hearing us, so whilst the bus is fast we keep it busy with broadcast pings.
+		/// </summary>
+		void negotiateBaudRate(int baudRate);
+
+		// The rate our end of the bus is at now
+		int getBaudRate() const;
+
+		// Reply slots are sized for BAUD_RATE. This shrinks the wire time part of a slot to suit the current rate
+		uint32_t scaleReplySlot_us(uint32_t replySlot_us) const;
+
+		// Serial thread only (e.g. from a Packet's onSent). Our end goes back to BAUD_RATE without telling the portals,
+		// e.g. after announcing firmware, since the portals reboot into the bootloader
+		void serialThreadFallBackToBootBaudRate();
 	protected:
 		Column* column;
 
 		void openSerial(const nlohmann::json&);
 		void openSerial(const SerialDevices::ListedDevice&);
 		void openSerial(shared_ptr<SerialDevices::IDevice>);
-		void closeSerial();
+		void recordDeviceConnect(SerialDevices::IDevice&);
+
+		// reason is as the session report's device_disconnect (closed, io_error, stall, shutdown)
+		void closeSerial(const char* reason = "closed");
 
 		void serialThreadedFunction();
 		bool serialThreadReceive();
 		bool serialThreadSend();
 
+		// ACK window
+		void serialThreadRetireInFlight();
+		void serialThreadWaitUntil(const function<bool()>&
+			, chrono::steady_clock::time_point wakeAt = chrono::steady_clock::time_point::max());
+		bool serialThreadIsInFlight(int target) const;
+
+		// Block on the device until bytes arrive, the device is woken (outbox has work, or we are closing),
+		// or the earliest of wakeAt and our own deadlines (ACK expiry, gap after last rx) passes
+		void serialThreadWaitForData(chrono::steady_clock::time_point wakeAt);
+
 		void updateInbox();
 
+		// Serial thread only. Does nothing if we're not recording
+		void serialThreadRecord(Reports::Event&);
+
+		void updateBaudRate();
+		void serialThreadNegotiateBaudRate(int baudRate);
+
 		struct SerialThread {
 			std::thread thread;
 
 			bool joining = false;
 			shared_ptr<SerialDevices::IDevice> serialDevice;
-			std::chrono::system_clock::time_point lastRxTime = chrono::system_clock::now();
-
-			vector<uint8_t> cobsIncoming;
-			bool isFirstIncoming = true;
-			ofThreadChannel<nlohmann::json> inbox;
-			ofThreadChannel<Packet> outbox;
+			std::chrono::steady_clock::time_point lastRxTime = chrono::steady_clock::now();
+
+			// Bytes are read from the device into here, then COBS frames are decoded in place in the inbox
+			uint8_t rxChunk[4096];
+			FrameArena inbox;
+			TxScheduler outbox;
+
+			// A reply seen on the bus, with the seq echoed in its trailer (-1 = frame had no trailer)
+			struct ReplySeen {
+				int source;
+				int seq;
+			};
+			vector<ReplySeen> repliesSeen;
+
+			// Addressed packets which have been sent and are waiting for their ACK
+			struct InFlightPacket {
+				int target;
+				uint8_t seq;
+				bool commitGated; // the reply echoes seq (otherwise it echoes whatever the portal last verified)
+				char address[sizeof(Reports::Event::address)]; // for the session report if the ACK never comes
+				std::chrono::steady_clock::time_point sentTime;
+				std::chrono::steady_clock::time_point deadline;
+			};
+			vector<InFlightPacket> inFlight;
+			std::atomic<size_t> inFlightCount{ 0 };
+
+			// Per-target sequence numbers. 0 is never stamped (it's what the firmware echoes before it has verified anything)
+			uint8_t txSeq[128] = { 0 };
+
+			// Session recording (null if we're not recording)
+			shared_ptr<Reports::EventRing> eventRing;
 		};
 		shared_ptr<SerialThread> serialThread;
 
 		struct {
 			nlohmann::json settings;
-			std::chrono::system_clock::time_point lastConnectionAttempt = chrono::system_clock::now();
+			std::chrono::steady_clock::time_point lastConnectionAttempt = chrono::steady_clock::now();
 			const std::chrono::milliseconds retryPeriod{ 20000 };
 		} initilialisation;
 
-		std::chrono::system_clock::time_point lastPoll;
-		std::chrono::system_clock::time_point lastKeepAlive;
-		std::chrono::system_clock::time_point lastIncomingMessageTime = std::chrono::system_clock::now();
+		// Recorded by the serial thread (and updateInbox), the rates are sampled in update
+		const shared_ptr<BusMetrics> metrics = make_shared<BusMetrics>();
+		std::chrono::steady_clock::time_point lastMetricsUpdate;
+
+		std::chrono::steady_clock::time_point lastPoll;
+		std::chrono::steady_clock::time_point lastKeepAlive;
+		std::chrono::steady_clock::time_point lastIncomingMessageTime = std::chrono::steady_clock::now();
+
+		// Written by the serial thread as the device changes rate
+		std::atomic<int> baudRate{ BAUD_RATE };
+		std::atomic<bool> baudRateFixed{ false }; // the device can't change rate (e.g. TCP)
+		std::atomic<int> baudRateUnsupported{ 0 }; // a rate the device refused (never announced again)
+
+		struct {
+			int requested = BAUD_RATE;
+			std::chrono::steady_clock::time_point lastAttempt;
+			uint64_t timeoutsAtAttempt = 0;
+		} baudNegotiation;
 
 		struct : ofParameterGroup {
 			ofParameter<int> responseWindow_ms{ "Response window [ms]", 300 };
@@ -130,6 +196,28 @@ namespace Modules {
 			ofParameter<int> gapAfterLastRx_ms{ "Gap after last rx [ms]",  5 };
 			ofParameter<bool> collatePackets{ "Collate packets",  true };
 
+			struct : ofParameterGroup {
+				ofParameter<float> motionBudget{ "Motion budget", 0.8, 0, 1 };
+				ofParameter<float> pollBudget{ "Poll budget", 0.15, 0, 1 };
+				ofParameter<float> diagnosticBudget{ "Diagnostic budget", 0.05, 0, 1 };
+				PARAM_DECLARE("Scheduler", motionBudget, pollBudget, diagnosticBudget);
+			} scheduler;
+
+			struct : ofParameterGroup {
+				ofParameter<bool> appendSeqCRC{ "Append seq+CRC", true };
+				ofParameter<int> window{ "Window", 4, 1, 32 }; // 1 = stop-and-wait for everything (ACK-only packets are pipelined otherwise)
+				ofParameter<int> turnaround_ms{ "Turnaround [ms]", 15 };
+				PARAM_DECLARE("ACK", appendSeqCRC, window, turnaround_ms);
+			} ack;
+
+			struct : ofParameterGroup {
+				ofParameter<int> target{ "Target", BAUD_RATE }; // 115200, 230400, 460800, 921600 or 1000000
+				ofParameter<int> switchDelay_ms{ "Switch delay [ms]", 20 };
+				ofParameter<int> reannounce_s{ "Re-announce [s]", 10 };
+				ofParameter<int> fallBackAfter_s{ "Fall back after [s]", 5 };
+				PARAM_DECLARE("Baud", target, switchDelay_ms, reannounce_s, fallBackAfter_s);
+			} baud;
+
 			struct : ofParameterGroup {
 				ofParameter<bool> printTx{ "Print Tx", false };
 				ofParameter<bool> printRx{ "Print Rx", false };
@@ -140,7 +228,7 @@ namespace Modules {
 				PARAM_DECLARE("Debug", printTx, printRx, printACKTime, printMessageErrors, targetID);
 			} debug;
 			
-			PARAM_DECLARE("RS485", responseWindow_ms, gapBetweenBroadcastSends_ms, gapAfterLastRx_ms, collatePackets, debug);
+			PARAM_DECLARE("RS485", responseWindow_ms, gapBetweenBroadcastSends_ms, gapAfterLastRx_ms, collatePackets, scheduler, ack, baud, debug);
 		} parameters;
 
 		struct {
@@ -161,7 +249,10 @@ namespace Modules {
 			bool hasRxBeenReceived = false;
 		} debug;
 
-		vector<int> repliesSeenFrom; // the ID of the sender
+		// The serial thread's copy lives in SerialThread (handed over with serialThreadActions)
+		shared_ptr<Reports::EventRing> serialThreadEventRing;
+		shared_ptr<Reports::EventRing> mainThreadEventRing;
+
 		ofThreadChannel<std::function<void()>> serialThreadActions;
 		ofThreadChannel<std::promise<void>*> clearOutboxNotify;
 	}; 
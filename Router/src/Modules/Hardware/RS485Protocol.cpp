@@ -0,0 +1,571 @@
+#include "pch_App.h"
+#include "RS485Protocol.h"
+
+#include "../cobs-c/cobs.h"
+#include "../../crc16ccitt.h"
+
+namespace Modules {
+#pragma mark Packet
+	//----------
+	RS485Protocol::Packet::Packet()
+	{
+
+	}
+
+	//----------
+	RS485Protocol::Packet::Packet(const MsgpackBinary& msgpackBinary)
+		: msgpackBinary(msgpackBinary)
+	{
+
+	}
+
+	//----------
+	RS485Protocol::Packet::Packet(const msgpack11::MsgPack& message)
+	{
+		// take the first key as address
+		if (message.is_array()) {
+			const auto& root_array_items = message.array_items();
+			if (root_array_items.size() >= 3) {
+				// the third element might be an object
+				if (root_array_items[2].is_object()) {
+					const auto& object_items = root_array_items[2].object_items();
+					if (!object_items.empty()) {
+						const auto& firstItem = object_items.begin();
+						if (firstItem->first.is_string()) {
+							this->address = (string)firstItem->first.string_value();
+						}
+					}
+				}
+			}
+			
+		}
+
+		auto dataString = message.dump();
+		auto dataBegin = (uint8_t*)dataString.data();
+		auto dataEnd = dataBegin + dataString.size();
+		this->msgpackBinary.assign(dataBegin, dataEnd);
+	}
+
+	//----------
+	RS485Protocol::Packet::Packet(const function<msgpack11::MsgPack()>& lazyMessageRenderer)
+		: lazyMessageRenderer(lazyMessageRenderer)
+	{
+
+	}
+
+	//----------
+	void
+		RS485Protocol::Packet::render()
+	{
+		if (this->lazyMessageRenderer) {
+			auto message = this->lazyMessageRenderer();
+			auto dataString = message.dump();
+			auto dataBegin = (uint8_t*)dataString.data();
+			auto dataEnd = dataBegin + dataString.size();
+			this->msgpackBinary.assign(dataBegin, dataEnd);
+		}
+	}
+
+#pragma mark Outbox
+	//----------
+	void
+		RS485Protocol::Outbox::send(Packet&& packet)
+	{
+		std::lock_guard<mutex> lock(this->lock);
+
+		// This is true for cases where we gave a msgpack object but no address (we try to find the address automatically in Packet constructor)
+		if (packet.address.empty()) {
+			this->packets.push_back(std::move(packet));
+			return;
+		}
+
+		auto& slot = this->index[Key(packet.address, packet.target)];
+
+		// Supersede the pending packet in place
+		if (this->collate
+			&& packet.collateable
+			&& slot.hasCollateablePacket) {
+			*slot.collateablePacket = std::move(packet);
+			return;
+		}
+
+		auto collateable = packet.collateable;
+		auto it = this->packets.insert(this->packets.end(), std::move(packet));
+		slot.packets.push_back(it);
+		if (collateable && !slot.hasCollateablePacket) {
+			slot.collateablePacket = it;
+			slot.hasCollateablePacket = true;
+		}
+	}
+
+	//----------
+	bool
+		RS485Protocol::Outbox::tryReceive(Packet& packet)
+	{
+		std::lock_guard<mutex> lock(this->lock);
+
+		if (this->packets.empty()) {
+			return false;
+		}
+
+		auto it = this->packets.begin();
+
+		if (!it->address.empty()) {
+			auto findSlot = this->index.find(Key(it->address, it->target));
+			if (findSlot != this->index.end()) {
+				auto& slot = findSlot->second;
+
+				// Packets for a key leave in the same order as they arrived, so this is always the front
+				if (!slot.packets.empty() && slot.packets.front() == it) {
+					slot.packets.pop_front();
+				}
+				if (slot.hasCollateablePacket && slot.collateablePacket == it) {
+					slot.hasCollateablePacket = false;
+				}
+				if (slot.packets.empty()) {
+					this->index.erase(findSlot);
+				}
+			}
+		}
+
+		packet = std::move(*it);
+		this->packets.erase(it);
+		return true;
+	}
+
+	//----------
+	size_t
+		RS485Protocol::Outbox::size() const
+	{
+		std::lock_guard<mutex> lock(this->lock);
+		return this->packets.size();
+	}
+
+	//----------
+	void
+		RS485Protocol::Outbox::clear()
+	{
+		std::lock_guard<mutex> lock(this->lock);
+		this->packets.clear();
+		this->index.clear();
+	}
+
+	//----------
+	void
+		RS485Protocol::Outbox::remove(const string& address, int target)
+	{
+		std::lock_guard<mutex> lock(this->lock);
+
+		auto findSlot = this->index.find(Key(address, target));
+		if (findSlot == this->index.end()) {
+			return;
+		}
+
+		for (auto it : findSlot->second.packets) {
+			this->packets.erase(it);
+		}
+		this->index.erase(findSlot);
+	}
+
+	//----------
+	void
+		RS485Protocol::Outbox::setCollate(bool collate)
+	{
+		std::lock_guard<mutex> lock(this->lock);
+		if (this->collate == collate) {
+			return;
+		}
+		this->collate = collate;
+
+		// When collation is switched back on, only packets sent from now on can supersede each other
+		if (collate) {
+			return;
+		}
+		for (auto& it : this->index) {
+			it.second.hasCollateablePacket = false;
+		}
+	}
+
+#pragma mark TxScheduler
+	//----------
+	RS485Protocol::TxScheduler::TxScheduler()
+	{
+		this->budgets[(size_t)Priority::Motion] = 0.8f;
+		this->budgets[(size_t)Priority::Poll] = 0.15f;
+		this->budgets[(size_t)Priority::Diagnostic] = 0.05f;
+
+		for (auto& latency_ms : this->latency_ms) {
+			latency_ms = 0.0f;
+		}
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::send(Packet&& packet)
+	{
+		packet.enqueueTime = chrono::steady_clock::now();
+		auto priority = min((size_t)packet.priority, (size_t)Priority::Count - 1);
+		this->queues[priority].send(std::move(packet));
+	}
+
+	//----------
+	bool
+		RS485Protocol::TxScheduler::tryReceive(Packet& packet)
+	{
+		this->decayUsage();
+
+		float totalUsage = 0.0f;
+		for (auto usage : this->usage) {
+			totalUsage += usage;
+		}
+
+		auto receiveFrom = [&](size_t priority) {
+			if (!this->queues[priority].tryReceive(packet)) {
+				return false;
+			}
+
+			// Update the smoothed latency
+			auto latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - packet.enqueueTime).count() / 1000.0f;
+			auto priorLatency = this->latency_ms[priority].load();
+			this->latency_ms[priority] = priorLatency + (latency - priorLatency) * 0.1f;
+
+			return true;
+		};
+
+		// Highest priority class which hasn't used up its share of the bus
+		for (size_t priority = 0; priority < (size_t)Priority::Count; priority++) {
+			if (this->queues[priority].size() == 0) {
+				continue;
+			}
+			auto share = totalUsage > 0.0f
+				? this->usage[priority] / totalUsage
+				: 0.0f;
+			if (share <= this->budgets[priority].load() && receiveFrom(priority)) {
+				return true;
+			}
+		}
+
+		// Everybody waiting is over budget, so don't leave the bus idle
+		for (size_t priority = 0; priority < (size_t)Priority::Count; priority++) {
+			if (receiveFrom(priority)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::notifySent(Priority priority, size_t byteCount)
+	{
+		this->usage[min((size_t)priority, (size_t)Priority::Count - 1)] += (float)byteCount;
+	}
+
+	//----------
+	size_t
+		RS485Protocol::TxScheduler::size() const
+	{
+		size_t total = 0;
+		for (const auto& queue : this->queues) {
+			total += queue.size();
+		}
+		return total;
+	}
+
+	//----------
+	size_t
+		RS485Protocol::TxScheduler::size(Priority priority) const
+	{
+		return this->queues[min((size_t)priority, (size_t)Priority::Count - 1)].size();
+	}
+
+	//----------
+	float
+		RS485Protocol::TxScheduler::getLatency_ms(Priority priority) const
+	{
+		return this->latency_ms[min((size_t)priority, (size_t)Priority::Count - 1)].load();
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::clear()
+	{
+		for (auto& queue : this->queues) {
+			queue.clear();
+		}
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::remove(const string& address, int target)
+	{
+		for (auto& queue : this->queues) {
+			queue.remove(address, target);
+		}
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::setCollate(bool collate)
+	{
+		for (auto& queue : this->queues) {
+			queue.setCollate(collate);
+		}
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::setBudget(Priority priority, float fraction)
+	{
+		this->budgets[min((size_t)priority, (size_t)Priority::Count - 1)] = fraction;
+	}
+
+	//----------
+	void
+		RS485Protocol::TxScheduler::decayUsage()
+	{
+		auto now = chrono::steady_clock::now();
+		auto dt_s = chrono::duration_cast<chrono::microseconds>(now - this->lastDecay).count() / 1000000.0f;
+		this->lastDecay = now;
+
+		// Usage is bytes sent over roughly the last second
+		auto decay = exp(-dt_s);
+		for (auto& usage : this->usage) {
+			usage *= decay;
+		}
+	}
+
+	//----------
+	string
+		RS485Protocol::toString(Priority priority)
+	{
+		switch (priority) {
+		case Priority::Motion:
+			return "Motion";
+		case Priority::Poll:
+			return "Poll";
+		case Priority::Diagnostic:
+			return "Diagnostic";
+		default:
+			return "Unknown";
+		}
+	}
+
+#pragma mark Envelope
+	namespace {
+		//----------
+		// Read an int8 address in whichever form the sender packed it
+		bool
+			readAddress(const uint8_t* data, size_t size, size_t& offset, int& value)
+		{
+			if (offset >= size) {
+				return false;
+			}
+			auto byte = data[offset++];
+			if (byte <= 0x7F || byte >= 0xE0) {
+				// positive / negative fixint
+				value = (int)(int8_t)byte;
+				return true;
+			}
+			if ((byte == 0xD0 || byte == 0xCC) && offset < size) {
+				value = byte == 0xD0
+					? (int)(int8_t)data[offset]
+					: (int)data[offset];
+				offset++;
+				return true;
+			}
+			return false;
+		}
+
+		//----------
+		// Read a fixstr / str8, returning false for anything else
+		bool
+			readString(const uint8_t* data, size_t size, size_t& offset, const char*& string, size_t& length)
+		{
+			if (offset >= size) {
+				return false;
+			}
+			auto byte = data[offset++];
+			if ((byte & 0xE0) == 0xA0) {
+				length = byte & 0x1F;
+			}
+			else if (byte == 0xD9 && offset < size) {
+				length = data[offset++];
+			}
+			else {
+				return false;
+			}
+			if (offset + length > size) {
+				return false;
+			}
+			string = (const char*)data + offset;
+			offset += length;
+			return true;
+		}
+	}
+
+	//----------
+	bool
+		RS485Protocol::appendSeqAndCRC(MsgpackBinary& msgpackBinary, uint8_t seq)
+	{
+		// We can only extend an envelope which was packed as a fixarray [target, source, body]
+		if (msgpackBinary.empty() || msgpackBinary[0] != 0x93) {
+			return false;
+		}
+
+		// [target, source, body, seq, crc16]
+		msgpackBinary[0] = 0x95;
+
+		msgpackBinary.push_back(0xcc);
+		msgpackBinary.push_back(seq);
+
+		// CRC covers everything before the CRC field (including the rewritten array header)
+		auto crc = crc16ccitt(msgpackBinary.data(), msgpackBinary.size());
+		msgpackBinary.push_back(0xcd);
+		msgpackBinary.push_back((uint8_t)(crc >> 8));
+		msgpackBinary.push_back((uint8_t)(crc & 0xFF));
+
+		return true;
+	}
+
+	//----------
+	bool
+		RS485Protocol::peekEnvelope(const uint8_t* data, size_t size, int& source, int& seq)
+	{
+		source = -1;
+		seq = -1;
+
+		// [target, source, body] or [target, source, body, seq, crc16]
+		if (size < 3 || (data[0] & 0xF0) != 0x90) {
+			return true;
+		}
+		auto elementCount = data[0] & 0x0F;
+
+		size_t offset = 1;
+		int target;
+		if (!readAddress(data, size, offset, target) || !readAddress(data, size, offset, source)) {
+			source = -1;
+			return true;
+		}
+
+		// Trailer is always the last 5 bytes : 0xcc seq 0xcd crcHi crcLo
+		if (elementCount >= 5
+			&& size >= offset + 5
+			&& data[size - 5] == 0xCC
+			&& data[size - 3] == 0xCD) {
+			auto crc = (uint16_t)((data[size - 2] << 8) | data[size - 1]);
+			if (crc16ccitt(data, size - 3) != crc) {
+				return false;
+			}
+			seq = data[size - 4];
+		}
+
+		return true;
+	}
+
+	//----------
+	void
+		RS485Protocol::peekCommand(const uint8_t* data, size_t size, bool& commitGated, bool& ackOnly)
+	{
+		commitGated = false;
+		ackOnly = true;
+
+		// [target, source, body, ...]
+		if (size < 3 || (data[0] & 0xF0) != 0x90) {
+			return;
+		}
+		size_t offset = 1;
+		int target, source;
+		if (!readAddress(data, size, offset, target) || !readAddress(data, size, offset, source) || offset >= size) {
+			return;
+		}
+
+		// A bare string is the firmware announce, which is verified before the portal reboots
+		{
+			const char* word;
+			size_t wordLength;
+			auto stringOffset = offset;
+			if (readString(data, size, stringOffset, word, wordLength)) {
+				commitGated = true;
+				return;
+			}
+		}
+
+		// Otherwise we want a map, and the first key decides
+		auto byte = data[offset++];
+		if ((byte & 0xF0) == 0x80) {
+			if ((byte & 0x0F) == 0) {
+				return;
+			}
+		}
+		else if (byte == 0xDE) {
+			offset += 2;
+		}
+		else {
+			return;
+		}
+
+		const char* keyChars;
+		size_t keyLength;
+		if (!readString(data, size, offset, keyChars, keyLength)) {
+			return;
+		}
+		const string key(keyChars, keyLength);
+
+		// "poll" and "s" are only verified in their broadcast [slot_us, firstID, ...] form
+		auto valueIsArray = offset < size
+			&& ((data[offset] & 0xF0) == 0x90 || data[offset] == 0xDC || data[offset] == 0xDD);
+
+		static const char* const commitGatedKeys[] = {
+			"m", "mm", "settingsWrite", "init", "calibrate", "home", "unjam", "reset", "baud"
+		};
+
+		if (key == "poll" || key == "s") {
+			commitGated = valueIsArray;
+			ackOnly = false;
+		}
+		else if (key == "p" || key == "settingsRead") {
+			ackOnly = false;
+		}
+		else {
+			for (auto commitGatedKey : commitGatedKeys) {
+				if (key == commitGatedKey) {
+					commitGated = true;
+					break;
+				}
+			}
+		}
+	}
+
+	//----------
+	bool
+		RS485Protocol::encodeFrame(const MsgpackBinary& msgpackBinary, vector<uint8_t>& frame)
+	{
+		auto data = msgpackBinary.data();
+		auto size = msgpackBinary.size();
+
+		// allocate buffer of max size for cobs
+		frame.resize(size * 255 / 254 + 2);
+
+		// Perform the encode
+		auto encodeResult = cobs_encode(frame.data()
+			, frame.size()
+			, data
+			, size);
+
+		// Check we encoded OK
+		if (encodeResult.status != COBS_ENCODE_OK) {
+			frame.clear();
+			return false;
+		}
+
+		// Crop the message to the correct number of bytes
+		frame.resize(encodeResult.out_len);
+
+		// add a zero on the end
+		frame.push_back(0);
+
+		return true;
+	}
+}
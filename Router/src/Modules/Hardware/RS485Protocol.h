@@ -0,0 +1,170 @@
+#pragma once
+
+#include "../msgpack11/msgpack11.hpp"
+
+struct msgpack_sbuffer;
+
+namespace Modules {
+	/// <summary>
+	/// The parts of RS485 which don't touch openFrameworks : packets, the outbox / scheduler
+	/// and the envelope helpers. RS485 inherits these so that they're still RS485::Packet etc,
+	/// and they can also be built headless (see Router/core).
+	/// </summary>
+	struct RS485Protocol {
+		// A messagepack encoded message (not COBS yet)
+		typedef vector<uint8_t> MsgpackBinary;
+
+		// Tx priority classes, highest first
+		enum class Priority : uint8_t {
+			Motion = 0,
+			Poll,
+			Diagnostic,
+			Count
+		};
+		static string toString(Priority);
+
+		struct Packet {
+			Packet();
+			Packet(const MsgpackBinary&);
+			Packet(const msgpack11::MsgPack&);
+			Packet(const msgpack_sbuffer&);
+			Packet(const function<msgpack11::MsgPack()>&);
+
+			void render();
+
+			MsgpackBinary msgpackBinary;
+			bool needsACK = true;
+			int32_t customWaitTime_ms = -1;
+			int target = -1;
+			string address;
+			bool collateable = true;
+
+			// Stamped by the serial thread at send time (never at enqueue, so collation can't carry a stale one)
+			uint8_t seq = 0;
+
+			Priority priority = Priority::Motion;
+			chrono::steady_clock::time_point enqueueTime;
+
+			// For broadcasts which elicit replies in time slots (e.g. "mm", broadcast "poll")
+			// Slot n starts n * replySlot_us after the end of the frame
+			struct ReplySlot {
+				int target;
+				int slot;
+			};
+			vector<ReplySlot> replySlots;
+			uint32_t replySlot_us = 0;
+
+			function<msgpack11::MsgPack()> lazyMessageRenderer;
+
+			// A frame which is already COBS encoded (e.g. firmware frames, encoded once and sent to every bus)
+			// It goes out as is : nothing is rendered, stamped or encoded at send time
+			shared_ptr<const vector<uint8_t>> encodedFrame;
+
+			std::function<void()> onSent;
+		};
+
+		// FIFO of packets with an index on (address, target) so that a collateable packet
+		// supersedes the pending one in place (keeping its place in the queue).
+		// Every operation is O(1) and holds the lock only briefly.
+		class Outbox {
+		public:
+			void send(Packet&&);
+			bool tryReceive(Packet&);
+			size_t size() const;
+			void clear();
+			void remove(const string& address, int target);
+			void setCollate(bool);
+		protected:
+			typedef list<Packet>::iterator PacketIterator;
+			typedef pair<string, int> Key;
+
+			struct KeyHash {
+				size_t operator()(const Key& key) const {
+					return hash<string>()(key.first) ^ (hash<int>()(key.second) << 1);
+				}
+			};
+
+			struct Slot {
+				deque<PacketIterator> packets; // in queue order
+				PacketIterator collateablePacket;
+				bool hasCollateablePacket = false;
+			};
+
+			mutable mutex lock;
+			list<Packet> packets;
+			unordered_map<Key, Slot, KeyHash> index;
+			bool collate = true;
+		};
+
+		// One Outbox per priority class. The serial thread takes from the highest priority
+		// class which is within its share of the bus (falling back to strict priority when
+		// every waiting class is over budget), so motion never waits behind polls.
+		class TxScheduler {
+		public:
+			TxScheduler();
+
+			void send(Packet&&);
+			bool tryReceive(Packet&);
+			void notifySent(Priority, size_t byteCount);
+
+			size_t size() const;
+			size_t size(Priority) const;
+			float getLatency_ms(Priority) const;
+
+			void clear();
+			void remove(const string& address, int target);
+			void setCollate(bool);
+			void setBudget(Priority, float fraction);
+		protected:
+			void decayUsage();
+
+			Outbox queues[(size_t)Priority::Count];
+
+			// Share of the bus for each class (written by main thread)
+			std::atomic<float> budgets[(size_t)Priority::Count];
+
+			// Bytes sent per class, decaying over ~1s (serial thread only)
+			float usage[(size_t)Priority::Count] = { 0.0f, 0.0f, 0.0f };
+			chrono::steady_clock::time_point lastDecay = chrono::steady_clock::now();
+
+			// Time spent waiting in the queue, smoothed (written by serial thread)
+			std::atomic<float> latency_ms[(size_t)Priority::Count];
+		};
+
+		// -1 = Everybody
+		// 0 = Host
+		// 1-127 = Clients
+		typedef int8_t Target;
+
+		// Append the [seq, crc16] trailer to a msgpack envelope (see protocol-hardening.md §3)
+		static bool appendSeqAndCRC(MsgpackBinary&, uint8_t seq);
+
+		// Read the source and the optional trailer seq (-1 if none) from a msgpack envelope without decoding the body
+		// Returns false if the frame has a trailer whose CRC doesn't match
+		static bool peekEnvelope(const uint8_t* data, size_t size, int& source, int& seq);
+
+		// What a portal does with an envelope addressed to it, judged by the first key of the body (as PortalFW's
+		// App::processIncoming) :
+		//  commitGated = the firmware verifies the trailer before acting, so its reply echoes our seq. Any other
+		//    reply carries whichever seq the portal last verified
+		//  ackOnly = the reply is a bare ACK, rather than a status / positions report
+		static void peekCommand(const uint8_t* data, size_t size, bool& commitGated, bool& ackOnly);
+
+		// Upper bound for an ACK on the wire ([0, id, bool, seq, crc16], COBS encoded and delimited)
+		static const size_t ackFrameSize = 12;
+
+		// A portal may start replying up to one pass of its main loop after our frame ends
+		static const uint32_t replyLoopAllowance_us = 2000;
+
+		// Upper bound for a compact status reply on the wire ([0, id, {"s" : bin}, seq, crc16] carrying the largest
+		// layout v1 report which PortalFW packs, App::compactStatusMaxSize = 160 bytes, COBS encoded and delimited)
+		static const size_t compactStatusFrameSize = 176;
+
+		// A broadcast compact poll's reply slot at BAUD_RATE (115200) : that reply's wire time plus the loop allowance
+		static const uint32_t compactStatusSlot_us = replyLoopAllowance_us
+			+ (uint32_t)((compactStatusFrameSize * 10 * 1000000 + 115200 - 1) / 115200);
+
+		// COBS encode a msgpack envelope into a frame ready for the wire (including the 0 delimiter)
+		static bool encodeFrame(const MsgpackBinary&, vector<uint8_t>& frame);
+	};
+}
@@ -0,0 +1,303 @@
+#include "pch_App.h"
+#include "ReplyDecoder.h"
+
+namespace Modules {
+	namespace {
+		// Minimal forward-only msgpack reader over a frame. Every read fails (and the
+		// caller falls back to json) if the bytes aren't exactly what we expect.
+		struct Reader {
+			const uint8_t* data;
+			size_t size;
+			size_t offset = 0;
+
+			//----------
+			bool
+				readByte(uint8_t& value)
+			{
+				if (this->offset >= this->size) {
+					return false;
+				}
+				value = this->data[this->offset++];
+				return true;
+			}
+
+			//----------
+			bool
+				readBigEndian(uint64_t& value, size_t byteCount)
+			{
+				if (this->offset + byteCount > this->size) {
+					return false;
+				}
+				value = 0;
+				for (size_t i = 0; i < byteCount; i++) {
+					value = (value << 8) | this->data[this->offset++];
+				}
+				return true;
+			}
+
+			//----------
+			template<typename T>
+			bool
+				readLittleEndian(T& value)
+			{
+				if (this->offset + sizeof(T) > this->size) {
+					return false;
+				}
+				uint64_t raw = 0;
+				for (size_t i = 0; i < sizeof(T); i++) {
+					raw |= (uint64_t)this->data[this->offset++] << (8 * i);
+				}
+				value = (T)raw;
+				return true;
+			}
+
+			//----------
+			bool
+				readInt(int64_t& value)
+			{
+				uint8_t header;
+				if (!this->readByte(header)) {
+					return false;
+				}
+
+				// fixint
+				if (header <= 0x7F || header >= 0xE0) {
+					value = (int8_t)header;
+					return true;
+				}
+
+				size_t byteCount;
+				bool isSigned;
+				switch (header) {
+				case 0xCC: byteCount = 1; isSigned = false; break;
+				case 0xCD: byteCount = 2; isSigned = false; break;
+				case 0xCE: byteCount = 4; isSigned = false; break;
+				case 0xD0: byteCount = 1; isSigned = true; break;
+				case 0xD1: byteCount = 2; isSigned = true; break;
+				case 0xD2: byteCount = 4; isSigned = true; break;
+				default:
+					return false;
+				}
+
+				uint64_t raw;
+				if (!this->readBigEndian(raw, byteCount)) {
+					return false;
+				}
+
+				if (isSigned) {
+					// sign extend
+					auto shift = 64 - 8 * byteCount;
+					value = (int64_t)(raw << shift) >> shift;
+				}
+				else {
+					value = (int64_t)raw;
+				}
+				return true;
+			}
+
+			//----------
+			bool
+				readFixArraySize(uint8_t& size)
+			{
+				uint8_t header;
+				if (!this->readByte(header) || (header & 0xF0) != 0x90) {
+					return false;
+				}
+				size = header & 0x0F;
+				return true;
+			}
+		};
+	}
+
+	//----------
+	bool
+		decodeCompactStatus(const uint8_t* data, size_t size, CompactStatus& status)
+	{
+		Reader reader{ data, size };
+
+		uint8_t flags;
+		if (!reader.readByte(status.formatVersion)
+			|| status.formatVersion != 1
+			|| !reader.readByte(flags)
+			|| !reader.readByte(status.fields)
+			|| !reader.readLittleEndian(status.upTime)) {
+			return false;
+		}
+		status.changedOnly = (flags & 1) != 0;
+		status.logMessagesWaiting = (flags & 2) != 0;
+
+		if (status.has(CompactStatus::Positions)) {
+			for (auto& axis : status.axes) {
+				if (!reader.readLittleEndian(axis.position)) {
+					return false;
+				}
+			}
+			for (auto& axis : status.axes) {
+				if (!reader.readLittleEndian(axis.targetPosition)) {
+					return false;
+				}
+			}
+		}
+
+		if (status.has(CompactStatus::Health)) {
+			uint8_t health;
+			if (!reader.readByte(health)) {
+				return false;
+			}
+			for (int i = 0; i < 2; i++) {
+				auto axisHealth = health >> (i * 4);
+				status.axes[i].measureCycleOK = axisHealth & 1;
+				status.axes[i].switchesOK = axisHealth & 2;
+				status.axes[i].backlashOK = axisHealth & 4;
+				status.axes[i].homeOK = axisHealth & 8;
+			}
+		}
+
+		if (status.has(CompactStatus::MotionProfiles)) {
+			for (auto& axis : status.axes) {
+				if (!reader.readLittleEndian(axis.maximumSpeed)
+					|| !reader.readLittleEndian(axis.acceleration)
+					|| !reader.readLittleEndian(axis.minimumSpeed)) {
+					return false;
+				}
+			}
+		}
+
+		if (status.has(CompactStatus::Optical)) {
+			for (auto& axis : status.axes) {
+				if (!reader.readLittleEndian(axis.opticalThreshold)
+					|| !reader.readLittleEndian(axis.opticalWidth)) {
+					return false;
+				}
+			}
+		}
+
+		if (status.has(CompactStatus::FastHomeFailure)) {
+			for (auto& axis : status.axes) {
+				if (!reader.readByte(axis.fastHomeFailure)) {
+					return false;
+				}
+			}
+		}
+
+		if (status.has(CompactStatus::Settings)) {
+			uint8_t fullCurrentHomeRecovery;
+			if (!reader.readLittleEndian(status.operatingCurrentMa)
+				|| !reader.readByte(fullCurrentHomeRecovery)
+				|| !reader.readByte(status.settingsSource)
+				|| !reader.readLittleEndian(status.opticalCalibrationVersion)) {
+				return false;
+			}
+			status.fullCurrentHomeRecovery = fullCurrentHomeRecovery != 0;
+		}
+
+		if (status.has(CompactStatus::ProvisionSerial)) {
+			if (!reader.readLittleEndian(status.provisionSerial)) {
+				return false;
+			}
+		}
+
+		status.version[0] = '\0';
+		if (status.has(CompactStatus::Version)) {
+			uint8_t length;
+			if (!reader.readByte(length)
+				|| length >= sizeof(status.version)
+				|| reader.offset + length > reader.size) {
+				return false;
+			}
+			std::copy(data + reader.offset, data + reader.offset + length, status.version);
+			status.version[length] = '\0';
+			reader.offset += length;
+		}
+
+		return reader.offset == size;
+	}
+
+	//----------
+	bool
+		decodeHotReply(const uint8_t* data, size_t size, HotReply& reply)
+	{
+		Reader reader{ data, size };
+
+		// [target, source, body] or [target, source, body, seq, crc16]
+		uint8_t elementCount;
+		if (!reader.readFixArraySize(elementCount)
+			|| (elementCount != 3 && elementCount != 5)) {
+			return false;
+		}
+
+		int64_t target, source;
+		if (!reader.readInt(target) || !reader.readInt(source)) {
+			return false;
+		}
+		reply.target = (int)target;
+		reply.source = (int)source;
+
+		uint8_t bodyHeader;
+		if (!reader.readByte(bodyHeader)) {
+			return false;
+		}
+
+		if (bodyHeader == 0xC2 || bodyHeader == 0xC3) {
+			// ACK
+			reply.type = HotReply::Type::ACK;
+			reply.success = bodyHeader == 0xC3;
+		}
+		else if (bodyHeader == 0x81) {
+			// {"p" : [...]} or {"s" : bin}
+			uint8_t keyHeader, key;
+			if (!reader.readByte(keyHeader) || keyHeader != 0xA1
+				|| !reader.readByte(key)) {
+				return false;
+			}
+
+			if (key == 'p') {
+				uint8_t positionCount;
+				if (!reader.readFixArraySize(positionCount) || positionCount > 4) {
+					return false;
+				}
+
+				for (uint8_t i = 0; i < positionCount; i++) {
+					int64_t position;
+					if (!reader.readInt(position)) {
+						return false;
+					}
+					reply.positions[i] = (int32_t)position;
+				}
+
+				reply.type = HotReply::Type::Positions;
+				reply.positionCount = positionCount;
+			}
+			else if (key == 's') {
+				uint8_t binHeader, binSize;
+				if (!reader.readByte(binHeader) || binHeader != 0xC4
+					|| !reader.readByte(binSize)
+					|| reader.offset + binSize > reader.size
+					|| !decodeCompactStatus(data + reader.offset, binSize, reply.compactStatus)) {
+					return false;
+				}
+				reader.offset += binSize;
+				reply.type = HotReply::Type::CompactStatus;
+			}
+			else {
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+
+		// Trailer (CRC has already been checked by the serial thread)
+		reply.seq = -1;
+		if (elementCount == 5) {
+			int64_t seq, crc;
+			if (!reader.readInt(seq) || !reader.readInt(crc)) {
+				return false;
+			}
+			reply.seq = (int)seq;
+		}
+
+		// Anything left over means this isn't the shape we thought it was
+		return reader.offset == size;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Modules {
+	/// <summary>
+	/// PortalFW's compact status report (App::packCompactStatus), sent as {"s" : bin} in reply to {"s" : ...}.
+	/// A report sent with the changedOnly flag only carries the field groups which changed since the previous
+	/// compact report from that board, so the fields bitmask says which members below are valid.
+	/// </summary>
+	struct CompactStatus {
+		enum Field : uint8_t {
+			Positions = 1 << 0,
+			Health = 1 << 1,
+			MotionProfiles = 1 << 2,
+			Optical = 1 << 3,
+			FastHomeFailure = 1 << 4,
+			Settings = 1 << 5,
+			ProvisionSerial = 1 << 6,
+			Version = 1 << 7
+		};
+
+		struct Axis {
+			int32_t position;
+			int32_t targetPosition;
+
+			bool measureCycleOK;
+			bool switchesOK;
+			bool backlashOK;
+			bool homeOK;
+
+			int32_t maximumSpeed;
+			int32_t acceleration;
+			int32_t minimumSpeed;
+
+			int16_t opticalThreshold;
+			int32_t opticalWidth;
+			uint8_t fastHomeFailure;
+		};
+
+		uint8_t formatVersion;
+		bool changedOnly;
+		bool logMessagesWaiting; // only a full status report (poll) carries them
+		uint8_t fields;
+
+		uint32_t upTime;
+		Axis axes[2];
+
+		uint16_t operatingCurrentMa;
+		bool fullCurrentHomeRecovery;
+		uint8_t settingsSource;
+		uint16_t opticalCalibrationVersion;
+		uint32_t provisionSerial;
+
+		char version[128]; // null terminated
+
+		bool has(Field field) const {
+			return (this->fields & field) != 0;
+		}
+	};
+
+	bool decodeCompactStatus(const uint8_t* data, size_t size, CompactStatus&);
+
+	/// <summary>
+	/// Fast path for the fixed-shape replies which PortalFW sends most often:
+	///   RS485::sendPositions  [0, id, {"p" : [a, b, targetA, targetB]}, seq, crc]
+	///   RS485::sendACK        [0, id, success, seq, crc]
+	///   RS485::sendCompactStatusReport [0, id, {"s" : bin}, seq, crc]
+	/// These are decoded straight from the msgpack bytes into a POD without building
+	/// a json tree. Anything else (or any deviation from these shapes) returns false
+	/// and should go through nlohmann::json as usual.
+	/// </summary>
+	struct HotReply {
+		enum class Type : uint8_t {
+			Positions,
+			ACK,
+			CompactStatus
+		};
+
+		Type type;
+		int target;
+		int source;
+		int seq; // -1 if the frame has no trailer
+
+		// ACK
+		bool success;
+
+		// Positions (currentA, currentB, targetA, targetB)
+		int32_t positions[4];
+		uint8_t positionCount;
+
+		// CompactStatus
+		Modules::CompactStatus compactStatus;
+	};
+
+	bool decodeHotReply(const uint8_t* data, size_t size, HotReply&);
+}
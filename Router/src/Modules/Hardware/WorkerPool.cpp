@@ -0,0 +1,136 @@
+#include "pch_App.h"
+#include "WorkerPool.h"
+
+namespace Modules {
+	//----------
+	WorkerPool::WorkerPool()
+	{
+
+	}
+
+	//----------
+	WorkerPool::~WorkerPool()
+	{
+		this->stopThreads();
+	}
+
+	//----------
+	void
+		WorkerPool::setThreadCount(size_t threadCount)
+	{
+		if (threadCount == this->threads.size()) {
+			return;
+		}
+
+		this->stopThreads();
+
+		// Workers start from the current generation, so that a parallelFor issued before a worker gets going
+		// still counts as new work for it
+		this->joining = false;
+		const auto generation = this->generation;
+		for (size_t i = 0; i < threadCount; i++) {
+			this->threads.emplace_back([this, generation]() {
+				this->workerFunction(generation);
+				});
+		}
+	}
+
+	//----------
+	size_t
+		WorkerPool::getThreadCount() const
+	{
+		return this->threads.size();
+	}
+
+	//----------
+	void
+		WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+	{
+		// Nothing to share
+		if (this->threads.empty() || count <= 1) {
+			for (size_t i = 0; i < count; i++) {
+				task(i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->task = &task;
+			this->taskCount = count;
+			this->nextTask = 0;
+			this->busyWorkers = this->threads.size();
+			this->generation++;
+		}
+		this->workAvailable.notify_all();
+
+		this->runTasks();
+
+		// Every worker has to check in (even one which found nothing left to do), so none of them can still be
+		// looking at this task when the next parallelFor starts
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->workDone.wait(lock, [this]() {
+				return this->busyWorkers == 0;
+				});
+			this->task = nullptr;
+		}
+	}
+
+	//----------
+	void
+		WorkerPool::workerFunction(uint64_t lastGeneration)
+	{
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->workAvailable.wait(lock, [this, lastGeneration]() {
+					return this->joining || this->generation != lastGeneration;
+					});
+				if (this->joining) {
+					return;
+				}
+				lastGeneration = this->generation;
+			}
+
+			this->runTasks();
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->busyWorkers--;
+				if (this->busyWorkers == 0) {
+					this->workDone.notify_one();
+				}
+			}
+		}
+	}
+
+	//----------
+	void
+		WorkerPool::runTasks()
+	{
+		const auto& task = *this->task;
+		const auto taskCount = this->taskCount;
+
+		size_t index;
+		while ((index = this->nextTask.fetch_add(1)) < taskCount) {
+			task(index);
+		}
+	}
+
+	//----------
+	void
+		WorkerPool::stopThreads()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->joining = true;
+		}
+		this->workAvailable.notify_all();
+
+		for (auto& thread : this->threads) {
+			thread.join();
+		}
+		this->threads.clear();
+	}
+}
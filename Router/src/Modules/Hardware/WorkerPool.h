@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Modules {
+	/// <summary>
+	/// A fixed set of worker threads for running independent tasks (e.g. one per Column) in parallel. Tasks are
+	/// handed out one index at a time, so a slow column doesn't hold up the others' workers. parallelFor is the
+	/// barrier : it returns once every task has finished, so the caller (the main thread) then sees everything
+	/// the tasks wrote.
+	/// </summary>
+	class WorkerPool {
+	public:
+		WorkerPool();
+		~WorkerPool();
+
+		// Main thread only, and not from inside a task. 0 runs every task on the calling thread
+		void setThreadCount(size_t);
+		size_t getThreadCount() const;
+
+		// Calls task(i) for every i in [0, count), on the workers and on the calling thread. Not reentrant
+		void parallelFor(size_t count, const std::function<void(size_t)>& task);
+	protected:
+		void workerFunction(uint64_t lastGeneration);
+		void runTasks();
+		void stopThreads();
+
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable workDone;
+
+		// The current parallelFor (set under the mutex before the workers are woken)
+		const std::function<void(size_t)>* task = nullptr;
+		size_t taskCount = 0;
+		std::atomic<size_t> nextTask{ 0 };
+
+		uint64_t generation = 0;
+		size_t busyWorkers = 0;
+		bool joining = false;
+	};
+}
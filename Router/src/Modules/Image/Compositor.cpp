@@ -0,0 +1,300 @@
+#include "pch_App.h"
+#include "Compositor.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define COMPOSITOR_SSE2
+#endif
+
+namespace Modules {
+	namespace Image {
+		namespace {
+			//----------
+			// Same as ofFloatColor::getHsb, but we only need hue and brightness
+			inline void
+				getHueBrightness(const glm::vec3& color, float& hue, float& brightness)
+			{
+				const auto max = std::max(std::max(color.x, color.y), color.z);
+				const auto min = std::min(std::min(color.x, color.y), color.z);
+				brightness = max;
+
+				if (max == 0 || max == min) {
+					hue = 0.0f;
+					return;
+				}
+
+				float hueSixth;
+				if (color.x == max) {
+					hueSixth = (color.y - color.z) / (max - min);
+					if (hueSixth < 0.0f) {
+						hueSixth += 6.0f;
+					}
+				}
+				else if (color.y == max) {
+					hueSixth = 2.0f + (color.z - color.x) / (max - min);
+				}
+				else {
+					hueSixth = 4.0f + (color.x - color.y) / (max - min);
+				}
+				hue = hueSixth / 6.0f;
+			}
+
+#ifdef COMPOSITOR_SSE2
+			//----------
+			inline __m128
+				select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+			{
+				return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+			}
+
+			//----------
+			// Taylor series, error < 3e-8 for x in [0, 1]
+			inline void
+				sinCos01(__m128 x, __m128& sinX, __m128& cosX)
+			{
+				const auto x2 = _mm_mul_ps(x, x);
+
+				auto s = _mm_set1_ps(1.0f / 362880.0f);
+				s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.0f / 5040.0f));
+				s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f / 120.0f));
+				s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.0f / 6.0f));
+				s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+				sinX = _mm_mul_ps(s, x);
+
+				auto c = _mm_set1_ps(-1.0f / 3628800.0f);
+				c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f / 40320.0f));
+				c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.0f / 720.0f));
+				c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f / 24.0f));
+				c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.0f / 2.0f));
+				cosX = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+			}
+#endif
+		}
+
+		//----------
+		void
+			Compositor::add(Sources::Style style, const ofFloatPixels& source, ofFloatPixels& result, float alpha)
+		{
+			switch (style.get()) {
+			case Sources::Style::Direct:
+				Compositor::addDirect(source.getData(), result.getData(), result.size(), alpha);
+				break;
+			case Sources::Style::HV_ThetaR:
+				Compositor::addHV_ThetaR((const glm::vec3*)source.getData()
+					, (glm::vec3*)result.getData()
+					, result.getWidth() * result.getHeight()
+					, alpha);
+				break;
+			case Sources::Style::Centered:
+				this->addCentered((const glm::vec3*)source.getData()
+					, (glm::vec3*)result.getData()
+					, result.getWidth()
+					, result.getHeight()
+					, alpha);
+				break;
+			default:
+				break;
+			}
+		}
+
+		//----------
+		void
+			Compositor::addReference(Sources::Style style, const ofFloatPixels& source, ofFloatPixels& result, float alpha)
+		{
+			// The loops as they were in Renderer::render, untouched (so alpha only applies to Direct, and Centered
+			// still reads input[i] with its centre offset wrapping around in size_t)
+			auto sourcePixels = source.getData();
+			auto resultPixels = result.getData();
+
+			auto width = result.getWidth();
+			auto height = result.getHeight();
+
+			switch (style.get()) {
+			case Sources::Style::Direct:
+			{
+				// Simply add the pixel values
+				for (int i = 0; i < result.size(); i++) {
+					resultPixels[i] += sourcePixels[i] * alpha;
+				}
+				break;
+			}
+			case Sources::Style::HV_ThetaR:
+			{
+				// Interpret HV as theta-R
+				auto pixelCount = result.getWidth() * result.getHeight();
+				auto input = (glm::vec3*)source.getData();
+				auto output = (glm::vec3*)resultPixels;
+
+				for (size_t i = 0; i < pixelCount; i++) {
+					const auto& in = input[i];
+					ofFloatColor color(in.x, in.y, in.z);
+					float hue, saturation, brightness;
+					color.getHsb(hue, saturation, brightness);
+					auto& out = output[i];
+					auto r = brightness;
+					auto theta = hue;
+					out.x += cos(theta) * r;
+					out.y += sin(theta) * r;
+				}
+
+				break;
+			}
+			case Sources::Style::Centered:
+			{
+				// Interpret V as R and theta is always away from center
+
+				auto pixelCount = result.getWidth() * result.getHeight();
+				auto input = (glm::vec3*)source.getData();
+				auto output = (glm::vec3*)resultPixels;
+
+				auto halfWidth = width / 2;
+				auto halfHeight = height / 2;
+
+				for (size_t j = 0; j < height; j++) {
+					for (size_t i = 0; i < width; i++) {
+
+						glm::vec2 x{ i - halfWidth, j - halfHeight };
+						auto theta = atan2(x.y, x.x);
+
+						const auto& in = input[i];
+						ofFloatColor color(in.x, in.y, in.z);
+						float hue, saturation, brightness;
+						color.getHsb(hue, saturation, brightness);
+
+						auto& out = output[i + j * width];
+
+						auto r = glm::length(x) / max(halfWidth, halfHeight);
+						r *= brightness;
+
+						out.x += cos(theta) * r;
+						out.y += sin(theta) * r;
+					}
+				}
+			}
+			}
+		}
+
+		//----------
+		void
+			Compositor::addDirect(const float* source, float* result, size_t count, float alpha)
+		{
+			size_t i = 0;
+#ifdef COMPOSITOR_SSE2
+			const auto alpha4 = _mm_set1_ps(alpha);
+			for (; i + 4 <= count; i += 4) {
+				const auto sum = _mm_add_ps(_mm_loadu_ps(result + i)
+					, _mm_mul_ps(_mm_loadu_ps(source + i), alpha4));
+				_mm_storeu_ps(result + i, sum);
+			}
+#endif
+			for (; i < count; i++) {
+				result[i] += source[i] * alpha;
+			}
+		}
+
+		//----------
+		void
+			Compositor::addHV_ThetaR(const glm::vec3* source, glm::vec3* result, size_t pixelCount, float alpha)
+		{
+			size_t i = 0;
+#ifdef COMPOSITOR_SSE2
+			const auto zero = _mm_setzero_ps();
+			const auto alpha4 = _mm_set1_ps(alpha);
+
+			for (; i + 4 <= pixelCount; i += 4) {
+				const auto in = source + i;
+				const auto r = _mm_setr_ps(in[0].x, in[1].x, in[2].x, in[3].x);
+				const auto g = _mm_setr_ps(in[0].y, in[1].y, in[2].y, in[3].y);
+				const auto b = _mm_setr_ps(in[0].z, in[1].z, in[2].z, in[3].z);
+
+				// HSB (as getHueBrightness)
+				const auto max = _mm_max_ps(_mm_max_ps(r, g), b);
+				const auto min = _mm_min_ps(_mm_min_ps(r, g), b);
+				const auto delta = _mm_sub_ps(max, min);
+
+				auto hueR = _mm_div_ps(_mm_sub_ps(g, b), delta);
+				hueR = _mm_add_ps(hueR, _mm_and_ps(_mm_cmplt_ps(hueR, zero), _mm_set1_ps(6.0f)));
+				const auto hueG = _mm_add_ps(_mm_set1_ps(2.0f), _mm_div_ps(_mm_sub_ps(b, r), delta));
+				const auto hueB = _mm_add_ps(_mm_set1_ps(4.0f), _mm_div_ps(_mm_sub_ps(r, g), delta));
+
+				const auto isR = _mm_cmpeq_ps(r, max);
+				const auto isG = _mm_cmpeq_ps(g, max);
+				auto hue = select(isR, hueR, select(isG, hueG, hueB));
+				hue = _mm_div_ps(hue, _mm_set1_ps(6.0f));
+
+				// Grey (including black) has no hue
+				const auto isGrey = _mm_or_ps(_mm_cmpeq_ps(max, zero), _mm_cmpeq_ps(delta, zero));
+				hue = _mm_andnot_ps(isGrey, hue);
+
+				// theta = hue, r = brightness
+				__m128 sinTheta, cosTheta;
+				sinCos01(hue, sinTheta, cosTheta);
+				const auto radius = _mm_mul_ps(max, alpha4);
+
+				alignas(16) float x[4], y[4];
+				_mm_store_ps(x, _mm_mul_ps(cosTheta, radius));
+				_mm_store_ps(y, _mm_mul_ps(sinTheta, radius));
+
+				auto out = result + i;
+				for (int k = 0; k < 4; k++) {
+					out[k].x += x[k];
+					out[k].y += y[k];
+				}
+			}
+#endif
+			for (; i < pixelCount; i++) {
+				float hue, brightness;
+				getHueBrightness(source[i], hue, brightness);
+				auto r = brightness * alpha;
+				result[i].x += cos(hue) * r;
+				result[i].y += sin(hue) * r;
+			}
+		}
+
+		//----------
+		void
+			Compositor::addCentered(const glm::vec3* source, glm::vec3* result, size_t width, size_t height, float alpha)
+		{
+			if (this->centeredLUT.width != width || this->centeredLUT.height != height) {
+				this->rebuildCenteredLUT(width, height);
+			}
+
+			const auto directions = this->centeredLUT.directions.data();
+			const auto pixelCount = width * height;
+
+			// Only brightness is used here, and that's just max(r, g, b) (this loop auto-vectorises)
+			for (size_t i = 0; i < pixelCount; i++) {
+				const auto& in = source[i];
+				const auto r = std::max(std::max(in.x, in.y), in.z) * alpha;
+				result[i].x += directions[i].x * r;
+				result[i].y += directions[i].y * r;
+			}
+		}
+
+		//----------
+		void
+			Compositor::rebuildCenteredLUT(size_t width, size_t height)
+		{
+			this->centeredLUT.width = width;
+			this->centeredLUT.height = height;
+			this->centeredLUT.directions.resize(width * height);
+
+			auto halfWidth = (int)width / 2;
+			auto halfHeight = (int)height / 2;
+			auto maxHalf = (float)max(max(halfWidth, halfHeight), 1);
+
+			for (size_t j = 0; j < height; j++) {
+				for (size_t i = 0; i < width; i++) {
+					glm::vec2 x{ (int)i - halfWidth, (int)j - halfHeight };
+					auto theta = atan2(x.y, x.x);
+					auto r = glm::length(x) / maxHalf;
+
+					this->centeredLUT.directions[i + j * width] = {
+						cos(theta) * r
+						, sin(theta) * r
+					};
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Sources/Base.h"
+
+namespace Modules {
+	namespace Image {
+		/// <summary>
+		/// Accumulates source images into the Renderer's result (alpha is applied in the same pass).
+		///
+		/// Direct and HV_ThetaR are processed 4 pixels at a time with SSE2. HV_ThetaR only needs
+		/// hue and brightness from HSB, and the hue of an ofFloatColor is always in [0, 1), so
+		/// cos / sin are evaluated with short polynomials instead of per pixel libm calls.
+		/// Centered only needs brightness (max of r, g, b); its direction * radius per pixel
+		/// is cached in a LUT which is rebuilt when the resolution changes.
+		///
+		/// The addReference function keeps the original per pixel implementation, untouched, for benchmarking. It
+		/// only applies alpha for Direct, and its Centered has the original's bugs (see Renderer::benchmarkCompositor).
+		/// </summary>
+		class Compositor {
+		public:
+			void add(Sources::Style, const ofFloatPixels& source, ofFloatPixels& result, float alpha);
+			static void addReference(Sources::Style, const ofFloatPixels& source, ofFloatPixels& result, float alpha);
+
+			static void addDirect(const float* source, float* result, size_t count, float alpha);
+			static void addHV_ThetaR(const glm::vec3* source, glm::vec3* result, size_t pixelCount, float alpha);
+			void addCentered(const glm::vec3* source, glm::vec3* result, size_t width, size_t height, float alpha);
+		protected:
+			void rebuildCenteredLUT(size_t width, size_t height);
+
+			struct {
+				size_t width = 0;
+				size_t height = 0;
+				vector<glm::vec2> directions; // (cos(theta), sin(theta)) * normalised radius
+			} centeredLUT;
+		};
+	}
+}
@@ -75,76 +75,10 @@ namespace Modules {
 						continue;
 					}
 
-					auto sourcePixels = source->pixels.getData();
-					auto resultPixels = this->pixels.getData();
-					const auto& alpha = baseParameters.alpha.get();
-
-					auto width = this->pixels.getWidth();
-					auto height = this->pixels.getHeight();
-
-					switch (baseParameters.style.get()) {
-					case Sources::Style::Direct:
-					{
-						// Simply add the pixel values
-						for (int i = 0; i < this->pixels.size(); i++) {
-							resultPixels[i] += sourcePixels[i] * alpha;
-						}
-						break;
-					}
-					case Sources::Style::HV_ThetaR:
-					{
-						// Interpret HV as theta-R
-						auto pixelCount = this->pixels.getWidth() * this->pixels.getHeight();
-						auto input = (glm::vec3*)source->pixels.getData();
-						auto output = (glm::vec3*)resultPixels;
-
-						for (size_t i = 0; i < pixelCount; i++) {
-							const auto& in = input[i];
-							ofFloatColor color(in.x, in.y, in.z);
-							float hue, saturation, brightness;
-							color.getHsb(hue, saturation, brightness);
-							auto& out = output[i];
-							auto r = brightness;
-							auto theta = hue;
-							out.x += cos(theta) * r;
-							out.y += sin(theta) * r;
-						}
-
-						break;
-					}
-					case Sources::Style::Centered:
-					{
-						// Interpret V as R and theta is always away from center
-
-						auto pixelCount = this->pixels.getWidth() * this->pixels.getHeight();
-						auto input = (glm::vec3*)source->pixels.getData();
-						auto output = (glm::vec3*)resultPixels;
-
-						auto halfWidth = width / 2;
-						auto halfHeight = height / 2;
-
-						for (size_t j = 0; j < height; j++) {
-							for (size_t i = 0; i < width; i++) {
-
-								glm::vec2 x{ i - halfWidth, j - halfHeight };
-								auto theta = atan2(x.y, x.x);
-
-								const auto& in = input[i];
-								ofFloatColor color(in.x, in.y, in.z);
-								float hue, saturation, brightness;
-								color.getHsb(hue, saturation, brightness);
-
-								auto& out = output[i + j * width];
-
-								auto r = glm::length(x) / max(halfWidth, halfHeight);
-								r *= brightness;
-
-								out.x += cos(theta) * r;
-								out.y += sin(theta) * r;
-							}
-						}
-					}
-					}
+					this->compositor.add(baseParameters.style.get()
+						, source->pixels
+						, this->pixels
+						, baseParameters.alpha.get());
 				}
 			}
 
@@ -163,6 +97,81 @@ namespace Modules {
 			Renderer::populateInspector(ofxCvGui::InspectArguments& args)
 		{
 			auto inspector = args.inspector;
+
+			inspector->addButton("Benchmark compositor", [this]() {
+				this->benchmarkCompositor();
+				});
+		}
+
+		//----------
+		void
+			Renderer::benchmarkCompositor()
+		{
+			const int iterations = 100;
+
+			for (auto source : this->sources) {
+				if (source->pixels.size() != this->pixels.size() || this->pixels.size() == 0) {
+					continue;
+				}
+
+				const auto& baseParameters = source->getBaseParameters();
+				const auto style = baseParameters.style.get();
+				const auto alpha = baseParameters.alpha.get();
+
+				auto referenceResult = this->pixels;
+				auto result = this->pixels;
+				referenceResult.set(0.0f);
+				result.set(0.0f);
+
+				auto startTime = chrono::high_resolution_clock::now();
+				for (int i = 0; i < iterations; i++) {
+					Compositor::addReference(style, source->pixels, referenceResult, alpha);
+				}
+				auto referenceDuration = chrono::high_resolution_clock::now() - startTime;
+
+				startTime = chrono::high_resolution_clock::now();
+				for (int i = 0; i < iterations; i++) {
+					this->compositor.add(style, source->pixels, result, alpha);
+				}
+				auto duration = chrono::high_resolution_clock::now() - startTime;
+
+				// Check against the original at alpha 1 (the original only applied alpha for Direct)
+				float maxDifference = 0.0f;
+				auto unitResult = this->pixels;
+				{
+					auto unitReferenceResult = this->pixels;
+					unitResult.set(0.0f);
+					unitReferenceResult.set(0.0f);
+					Compositor::addReference(style, source->pixels, unitReferenceResult, 1.0f);
+					this->compositor.add(style, source->pixels, unitResult, 1.0f);
+					for (size_t i = 0; i < unitResult.size(); i++) {
+						maxDifference = max(maxDifference, abs(unitResult[i] - unitReferenceResult[i]));
+					}
+				}
+
+				// Check the alpha separately : one pass at alpha should be alpha x one pass at 1
+				float maxAlphaDifference = 0.0f;
+				{
+					auto alphaResult = this->pixels;
+					alphaResult.set(0.0f);
+					this->compositor.add(style, source->pixels, alphaResult, alpha);
+					for (size_t i = 0; i < alphaResult.size(); i++) {
+						maxAlphaDifference = max(maxAlphaDifference, abs(alphaResult[i] - unitResult[i] * alpha));
+					}
+				}
+
+				auto toMicroseconds = [iterations](chrono::high_resolution_clock::duration duration) {
+					return (float)chrono::duration_cast<chrono::microseconds>(duration).count() / (float)iterations;
+				};
+
+				ofLogNotice("Renderer") << source->getName() << " (" << style.toString() << ", "
+					<< this->pixels.getWidth() << "x" << this->pixels.getHeight() << ") : "
+					<< "reference " << toMicroseconds(referenceDuration) << "us, "
+					<< "compositor " << toMicroseconds(duration) << "us, "
+					<< "max difference " << maxDifference
+					<< (style.get() == Sources::Style::Centered ? " (the original read input[i] and wrapped the centre offset)" : "")
+					<< ", alpha " << alpha << " max difference " << maxAlphaDifference;
+			}
 		}
 
 		//----------
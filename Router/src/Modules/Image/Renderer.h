@@ -2,6 +2,7 @@
 
 #include "../TopLevelModule.h"
 #include "Sources/Base.h"
+#include "Compositor.h"
 
 namespace Modules {
 	namespace Image {
@@ -19,6 +20,9 @@ namespace Modules {
 			void populateInspector(ofxCvGui::InspectArguments&);
 			void deserialise(const nlohmann::json&);
 
+			// Time the compositor against the original per pixel implementation on the current sources
+			void benchmarkCompositor();
+
 			ofxCvGui::PanelPtr getMiniView() override;
 			ofxCvGui::PanelPtr getPanel() override;
 
@@ -29,6 +33,7 @@ namespace Modules {
 			vector<shared_ptr<Sources::Base>> sources;
 			ofFloatPixels pixels;
 			ofTexture preview;
+			Compositor compositor;
 
 			shared_ptr<ofxCvGui::Panels::Widgets> panel;
 			bool needsPanelRefresh = true;
@@ -54,9 +54,15 @@ namespace Modules {
 			if (this->oscReceiver) {
 				ofxOscMessage message;
 				while (this->oscReceiver->getNextMessage(&message)) {
-					::OSC::handleRoute(message);
+					try {
+						::OSC::handleRoute(message);
+					}
+					catch (const std::exception& e) {
+						ofLogError("OSC") << message.getAddress() << " : " << e.what();
+					}
 					this->isFrameNew.notify();
 				}
+				::OSC::applyPendingFrame();
 			}
 
 			this->isFrameNew.update();
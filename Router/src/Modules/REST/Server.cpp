@@ -243,6 +243,123 @@ namespace Modules {
 
 				return crow::response(200, "true");
 				});
+
+			// Positions for the whole installation in one request, laid out as the Renderer's pixels
+			// (row-major over getResolution(), one x,y pair per portal). The body is decoded here on the
+			// crow thread and handed to the main loop through the Installation's frame mailbox, where it
+			// replaces any frame that hasn't been applied yet.
+			//
+			// Content-Type: application/octet-stream : width * height * 2 little-endian float32
+			// otherwise JSON : [ [ [x, y], [x, y], ... ], ... ] (height rows of width pairs)
+			CROW_ROUTE(crow, "/frame").methods(crow::HTTPMethod::Post)([this](const crow::request& request) {
+				auto app = App::X();
+				auto installation = app->getInstallation();
+
+				// The resolution published with the last main loop snapshot
+				auto state = installation->getState();
+				if (!state) {
+					return crow::response(503, "Installation not ready");
+				}
+				const auto width = state->resolution.x;
+				const auto height = state->resolution.y;
+
+				auto frame = make_unique<Hardware::PositionFrame>();
+				frame->positions.allocate(width, height, 3);
+				frame->positions.set(0.0f);
+				auto positions = (glm::vec3*)frame->positions.getData();
+
+				if (request.get_header_value("Content-Type").find("octet-stream") != string::npos) {
+					const auto count = width * height * 2;
+					if (request.body.size() != count * sizeof(float)) {
+						return crow::response(400, "Expected " + ofToString(count) + " float32 values for " + ofToString(width) + "x" + ofToString(height));
+					}
+
+					auto values = (const float*)request.body.data();
+					for (size_t i = 0; i < width * height; i++) {
+						positions[i].x = values[i * 2 + 0];
+						positions[i].y = values[i * 2 + 1];
+					}
+				}
+				else {
+					auto json = nlohmann::json::parse(request.body, nullptr, false);
+					if (!json.is_array() || json.size() != height) {
+						return crow::response(400, "Expected " + ofToString(height) + " rows");
+					}
+
+					for (size_t j = 0; j < height; j++) {
+						const auto& row = json[j];
+						if (!row.is_array() || row.size() != width) {
+							return crow::response(400, "Expected " + ofToString(width) + " positions in row " + ofToString(j));
+						}
+						for (size_t i = 0; i < width; i++) {
+							const auto& position = row[i];
+							if (!position.is_array() || position.size() != 2
+								|| !position[0].is_number() || !position[1].is_number()) {
+								return crow::response(400, "Expected [x, y] at " + ofToString(i) + "," + ofToString(j));
+							}
+							positions[j * width + i].x = position[0].get<float>();
+							positions[j * width + i].y = position[1].get<float>();
+						}
+					}
+				}
+
+				for (size_t i = 0; i < width * height; i++) {
+					if (!isfinite(positions[i].x) || !isfinite(positions[i].y)) {
+						return crow::response(400, "Non-finite position at index " + ofToString(i));
+					}
+				}
+
+				frame->received = chrono::steady_clock::now();
+				installation->postFrame(move(frame));
+
+				return crow::response(200, "true");
+				});
+
+			// The snapshot the main loop publishes once per frame. This never touches the live Portals.
+			CROW_ROUTE(crow, "/state")([this]() {
+				auto app = App::X();
+				auto installation = app->getInstallation();
+
+				auto state = installation->getState();
+				if (!state) {
+					return crow::response(503, "Installation not ready");
+				}
+
+				crow::json::wvalue json;
+				json["frameIndex"] = state->frameIndex;
+				json["resolution"]["width"] = state->resolution.x;
+				json["resolution"]["height"] = state->resolution.y;
+
+				auto& portalsJson = json["portals"];
+				for (size_t i = 0; i < state->portals.size(); i++) {
+					const auto& portal = state->portals[i];
+					auto& portalJson = portalsJson[(unsigned)i];
+					portalJson["column"] = portal.column;
+					portalJson["id"] = (int)portal.target;
+					portalJson["position"][0] = portal.position.x;
+					portalJson["position"][1] = portal.position.y;
+					portalJson["livePosition"][0] = portal.livePosition.x;
+					portalJson["livePosition"][1] = portal.livePosition.y;
+					portalJson["inPosition"] = portal.inPosition;
+				}
+
+				return crow::response(200, json);
+				});
+
+			// Latency histograms and throughput of each bus, in the Prometheus text format
+			CROW_ROUTE(crow, "/metrics")([this]() {
+				auto app = App::X();
+				auto installation = app->getInstallation();
+
+				auto state = installation->getState();
+				if (!state) {
+					return crow::response(503, "Installation not ready");
+				}
+
+				crow::response response(200, BusMetrics::toPrometheus(state->busMetrics));
+				response.set_header("Content-Type", "text/plain; version=0.0.4");
+				return response;
+				});
 		}
 	}
 }
\ No newline at end of file
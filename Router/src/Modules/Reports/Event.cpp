@@ -0,0 +1,31 @@
+#include "pch_App.h"
+#include "Event.h"
+
+namespace Modules {
+	namespace Reports {
+		//----------
+		uint64_t
+			Event::now_ms()
+		{
+			return (uint64_t)chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+		}
+
+		//----------
+		void
+			Event::setAddress(const char* value, size_t length)
+		{
+			length = min(length, sizeof(this->address) - 1);
+			std::copy(value, value + length, this->address);
+			this->address[length] = '\0';
+		}
+
+		//----------
+		void
+			Event::setText(const char* value, size_t length)
+		{
+			length = min(length, sizeof(this->text) - 1);
+			std::copy(value, value + length, this->text);
+			this->text[length] = '\0';
+		}
+	}
+}
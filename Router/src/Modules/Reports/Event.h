@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace Modules {
+	namespace Reports {
+		/// <summary>
+		/// One thing which happened on a bus, as recorded by the serial thread (or the main thread) and written out
+		/// by SessionWriter as a line of the report schema (RouterRS/crates/router-report/src/events.rs).
+		/// This is a plain fixed-size record so that recording never allocates : strings are truncated into the
+		/// inline buffers.
+		/// </summary>
+		struct Event {
+			enum class Type : uint8_t {
+				PacketTx, // portal, address, bytes, flag = needs ACK, value = outbox depth
+				PacketRx, // portal = source, rxKind, bytes
+				ACK, // portal, latency_ms
+				ACKTimeout, // portal, address, value = waited [ms]
+				COBSError, // text = detail
+				CRCError, // portal = source, value = expected, value2 = got
+				MsgpackError, // text = detail, address = hex prefix
+				DeviceConnect, // flag = ok, address = transport, text = endpoint or error
+				DeviceDisconnect, // address = reason, text = error
+				PortalLog, // portal, level, text = message, value = firmware timestamp [ms] (0 if unknown)
+				PortalStatus, // portal, value = upTime [ms], healthKnown/health, text = version (empty if unknown)
+				Marker // text = label
+			};
+
+			enum class RxKind : uint8_t {
+				ACK,
+				Report,
+				Other
+			};
+
+			Type type;
+			uint8_t column = 0;
+			int16_t portal = -1;
+			uint64_t timestamp_ms = 0; // since epoch (UTC)
+
+			uint32_t bytes = 0;
+			float latency_ms = 0.0f;
+			int64_t value = 0;
+			int64_t value2 = 0;
+			bool flag = false;
+			RxKind rxKind = RxKind::Other;
+			uint8_t level = 0;
+
+			// Per axis (A in bits 0-3, B in 4-7) : measureCycleOK, switchesOK, backlashOK, homeOK
+			uint8_t health = 0;
+			uint8_t healthKnown = 0; // which of the health bits were reported
+
+			char address[48] = { 0 };
+			char text[128] = { 0 };
+
+			static uint64_t now_ms();
+
+			// Copy with truncation (always null terminated)
+			void setAddress(const char*, size_t length);
+			void setText(const char*, size_t length);
+		};
+	}
+}
@@ -0,0 +1,80 @@
+#include "pch_App.h"
+#include "EventRing.h"
+
+namespace Modules {
+	namespace Reports {
+		namespace {
+			//----------
+			size_t
+				nextPowerOfTwo(size_t value)
+			{
+				size_t result = 1;
+				while (result < value) {
+					result <<= 1;
+				}
+				return result;
+			}
+		}
+
+		//----------
+		EventRing::EventRing(int column, size_t capacity)
+			: column(column)
+			, events(nextPowerOfTwo(max(capacity, (size_t)2)))
+			, mask(nextPowerOfTwo(max(capacity, (size_t)2)) - 1)
+		{
+
+		}
+
+		//----------
+		int
+			EventRing::getColumn() const
+		{
+			return this->column;
+		}
+
+		//----------
+		bool
+			EventRing::push(Event& event)
+		{
+			auto writeIndex = this->writeIndex.load(std::memory_order_relaxed);
+			auto readIndex = this->readIndex.load(std::memory_order_acquire);
+			if (writeIndex - readIndex >= this->events.size()) {
+				this->droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			if (this->column >= 0) {
+				event.column = (uint8_t)this->column;
+			}
+			if (event.timestamp_ms == 0) {
+				event.timestamp_ms = Event::now_ms();
+			}
+
+			this->events[writeIndex & this->mask] = event;
+			this->writeIndex.store(writeIndex + 1, std::memory_order_release);
+			return true;
+		}
+
+		//----------
+		bool
+			EventRing::pop(Event& event)
+		{
+			auto readIndex = this->readIndex.load(std::memory_order_relaxed);
+			auto writeIndex = this->writeIndex.load(std::memory_order_acquire);
+			if (readIndex == writeIndex) {
+				return false;
+			}
+
+			event = this->events[readIndex & this->mask];
+			this->readIndex.store(readIndex + 1, std::memory_order_release);
+			return true;
+		}
+
+		//----------
+		size_t
+			EventRing::getDroppedCount() const
+		{
+			return this->droppedCount.load(std::memory_order_relaxed);
+		}
+	}
+}
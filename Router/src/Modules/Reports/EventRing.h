@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Event.h"
+
+namespace Modules {
+	namespace Reports {
+		/// <summary>
+		/// Single producer / single consumer ring of Events. Each column's serial thread pushes into its own ring
+		/// and SessionWriter's thread drains them all, so neither side takes a lock or allocates after
+		/// construction. If the writer falls behind, pushes fail and are counted as dropped.
+		/// </summary>
+		class EventRing {
+		public:
+			// column < 0 : events keep whichever column they were pushed with (e.g. the main thread's ring)
+			EventRing(int column, size_t capacity = 4096);
+
+			int getColumn() const;
+
+			// Producer side. Stamps the column (and the time if it's not set). Returns false if full
+			bool push(Event&);
+
+			// Consumer side
+			bool pop(Event&);
+
+			size_t getDroppedCount() const;
+		protected:
+			const int column;
+			vector<Event> events;
+			const size_t mask;
+			std::atomic<size_t> writeIndex{ 0 };
+			std::atomic<size_t> readIndex{ 0 };
+			std::atomic<size_t> droppedCount{ 0 };
+		};
+	}
+}
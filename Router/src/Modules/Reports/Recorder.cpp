@@ -0,0 +1,265 @@
+#include "pch_App.h"
+#include "Recorder.h"
+#include "../App.h"
+#include "../../Utils.h"
+
+namespace Modules {
+	namespace Reports {
+		//----------
+		Recorder::Recorder()
+		{
+
+		}
+
+		//----------
+		Recorder::~Recorder()
+		{
+			this->stop("clean");
+		}
+
+		//----------
+		string
+			Recorder::getTypeName() const
+		{
+			return "Reports::Recorder";
+		}
+
+		//----------
+		void
+			Recorder::init()
+		{
+			this->onPopulateInspector += [this](ofxCvGui::InspectArguments& args) {
+				this->populateInspector(args);
+				};
+		}
+
+		//----------
+		void
+			Recorder::deserialise(const nlohmann::json& json)
+		{
+			Utils::deserialize(json, this->parameters.enabled);
+			Utils::deserialize(json, this->parameters.directory);
+			Utils::deserialize(json, this->parameters.verbose);
+			Utils::deserialize(json, this->parameters.rotate_MB);
+			Utils::deserialize(json, this->parameters.statsInterval_s);
+		}
+
+		//----------
+		void
+			Recorder::update()
+		{
+			// Stop if disabled
+			if (this->sessionWriter.isRunning() && !this->parameters.enabled) {
+				this->stop("clean");
+			}
+
+			// Start if enabled (and don't retry a failed start every frame)
+			if (!this->sessionWriter.isRunning() && this->parameters.enabled) {
+				auto now = chrono::steady_clock::now();
+				if (!this->startFailed || now - this->lastStartAttempt > chrono::seconds(10)) {
+					this->lastStartAttempt = now;
+					this->start();
+				}
+			}
+
+			if (this->sessionWriter.isRunning()) {
+				this->sessionWriter.setVerbose(this->parameters.verbose.get());
+
+				// Columns can be rebuilt at any time (e.g. when the arrangement changes)
+				this->attachColumns();
+			}
+		}
+
+		//----------
+		void
+			Recorder::populateInspector(ofxCvGui::InspectArguments& args)
+		{
+			auto inspector = args.inspector;
+			inspector->addIndicatorBool("Recording", [this]() {
+				return this->isRecording();
+				});
+			inspector->addLiveValue<string>("File", [this]() {
+				return this->sessionWriter.getPath();
+				});
+			inspector->addLiveValue<uint64_t>("Lines written", [this]() {
+				return this->sessionWriter.getLinesWritten();
+				});
+			inspector->addLiveValue<string>("Size", [this]() {
+				return ofToString(this->sessionWriter.getBytesWritten() / 1024) + "kB";
+				});
+			inspector->addLiveValue<uint64_t>("Dropped events", [this]() {
+				return this->sessionWriter.getDroppedCount();
+				});
+
+			inspector->addButton("Add marker", [this]() {
+				auto label = ofSystemTextBoxDialog("Marker label");
+				if (!label.empty()) {
+					this->addMarker(label);
+				}
+				}, 'm');
+
+			inspector->addParameterGroup(this->parameters);
+		}
+
+		//----------
+		ofxCvGui::PanelPtr
+			Recorder::getMiniView()
+		{
+			auto view = ofxCvGui::Panels::makeWidgets();
+			{
+				auto stack = view->addHorizontalStack();
+				{
+					auto element = make_shared<ofxCvGui::Widgets::Indicator>("Recording", [this]() {
+						if (this->isRecording()) {
+							return this->sessionWriter.getDroppedCount() > 0
+								? ofxCvGui::Widgets::Indicator::Status::Warning
+								: ofxCvGui::Widgets::Indicator::Status::Good;
+						}
+						else {
+							return ofxCvGui::Widgets::Indicator::Status::Clear;
+						}
+						});
+					stack->add(element);
+				}
+				{
+					auto element = make_shared<ofxCvGui::Widgets::LiveValue<uint64_t>>("Lines", [this]() {
+						return this->sessionWriter.getLinesWritten();
+						});
+					stack->add(element);
+				}
+			}
+
+			{
+				view->addLiveValueHistory("Lines", [this]() {
+					return (float)this->sessionWriter.getLinesWritten();
+					});
+			}
+
+			return view;
+		}
+
+		//----------
+		int
+			Recorder::getMiniViewHeight() const
+		{
+			return 120;
+		}
+
+		//----------
+		bool
+			Recorder::isRecording() const
+		{
+			return this->sessionWriter.isRunning();
+		}
+
+		//----------
+		void
+			Recorder::record(Event& event)
+		{
+			if (this->mainThreadRing) {
+				this->mainThreadRing->push(event);
+			}
+		}
+
+		//----------
+		void
+			Recorder::addMarker(const string& label)
+		{
+			Event event;
+			event.type = Event::Type::Marker;
+			event.setText(label.c_str(), label.size());
+			this->record(event);
+		}
+
+		//----------
+		void
+			Recorder::start()
+		{
+			SessionWriter::Settings settings;
+			{
+				settings.directory = ofToDataPath(this->parameters.directory.get(), true);
+				settings.verbose = this->parameters.verbose.get();
+				settings.statsInterval = chrono::seconds(max(this->parameters.statsInterval_s.get(), 1));
+				settings.rotateBytes = (size_t)max(this->parameters.rotate_MB.get(), 0) * 1024 * 1024;
+
+				settings.appVersion = "Router (C++)";
+				{
+					auto host = getenv("COMPUTERNAME");
+					if (!host) {
+						host = getenv("HOSTNAME");
+					}
+					settings.host = host ? host : "";
+				}
+
+				nlohmann::json config;
+				config["columns"] = App::X()->getInstallation()->getAllColumns().size();
+				config["directory"] = this->parameters.directory.get();
+				config["rotate_mb"] = this->parameters.rotate_MB.get();
+				config["stats_interval_s"] = this->parameters.statsInterval_s.get();
+				settings.configJson = config.dump();
+			}
+
+			if (!this->sessionWriter.start(settings)) {
+				ofLogError("Reports::Recorder") << "Couldn't open a session file in " << settings.directory;
+				this->startFailed = true;
+				return;
+			}
+			this->startFailed = false;
+
+			this->mainThreadRing = make_shared<EventRing>(-1, 256);
+			this->sessionWriter.addRing(this->mainThreadRing);
+
+			this->attachColumns();
+		}
+
+		//----------
+		void
+			Recorder::stop(const string& reason)
+		{
+			for (const auto& weakRS485 : this->attachedRS485s) {
+				auto rs485 = weakRS485.lock();
+				if (rs485) {
+					rs485->setEventRings(nullptr, nullptr);
+				}
+			}
+			this->attachedRS485s.clear();
+			this->mainThreadRing.reset();
+
+			this->sessionWriter.stop(reason);
+		}
+
+		//----------
+		void
+			Recorder::attachColumns()
+		{
+			auto installation = App::X()->getInstallation();
+			if (!installation) {
+				return;
+			}
+
+			for (const auto& column : installation->getAllColumns()) {
+				auto rs485 = column->getRS485();
+				if (!rs485 || rs485->hasEventRings()) {
+					continue;
+				}
+
+				auto columnIndex = (int)column->getIndex();
+				auto serialThreadRing = make_shared<EventRing>(columnIndex);
+				auto mainThreadRing = make_shared<EventRing>(columnIndex, 1024);
+				this->sessionWriter.addRing(serialThreadRing);
+				this->sessionWriter.addRing(mainThreadRing);
+				rs485->setEventRings(serialThreadRing, mainThreadRing);
+
+				this->attachedRS485s.push_back(rs485);
+			}
+
+			// Forget RS485s which have gone (their rings stay with the writer until the session ends)
+			this->attachedRS485s.erase(std::remove_if(this->attachedRS485s.begin()
+				, this->attachedRS485s.end()
+				, [](const weak_ptr<RS485>& rs485) {
+					return rs485.expired();
+				})
+				, this->attachedRS485s.end());
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../TopLevelModule.h"
+#include "SessionWriter.h"
+
+namespace Modules {
+	class RS485;
+
+	namespace Reports {
+		/// <summary>
+		/// Records the session to NDJSON in the report schema which RouterReports reads, so that C++ driven sites
+		/// get the same dashboards as RouterRS ones. Each column's RS485 is given a pair of rings (one for its
+		/// serial thread, one for the main thread) and SessionWriter drains them on its own thread.
+		/// </summary>
+		class Recorder : public TopLevelModule
+		{
+		public:
+			Recorder();
+			~Recorder();
+
+			string getTypeName() const override;
+			void init() override;
+			void deserialise(const nlohmann::json&) override;
+			void update() override;
+			void populateInspector(ofxCvGui::InspectArguments& args);
+
+			ofxCvGui::PanelPtr getMiniView() override;
+			int getMiniViewHeight() const override;
+
+			bool isRecording() const;
+
+			// Main thread only (events which don't belong to a column, e.g. markers)
+			void record(Event&);
+			void addMarker(const string& label);
+		protected:
+			void start();
+			void stop(const string& reason);
+			void attachColumns();
+
+			struct : ofParameterGroup {
+				ofParameter<bool> enabled{ "Enabled", true };
+				ofParameter<string> directory{ "Directory", "reports" };
+				ofParameter<bool> verbose{ "Verbose", false };
+				ofParameter<int> rotate_MB{ "Rotate [MB]", 64 };
+				ofParameter<int> statsInterval_s{ "Stats interval [s]", 10 };
+				PARAM_DECLARE("Recorder", enabled, directory, verbose, rotate_MB, statsInterval_s);
+			} parameters;
+
+			SessionWriter sessionWriter;
+			shared_ptr<EventRing> mainThreadRing;
+			vector<weak_ptr<RS485>> attachedRS485s;
+
+			chrono::steady_clock::time_point lastStartAttempt;
+			bool startFailed = false;
+		};
+	}
+}
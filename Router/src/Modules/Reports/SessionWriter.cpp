@@ -0,0 +1,678 @@
+#include "pch_App.h"
+#include "SessionWriter.h"
+
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+
+namespace Modules {
+	namespace Reports {
+		namespace {
+			// As RouterRS (router-report/src/writer.rs), so that percentiles from either Router compare
+			const float latencyBucketEdges_ms[10] = { 1, 2, 5, 10, 20, 50, 100, 200, 300, std::numeric_limits<float>::infinity() };
+
+			const uint32_t schemaVersion = 1;
+
+			const char* rxKindNames[] = { "ack", "report", "other" };
+
+			//----------
+			void
+				appendNumber(std::string& line, const char* key, int64_t value)
+			{
+				line += ",\"";
+				line += key;
+				line += "\":";
+				line += std::to_string(value);
+			}
+
+			//----------
+			void
+				appendNumber(std::string& line, const char* key, float value)
+			{
+				char buffer[32];
+				snprintf(buffer, sizeof(buffer), "%.3f", std::isfinite(value) ? value : 0.0f);
+				line += ",\"";
+				line += key;
+				line += "\":";
+				line += buffer;
+			}
+
+			//----------
+			void
+				appendBool(std::string& line, const char* key, bool value)
+			{
+				line += ",\"";
+				line += key;
+				line += "\":";
+				line += value ? "true" : "false";
+			}
+
+			//----------
+			void
+				appendString(std::string& line, const char* key, const char* value)
+			{
+				line += ",\"";
+				line += key;
+				line += "\":";
+				SessionWriter::appendJSONString(line, value);
+			}
+
+			//----------
+			void
+				appendHealth(std::string& line, const char* key, uint8_t health, uint8_t healthKnown)
+			{
+				// AxisHealthFlags : each flag is null if it wasn't reported
+				const char* names[] = { "measure_cycle_ok", "switches_ok", "backlash_ok", "home_ok" };
+				line += ",\"";
+				line += key;
+				line += "\":{";
+				for (int i = 0; i < 4; i++) {
+					if (i > 0) {
+						line += ",";
+					}
+					line += "\"";
+					line += names[i];
+					line += "\":";
+					if (healthKnown & (1 << i)) {
+						line += (health & (1 << i)) ? "true" : "false";
+					}
+					else {
+						line += "null";
+					}
+				}
+				line += "}";
+			}
+		}
+
+		//----------
+		void
+			SessionWriter::LatencyHistogram::record(float ms)
+		{
+			size_t index = 9;
+			for (size_t i = 0; i < 10; i++) {
+				if (ms <= latencyBucketEdges_ms[i]) {
+					index = i;
+					break;
+				}
+			}
+			this->counts[index]++;
+			this->total++;
+			this->max_ms = max(this->max_ms, ms);
+		}
+
+		//----------
+		float
+			SessionWriter::LatencyHistogram::percentile(float p) const
+		{
+			if (this->total == 0) {
+				return 0.0f;
+			}
+
+			auto rank = (uint64_t)ceil(p * (float)this->total);
+			uint64_t seen = 0;
+			float lower = 0.0f;
+			for (size_t i = 0; i < 10; i++) {
+				auto upper = std::isinf(latencyBucketEdges_ms[i])
+					? max(this->max_ms, lower)
+					: latencyBucketEdges_ms[i];
+				auto count = this->counts[i];
+				if (seen + count >= rank) {
+					// Linear interpolation inside the bucket
+					auto into = count == 0
+						? 0.0f
+						: (float)(rank - seen) / (float)count;
+					return min(lower + (upper - lower) * into, this->max_ms);
+				}
+				seen += count;
+				lower = upper;
+			}
+			return this->max_ms;
+		}
+
+		//----------
+		SessionWriter::SessionWriter()
+		{
+
+		}
+
+		//----------
+		SessionWriter::~SessionWriter()
+		{
+			this->stop();
+		}
+
+		//----------
+		bool
+			SessionWriter::start(const Settings& settings)
+		{
+			this->stop();
+
+			this->settings = settings;
+			this->verbose = settings.verbose;
+
+			this->startTime_ms = Event::now_ms();
+			this->stamp = SessionWriter::makeStamp(this->startTime_ms);
+			this->part = 0;
+			this->seq = 0;
+			this->reportedDropped = 0;
+			this->columnStats.clear();
+			this->connectedColumns.clear();
+			this->portalStatuses.clear();
+			this->totals = Totals();
+			this->linesWritten = 0;
+			this->bytesWritten = 0;
+			this->droppedCount = 0;
+
+			std::error_code error;
+			std::filesystem::create_directories(settings.directory, error);
+
+			if (!this->openPart()) {
+				return false;
+			}
+
+			// session_start
+			{
+				this->beginLine("session_start", this->startTime_ms);
+				appendString(this->line, "app_version", settings.appVersion.c_str());
+				appendString(this->line, "host", settings.host.c_str());
+				this->line += ",\"config\":";
+				this->line += settings.configJson.empty() ? "{}" : settings.configJson;
+				appendBool(this->line, "verbose", settings.verbose);
+				this->endLine();
+				this->file.flush();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stopRequested = false;
+				this->stopReason.clear();
+			}
+
+			this->running = true;
+			this->thread = std::thread([this]() {
+				this->threadedFunction();
+				});
+
+			return true;
+		}
+
+		//----------
+		void
+			SessionWriter::stop(const std::string& reason)
+		{
+			if (!this->thread.joinable()) {
+				return;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->stopRequested = true;
+				this->stopReason = reason;
+			}
+			this->stopCondition.notify_all();
+			this->thread.join();
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->rings.clear();
+			}
+			this->ringsCopy.clear();
+		}
+
+		//----------
+		bool
+			SessionWriter::isRunning() const
+		{
+			return this->running;
+		}
+
+		//----------
+		void
+			SessionWriter::addRing(shared_ptr<EventRing> ring)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->rings.push_back(ring);
+		}
+
+		//----------
+		void
+			SessionWriter::setVerbose(bool verbose)
+		{
+			this->verbose = verbose;
+		}
+
+		//----------
+		std::string
+			SessionWriter::getPath() const
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			return this->path;
+		}
+
+		//----------
+		uint64_t
+			SessionWriter::getLinesWritten() const
+		{
+			return this->linesWritten;
+		}
+
+		//----------
+		uint64_t
+			SessionWriter::getBytesWritten() const
+		{
+			return this->bytesWritten;
+		}
+
+		//----------
+		uint64_t
+			SessionWriter::getDroppedCount() const
+		{
+			return this->droppedCount;
+		}
+
+		//----------
+		std::string
+			SessionWriter::makeStamp(uint64_t epoch_ms)
+		{
+			auto time = (std::time_t)(epoch_ms / 1000);
+			std::tm utc;
+#ifdef _WIN32
+			gmtime_s(&utc, &time);
+#else
+			gmtime_r(&time, &utc);
+#endif
+			char buffer[32];
+			std::strftime(buffer, sizeof(buffer), "%Y%m%dT%H%M%SZ", &utc);
+			return buffer;
+		}
+
+		//----------
+		void
+			SessionWriter::appendJSONString(std::string& line, const char* value)
+		{
+			line += '"';
+			for (auto c = value; *c; c++) {
+				switch (*c) {
+				case '"': line += "\\\""; break;
+				case '\\': line += "\\\\"; break;
+				case '\n': line += "\\n"; break;
+				case '\r': line += "\\r"; break;
+				case '\t': line += "\\t"; break;
+				default:
+					if ((uint8_t)*c < 0x20) {
+						char escaped[8];
+						snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)(uint8_t)*c);
+						line += escaped;
+					}
+					else {
+						line += *c;
+					}
+				}
+			}
+			line += '"';
+		}
+
+		//----------
+		void
+			SessionWriter::threadedFunction()
+		{
+			auto lastFlush = chrono::steady_clock::now();
+			auto lastStats = chrono::steady_clock::now();
+
+			while (true) {
+				bool stopRequested;
+				{
+					std::unique_lock<std::mutex> lock(this->mutex);
+					this->stopCondition.wait_for(lock, chrono::milliseconds(20), [this]() {
+						return this->stopRequested;
+						});
+					stopRequested = this->stopRequested;
+					this->ringsCopy = this->rings;
+				}
+
+				this->drain();
+				this->checkDropped();
+
+				auto now = chrono::steady_clock::now();
+				if (stopRequested || now - lastStats >= this->settings.statsInterval) {
+					this->writeStats(chrono::duration_cast<chrono::milliseconds>(now - lastStats));
+					lastStats = now;
+				}
+
+				if (stopRequested) {
+					break;
+				}
+
+				if (now - lastFlush >= this->settings.flushInterval) {
+					this->file.flush();
+					lastFlush = now;
+				}
+
+				if (this->settings.rotateBytes > 0 && this->partBytes >= this->settings.rotateBytes) {
+					this->file.close();
+					this->part++;
+					this->openPart();
+				}
+			}
+
+			// session_end
+			{
+				auto now_ms = Event::now_ms();
+				this->beginLine("session_end", now_ms);
+				{
+					std::lock_guard<std::mutex> lock(this->mutex);
+					appendString(this->line, "reason", this->stopReason.c_str());
+				}
+				appendNumber(this->line, "duration_ms", (int64_t)(now_ms - this->startTime_ms));
+				this->line += ",\"totals\":{\"tx\":" + std::to_string(this->totals.tx)
+					+ ",\"rx\":" + std::to_string(this->totals.rx)
+					+ ",\"acks\":" + std::to_string(this->totals.acks)
+					+ ",\"timeouts\":" + std::to_string(this->totals.timeouts)
+					+ ",\"cobs_errors\":" + std::to_string(this->totals.cobsErrors)
+					+ ",\"msgpack_errors\":" + std::to_string(this->totals.msgpackErrors)
+					+ ",\"portal_error_logs\":" + std::to_string(this->totals.portalErrorLogs)
+					+ ",\"reconnects\":" + std::to_string(this->totals.reconnects)
+					+ ",\"dropped_events\":" + std::to_string(this->totals.droppedEvents)
+					+ "}";
+				this->endLine();
+			}
+
+			this->file.flush();
+			this->file.close();
+			this->running = false;
+		}
+
+		//----------
+		void
+			SessionWriter::drain()
+		{
+			Event event;
+			for (const auto& ring : this->ringsCopy) {
+				while (ring->pop(event)) {
+					this->handle(event);
+				}
+			}
+		}
+
+		//----------
+		void
+			SessionWriter::handle(const Event& event)
+		{
+			auto& column = this->columnStats[event.column];
+			const bool verbose = this->verbose;
+
+			switch (event.type) {
+			case Event::Type::PacketTx:
+				column.tx++;
+				column.outboxPeak = max(column.outboxPeak, (uint32_t)event.value);
+				this->totals.tx++;
+				if (verbose) {
+					this->beginLine("packet_tx", event.timestamp_ms);
+					appendNumber(this->line, "col", (int64_t)event.column);
+					appendNumber(this->line, "portal", (int64_t)event.portal);
+					appendString(this->line, "addr", event.address);
+					appendNumber(this->line, "bytes", (int64_t)event.bytes);
+					appendBool(this->line, "needs_ack", event.flag);
+					this->endLine();
+				}
+				break;
+
+			case Event::Type::PacketRx:
+				column.rx++;
+				this->totals.rx++;
+				if (verbose) {
+					this->beginLine("packet_rx", event.timestamp_ms);
+					appendNumber(this->line, "col", (int64_t)event.column);
+					appendNumber(this->line, "source", (int64_t)event.portal);
+					appendString(this->line, "kind", rxKindNames[(int)event.rxKind]);
+					appendNumber(this->line, "bytes", (int64_t)event.bytes);
+					this->endLine();
+				}
+				break;
+
+			case Event::Type::ACK:
+				column.acks++;
+				column.latency.record(event.latency_ms);
+				this->totals.acks++;
+				if (verbose) {
+					// As RouterRS : the ACK match is its own packet_rx line carrying the latency
+					this->beginLine("packet_rx", event.timestamp_ms);
+					appendNumber(this->line, "col", (int64_t)event.column);
+					appendNumber(this->line, "source", (int64_t)event.portal);
+					appendString(this->line, "kind", "ack");
+					appendNumber(this->line, "bytes", (int64_t)0);
+					appendNumber(this->line, "latency_ms", event.latency_ms);
+					this->endLine();
+				}
+				break;
+
+			case Event::Type::ACKTimeout:
+				column.timeouts++;
+				this->totals.timeouts++;
+				this->beginLine("ack_timeout", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendNumber(this->line, "portal", (int64_t)event.portal);
+				appendString(this->line, "addr", event.address);
+				appendNumber(this->line, "waited_ms", event.value);
+				this->endLine();
+				break;
+
+			case Event::Type::COBSError:
+				column.cobsErrors++;
+				this->totals.cobsErrors++;
+				this->beginLine("cobs_error", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendString(this->line, "detail", event.text);
+				this->endLine();
+				break;
+
+			case Event::Type::CRCError:
+				this->beginLine("crc_error", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendNumber(this->line, "expected", event.value);
+				appendNumber(this->line, "got", event.value2);
+				this->endLine();
+				break;
+
+			case Event::Type::MsgpackError:
+				column.msgpackErrors++;
+				this->totals.msgpackErrors++;
+				this->beginLine("msgpack_error", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendString(this->line, "detail", event.text);
+				appendString(this->line, "hex_prefix", event.address);
+				this->endLine();
+				break;
+
+			case Event::Type::DeviceConnect:
+				if (event.flag) {
+					if (this->connectedColumns.count(event.column)) {
+						this->totals.reconnects++;
+					}
+					this->connectedColumns.insert(event.column);
+				}
+				this->beginLine("device_connect", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendString(this->line, "transport", event.address);
+				appendString(this->line, "endpoint", event.flag ? event.text : "");
+				appendBool(this->line, "ok", event.flag);
+				if (!event.flag) {
+					appendString(this->line, "error", event.text);
+				}
+				this->endLine();
+				break;
+
+			case Event::Type::DeviceDisconnect:
+				this->beginLine("device_disconnect", event.timestamp_ms);
+				appendNumber(this->line, "col", (int64_t)event.column);
+				appendString(this->line, "reason", event.address);
+				if (event.text[0] != '\0') {
+					appendString(this->line, "error", event.text);
+				}
+				this->endLine();
+				break;
+
+			case Event::Type::PortalLog:
+				// As RouterRS : warnings and errors always, status messages in verbose mode
+				if (event.level >= 20) {
+					this->totals.portalErrorLogs++;
+				}
+				if (event.level >= 10 || verbose) {
+					this->beginLine("portal_log", event.timestamp_ms);
+					appendNumber(this->line, "col", (int64_t)event.column);
+					appendNumber(this->line, "portal", (int64_t)event.portal);
+					appendNumber(this->line, "level", (int64_t)event.level);
+					appendString(this->line, "message", event.text);
+					if (event.value > 0) {
+						appendNumber(this->line, "fw_ts_ms", event.value);
+					}
+					appendNumber(this->line, "count", (int64_t)max(event.bytes, (uint32_t)1));
+					this->endLine();
+				}
+				break;
+
+			case Event::Type::PortalStatus:
+			{
+				auto& status = this->portalStatuses[{ event.column, event.portal }];
+				auto hasVersion = event.text[0] != '\0';
+				auto changed = (hasVersion && status.version != event.text)
+					|| (event.healthKnown & ~status.healthKnown) != 0
+					|| ((event.health ^ status.health) & event.healthKnown) != 0
+					|| (status.upTime >= 0 && event.value < status.upTime); // rebooted
+				auto due = event.timestamp_ms - status.lastWritten_ms >= (uint64_t)this->settings.portalStatusInterval.count();
+
+				status.upTime = event.value;
+				if (hasVersion) {
+					status.version = event.text;
+				}
+				status.health = (status.health & ~event.healthKnown) | (event.health & event.healthKnown);
+				status.healthKnown |= event.healthKnown;
+
+				if (changed || due) {
+					status.lastWritten_ms = event.timestamp_ms;
+					this->beginLine("portal_status", event.timestamp_ms);
+					appendNumber(this->line, "col", (int64_t)event.column);
+					appendNumber(this->line, "portal", (int64_t)event.portal);
+					appendNumber(this->line, "uptime_ms", event.value);
+					if (!status.version.empty()) {
+						appendString(this->line, "version", status.version.c_str());
+					}
+					if (status.healthKnown & 0x0F) {
+						appendHealth(this->line, "mca", status.health & 0x0F, status.healthKnown & 0x0F);
+					}
+					if (status.healthKnown & 0xF0) {
+						appendHealth(this->line, "mcb", status.health >> 4, status.healthKnown >> 4);
+					}
+					this->endLine();
+				}
+				break;
+			}
+
+			case Event::Type::Marker:
+				this->beginLine("marker", event.timestamp_ms);
+				appendString(this->line, "label", event.text);
+				this->endLine();
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		//----------
+		void
+			SessionWriter::writeStats(chrono::milliseconds window)
+		{
+			auto now_ms = Event::now_ms();
+			for (auto& it : this->columnStats) {
+				auto& column = it.second;
+				this->beginLine("bus_stats", now_ms);
+				appendNumber(this->line, "col", (int64_t)it.first);
+				appendNumber(this->line, "window_ms", (int64_t)window.count());
+				appendNumber(this->line, "tx", (int64_t)column.tx);
+				appendNumber(this->line, "rx", (int64_t)column.rx);
+				appendNumber(this->line, "acks", (int64_t)column.acks);
+				appendNumber(this->line, "timeouts", (int64_t)column.timeouts);
+				appendNumber(this->line, "cobs_errors", (int64_t)column.cobsErrors);
+				appendNumber(this->line, "msgpack_errors", (int64_t)column.msgpackErrors);
+				{
+					// appendNumber writes a leading comma, which the nested object doesn't want for its first key
+					std::string latency;
+					appendNumber(latency, "p50", column.latency.percentile(0.50f));
+					appendNumber(latency, "p90", column.latency.percentile(0.90f));
+					appendNumber(latency, "p99", column.latency.percentile(0.99f));
+					appendNumber(latency, "max", column.latency.max_ms);
+					this->line += ",\"latency_ms\":{" + latency.substr(1) + "}";
+				}
+				appendNumber(this->line, "outbox_peak", (int64_t)column.outboxPeak);
+				this->endLine();
+
+				column = ColumnStats();
+			}
+			this->file.flush();
+		}
+
+		//----------
+		void
+			SessionWriter::checkDropped()
+		{
+			uint64_t dropped = 0;
+			for (const auto& ring : this->ringsCopy) {
+				dropped += ring->getDroppedCount();
+			}
+
+			if (dropped > this->reportedDropped) {
+				auto count = dropped - this->reportedDropped;
+				this->reportedDropped = dropped;
+				this->totals.droppedEvents += count;
+				this->droppedCount = this->totals.droppedEvents;
+
+				this->beginLine("dropped_events", Event::now_ms());
+				appendNumber(this->line, "count", (int64_t)count);
+				this->endLine();
+			}
+		}
+
+		//----------
+		void
+			SessionWriter::beginLine(const char* type, uint64_t timestamp_ms)
+		{
+			this->seq++;
+			this->line.clear();
+			this->line += "{\"v\":" + std::to_string(schemaVersion)
+				+ ",\"ts\":" + std::to_string(timestamp_ms)
+				+ ",\"seq\":" + std::to_string(this->seq)
+				+ ",\"type\":\"" + type + "\"";
+		}
+
+		//----------
+		void
+			SessionWriter::endLine()
+		{
+			this->line += "}\n";
+			this->file.write(this->line.data(), this->line.size());
+			this->partBytes += this->line.size();
+			this->linesWritten++;
+			this->bytesWritten += this->line.size();
+		}
+
+		//----------
+		bool
+			SessionWriter::openPart()
+		{
+			char partName[16];
+			snprintf(partName, sizeof(partName), "%04u", (unsigned)this->part);
+			auto path = (std::filesystem::path(this->settings.directory)
+				/ ("session-" + this->stamp + "." + partName + ".ndjson")).string();
+
+			this->file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+			this->partBytes = 0;
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->path = this->file.is_open() ? path : std::string();
+			}
+			return this->file.is_open();
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "EventRing.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <set>
+#include <thread>
+
+namespace Modules {
+	namespace Reports {
+		/// <summary>
+		/// Owns the session's NDJSON file and the thread which writes it. Drains every registered EventRing, keeps
+		/// the per-column / per-portal aggregates, and writes the lines of the report schema which RouterReports
+		/// reads (see RouterRS/crates/router-report/src/events.rs) :
+		///  session_start / session_end, device_connect / device_disconnect, ack_timeout, cobs_error, crc_error,
+		///  msgpack_error, portal_log, portal_status, bus_stats, marker, dropped_events, and in verbose mode
+		///  packet_tx / packet_rx.
+		///
+		/// Files are named session-<UTC stamp>.<part>.ndjson. The part is zero padded so that RouterReports (which
+		/// sorts the file names of a session) reads the parts in order.
+		/// </summary>
+		class SessionWriter {
+		public:
+			struct Settings {
+				std::string directory = "reports";
+				bool verbose = false;
+				chrono::milliseconds flushInterval{ 1000 };
+				chrono::milliseconds statsInterval{ 10000 };
+				chrono::milliseconds portalStatusInterval{ 60000 }; // portal_status is written on change, or at most this often
+				size_t rotateBytes = 64 * 1024 * 1024;
+
+				// For session_start
+				std::string appVersion;
+				std::string host;
+				std::string configJson = "{}";
+			};
+
+			SessionWriter();
+			~SessionWriter();
+
+			// Opens the first file and starts the thread
+			bool start(const Settings&);
+
+			// Drains what's left, writes session_end and closes the file
+			void stop(const std::string& reason = "clean");
+
+			bool isRunning() const;
+
+			// Rings can be added whilst running. The writer keeps them until stop
+			void addRing(shared_ptr<EventRing>);
+
+			void setVerbose(bool);
+
+			std::string getPath() const;
+			uint64_t getLinesWritten() const;
+			uint64_t getBytesWritten() const;
+			uint64_t getDroppedCount() const;
+
+			// The stamp used in session file names (e.g. 20240131T235959Z)
+			static std::string makeStamp(uint64_t epoch_ms);
+
+			// Append value as a json string (with quotes)
+			static void appendJSONString(std::string&, const char* value);
+		protected:
+			struct LatencyHistogram {
+				uint64_t counts[10] = { 0 };
+				uint64_t total = 0;
+				float max_ms = 0.0f;
+
+				void record(float ms);
+				float percentile(float p) const;
+			};
+
+			struct ColumnStats {
+				uint64_t tx = 0;
+				uint64_t rx = 0;
+				uint64_t acks = 0;
+				uint64_t timeouts = 0;
+				uint64_t cobsErrors = 0;
+				uint64_t msgpackErrors = 0;
+				LatencyHistogram latency;
+				uint32_t outboxPeak = 0;
+			};
+
+			struct Totals {
+				uint64_t tx = 0;
+				uint64_t rx = 0;
+				uint64_t acks = 0;
+				uint64_t timeouts = 0;
+				uint64_t cobsErrors = 0;
+				uint64_t msgpackErrors = 0;
+				uint64_t portalErrorLogs = 0;
+				uint64_t reconnects = 0;
+				uint64_t droppedEvents = 0;
+			};
+
+			struct PortalStatus {
+				int64_t upTime = -1;
+				std::string version;
+				uint8_t health = 0;
+				uint8_t healthKnown = 0;
+				uint64_t lastWritten_ms = 0;
+			};
+
+			void threadedFunction();
+			void drain();
+			void handle(const Event&);
+			void writeStats(chrono::milliseconds window);
+			void checkDropped();
+
+			// Begin a line with its envelope and type, then finish it once the payload has been appended
+			void beginLine(const char* type, uint64_t timestamp_ms);
+			void endLine();
+
+			bool openPart();
+
+			Settings settings;
+			std::atomic<bool> verbose{ false };
+
+			std::thread thread;
+			std::atomic<bool> running{ false };
+			bool stopRequested = false;
+			std::string stopReason;
+			mutable std::mutex mutex; // stop request, rings, path
+			std::condition_variable stopCondition;
+
+			vector<shared_ptr<EventRing>> rings;
+			vector<shared_ptr<EventRing>> ringsCopy; // only used on the thread
+
+			// Only used on the thread
+			std::ofstream file;
+			std::string stamp;
+			std::string path;
+			size_t part = 0;
+			size_t partBytes = 0;
+			std::string line;
+			uint64_t seq = 0;
+			uint64_t startTime_ms = 0;
+			uint64_t reportedDropped = 0;
+			map<uint8_t, ColumnStats> columnStats; // since the last bus_stats
+			set<uint8_t> connectedColumns;
+			map<pair<uint8_t, int16_t>, PortalStatus> portalStatuses;
+			Totals totals;
+
+			std::atomic<uint64_t> linesWritten{ 0 };
+			std::atomic<uint64_t> bytesWritten{ 0 };
+			std::atomic<uint64_t> droppedCount{ 0 };
+		};
+	}
+}
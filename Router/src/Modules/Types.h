@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Modules {
+	typedef int32_t Steps;
+	typedef int32_t StepsPerSecond;
+	typedef int32_t StepsPerSecondPerSecond;
+}
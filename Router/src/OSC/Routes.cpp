@@ -6,7 +6,11 @@ using namespace Modules;
 
 namespace OSC {
 	//----------
-	vector<Route> routes;
+	unordered_map<string, Route> routes;
+	unordered_map<string, ColumnRoute> columnRoutes;
+
+	// Written by the frame routes, applied in applyPendingFrame
+	map<size_t, vector<glm::vec2>> pendingFrame;
 
 	//----------
 	void performOnAllPortals(App * app, std::function<void(shared_ptr<Portal>)> action)
@@ -21,10 +25,35 @@ namespace OSC {
 		}
 	}
 
+	//----------
+	// A blob of packed little-endian float32 (x, y) pairs
+	vector<glm::vec2> getPositionsFromBlob(const ofxOscMessage& message, size_t argIndex)
+	{
+		if (message.getNumArgs() <= argIndex || message.getArgType(argIndex) != ofxOscArgType::OFXOSC_TYPE_BLOB) {
+			throw(Exception("Please send a blob of float32 (x, y) pairs"));
+		}
+
+		auto blob = message.getArgAsBlob(argIndex);
+		if (blob.size() % sizeof(glm::vec2) != 0) {
+			throw(Exception("Blob size " + ofToString(blob.size()) + " is not a whole number of (x, y) pairs"));
+		}
+
+		vector<glm::vec2> positions(blob.size() / sizeof(glm::vec2));
+		memcpy(positions.data(), blob.getData(), blob.size());
+
+		for (const auto& position : positions) {
+			if (!isfinite(position.x) || !isfinite(position.y)) {
+				throw(Exception("Non-finite position in blob"));
+			}
+		}
+
+		return positions;
+	}
+
 	//----------
 	void initRoutes(Modules::App* app)
 	{
-		routes = {
+		vector<Route> globalRoutes = {
 			Route {
 				"/move"
 				, [app](const ofxOscMessage& message) {
@@ -242,17 +271,84 @@ namespace OSC {
 							});
 					}
 				}
+			},
+			Route{
+				"/frame"
+				, [app](const ofxOscMessage& message) {
+					// Positions for every portal in installation order (columns in order, then each column's portals)
+					auto positions = getPositionsFromBlob(message, 0);
+
+					auto columns = app->getInstallation()->getAllColumns();
+					size_t portalCount = 0;
+					for (const auto& column : columns) {
+						portalCount += column->getAllPortals().size();
+					}
+					if (positions.size() != portalCount) {
+						throw(Exception("Received " + ofToString(positions.size()) + " positions for " + ofToString(portalCount) + " portals"));
+					}
+
+					auto position = positions.begin();
+					for (size_t columnIndex = 0; columnIndex < columns.size(); columnIndex++) {
+						auto columnPortalCount = columns[columnIndex]->getAllPortals().size();
+						pendingFrame[columnIndex].assign(position, position + columnPortalCount);
+						position += columnPortalCount;
+					}
+				}
 			}
 		};
+
+		vector<ColumnRoute> perColumnRoutes = {
+			ColumnRoute{
+				"frame"
+				, [app](size_t columnIndex, const ofxOscMessage& message) {
+					// Positions for each of the column's portals in order
+					auto positions = getPositionsFromBlob(message, 0);
+
+					auto column = app->getInstallation()->getColumnByID(columnIndex);
+					if (!column) {
+						throw(Exception("Column " + ofToString(columnIndex) + " not found"));
+					}
+
+					auto portalCount = column->getAllPortals().size();
+					if (positions.size() != portalCount) {
+						throw(Exception("Received " + ofToString(positions.size()) + " positions for " + ofToString(portalCount) + " portals"));
+					}
+
+					pendingFrame[columnIndex] = move(positions);
+				}
+			}
+		};
+
+		routes.clear();
+		for (const auto& route : globalRoutes) {
+			routes.emplace(ofToLower(route.address), route);
+		}
+
+		columnRoutes.clear();
+		for (const auto& route : perColumnRoutes) {
+			columnRoutes.emplace(ofToLower(route.address), route);
+		}
+	}
+
+	//----------
+	void applyPendingFrame()
+	{
+		if (pendingFrame.empty()) {
+			return;
+		}
+
+		App::X()->getInstallation()->applyColumnPositions(pendingFrame);
+		pendingFrame.clear();
 	}
 
 	//----------
 	void handleRoute(const ofxOscMessage& message)
 	{
 		// Handle global routes
-		for (const auto& route : routes) {
-			if (ofToLower(route.address) == ofToLower(message.getAddress())) {
-				route.action(message);
+		{
+			auto findRoute = routes.find(ofToLower(message.getAddress()));
+			if (findRoute != routes.end()) {
+				findRoute->second.action(message);
 				return;
 			}
 		}
@@ -286,8 +382,16 @@ namespace OSC {
 					}
 				}
 				else if (hasColumnIndex && !hasPortalIndex) {
-					// Perform on column
 					auto columnIndex = ofToInt(addressParts[0]);
+
+					// Column routes
+					auto findColumnRoute = columnRoutes.find(ofToLower(addressParts[1]));
+					if (findColumnRoute != columnRoutes.end()) {
+						findColumnRoute->second.action(columnIndex, message);
+						return;
+					}
+
+					// Perform on column
 					auto column = App::X()->getInstallation()->getColumnByID(columnIndex);
 					
 					if (column) {
@@ -2,6 +2,7 @@
 
 #include "ofxOscMessage.h"
 #include "ofMain.h"
+#include <unordered_map>
 
 namespace Modules {
 	class App;
@@ -27,7 +28,21 @@ namespace OSC {
 		Action action;
 	};
 
-	extern vector<Route> routes;
+	// Addressed as /<column index>/address
+	struct ColumnRoute {
+		typedef std::function<void(size_t columnIndex, const ofxOscMessage&)> Action;
+		string address;
+		Action action;
+	};
+
+	// Keyed by lower case address
+	extern unordered_map<string, Route> routes;
+	extern unordered_map<string, ColumnRoute> columnRoutes;
+
 	void initRoutes(Modules::App*);
 	void handleRoute(const ofxOscMessage&);
+
+	// Frames received (/frame, /<column>/frame) since the last call are applied together in one Installation pass.
+	// Called once the receiver has drained its queue, so that a bundle of column frames is applied as one
+	void applyPendingFrame();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Serial.h"
 #include "TCP.h"
+#include "Simulated.h"
 
 namespace SerialDevices {
 	//----------
@@ -14,6 +15,7 @@ namespace SerialDevices {
 	{
 		registerFactory<Serial>();
 		registerFactory<TCP>();
+		registerFactory<Simulated>();
 	}
 
 	//----------
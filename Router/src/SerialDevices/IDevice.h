@@ -2,6 +2,8 @@
 
 #include "ofMain.h"
 
+// The rate everything comes up at (and the only rate the bootloader speaks). RS485 can negotiate a faster one
+// with the application firmware, see RS485::negotiateBaudRate
 #define BAUD_RATE 115200
 
 namespace SerialDevices {
@@ -11,6 +13,8 @@ namespace SerialDevices {
 	class IDevice
 	{
 	public:
+		virtual ~IDevice() { }
+
 		virtual string getTypeName() const = 0;
 		virtual string getAddressString() = 0;
 
@@ -20,10 +24,62 @@ namespace SerialDevices {
 
 		virtual size_t transmit(const Buffer&) = 0;
 
+		// Devices which queue what they transmit (e.g. TCP, to send back to back frames together) send it here
+		// The serial thread calls this whenever it has run out of frames to send for now
+		virtual void flush() { }
+
+		// Change the line rate of an open device. Anything already transmitted goes out at the old rate first
+		// Returns false if the device can't (e.g. TCP, where the gateway's UART is configured on the gateway)
+		virtual bool setBaudRate(int /*baudRate*/) { return false; }
+
 		virtual bool hasDataIncoming() = 0;
 
+		// Read up to size bytes into the caller's buffer, returns the number of bytes read
 		// Note that messages may be partial and need packetising
-		virtual Buffer receiveBytes() = 0;
+		virtual size_t receiveBytes(uint8_t* buffer, size_t size) = 0;
+
+		// Block the calling (serial) thread until bytes are incoming, wake() is called or the timeout passes
+		// Returns true if bytes are incoming. Devices which can block on their transport should override this
+		// (and wake), the default polls hasDataIncoming between short sleeps
+		virtual bool waitForData(chrono::microseconds timeout)
+		{
+			auto deadline = chrono::steady_clock::now() + timeout;
+			while (!this->hasDataIncoming()) {
+				auto now = chrono::steady_clock::now();
+				if (now >= deadline) {
+					return false;
+				}
+				if (this->sleepUntil(min(deadline, now + chrono::milliseconds(1)))) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Called from any thread to return waitForData early. If nobody is waiting, the next wait returns immediately
+		virtual void wake()
+		{
+			{
+				lock_guard<mutex> lock(this->wakeMutex);
+				this->wakeRequested = true;
+			}
+			this->wakeCondition.notify_all();
+		}
+	protected:
+		// Sleep until the time or until wake() is called. Returns true if woken
+		bool sleepUntil(chrono::steady_clock::time_point time)
+		{
+			unique_lock<mutex> lock(this->wakeMutex);
+			this->wakeCondition.wait_until(lock, time, [this]() {
+				return this->wakeRequested;
+				});
+			auto woken = this->wakeRequested;
+			this->wakeRequested = false;
+			return woken;
+		}
 
+		mutex wakeMutex;
+		condition_variable wakeCondition;
+		bool wakeRequested = false;
 	};
 }
\ No newline at end of file
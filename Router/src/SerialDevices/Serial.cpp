@@ -1,13 +1,64 @@
 #include "pch_App.h"
 #include "Serial.h"
 
+#ifndef TARGET_WIN32
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <termios.h>
+#	include <unistd.h>
+#	include <sys/ioctl.h>
+#endif
+
 namespace SerialDevices {
+#ifndef TARGET_WIN32
+	namespace {
+		//----------
+		bool
+			toSpeed(int baudRate, speed_t& speed)
+		{
+			switch (baudRate) {
+			case 9600: speed = B9600; return true;
+			case 19200: speed = B19200; return true;
+			case 38400: speed = B38400; return true;
+			case 57600: speed = B57600; return true;
+			case 115200: speed = B115200; return true;
+			case 230400: speed = B230400; return true;
+#ifdef B460800
+			case 460800: speed = B460800; return true;
+#endif
+#ifdef B921600
+			case 921600: speed = B921600; return true;
+#endif
+#ifdef B1000000
+			case 1000000: speed = B1000000; return true;
+#endif
+			default: return false;
+			}
+		}
+	}
+#endif
+
+	//----------
+	Serial::Serial()
+	{
+#ifdef TARGET_WIN32
+		for (auto overlapped : { &this->commEvent.overlapped, &this->readOverlapped, &this->writeOverlapped }) {
+			memset(overlapped, 0, sizeof(OVERLAPPED));
+			overlapped->hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		}
+#endif
+	}
+
 	//----------
 	Serial::~Serial()
 	{
-		if (this->serial.isInitialized()) {
-			this->serial.close();
+		this->close();
+
+#ifdef TARGET_WIN32
+		for (auto overlapped : { &this->commEvent.overlapped, &this->readOverlapped, &this->writeOverlapped }) {
+			CloseHandle(overlapped->hEvent);
 		}
+#endif
 	}
 
 	//----------
@@ -37,63 +88,445 @@ namespace SerialDevices {
 		}
 	}
 
+#ifdef TARGET_WIN32
 	//----------
 	bool
 		Serial::open(string portAddress)
 	{
-		auto success = this->serial.setup(portAddress, BAUD_RATE);
+		this->close();
+
+		// Ports above COM9 can only be opened by their device path
+		auto path = portAddress;
+		if (path.find("\\\\.\\") != 0) {
+			path = "\\\\.\\" + path;
+		}
+
+		auto handle = CreateFileA(path.c_str()
+			, GENERIC_READ | GENERIC_WRITE
+			, 0
+			, NULL
+			, OPEN_EXISTING
+			, FILE_FLAG_OVERLAPPED
+			, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			ofLogError("Serial") << "Could not open " << portAddress;
+			return false;
+		}
+
+		DCB dcb;
+		memset(&dcb, 0, sizeof(dcb));
+		dcb.DCBlength = sizeof(dcb);
+		auto success = GetCommState(handle, &dcb) != 0;
+		if (success) {
+			dcb.BaudRate = BAUD_RATE;
+			dcb.ByteSize = 8;
+			dcb.Parity = NOPARITY;
+			dcb.StopBits = ONESTOPBIT;
+			dcb.fBinary = TRUE;
+			dcb.fParity = FALSE;
+			dcb.fOutxCtsFlow = FALSE;
+			dcb.fOutxDsrFlow = FALSE;
+			dcb.fDsrSensitivity = FALSE;
+			dcb.fDtrControl = DTR_CONTROL_ENABLE;
+			dcb.fRtsControl = RTS_CONTROL_ENABLE;
+			dcb.fOutX = FALSE;
+			dcb.fInX = FALSE;
+			dcb.fNull = FALSE;
+			dcb.fAbortOnError = FALSE;
+			success = SetCommState(handle, &dcb) != 0;
+		}
+
+		// Reads return immediately with whatever has arrived (waitForData does the waiting)
+		if (success) {
+			COMMTIMEOUTS timeouts;
+			memset(&timeouts, 0, sizeof(timeouts));
+			timeouts.ReadIntervalTimeout = MAXDWORD;
+			success = SetCommTimeouts(handle, &timeouts) != 0;
+		}
+
 		if (success) {
-			this->addressString = portAddress;
+			success = SetCommMask(handle, EV_RXCHAR) != 0;
+		}
+
+		if (!success) {
+			ofLogError("Serial") << "Could not configure " << portAddress;
+			CloseHandle(handle);
+			return false;
+		}
+
+		PurgeComm(handle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+
+		this->handle = handle;
+		this->commEvent.pending = false;
+		this->addressString = portAddress;
+		return true;
+	}
+
+	//----------
+	void
+		Serial::close()
+	{
+		if (this->handle == INVALID_HANDLE_VALUE) {
+			return;
+		}
+
+		if (this->commEvent.pending) {
+			DWORD unused;
+			CancelIoEx(this->handle, &this->commEvent.overlapped);
+			GetOverlappedResult(this->handle, &this->commEvent.overlapped, &unused, TRUE);
+			this->commEvent.pending = false;
+		}
+
+		CloseHandle(this->handle);
+		this->handle = INVALID_HANDLE_VALUE;
+	}
+
+	//----------
+	bool
+		Serial::isConnected()
+	{
+		return this->handle != INVALID_HANDLE_VALUE;
+	}
+
+	//----------
+	bool
+		Serial::setBaudRate(int baudRate)
+	{
+		if (!this->isConnected()) {
+			return false;
+		}
+
+		// Let anything the driver still has go out at the old rate
+		FlushFileBuffers(this->handle);
+
+		DCB dcb;
+		memset(&dcb, 0, sizeof(dcb));
+		dcb.DCBlength = sizeof(dcb);
+		if (!GetCommState(this->handle, &dcb)) {
+			return false;
+		}
+		dcb.BaudRate = (DWORD)baudRate;
+		if (!SetCommState(this->handle, &dcb)) {
+			ofLogError("Serial") << "Could not set " << this->addressString << " to " << baudRate << " baud";
+			return false;
+		}
+		return true;
+	}
+
+	//----------
+	size_t
+		Serial::transmit(const Buffer & buffer)
+	{
+		if (!this->isConnected() || buffer.empty()) {
+			return 0;
+		}
+
+		DWORD bytesWritten = 0;
+		ResetEvent(this->writeOverlapped.hEvent);
+		if (!WriteFile(this->handle, buffer.data(), (DWORD)buffer.size(), NULL, &this->writeOverlapped)
+			&& GetLastError() != ERROR_IO_PENDING) {
+			ofLogError("Serial") << "Write failed on " << this->addressString;
+			this->close();
+			return 0;
+		}
+		if (!GetOverlappedResult(this->handle, &this->writeOverlapped, &bytesWritten, TRUE)) {
+			ofLogError("Serial") << "Write failed on " << this->addressString;
+			this->close();
+			return 0;
+		}
+		return (size_t)bytesWritten;
+	}
+
+	//----------
+	bool
+		Serial::hasDataIncoming()
+	{
+		return this->getBytesQueued() > 0;
+	}
+
+	//----------
+	size_t
+		Serial::receiveBytes(uint8_t* buffer, size_t size)
+	{
+		auto bytesQueued = this->getBytesQueued();
+		if (bytesQueued == 0) {
+			return 0;
+		}
+
+		DWORD bytesRead = 0;
+		ResetEvent(this->readOverlapped.hEvent);
+		if (!ReadFile(this->handle, buffer, (DWORD)min(bytesQueued, size), NULL, &this->readOverlapped)
+			&& GetLastError() != ERROR_IO_PENDING) {
+			ofLogError("Serial") << "Read failed on " << this->addressString;
+			this->close();
+			return 0;
+		}
+		if (!GetOverlappedResult(this->handle, &this->readOverlapped, &bytesRead, TRUE)) {
+			ofLogError("Serial") << "Read failed on " << this->addressString;
+			this->close();
+			return 0;
+		}
+		return (size_t)bytesRead;
+	}
+
+	//----------
+	bool
+		Serial::waitForData(chrono::microseconds timeout)
+	{
+		auto timeout_ms = (DWORD)min<int64_t>((timeout.count() + 999) / 1000, INFINITE - 1);
+
+		if (!this->isConnected()) {
+			WaitForSingleObject(this->wakeSignal.getHandle(), timeout_ms);
+			return false;
+		}
+
+		if (this->getBytesQueued() > 0) {
 			return true;
 		}
-		else {
+
+		if (!this->commEvent.pending) {
+			ResetEvent(this->commEvent.overlapped.hEvent);
+			if (WaitCommEvent(this->handle, &this->commEvent.eventMask, &this->commEvent.overlapped)) {
+				return this->getBytesQueued() > 0;
+			}
+			if (GetLastError() != ERROR_IO_PENDING) {
+				ofLogError("Serial") << "WaitCommEvent failed on " << this->addressString;
+				this->close();
+				return false;
+			}
+			this->commEvent.pending = true;
+
+			// A byte which arrived before the wait was armed doesn't raise EV_RXCHAR
+			if (this->getBytesQueued() > 0) {
+				return true;
+			}
+		}
+
+		HANDLE handles[] = { this->commEvent.overlapped.hEvent, this->wakeSignal.getHandle() };
+		auto result = WaitForMultipleObjects(2, handles, FALSE, timeout_ms);
+		if (result == WAIT_OBJECT_0) {
+			DWORD unused;
+			GetOverlappedResult(this->handle, &this->commEvent.overlapped, &unused, FALSE);
+			this->commEvent.pending = false;
+			return this->getBytesQueued() > 0;
+		}
+
+		// Woken or timed out. The comm event stays armed for the next wait
+		return false;
+	}
+
+	//----------
+	size_t
+		Serial::getBytesQueued()
+	{
+		if (!this->isConnected()) {
+			return 0;
+		}
+
+		DWORD errors;
+		COMSTAT status;
+		if (!ClearCommError(this->handle, &errors, &status)) {
+			ofLogError("Serial") << "Lost " << this->addressString;
+			this->close();
+			return 0;
+		}
+		return (size_t)status.cbInQue;
+	}
+#else
+	//----------
+	bool
+		Serial::open(string portAddress)
+	{
+		this->close();
+
+		speed_t speed;
+		if (!toSpeed(BAUD_RATE, speed)) {
+			ofLogError("Serial") << "Baud rate " << BAUD_RATE << " is not supported";
+			return false;
+		}
+
+		auto fd = ::open(portAddress.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) {
+			ofLogError("Serial") << "Could not open " << portAddress << " : " << strerror(errno);
+			return false;
+		}
+
+		termios options;
+		auto success = tcgetattr(fd, &options) == 0;
+		if (success) {
+			cfmakeraw(&options);
+			options.c_cflag |= CLOCAL | CREAD;
+			options.c_cflag &= ~CSTOPB;
+#ifdef CRTSCTS
+			options.c_cflag &= ~CRTSCTS;
+#endif
+			// Reads return immediately with whatever has arrived (waitForData does the waiting)
+			options.c_cc[VMIN] = 0;
+			options.c_cc[VTIME] = 0;
+			cfsetispeed(&options, speed);
+			cfsetospeed(&options, speed);
+			success = tcsetattr(fd, TCSANOW, &options) == 0;
+		}
+
+		if (!success) {
+			ofLogError("Serial") << "Could not configure " << portAddress << " : " << strerror(errno);
+			::close(fd);
 			return false;
 		}
+
+		tcflush(fd, TCIOFLUSH);
+
+		this->fd = fd;
+		this->addressString = portAddress;
+		return true;
 	}
 
 	//----------
 	void
 		Serial::close()
 	{
-		this->serial.close();
+		if (this->fd < 0) {
+			return;
+		}
+
+		::close(this->fd);
+		this->fd = -1;
 	}
 
 	//----------
 	bool
 		Serial::isConnected()
 	{
-		return this->serial.isInitialized();
+		return this->fd >= 0;
+	}
+
+	//----------
+	bool
+		Serial::setBaudRate(int baudRate)
+	{
+		if (!this->isConnected()) {
+			return false;
+		}
+
+		speed_t speed;
+		if (!toSpeed(baudRate, speed)) {
+			ofLogError("Serial") << "Baud rate " << baudRate << " is not supported";
+			return false;
+		}
+
+		// Let anything the driver still has go out at the old rate
+		tcdrain(this->fd);
+
+		termios options;
+		auto success = tcgetattr(this->fd, &options) == 0;
+		if (success) {
+			cfsetispeed(&options, speed);
+			cfsetospeed(&options, speed);
+			success = tcsetattr(this->fd, TCSANOW, &options) == 0;
+		}
+		if (!success) {
+			ofLogError("Serial") << "Could not set " << this->addressString << " to " << baudRate << " baud : " << strerror(errno);
+		}
+		return success;
 	}
 
 	//----------
 	size_t
 		Serial::transmit(const Buffer & buffer)
 	{
-		return (size_t) this->serial.writeBytes((char *) buffer.data()
-			, buffer.size());
+		size_t bytesWritten = 0;
+		while (this->isConnected() && bytesWritten < buffer.size()) {
+			auto result = ::write(this->fd, buffer.data() + bytesWritten, buffer.size() - bytesWritten);
+			if (result > 0) {
+				bytesWritten += (size_t)result;
+			}
+			else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+				// The driver's buffer is full, wait for it to drain
+				pollfd writable{ this->fd, POLLOUT, 0 };
+				if (poll(&writable, 1, 1000) <= 0) {
+					break;
+				}
+			}
+			else {
+				ofLogError("Serial") << "Write failed on " << this->addressString << " : " << strerror(errno);
+				this->close();
+			}
+		}
+		return bytesWritten;
 	}
 
 	//----------
 	bool
 		Serial::hasDataIncoming()
 	{
-		return this->serial.available() > 0;
+		if (!this->isConnected()) {
+			return false;
+		}
+
+		int bytesQueued = 0;
+		if (ioctl(this->fd, FIONREAD, &bytesQueued) != 0) {
+			return false;
+		}
+		return bytesQueued > 0;
+	}
+
+	//----------
+	size_t
+		Serial::receiveBytes(uint8_t* buffer, size_t size)
+	{
+		if (!this->isConnected()) {
+			return 0;
+		}
+
+		auto result = ::read(this->fd, buffer, size);
+		if (result > 0) {
+			return (size_t)result;
+		}
+		if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			ofLogError("Serial") << "Read failed on " << this->addressString << " : " << strerror(errno);
+			this->close();
+		}
+		return 0;
 	}
 
 	//----------
-	Buffer
-		Serial::receiveBytes()
+	bool
+		Serial::waitForData(chrono::microseconds timeout)
 	{
-		Buffer buffer;
+		pollfd fds[2];
+		nfds_t count = 0;
+		fds[count++] = { this->wakeSignal.getFD(), POLLIN, 0 };
+		if (this->isConnected()) {
+			fds[count++] = { this->fd, POLLIN, 0 };
+		}
 
-		auto bytesAvailable = this->serial.available();
-		if (bytesAvailable > 0) {
-			buffer.resize(bytesAvailable);
-			serial.readBytes(buffer.data(), bytesAvailable);
-			return buffer;
+		auto timeout_ms = (int)min<int64_t>((timeout.count() + 999) / 1000, numeric_limits<int>::max());
+		if (poll(fds, count, timeout_ms) <= 0) {
+			return false;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			this->wakeSignal.clear();
 		}
 
-		return buffer;
+		if (count > 1) {
+			if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+				ofLogError("Serial") << "Lost " << this->addressString;
+				this->close();
+				return false;
+			}
+			return (fds[1].revents & POLLIN) != 0;
+		}
+		return false;
+	}
+
+#endif
+
+	//----------
+	void
+		Serial::wake()
+	{
+		this->wakeSignal.signal();
 	}
 
 	//----------
@@ -2,11 +2,17 @@
 
 #include "IDevice.h"
 #include "ListedDevice.h"
+#include "WakeSignal.h"
 
 namespace SerialDevices {
+	/// <summary>
+	/// A COM port / tty. The port is opened natively rather than through ofSerial so that the serial thread can
+	/// block on it (overlapped I/O with WaitCommEvent on Windows, poll() elsewhere) alongside a WakeSignal.
+	/// </summary>
 	class Serial : public IDevice
 	{
 	public:
+		Serial();
 		~Serial();
 		string getTypeName() const override;
 		string getAddressString() override;
@@ -15,15 +21,36 @@ namespace SerialDevices {
 		bool open(string portAddress);
 		void close() override;
 		bool isConnected() override;
+		bool setBaudRate(int baudRate) override;
 
 		size_t transmit(const Buffer&) override;
 
 		bool hasDataIncoming() override;
-		Buffer receiveBytes() override;
+		size_t receiveBytes(uint8_t* buffer, size_t size) override;
+
+		bool waitForData(chrono::microseconds timeout) override;
+		void wake() override;
 
 		static vector<ListedDevice> listDevices();
 	protected:
-		ofSerial serial;
+#ifdef TARGET_WIN32
+		size_t getBytesQueued();
+
+		HANDLE handle = INVALID_HANDLE_VALUE;
+
+		// WaitCommEvent stays pending between calls to waitForData until a byte arrives
+		struct {
+			OVERLAPPED overlapped;
+			DWORD eventMask = 0;
+			bool pending = false;
+		} commEvent;
+
+		OVERLAPPED readOverlapped;
+		OVERLAPPED writeOverlapped;
+#else
+		int fd = -1;
+#endif
+		WakeSignal wakeSignal;
 		string addressString;
 	};
 }
\ No newline at end of file
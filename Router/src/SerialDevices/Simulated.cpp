@@ -0,0 +1,1297 @@
+#include "pch_App.h"
+#include "Simulated.h"
+
+#include "../Modules/Hardware/RS485Protocol.h"
+#include "../Modules/Hardware/KeyframeEncoder.h"
+#include "../cobs-c/cobs.h"
+
+using namespace msgpack11;
+
+namespace SerialDevices {
+	namespace {
+		//----------
+		// As msgpack-arduino's writeInt8
+		void
+			writeInt8(Buffer& buffer, int8_t value)
+		{
+			buffer.push_back(0xd0);
+			buffer.push_back((uint8_t)value);
+		}
+
+		//----------
+		// As msgpack-arduino's writeInt32 (always 5 bytes)
+		void
+			writeInt32(Buffer& buffer, int32_t value)
+		{
+			auto raw = (uint32_t)value;
+			buffer.push_back(0xd2);
+			buffer.push_back((uint8_t)(raw >> 24));
+			buffer.push_back((uint8_t)(raw >> 16));
+			buffer.push_back((uint8_t)(raw >> 8));
+			buffer.push_back((uint8_t)raw);
+		}
+
+		//----------
+		// As the write lambda in App::packCompactStatus (little-endian, byteCount bytes)
+		void
+			writeLittleEndian(Buffer& buffer, uint32_t value, uint8_t byteCount)
+		{
+			for (uint8_t i = 0; i < byteCount; i++) {
+				buffer.push_back((uint8_t)(value >> (i * 8)));
+			}
+		}
+
+		//----------
+		// As MotionControl::reportStatus
+		MsgPack
+			makeAxisStatus(int32_t position, int32_t target, int32_t maximumSpeed)
+		{
+			return MsgPack::object{
+				{ "position", position }
+				, { "targetPosition", target }
+				, { "healthStatus", MsgPack::object{
+					{ "measureCycleOK", true }
+					, { "SwitchesOK", true }
+					, { "backlashOK", true }
+					, { "homeOK", true }
+				} }
+				, { "maximumSpeed", maximumSpeed }
+				, { "acceleration", 10000 }
+				, { "minimumSpeed", 5 }
+				, { "opticalThreshold", (uint8_t)128 }
+				, { "opticalWidth", (uint8_t)0 }
+				, { "fastHomeFailure", (uint8_t)0 }
+			};
+		}
+	}
+
+	//----------
+	Simulated::~Simulated()
+	{
+		this->close();
+	}
+
+	//----------
+	string
+		Simulated::getTypeName() const
+	{
+		return "Simulated";
+	}
+
+	//----------
+	string
+		Simulated::getAddressString()
+	{
+		return ofToString(this->settings.portalCount) + " portals @ " + ofToString(this->settings.baudRate);
+	}
+
+	//----------
+	bool
+		Simulated::open(const nlohmann::json& json)
+	{
+		Settings settings;
+		{
+			if (json.contains("portalCount")) {
+				settings.portalCount = (int)json["portalCount"];
+			}
+			if (json.contains("firstID")) {
+				settings.firstID = (int)json["firstID"];
+			}
+			if (json.contains("baudRate")) {
+				settings.baudRate = (int)json["baudRate"];
+			}
+			if (json.contains("baudFallbackTimeout_ms")) {
+				settings.baudFallbackTimeout_ms = (int)json["baudFallbackTimeout_ms"];
+			}
+			if (json.contains("loopPeriod_us")) {
+				settings.loopPeriod_us = (int)json["loopPeriod_us"];
+			}
+			if (json.contains("processing_us")) {
+				settings.processing_us = (int)json["processing_us"];
+			}
+			if (json.contains("bitErrorRate")) {
+				settings.bitErrorRate = (double)json["bitErrorRate"];
+			}
+			if (json.contains("verifyChecksum")) {
+				settings.verifyChecksum = (bool)json["verifyChecksum"];
+			}
+			if (json.contains("maximumSpeed")) {
+				settings.maximumSpeed = (int32_t)json["maximumSpeed"];
+			}
+			if (json.contains("seed")) {
+				settings.seed = (uint32_t)json["seed"];
+			}
+		}
+		return this->open(settings);
+	}
+
+	//----------
+	bool
+		Simulated::open(const Settings& settings)
+	{
+		if (settings.portalCount < 1
+			|| settings.firstID < 1
+			|| settings.firstID + settings.portalCount > 128
+			|| settings.baudRate <= 0) {
+			return false;
+		}
+
+		this->settings = settings;
+
+		// start bit + 8 data bits + stop bit
+		this->baudRate = settings.baudRate;
+		this->byteDuration = std::chrono::nanoseconds((int64_t)10 * 1000000000 / settings.baudRate);
+		this->random.seed(settings.seed);
+
+		auto now = Clock::now();
+		this->openTime = now;
+		this->hostTxEnd = now;
+
+		this->portals.clear();
+		for (int i = 0; i < settings.portalCount; i++) {
+			Portal portal;
+			portal.id = settings.firstID + i;
+			portal.verifyChecksum = settings.verifyChecksum;
+			portal.baudRate = settings.baudRate;
+			portal.lastValidFrameTime = now;
+			portal.lastMotionUpdate = now;
+			portal.bootTime = now;
+			portal.txBusyUntil = now;
+			this->portals.push_back(portal);
+		}
+
+		this->events.clear();
+		this->bus.clear();
+		this->statistics = Statistics();
+
+		this->isOpen = true;
+		return true;
+	}
+
+	//----------
+	void
+		Simulated::close()
+	{
+		if (!this->isOpen) {
+			return;
+		}
+
+		auto duration_s = std::chrono::duration<double>(Clock::now() - this->openTime).count();
+		if (duration_s > 0.0) {
+			ofLogNotice("Simulated") << "Closed after " << duration_s << "s : "
+				<< this->statistics.framesFromHost / duration_s << " frames/s from host ("
+				<< this->statistics.keyframesFromHost / duration_s << " keyframes/s), "
+				<< this->statistics.repliesToHost / duration_s << " replies/s, "
+				<< this->statistics.collisions << " collisions, "
+				<< this->statistics.bitErrors << " bit errors, "
+				<< this->statistics.packetsDropped << " packets dropped";
+		}
+
+		this->events.clear();
+		this->bus.clear();
+		this->isOpen = false;
+	}
+
+	//----------
+	bool
+		Simulated::isConnected()
+	{
+		return this->isOpen;
+	}
+
+	//----------
+	bool
+		Simulated::setBaudRate(int baudRate)
+	{
+		if (!this->isOpen || baudRate <= 0) {
+			return false;
+		}
+
+		// Frames already handed to the UART keep the rate they were sent at
+		this->advance(Clock::now());
+
+		this->baudRate = baudRate;
+		this->byteDuration = std::chrono::nanoseconds((int64_t)10 * 1000000000 / baudRate);
+		return true;
+	}
+
+	//----------
+	size_t
+		Simulated::transmit(const Buffer& buffer)
+	{
+		if (!this->isOpen || buffer.empty()) {
+			return 0;
+		}
+
+		auto now = Clock::now();
+		this->advance(now);
+
+		// The host UART sends its frames back to back
+		auto transmission = make_shared<Transmission>();
+		{
+			transmission->source = 0;
+			transmission->bytes = buffer;
+			transmission->start = max(now, this->hostTxEnd);
+			transmission->end = transmission->start + this->byteDuration * buffer.size();
+			transmission->baudRate = this->baudRate;
+			transmission->byteDuration = this->byteDuration;
+		}
+		this->hostTxEnd = transmission->end;
+
+		Event event;
+		{
+			event.type = Event::Type::HostFrameStart;
+			event.transmission = transmission;
+		}
+		this->addEvent(transmission->start, event);
+		this->advance(now);
+
+		return buffer.size();
+	}
+
+	//----------
+	bool
+		Simulated::hasDataIncoming()
+	{
+		if (!this->isOpen) {
+			return false;
+		}
+
+		auto now = Clock::now();
+		this->advance(now);
+
+		for (const auto& transmission : this->bus) {
+			if (transmission->source != 0 && this->bytesCompleteAt(*transmission, now) > transmission->delivered) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//----------
+	size_t
+		Simulated::receiveBytes(uint8_t* buffer, size_t size)
+	{
+		if (!this->isOpen) {
+			return 0;
+		}
+
+		auto now = Clock::now();
+		this->advance(now);
+
+		// Transmissions are in order of their start time, and the overlapping part of a later one has already been
+		// merged into the earlier one (see startTransmission), so this is the order the bytes arrive at the host UART
+		size_t bytesReceived = 0;
+		for (auto& transmission : this->bus) {
+			if (transmission->source == 0) {
+				continue;
+			}
+
+			auto bytesComplete = this->bytesCompleteAt(*transmission, now);
+			while (transmission->delivered < bytesComplete && bytesReceived < size) {
+				buffer[bytesReceived++] = transmission->bytes[transmission->delivered++];
+			}
+
+			if (bytesReceived == size) {
+				break;
+			}
+		}
+
+		// Forget anything which has finished with the bus
+		for (auto it = this->bus.begin(); it != this->bus.end(); ) {
+			auto& transmission = **it;
+			if (transmission.end <= now
+				&& (transmission.source == 0 || transmission.delivered == transmission.bytes.size())) {
+				it = this->bus.erase(it);
+			}
+			else {
+				it++;
+			}
+		}
+
+		return bytesReceived;
+	}
+
+	//----------
+	bool
+		Simulated::waitForData(chrono::microseconds timeout)
+	{
+		auto deadline = Clock::now() + timeout;
+		while (!this->hasDataIncoming()) {
+			auto now = Clock::now();
+			if (now >= deadline) {
+				return false;
+			}
+
+			auto until = this->isOpen
+				? min(deadline, this->getNextActivity())
+				: deadline;
+			if (this->sleepUntil(until)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//----------
+	const Simulated::Statistics&
+		Simulated::getStatistics() const
+	{
+		return this->statistics;
+	}
+
+	//----------
+	vector<ListedDevice>
+		Simulated::listDevices()
+	{
+		vector<ListedDevice> listedDevices;
+
+		auto typeName = Simulated().getTypeName();
+
+		for (auto portalCount : { 24, 32 }) {
+			ListedDevice listedDevice;
+			{
+				listedDevice.type = typeName;
+				listedDevice.name = ofToString(portalCount) + " portals";
+				listedDevice.createDevice = [portalCount]() {
+					Settings settings;
+					settings.portalCount = portalCount;
+
+					auto device = make_shared<Simulated>();
+					if (device->open(settings)) {
+						return static_pointer_cast<IDevice>(device);
+					}
+					return shared_ptr<IDevice>();
+				};
+			}
+			listedDevices.push_back(listedDevice);
+		}
+
+		return listedDevices;
+	}
+
+#pragma mark Bus
+	//----------
+	void
+		Simulated::advance(Clock::time_point now)
+	{
+		// Events can add further events (including ones which are already due)
+		while (!this->events.empty() && this->events.begin()->first <= now) {
+			auto time = this->events.begin()->first;
+			auto event = this->events.begin()->second;
+			this->events.erase(this->events.begin());
+			this->processEvent(time, event);
+		}
+	}
+
+	//----------
+	Simulated::Clock::time_point
+		Simulated::getNextActivity() const
+	{
+		auto next = Clock::time_point::max();
+		if (!this->events.empty()) {
+			next = this->events.begin()->first;
+		}
+
+		// Replies on the bus are handed over when they've finished arriving (the host only acts on whole frames)
+		for (const auto& transmission : this->bus) {
+			if (transmission->source != 0 && transmission->delivered < transmission->bytes.size()) {
+				next = min(next, transmission->end);
+			}
+		}
+		return next;
+	}
+
+	//----------
+	void
+		Simulated::addEvent(Clock::time_point time, const Event& event)
+	{
+		// Events at the same time stay in the order they were added
+		this->events.emplace_hint(this->events.upper_bound(time), time, event);
+	}
+
+	//----------
+	void
+		Simulated::processEvent(Clock::time_point time, const Event& event)
+	{
+		switch (event.type) {
+		case Event::Type::HostFrameStart:
+		{
+			this->startTransmission(event.transmission);
+			this->statistics.framesFromHost++;
+
+			Event endEvent = event;
+			endEvent.type = Event::Type::HostFrameEnd;
+			this->addEvent(event.transmission->end, endEvent);
+			break;
+		}
+		case Event::Type::HostFrameEnd:
+			this->receiveFromHost(*event.transmission, time);
+			break;
+		case Event::Type::Reply:
+		{
+			auto& portal = this->portals[event.portalIndex];
+
+			// A newer scheduled reply replaces this one (PortalFW only has one scheduledReply)
+			if (event.generation != 0 && event.generation != portal.scheduledGeneration) {
+				break;
+			}
+
+			// A reply can't start until the previous one has been flushed
+			if (time < portal.txBusyUntil) {
+				this->addEvent(portal.txBusyUntil, event);
+				break;
+			}
+
+			this->portalUpdateBaudRate(portal, time);
+			auto byteDuration = std::chrono::nanoseconds((int64_t)10 * 1000000000 / portal.baudRate);
+
+			auto transmission = make_shared<Transmission>();
+			{
+				transmission->source = portal.id;
+				transmission->bytes = this->portalBuildReply(portal, event.reply, event.success, time);
+				transmission->start = time;
+				transmission->end = time + byteDuration * transmission->bytes.size();
+				transmission->baudRate = portal.baudRate;
+				transmission->byteDuration = byteDuration;
+			}
+			portal.txBusyUntil = transmission->end;
+
+			// The host is listening at another rate, so all it gets is noise
+			if (portal.baudRate != this->baudRate) {
+				this->garble(*transmission, transmission->start, transmission->end);
+			}
+
+			this->startTransmission(transmission);
+			this->statistics.repliesToHost++;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	//----------
+	void
+		Simulated::startTransmission(shared_ptr<Transmission> transmission)
+	{
+		// Bit errors
+		if (this->settings.bitErrorRate > 0.0) {
+			std::bernoulli_distribution flip(this->settings.bitErrorRate);
+			for (auto& byte : transmission->bytes) {
+				for (int bit = 0; bit < 8; bit++) {
+					if (flip(this->random)) {
+						byte ^= (uint8_t)(1 << bit);
+						this->statistics.bitErrors++;
+					}
+				}
+			}
+		}
+
+		// Collisions with anything still on the bus (half duplex, and nobody listens before talking)
+		for (auto& other : this->bus) {
+			if (other->end <= transmission->start) {
+				continue;
+			}
+
+			auto overlapEnd = min(other->end, transmission->end);
+			this->garble(*other, transmission->start, overlapEnd);
+			this->garble(*transmission, transmission->start, overlapEnd);
+
+			// The host UART sees one stream of garbage rather than both transmissions
+			// (and hears nothing from the bus whilst it is transmitting itself)
+			transmission->delivered = max(transmission->delivered
+				, min(transmission->bytes.size(), this->bytesCompleteAt(*transmission, overlapEnd)));
+
+			this->statistics.collisions++;
+		}
+
+		this->bus.push_back(transmission);
+	}
+
+	//----------
+	void
+		Simulated::garble(Transmission& transmission, Clock::time_point from, Clock::time_point to)
+	{
+		auto firstByte = (size_t)((from - transmission.start) / transmission.byteDuration);
+		auto endByte = min(transmission.bytes.size()
+			, (size_t)((to - transmission.start + transmission.byteDuration - std::chrono::nanoseconds(1)) / transmission.byteDuration));
+
+		std::uniform_int_distribution<int> noise(1, 255);
+		for (auto i = firstByte; i < endByte; i++) {
+			transmission.bytes[i] ^= (uint8_t)noise(this->random);
+		}
+	}
+
+	//----------
+	size_t
+		Simulated::bytesCompleteAt(const Transmission& transmission, Clock::time_point time) const
+	{
+		if (time <= transmission.start) {
+			return 0;
+		}
+		auto bytesComplete = (size_t)((time - transmission.start) / transmission.byteDuration);
+		return min(bytesComplete, transmission.bytes.size());
+	}
+
+#pragma mark Portals
+	//----------
+	void
+		Simulated::receiveFromHost(const Transmission& transmission, Clock::time_point time)
+	{
+		// PortalFW's COBS stream ends a packet at every 0 (a garbled byte can split a frame)
+		const auto& bytes = transmission.bytes;
+		size_t packetStart = 0;
+		for (size_t i = 0; i < bytes.size(); i++) {
+			if (bytes[i] != 0) {
+				continue;
+			}
+			if (i > packetStart) {
+				this->receivePacket(bytes.data() + packetStart, i - packetStart, transmission.baudRate, time);
+			}
+			packetStart = i + 1;
+		}
+	}
+
+	//----------
+	void
+		Simulated::receivePacket(const uint8_t* data, size_t size, int baudRate, Clock::time_point time)
+	{
+		vector<uint8_t> decoded(size);
+		auto decodeResult = cobs_decode(decoded.data(), decoded.size(), data, size);
+		if (decodeResult.status != COBS_DECODE_OK) {
+			this->statistics.packetsDropped++;
+			return;
+		}
+		decoded.resize(decodeResult.out_len);
+
+		Packet packet;
+		{
+			int source;
+			packet.trailerValid = Modules::RS485Protocol::peekEnvelope(decoded.data(), decoded.size(), source, packet.seq);
+
+			string error;
+			auto message = MsgPack::parse(string(decoded.begin(), decoded.end()), error);
+			if (!error.empty()
+				|| !message.is_array()
+				|| message.array_items().size() < 3
+				|| !message[0].is_number()) {
+				this->statistics.packetsDropped++;
+				return;
+			}
+			packet.envelope = message.array_items();
+			packet.target = message[0].int_value();
+		}
+
+		if (packet.envelope[2].is_object()
+			&& (packet.envelope[2].object_items().count("kf") || packet.envelope[2].object_items().count("keyframe"))) {
+			this->statistics.keyframesFromHost++;
+		}
+
+		std::uniform_int_distribution<int> loopPhase_us(0, this->settings.loopPeriod_us);
+		for (auto& portal : this->portals) {
+			if (time < portal.bootTime) {
+				continue;
+			}
+
+			// A frame at another rate is noise to this portal's UART
+			this->portalUpdateBaudRate(portal, time);
+			if (portal.baudRate != baudRate) {
+				continue;
+			}
+
+			// Any frame which parses keeps the baud rate watchdog happy (as RS485::processIncoming)
+			portal.lastValidFrameTime = time;
+
+			if (packet.target != portal.id && packet.target != -1) {
+				continue;
+			}
+
+			// Each portal picks the packet up on its next pass through the main loop
+			auto processTime = time
+				+ std::chrono::microseconds(loopPhase_us(this->random) + this->settings.processing_us);
+			this->portalReceive(portal, packet, processTime);
+		}
+	}
+
+	//----------
+	void
+		Simulated::portalReceive(Portal& portal, const Packet& packet, Clock::time_point time)
+	{
+		// As RS485::processIncoming / processCOBSPacket in PortalFW
+		Context context;
+		context.time = time;
+
+		// Broadcasts are processed but never ACKed
+		context.disableACK = packet.target == -1;
+
+		this->portalAdvanceMotion(portal, time);
+
+		bool success = true;
+		const auto& body = packet.envelope[2];
+		if (body.is_null()) {
+			// Ping, the ACK is the reply
+		}
+		else if (body.is_string()) {
+			// Magic word
+			if (body.string_value() == "FW!KC79") {
+				if (!this->portalCheckChecksum(portal, packet)) {
+					success = false;
+				}
+				else {
+					// The bootloader isn't simulated, so the portal just comes back up again
+					this->portalReboot(portal, time + std::chrono::milliseconds(500));
+					return;
+				}
+			}
+		}
+		else if (body.is_object()) {
+			for (const auto& item : body.object_items()) {
+				if (!item.first.is_string()
+					|| !this->portalProcessKey(portal, item.first.string_value(), item.second, packet, context)) {
+					success = false;
+					break;
+				}
+				if (context.reset) {
+					return;
+				}
+			}
+		}
+		else {
+			success = false;
+		}
+
+		if (!context.disableACK && !context.sentACKEarly) {
+			this->portalQueueReply(portal, Reply::ACK, time, success);
+		}
+	}
+
+	//----------
+	bool
+		Simulated::portalProcessKey(Portal& portal, const string& key, const MsgPack& value, const Packet& packet, Context& context)
+	{
+		// As App::processIncomingByKey in PortalFW
+		auto replyAllowed = [&context]() {
+			return !context.disableACK && !context.sentACKEarly;
+		};
+		auto sendPositions = [&]() {
+			// sendPositions() also stands in for the ACK
+			context.disableACK = true;
+			this->portalQueueReply(portal, Reply::Positions, context.time);
+		};
+
+		if (key == "poll") {
+			if (value.is_array()) {
+				// Broadcast poll : [slot_us, firstID]
+				const auto& items = value.array_items();
+				if (items.size() != 2 || !items[0].is_number() || !items[1].is_number()) {
+					return false;
+				}
+				auto slot_us = items[0].uint32_value();
+				auto firstID = items[1].int_value();
+				if (portal.id < firstID) {
+					return true;
+				}
+				if (!this->portalCheckChecksum(portal, packet)) {
+					return false;
+				}
+
+				std::uniform_int_distribution<int> loopPhase_us(0, this->settings.loopPeriod_us);
+				auto replyTime = context.time
+					+ std::chrono::microseconds((int64_t)(portal.id - firstID) * slot_us + loopPhase_us(this->random));
+				this->portalQueueReply(portal, Reply::StatusReport, replyTime, true, ++portal.scheduledGeneration);
+				return true;
+			}
+			if (!value.is_null()) {
+				return false;
+			}
+			if (replyAllowed()) {
+				this->portalQueueReply(portal, Reply::StatusReport, context.time);
+			}
+			return true;
+		}
+		else if (key == "s") {
+			// Compact status : nil (everything), flags (bit 0 = changed fields only) or [slot_us, firstID(, flags)]
+			uint8_t flags = 0;
+			if (value.is_array()) {
+				const auto& items = value.array_items();
+				if (items.size() < 2 || items.size() > 3 || !items[0].is_number() || !items[1].is_number()
+					|| (items.size() == 3 && !items[2].is_number())) {
+					return false;
+				}
+				auto slot_us = items[0].uint32_value();
+				auto firstID = items[1].int_value();
+				if (items.size() == 3) {
+					flags = items[2].uint8_value();
+				}
+				if (portal.id < firstID) {
+					return true;
+				}
+				if (!this->portalCheckChecksum(portal, packet)) {
+					return false;
+				}
+
+				std::uniform_int_distribution<int> loopPhase_us(0, this->settings.loopPeriod_us);
+				auto replyTime = context.time
+					+ std::chrono::microseconds((int64_t)(portal.id - firstID) * slot_us + loopPhase_us(this->random));
+				this->portalQueueReply(portal, (flags & 1) ? Reply::CompactStatusChanges : Reply::CompactStatus
+					, replyTime, true, ++portal.scheduledGeneration);
+				return true;
+			}
+			if (value.is_number()) {
+				flags = value.uint8_value();
+			}
+			else if (!value.is_null()) {
+				return false;
+			}
+			if (replyAllowed()) {
+				// sendCompactStatusReport() stands in for the ACK
+				context.disableACK = true;
+				this->portalQueueReply(portal, (flags & 1) ? Reply::CompactStatusChanges : Reply::CompactStatus, context.time);
+			}
+			return true;
+		}
+		else if (key == "m") {
+			if (portal.insideRoutine) {
+				return true;
+			}
+			if (!value.is_array()) {
+				return false;
+			}
+			const auto& items = value.array_items();
+			for (const auto& item : items) {
+				if (!item.is_number()) {
+					return false;
+				}
+			}
+			if (!this->portalCheckChecksum(portal, packet)) {
+				return false;
+			}
+			for (size_t i = 0; i < min(items.size(), (size_t)2); i++) {
+				portal.axes[i].target = items[i].int32_value();
+			}
+			if (replyAllowed()) {
+				sendPositions();
+			}
+			return true;
+		}
+		else if (key == "mm") {
+			// Batched move : [slot_us, [id, a, b], ...]. Inside a routine the move is ignored but the slot is
+			// still answered (as App does)
+			if (!value.is_array() || value.array_items().empty() || !value[0].is_number()) {
+				return false;
+			}
+			const auto& items = value.array_items();
+			auto slot_us = items[0].uint32_value();
+
+			bool found = false;
+			size_t ourSlot = 0;
+			int32_t positionA = 0, positionB = 0;
+			for (size_t i = 1; i < items.size(); i++) {
+				const auto& entry = items[i];
+				if (!entry.is_array() || entry.array_items().size() != 3) {
+					return false;
+				}
+				if (entry[0].int_value() == portal.id && !found) {
+					found = true;
+					ourSlot = i - 1;
+					positionA = entry[1].int32_value();
+					positionB = entry[2].int32_value();
+				}
+			}
+			if (!found) {
+				return true;
+			}
+			if (!this->portalCheckChecksum(portal, packet)) {
+				return false;
+			}
+			if (!portal.insideRoutine) {
+				portal.axes[0].target = positionA;
+				portal.axes[1].target = positionB;
+			}
+
+			std::uniform_int_distribution<int> loopPhase_us(0, this->settings.loopPeriod_us);
+			auto replyTime = context.time
+				+ std::chrono::microseconds((int64_t)ourSlot * slot_us + loopPhase_us(this->random));
+			this->portalQueueReply(portal, Reply::Positions, replyTime, true, ++portal.scheduledGeneration);
+			return true;
+		}
+		else if (key == "p") {
+			if (!value.is_null()) {
+				return false;
+			}
+			if (replyAllowed()) {
+				sendPositions();
+			}
+			return true;
+		}
+		else if (key == "settingsRead") {
+			if (!value.is_null()) {
+				return false;
+			}
+			if (replyAllowed()) {
+				this->portalQueueReply(portal, Reply::StatusReport, context.time);
+			}
+			return true;
+		}
+		else if (key == "init" || key == "calibrate" || key == "home" || key == "unjam") {
+			if (portal.insideRoutine) {
+				return true;
+			}
+			if (!this->portalCheckChecksum(portal, packet)) {
+				return false;
+			}
+
+			// Early ACK, then the routine runs (modelled as a move to home)
+			if (replyAllowed()) {
+				this->portalQueueReply(portal, Reply::ACK, context.time, true);
+			}
+			context.sentACKEarly = true;
+
+			portal.insideRoutine = true;
+			portal.axes[0].target = 0;
+			portal.axes[1].target = 0;
+			return true;
+		}
+		else if (key == "escapeFromRoutine") {
+			if (!value.is_null()) {
+				return false;
+			}
+			portal.insideRoutine = false;
+			for (auto& axis : portal.axes) {
+				axis.target = (int32_t)axis.position;
+			}
+			return true;
+		}
+		else if (key == "reset") {
+			if (!value.is_null()) {
+				return false;
+			}
+			if (!this->portalCheckChecksum(portal, packet)) {
+				return false;
+			}
+			this->portalReboot(portal, context.time);
+			context.reset = true;
+			return true;
+		}
+		else if (key == "verifyChecksum") {
+			if (!value.is_bool()) {
+				return false;
+			}
+			portal.verifyChecksum = value.bool_value();
+			return true;
+		}
+		else if (key == "baud") {
+			// [baudRate, delay_ms] (broadcast)
+			if (!value.is_array()
+				|| value.array_items().size() != 2
+				|| !value[0].is_number()
+				|| !value[1].is_number()) {
+				return false;
+			}
+			auto baudRate = value[0].int_value();
+			switch (baudRate) {
+			case 115200:
+			case 230400:
+			case 460800:
+			case 921600:
+			case 1000000:
+				break;
+			default:
+				return false;
+			}
+			if (!this->portalCheckChecksum(portal, packet)) {
+				return false;
+			}
+			portal.pendingBaudRate = baudRate;
+			portal.pendingBaudRateTime = context.time + std::chrono::milliseconds(value[1].int_value());
+			return true;
+		}
+		else if (key == "keyframe") {
+			// { "startIndex" : n, "values" : [[a, b(, va, vb)], ...] }
+			if (portal.insideRoutine) {
+				return true;
+			}
+			if (!value.is_object() || !value["startIndex"].is_number() || !value["values"].is_array()) {
+				return false;
+			}
+			auto index = portal.id - value["startIndex"].int_value();
+			const auto& values = value["values"].array_items();
+			if (index < 0 || index >= (int)values.size()) {
+				return true;
+			}
+			const auto& ourValues = values[index];
+			if (!ourValues.is_array() || ourValues.array_items().size() < 2) {
+				return false;
+			}
+			portal.axes[0].target = ourValues[0].int32_value();
+			portal.axes[1].target = ourValues[1].int32_value();
+			return true;
+		}
+		else if (key == "kf") {
+			if (portal.insideRoutine) {
+				return true;
+			}
+			if (!value.is_binary()) {
+				return false;
+			}
+			return this->portalProcessKeyframeBinary(portal, value.binary_items());
+		}
+		else if (key == "id"
+			|| key == "motorDriverSettings"
+			|| key == "settingsWrite"
+			|| key == "motorDriverA"
+			|| key == "motorDriverB"
+			|| key == "motionControlA"
+			|| key == "motionControlB"
+			|| key == "flashLED"
+			|| key == "debugLightsEnabled"
+			|| key == "homeThreshold") {
+			// Accepted but not simulated
+			return true;
+		}
+
+		return false;
+	}
+
+	//----------
+	bool
+		Simulated::portalCheckChecksum(Portal& portal, const Packet& packet)
+	{
+		// As RS485::checkChecksum in PortalFW (a no-op unless verifyChecksum is enabled)
+		if (!portal.verifyChecksum) {
+			return true;
+		}
+		if (packet.seq < 0 || !packet.trailerValid) {
+			return false;
+		}
+		portal.lastRxSeq = (uint8_t)packet.seq;
+		return true;
+	}
+
+	//----------
+	bool
+		Simulated::portalProcessKeyframeBinary(Portal& portal, const MsgPack::binary& data)
+	{
+		// As KeyframeMotionControl::processIncomingBinary in PortalFW
+		if (data.size() < 4) {
+			return false;
+		}
+
+		auto flags = data[0];
+		auto seq = data[1];
+		auto startIndex = data[2];
+		auto count = data[3];
+
+		if (portal.id < startIndex || portal.id >= (int)startIndex + count) {
+			return true;
+		}
+
+		const bool isAbsolute = flags & KEYFRAME_FLAG_ABSOLUTE;
+		const bool hasVelocities = flags & KEYFRAME_FLAG_VELOCITIES;
+
+		if (!isAbsolute && (!portal.keyframes.synced || seq != (uint8_t)(portal.keyframes.lastSeq + 1))) {
+			portal.keyframes.synced = false;
+			return true;
+		}
+		portal.keyframes.lastSeq = seq;
+		portal.keyframes.synced = true;
+
+		const size_t bitmapSize = ((size_t)count + 7) / 8;
+		if (data.size() < 4 + bitmapSize) {
+			return false;
+		}
+		auto bitmap = data.data() + 4;
+
+		const auto ourIndex = portal.id - startIndex;
+		if (!(bitmap[ourIndex / 8] & (1 << (ourIndex % 8)))) {
+			return true;
+		}
+
+		const size_t valueCount = hasVelocities ? 4 : 2;
+		const size_t valueSize = isAbsolute ? 4 : 2;
+
+		size_t entriesBefore = 0;
+		for (int i = 0; i < ourIndex; i++) {
+			if (bitmap[i / 8] & (1 << (i % 8))) {
+				entriesBefore++;
+			}
+		}
+
+		auto offset = 4 + bitmapSize + entriesBefore * valueCount * valueSize;
+		if (data.size() < offset + valueCount * valueSize) {
+			return false;
+		}
+
+		int32_t values[4] = { 0, 0, 0, 0 };
+		for (size_t i = 0; i < valueCount; i++) {
+			auto entry = data.data() + offset + i * valueSize;
+			if (isAbsolute) {
+				values[i] = (int32_t)((uint32_t)entry[0]
+					| ((uint32_t)entry[1] << 8)
+					| ((uint32_t)entry[2] << 16)
+					| ((uint32_t)entry[3] << 24));
+			}
+			else {
+				auto delta = (int16_t)((uint16_t)entry[0] | ((uint16_t)entry[1] << 8));
+				values[i] = portal.keyframes.values[i] + delta;
+			}
+		}
+
+		for (size_t i = 0; i < 4; i++) {
+			portal.keyframes.values[i] = values[i];
+		}
+		portal.axes[0].target = values[0];
+		portal.axes[1].target = values[1];
+		return true;
+	}
+
+	//----------
+	void
+		Simulated::portalReboot(Portal& portal, Clock::time_point time)
+	{
+		portal.bootTime = time;
+		portal.lastMotionUpdate = time;
+		portal.lastRxSeq = 0;
+		portal.verifyChecksum = this->settings.verifyChecksum;
+		portal.baudRate = this->settings.baudRate;
+		portal.pendingBaudRate = 0;
+		portal.lastValidFrameTime = time;
+		portal.insideRoutine = false;
+		portal.keyframes.synced = false;
+		portal.compactStatus.sent = false;
+
+		// Cancel any scheduled reply
+		portal.scheduledGeneration++;
+
+		for (auto& axis : portal.axes) {
+			axis.position = 0.0;
+			axis.target = 0;
+		}
+	}
+
+	//----------
+	void
+		Simulated::portalUpdateBaudRate(Portal& portal, Clock::time_point time)
+	{
+		// As RS485::updateBaudRate in PortalFW (worked out whenever the portal next uses its UART)
+		if (portal.pendingBaudRate != 0 && time >= portal.pendingBaudRateTime) {
+			portal.baudRate = portal.pendingBaudRate;
+			portal.pendingBaudRate = 0;
+			portal.lastValidFrameTime = portal.pendingBaudRateTime;
+		}
+
+		if (portal.baudRate != this->settings.baudRate
+			&& time - portal.lastValidFrameTime > std::chrono::milliseconds(this->settings.baudFallbackTimeout_ms)) {
+			portal.baudRate = this->settings.baudRate;
+		}
+	}
+
+	//----------
+	void
+		Simulated::portalAdvanceMotion(Portal& portal, Clock::time_point time)
+	{
+		if (time <= portal.lastMotionUpdate) {
+			return;
+		}
+
+		auto dt_s = std::chrono::duration<double>(time - portal.lastMotionUpdate).count();
+		portal.lastMotionUpdate = time;
+
+		auto maxStep = this->settings.maximumSpeed * dt_s;
+		bool arrived = true;
+		for (auto& axis : portal.axes) {
+			auto remaining = (double)axis.target - axis.position;
+			if (abs(remaining) <= maxStep) {
+				axis.position = axis.target;
+			}
+			else {
+				axis.position += remaining > 0.0 ? maxStep : -maxStep;
+				arrived = false;
+			}
+		}
+
+		if (arrived) {
+			portal.insideRoutine = false;
+		}
+	}
+
+	//----------
+	void
+		Simulated::portalQueueReply(Portal& portal, Reply reply, Clock::time_point time, bool success, uint32_t generation)
+	{
+		Event event;
+		{
+			event.type = Event::Type::Reply;
+			event.portalIndex = &portal - this->portals.data();
+			event.reply = reply;
+			event.success = success;
+			event.generation = generation;
+		}
+		this->addEvent(time, event);
+	}
+
+	//----------
+	Buffer
+		Simulated::portalBuildReply(Portal& portal, Reply reply, bool success, Clock::time_point time)
+	{
+		this->portalAdvanceMotion(portal, time);
+
+		Modules::RS485Protocol::MsgpackBinary message;
+
+		switch (reply) {
+		case Reply::ACK:
+		{
+			// As RS485::sendACK
+			message.push_back(0x93);
+			message.push_back(0);
+			message.push_back((uint8_t)portal.id);
+			message.push_back(success ? 0xc3 : 0xc2);
+			break;
+		}
+		case Reply::Positions:
+		{
+			// As RS485::sendPositions
+			message.push_back(0x93);
+			writeInt8(message, 0);
+			writeInt8(message, (int8_t)portal.id);
+			message.push_back(0x81);
+			message.push_back(0xa1);
+			message.push_back('p');
+			message.push_back(0x94);
+			writeInt32(message, (int32_t)portal.axes[0].position);
+			writeInt32(message, (int32_t)portal.axes[1].position);
+			writeInt32(message, portal.axes[0].target);
+			writeInt32(message, portal.axes[1].target);
+			break;
+		}
+		case Reply::StatusReport:
+		{
+			// As RS485::sendStatusReport / App::reportStatus (with an empty log)
+			auto upTime = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(time - portal.bootTime).count();
+			MsgPack body = MsgPack::object{
+				{ "app", MsgPack::object{
+					{ "upTime", upTime }
+					, { "version", "Simulated" }
+					, { "provisionSerial", (uint32_t)portal.id }
+					, { "settingsVersion", (uint32_t)2 }
+					, { "operatingCurrentMa", (uint16_t)150 }
+					, { "fullCurrentHomeRecovery", true }
+					, { "settingsSource", "defaults" }
+				} }
+				, { "mca", makeAxisStatus((int32_t)portal.axes[0].position, portal.axes[0].target, this->settings.maximumSpeed) }
+				, { "mcb", makeAxisStatus((int32_t)portal.axes[1].position, portal.axes[1].target, this->settings.maximumSpeed) }
+				, { "logger", MsgPack::array{} }
+				, { "settings", MsgPack::object{
+					{ "version", (uint32_t)2 }
+					, { "operatingCurrentMa", (uint16_t)150 }
+					, { "fullCurrentHomeRecovery", true }
+					, { "source", "defaults" }
+					, { "opticalCalibrationVersion", (uint8_t)0 }
+					, { "axisAThreshold", (uint8_t)128 }
+					, { "axisAWidth", (uint8_t)0 }
+					, { "axisBThreshold", (uint8_t)128 }
+					, { "axisBWidth", (uint8_t)0 }
+				} }
+			};
+
+			MsgPack envelope = MsgPack::array{ (int8_t)0, (int8_t)portal.id, body };
+			auto dataString = envelope.dump();
+			message.assign(dataString.begin(), dataString.end());
+			break;
+		}
+		case Reply::CompactStatus:
+		case Reply::CompactStatusChanges:
+		{
+			// As App::packCompactStatus (layout v1), only the positions change after the first report
+			int32_t positions[4] = {
+				(int32_t)portal.axes[0].position
+				, (int32_t)portal.axes[1].position
+				, portal.axes[0].target
+				, portal.axes[1].target
+			};
+			const auto changedOnly = reply == Reply::CompactStatusChanges && portal.compactStatus.sent;
+
+			uint8_t fields = 0;
+			if (!changedOnly || memcmp(positions, portal.compactStatus.positions, sizeof(positions)) != 0) {
+				fields |= 1 << 0;
+			}
+			if (!changedOnly) {
+				fields |= 0xFE;
+			}
+
+			const char* version = "Simulated";
+			Buffer report;
+			auto upTime = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(time - portal.bootTime).count();
+			writeLittleEndian(report, 1, 1);
+			writeLittleEndian(report, changedOnly ? 1 : 0, 1);
+			writeLittleEndian(report, fields, 1);
+			writeLittleEndian(report, upTime, 4);
+			if (fields & (1 << 0)) {
+				for (auto position : positions) {
+					writeLittleEndian(report, (uint32_t)position, 4);
+				}
+			}
+			if (fields & (1 << 1)) {
+				// Every health flag OK on both axes
+				writeLittleEndian(report, 0xFF, 1);
+			}
+			if (fields & (1 << 2)) {
+				for (int i = 0; i < 2; i++) {
+					writeLittleEndian(report, (uint32_t)this->settings.maximumSpeed, 4);
+					writeLittleEndian(report, 10000, 4);
+					writeLittleEndian(report, 5, 4);
+				}
+			}
+			if (fields & (1 << 3)) {
+				for (int i = 0; i < 2; i++) {
+					writeLittleEndian(report, 128, 2);
+					writeLittleEndian(report, 0, 4);
+				}
+			}
+			if (fields & (1 << 4)) {
+				writeLittleEndian(report, 0, 1);
+				writeLittleEndian(report, 0, 1);
+			}
+			if (fields & (1 << 5)) {
+				writeLittleEndian(report, 150, 2); // operatingCurrentMa
+				writeLittleEndian(report, 1, 1); // fullCurrentHomeRecovery
+				writeLittleEndian(report, 0, 1); // PersistentSettings::Source::Defaults
+				writeLittleEndian(report, 0, 2); // opticalCalibrationVersion
+			}
+			if (fields & (1 << 6)) {
+				writeLittleEndian(report, (uint32_t)portal.id, 4);
+			}
+			if (fields & (1 << 7)) {
+				auto length = strlen(version);
+				writeLittleEndian(report, (uint32_t)length, 1);
+				report.insert(report.end(), version, version + length);
+			}
+
+			memcpy(portal.compactStatus.positions, positions, sizeof(positions));
+			portal.compactStatus.sent = true;
+
+			// As RS485::sendCompactStatusReport : [0, id, {"s" : bin8}, ...]
+			message.push_back(0x93);
+			writeInt8(message, 0);
+			writeInt8(message, (int8_t)portal.id);
+			message.push_back(0x81);
+			message.push_back(0xa1);
+			message.push_back('s');
+			message.push_back(0xc4);
+			message.push_back((uint8_t)report.size());
+			message.insert(message.end(), report.begin(), report.end());
+			break;
+		}
+		default:
+			break;
+		}
+
+		// [..., seq, crc16] with the seq of the last verified request (as RS485::finishFrame)
+		Modules::RS485Protocol::appendSeqAndCRC(message, portal.lastRxSeq);
+
+		Buffer frame;
+		Modules::RS485Protocol::encodeFrame(message, frame);
+		return frame;
+	}
+}
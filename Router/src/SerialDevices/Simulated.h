@@ -0,0 +1,197 @@
+#pragma once
+
+#include "IDevice.h"
+#include "ListedDevice.h"
+
+namespace SerialDevices {
+	/// <summary>
+	/// A bus of simulated PortalFW boards, so that the Router can be load tested without hardware.
+	///
+	/// Wire time is modelled per byte (start + 8 data + stop bits at the baud rate) against the
+	/// steady clock. Frames from the Router and replies from the portals each occupy the bus for
+	/// their wire time, portals react after their main loop latency (plus any reply slot), and
+	/// transmissions which overlap on the half-duplex bus are garbled for every receiver.
+	/// Bit errors can optionally be injected.
+	///
+	/// Each portal has its own baud rate, as PortalFW's "baud" handling and fallback watchdog set it. A frame
+	/// sent at one rate is noise to a UART listening at another.
+	///
+	/// Each portal follows PortalFW's RS485 / App handling of pings, "m", "mm", "p", "poll" and "s"
+	/// (addressed and broadcast), "keyframe", "kf" and the routines, including the ACK rules and
+	/// the seq echoed in the [seq, crc16] trailer. ACK, position and compact status replies are packed
+	/// byte for byte as the firmware packs them. Motion is a constant speed slew towards the target.
+	///
+	/// Settings are read from the json (e.g. { "deviceType" : "Simulated", "portalCount" : 24 }).
+	/// </summary>
+	class Simulated : public IDevice
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Settings {
+			int portalCount = 24;
+			int firstID = 1;
+			int baudRate = BAUD_RATE; // the rate the host and the portals come up at
+			int baudFallbackTimeout_ms = 3000; // as RS485::baudFallbackTimeout_ms in PortalFW
+			int loopPeriod_us = 1100; // PortalFW main loop (app.update() then HAL_Delay(1))
+			int processing_us = 150; // from the end of a frame to the start of the reply
+			double bitErrorRate = 0.0; // chance of each bit on the wire being flipped
+			bool verifyChecksum = false; // as RS485::verifyChecksumEnabled in PortalFW
+			int32_t maximumSpeed = 7040 * 2; // steps per second
+			uint32_t seed = 1;
+		};
+
+		struct Statistics {
+			size_t framesFromHost = 0;
+			size_t keyframesFromHost = 0;
+			size_t repliesToHost = 0;
+			size_t collisions = 0;
+			size_t bitErrors = 0;
+			size_t packetsDropped = 0; // COBS or msgpack errors seen by the portals
+		};
+
+		~Simulated();
+		string getTypeName() const override;
+		string getAddressString() override;
+
+		bool open(const nlohmann::json&) override;
+		bool open(const Settings&);
+		void close() override;
+		bool isConnected() override;
+		bool setBaudRate(int baudRate) override;
+
+		size_t transmit(const Buffer&) override;
+
+		bool hasDataIncoming() override;
+		size_t receiveBytes(uint8_t* buffer, size_t size) override;
+
+		// Sleeps until the bus next changes (an event falls due, or a reply finishes arriving)
+		bool waitForData(chrono::microseconds timeout) override;
+
+		const Statistics& getStatistics() const;
+
+		static vector<ListedDevice> listDevices();
+	protected:
+		struct Transmission {
+			int source; // 0 = host
+			Buffer bytes; // COBS frame including the delimiter
+			Clock::time_point start;
+			Clock::time_point end;
+			int baudRate; // the sender's
+			std::chrono::nanoseconds byteDuration;
+			size_t delivered = 0; // bytes passed to (or lost for) the host
+		};
+
+		enum class Reply {
+			ACK,
+			Positions,
+			StatusReport,
+			CompactStatus,
+			CompactStatusChanges
+		};
+
+		struct Event {
+			enum class Type {
+				HostFrameStart,
+				HostFrameEnd,
+				Reply
+			};
+			Type type;
+			shared_ptr<Transmission> transmission;
+
+			size_t portalIndex = 0;
+			Reply reply = Reply::ACK;
+			bool success = true;
+			uint32_t generation = 0; // scheduled replies are dropped if the portal has scheduled another since
+		};
+
+		struct Portal {
+			int id;
+
+			struct {
+				double position = 0.0;
+				int32_t target = 0;
+			} axes[2];
+
+			Clock::time_point lastMotionUpdate;
+			Clock::time_point bootTime;
+			Clock::time_point txBusyUntil;
+
+			int baudRate;
+			int pendingBaudRate = 0;
+			Clock::time_point pendingBaudRateTime;
+			Clock::time_point lastValidFrameTime;
+
+			uint8_t lastRxSeq = 0;
+			bool verifyChecksum = false;
+			bool insideRoutine = false;
+			uint32_t scheduledGeneration = 0;
+
+			// As App::compactStatusSent / lastCompactStatus. Only the positions move in the simulation
+			struct {
+				bool sent = false;
+				int32_t positions[4] = { 0, 0, 0, 0 };
+			} compactStatus;
+
+			struct {
+				bool synced = false;
+				uint8_t lastSeq = 0;
+				int32_t values[4] = { 0, 0, 0, 0 };
+			} keyframes;
+		};
+
+		// A decoded frame from the host
+		struct Packet {
+			msgpack11::MsgPack::array envelope;
+			int target;
+			int seq; // -1 if the frame had no trailer
+			bool trailerValid;
+		};
+
+		// As the ACK flags in PortalFW's RS485
+		struct Context {
+			Clock::time_point time;
+			bool disableACK = false;
+			bool sentACKEarly = false;
+			bool reset = false;
+		};
+
+		void advance(Clock::time_point);
+		Clock::time_point getNextActivity() const;
+		void addEvent(Clock::time_point, const Event&);
+		void processEvent(Clock::time_point, const Event&);
+
+		void startTransmission(shared_ptr<Transmission>);
+		void garble(Transmission&, Clock::time_point from, Clock::time_point to);
+		size_t bytesCompleteAt(const Transmission&, Clock::time_point) const;
+
+		void receiveFromHost(const Transmission&, Clock::time_point);
+		void receivePacket(const uint8_t* data, size_t size, int baudRate, Clock::time_point);
+
+		void portalReceive(Portal&, const Packet&, Clock::time_point);
+		bool portalProcessKey(Portal&, const string& key, const msgpack11::MsgPack& value, const Packet&, Context&);
+		bool portalCheckChecksum(Portal&, const Packet&);
+		bool portalProcessKeyframeBinary(Portal&, const msgpack11::MsgPack::binary&);
+		void portalReboot(Portal&, Clock::time_point);
+		void portalUpdateBaudRate(Portal&, Clock::time_point);
+		void portalAdvanceMotion(Portal&, Clock::time_point);
+		void portalQueueReply(Portal&, Reply, Clock::time_point, bool success = true, uint32_t generation = 0);
+		Buffer portalBuildReply(Portal&, Reply, bool success, Clock::time_point);
+
+		Settings settings;
+		bool isOpen = false;
+
+		// The host UART's
+		int baudRate;
+		std::chrono::nanoseconds byteDuration;
+		std::mt19937 random;
+
+		vector<Portal> portals;
+		std::multimap<Clock::time_point, Event> events;
+		std::list<shared_ptr<Transmission>> bus;
+		Clock::time_point hostTxEnd;
+
+		Clock::time_point openTime;
+		Statistics statistics;
+	};
+}
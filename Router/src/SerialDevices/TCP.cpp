@@ -1,13 +1,86 @@
 #include "pch_App.h"
 #include "TCP.h"
 
+#ifdef TARGET_WIN32
+#	include <mstcpip.h>
+#else
+#	include <fcntl.h>
+#	include <netdb.h>
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#	include <poll.h>
+#	include <sys/uio.h>
+#	include <unistd.h>
+#	define INVALID_SOCKET (-1)
+#	define SOCKET_ERROR (-1)
+#	define closesocket ::close
+#endif
+
 namespace SerialDevices {
+	namespace {
+		// Most frames handed to one send (IOV_MAX is at least 16, and 1024 on Linux / macOS)
+		const size_t maxBuffersPerSend = 64;
+
+		// Keepalive probes start after this much silence and repeat at this interval, so a gateway which vanishes
+		// without a FIN / RST is noticed within a few seconds (the OS defaults are ~2 hours)
+		const int keepAliveIdle_s = 2;
+		const int keepAliveInterval_s = 1;
+		const int keepAliveCount = 3; // probes before the connection is dropped (fixed at 10 on Windows)
+
+		//----------
+		int
+			lastSocketError()
+		{
+#ifdef TARGET_WIN32
+			return WSAGetLastError();
+#else
+			return errno;
+#endif
+		}
+
+		//----------
+		bool
+			isWouldBlock(int error)
+		{
+#ifdef TARGET_WIN32
+			return error == WSAEWOULDBLOCK;
+#else
+			return error == EAGAIN || error == EWOULDBLOCK || error == EINPROGRESS || error == EINTR;
+#endif
+		}
+
+		//----------
+		string
+			socketErrorString(int error)
+		{
+#ifdef TARGET_WIN32
+			return "WSA error " + ofToString(error);
+#else
+			return strerror(error);
+#endif
+		}
+	}
+
+	//----------
+	TCP::TCP()
+	{
+#ifdef TARGET_WIN32
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+		this->socketEvent = WSACreateEvent();
+#endif
+		this->socket = INVALID_SOCKET;
+	}
+
 	//----------
 	TCP::~TCP()
 	{
-		if (this->tcpClient.isConnected()) {
-			this->tcpClient.close();
-		}
+		this->close();
+
+#ifdef TARGET_WIN32
+		WSACloseEvent(this->socketEvent);
+		WSACleanup();
+#endif
 	}
 
 	//----------
@@ -21,7 +94,15 @@ namespace SerialDevices {
 	string
 		TCP::getAddressString()
 	{
-		return this->tcpClient.getIP();
+		auto address = this->settings.address + ":" + ofToString(this->settings.port);
+		switch (this->state.load()) {
+		case State::Connecting:
+			return address + " (connecting)";
+		case State::WaitingToReconnect:
+			return address + " (reconnecting)";
+		default:
+			return address;
+		}
 	}
 
 	//----------
@@ -30,20 +111,24 @@ namespace SerialDevices {
 	{
 		// address is required
 		if (json.contains("address")) {
-			auto address = (string)json["address"];
+			Settings settings;
+			settings.address = (string)json["address"];
 
-			// port is optional
-			int port = TCP_DEFAULT_PORT;
+			// the rest are optional
 			if (json.contains("port")) {
-				port = (int)json["port"];
+				settings.port = (int)json["port"];
 			}
-
-			int timeout_s = TCP_DEFAULT_TIMEOUT_S;
 			if (json.contains("timeout_s")) {
-				timeout_s = (int)json["timeout_s"];
+				settings.timeout_s = (int)json["timeout_s"];
+			}
+			if (json.contains("retryPeriod_ms")) {
+				settings.retryPeriod_ms = (int)json["retryPeriod_ms"];
+			}
+			if (json.contains("noDelay")) {
+				settings.noDelay = (bool)json["noDelay"];
 			}
 
-			return this->open(address, port, timeout_s);
+			return this->open(settings);
 		}
 		else {
 			return false;
@@ -54,58 +139,483 @@ namespace SerialDevices {
 	bool
 		TCP::open(string address, int port, int timeout_s)
 	{
-		this->tcpClient.getTCPManager().SetTimeoutConnect(timeout_s);
-		return this->tcpClient.setup(address, port);
+		Settings settings;
+		settings.address = address;
+		settings.port = port;
+		settings.timeout_s = timeout_s;
+		return this->open(settings);
+	}
+
+	//----------
+	bool
+		TCP::open(const Settings& settings)
+	{
+		this->close();
+
+		// Resolve now. This is the only part of opening which can block (and only for host names)
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		addrinfo* result = nullptr;
+		if (getaddrinfo(settings.address.c_str(), ofToString(settings.port).c_str(), &hints, &result) != 0 || !result) {
+			ofLogError("TCP") << "Could not resolve " << settings.address;
+			return false;
+		}
+		memcpy(&this->socketAddress, result->ai_addr, result->ai_addrlen);
+		this->socketAddressLength = (socklen_t)result->ai_addrlen;
+		freeaddrinfo(result);
+
+		this->settings = settings;
+		this->rxRing.readIndex = 0;
+		this->rxRing.size = 0;
+		this->txQueue.clear();
+		this->txQueueOffset = 0;
+		this->txQueueBytes = 0;
+		this->connectFailures = 0;
+		this->framesDropped = 0;
+
+		// Completes (or fails and retries) in the serial thread
+		this->startConnecting();
+		return true;
 	}
 
 	//----------
 	void
 		TCP::close()
 	{
-		this->tcpClient.close();
+		this->closeSocket();
+		this->state = State::Closed;
 	}
 
 	//----------
 	bool
 		TCP::isConnected()
 	{
-		return this->tcpClient.isConnected();
+		// True whilst reconnecting, since the device looks after that itself
+		return this->state != State::Closed;
 	}
 
 	//----------
 	size_t
 		TCP::transmit(const Buffer& buffer)
 	{
-		if (this->tcpClient.sendRawBytes((char*)buffer.data()
-			, buffer.size())) {
-			return buffer.size();
+		if (buffer.empty()) {
+			return 0;
 		}
-		else {
+
+		// Frames aren't held over whilst disconnected, they would only reach the portals as a stale burst
+		if (this->state != State::Connected) {
+			if (this->state != State::Closed) {
+				this->framesDropped++;
+			}
+			return 0;
+		}
+
+		// If the gateway is falling behind, the oldest frames are the least useful
+		while (this->txQueueBytes + buffer.size() > TCP::maxQueuedBytes
+			&& !this->txQueue.empty()
+			&& this->txQueueOffset == 0) {
+			this->txQueueBytes -= this->txQueue.front().size();
+			this->txQueue.pop_front();
+			this->framesDropped++;
+		}
+		if (this->txQueueBytes + buffer.size() > TCP::maxQueuedBytes) {
+			this->framesDropped++;
 			return 0;
 		}
+
+		this->txQueue.push_back(buffer);
+		this->txQueueBytes += buffer.size();
+		return buffer.size();
+	}
+
+	//----------
+	void
+		TCP::flush()
+	{
+		this->updateConnection();
+		this->writeSocket();
 	}
 
 	//----------
 	bool
 		TCP::hasDataIncoming()
 	{
-		return this->tcpClient.getNumReceivedBytes() > 0;
+		if (this->rxRing.size == 0) {
+			this->readSocket();
+		}
+		return this->rxRing.size > 0;
 	}
 
 	//----------
-	Buffer
-		TCP::receiveBytes()
+	size_t
+		TCP::receiveBytes(uint8_t* buffer, size_t size)
 	{
-		Buffer buffer;
-		buffer.resize(256);
+		this->readSocket();
+
+		auto& ring = this->rxRing;
+		auto capacity = ring.buffer.size();
 
-		auto bytesReceived = this->tcpClient.receiveRawBytes((char*)buffer.data(), buffer.size());
-		if (bytesReceived < 0) {
-			return Buffer();
+		size_t bytesReceived = 0;
+		while (bytesReceived < size && ring.size > 0) {
+			auto span = min(min(size - bytesReceived, ring.size), capacity - ring.readIndex);
+			memcpy(buffer + bytesReceived, ring.buffer.data() + ring.readIndex, span);
+			bytesReceived += span;
+			ring.readIndex = (ring.readIndex + span) % capacity;
+			ring.size -= span;
 		}
-		else {
-			buffer.resize(bytesReceived);
-			return buffer;
+		if (ring.size == 0) {
+			ring.readIndex = 0;
+		}
+
+		return bytesReceived;
+	}
+
+	//----------
+	bool
+		TCP::waitForData(chrono::microseconds timeout)
+	{
+		this->updateConnection();
+		this->writeSocket();
+		if (this->hasDataIncoming()) {
+			return true;
+		}
+
+		// Don't sleep through the next connection deadline
+		auto now = chrono::steady_clock::now();
+		auto until = now + timeout;
+		if (this->state == State::WaitingToReconnect) {
+			until = min(until, this->nextConnectAttempt);
+		}
+		else if (this->state == State::Connecting) {
+			until = min(until, this->connectStart + chrono::seconds(this->settings.timeout_s));
+		}
+		auto wait_us = max<int64_t>(chrono::duration_cast<chrono::microseconds>(until - now).count(), 0);
+		auto timeout_ms = (int)min<int64_t>((wait_us + 999) / 1000, numeric_limits<int>::max());
+
+#ifdef TARGET_WIN32
+		HANDLE handles[] = { this->wakeSignal.getHandle(), this->socketEvent };
+		DWORD count = this->socket != INVALID_SOCKET ? 2 : 1;
+		auto result = WaitForMultipleObjects(count, handles, FALSE, (DWORD)timeout_ms);
+		if (result == WAIT_OBJECT_0 + 1) {
+			// Also resets socketEvent
+			WSANETWORKEVENTS events;
+			if (WSAEnumNetworkEvents(this->socket, this->socketEvent, &events) == 0) {
+				if (events.lNetworkEvents & FD_CONNECT) {
+					auto error = events.iErrorCode[FD_CONNECT_BIT];
+					if (error != 0) {
+						this->disconnect("connect failed : " + socketErrorString(error));
+						return false;
+					}
+					this->onConnected();
+				}
+				if (events.lNetworkEvents & (FD_READ | FD_CLOSE)) {
+					this->readSocket();
+				}
+				if (events.lNetworkEvents & FD_WRITE) {
+					this->writeSocket();
+				}
+			}
+		}
+#else
+		pollfd fds[2];
+		nfds_t count = 0;
+		fds[count++] = { this->wakeSignal.getFD(), POLLIN, 0 };
+		if (this->socket != INVALID_SOCKET) {
+			short events = POLLIN;
+			if (this->state == State::Connecting || this->txQueueBytes > 0) {
+				events |= POLLOUT;
+			}
+			fds[count++] = { this->socket, events, 0 };
+		}
+
+		if (poll(fds, count, timeout_ms) > 0) {
+			if (fds[0].revents & POLLIN) {
+				this->wakeSignal.clear();
+			}
+			if (count > 1 && fds[1].revents) {
+				if (this->state == State::Connecting) {
+					int error = 0;
+					socklen_t length = sizeof(error);
+					getsockopt(this->socket, SOL_SOCKET, SO_ERROR, &error, &length);
+					if (error != 0) {
+						this->disconnect("connect failed : " + socketErrorString(error));
+						return false;
+					}
+					this->onConnected();
+				}
+				else {
+					if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+						this->readSocket();
+					}
+					if (fds[1].revents & POLLOUT) {
+						this->writeSocket();
+					}
+				}
+			}
+		}
+#endif
+
+		return this->rxRing.size > 0;
+	}
+
+	//----------
+	void
+		TCP::wake()
+	{
+		this->wakeSignal.signal();
+	}
+
+	//----------
+	void
+		TCP::updateConnection()
+	{
+		auto now = chrono::steady_clock::now();
+		switch (this->state.load()) {
+		case State::WaitingToReconnect:
+			if (now >= this->nextConnectAttempt) {
+				this->startConnecting();
+			}
+			break;
+		case State::Connecting:
+			if (now - this->connectStart > chrono::seconds(this->settings.timeout_s)) {
+				this->disconnect("timed out");
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	//----------
+	void
+		TCP::startConnecting()
+	{
+		this->closeSocket();
+		this->connectStart = chrono::steady_clock::now();
+		this->state = State::Connecting;
+
+		auto socket = ::socket(this->socketAddress.ss_family, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == INVALID_SOCKET) {
+			this->disconnect("could not create socket : " + socketErrorString(lastSocketError()));
+			return;
+		}
+		this->socket = socket;
+
+#ifdef TARGET_WIN32
+		// Also makes the socket non-blocking
+		WSAEventSelect(socket, this->socketEvent, FD_CONNECT | FD_READ | FD_WRITE | FD_CLOSE);
+#else
+		fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+		fcntl(socket, F_SETFD, FD_CLOEXEC);
+#	ifdef SO_NOSIGPIPE
+		{
+			int noSigPipe = 1;
+			setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+		}
+#	endif
+#endif
+		{
+			int noDelay = this->settings.noDelay ? 1 : 0;
+			setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+		}
+		{
+			// So that a gateway which vanishes is noticed even when we're not sending
+#ifdef TARGET_WIN32
+			tcp_keepalive keepAlive;
+			keepAlive.onoff = 1;
+			keepAlive.keepalivetime = keepAliveIdle_s * 1000;
+			keepAlive.keepaliveinterval = keepAliveInterval_s * 1000;
+			DWORD bytesReturned = 0;
+			WSAIoctl(socket, SIO_KEEPALIVE_VALS, &keepAlive, sizeof(keepAlive), nullptr, 0, &bytesReturned, nullptr, nullptr);
+#else
+			int keepAlive = 1;
+			setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(keepAlive));
+#	ifdef TCP_KEEPIDLE
+			setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &keepAliveIdle_s, sizeof(keepAliveIdle_s));
+#	elif defined(TCP_KEEPALIVE)
+			// macOS
+			setsockopt(socket, IPPROTO_TCP, TCP_KEEPALIVE, &keepAliveIdle_s, sizeof(keepAliveIdle_s));
+#	endif
+			setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &keepAliveInterval_s, sizeof(keepAliveInterval_s));
+			setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT, &keepAliveCount, sizeof(keepAliveCount));
+#endif
+		}
+
+		if (::connect(socket, (const sockaddr*)&this->socketAddress, this->socketAddressLength) == 0) {
+			this->onConnected();
+			return;
+		}
+
+		auto error = lastSocketError();
+		if (!isWouldBlock(error)) {
+			this->disconnect("connect failed : " + socketErrorString(error));
+		}
+	}
+
+	//----------
+	void
+		TCP::onConnected()
+	{
+		this->state = State::Connected;
+		this->connectFailures = 0;
+
+		ofLogNotice("TCP") << "Connected to " << this->getAddressString();
+		if (this->framesDropped > 0) {
+			ofLogWarning("TCP") << this->framesDropped << " frames were dropped whilst disconnected";
+			this->framesDropped = 0;
+		}
+
+		this->writeSocket();
+	}
+
+	//----------
+	void
+		TCP::disconnect(const string& reason)
+	{
+		if (this->state == State::Connected) {
+			ofLogError("TCP") << "Lost " << this->getAddressString() << " : " << reason;
+		}
+		else if (this->connectFailures++ == 0) {
+			ofLogError("TCP") << "Could not connect to " << this->settings.address << ":" << this->settings.port
+				<< " (" << reason << "), retrying every " << this->settings.retryPeriod_ms << "ms";
+		}
+
+		this->closeSocket();
+		this->state = State::WaitingToReconnect;
+		this->nextConnectAttempt = chrono::steady_clock::now() + chrono::milliseconds(this->settings.retryPeriod_ms);
+
+		// Anything not yet sent is lost with the connection (it would be stale by the time we're back)
+		this->framesDropped += this->txQueue.size();
+		this->txQueue.clear();
+		this->txQueueOffset = 0;
+		this->txQueueBytes = 0;
+	}
+
+	//----------
+	void
+		TCP::closeSocket()
+	{
+		if (this->socket == INVALID_SOCKET) {
+			return;
+		}
+
+		closesocket(this->socket);
+		this->socket = INVALID_SOCKET;
+
+#ifdef TARGET_WIN32
+		WSAResetEvent(this->socketEvent);
+#endif
+	}
+
+	//----------
+	void
+		TCP::readSocket()
+	{
+		auto& ring = this->rxRing;
+		auto capacity = ring.buffer.size();
+
+		while (this->state == State::Connected && ring.size < capacity) {
+			// Into the free space up to the end of the buffer (the next pass wraps)
+			auto writeIndex = (ring.readIndex + ring.size) % capacity;
+			auto span = min(capacity - ring.size, capacity - writeIndex);
+
+			auto result = ::recv(this->socket, (char*)ring.buffer.data() + writeIndex, (int)span, 0);
+			if (result > 0) {
+				ring.size += (size_t)result;
+				if ((size_t)result < span) {
+					// That's everything for now
+					break;
+				}
+			}
+			else if (result == 0) {
+				this->disconnect("closed by the gateway");
+			}
+			else {
+				auto error = lastSocketError();
+				if (!isWouldBlock(error)) {
+					this->disconnect(socketErrorString(error));
+				}
+				break;
+			}
+		}
+	}
+
+	//----------
+	void
+		TCP::writeSocket()
+	{
+		while (this->state == State::Connected && this->txQueueBytes > 0) {
+			size_t bytesSent = 0;
+
+#ifdef TARGET_WIN32
+			WSABUF buffers[maxBuffersPerSend];
+			DWORD count = 0;
+			for (auto it = this->txQueue.begin(); it != this->txQueue.end() && count < maxBuffersPerSend; it++) {
+				auto offset = count == 0 ? this->txQueueOffset : 0;
+				buffers[count].buf = (CHAR*)it->data() + offset;
+				buffers[count].len = (ULONG)(it->size() - offset);
+				count++;
+			}
+
+			DWORD result = 0;
+			if (WSASend(this->socket, buffers, count, &result, 0, NULL, NULL) == SOCKET_ERROR) {
+				auto error = lastSocketError();
+				if (!isWouldBlock(error)) {
+					this->disconnect(socketErrorString(error));
+				}
+				// Otherwise FD_WRITE tells us when there's room
+				return;
+			}
+			bytesSent = (size_t)result;
+#else
+			iovec buffers[maxBuffersPerSend];
+			size_t count = 0;
+			for (auto it = this->txQueue.begin(); it != this->txQueue.end() && count < maxBuffersPerSend; it++) {
+				auto offset = count == 0 ? this->txQueueOffset : 0;
+				buffers[count].iov_base = (void*)(it->data() + offset);
+				buffers[count].iov_len = it->size() - offset;
+				count++;
+			}
+
+			msghdr message;
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = buffers;
+			message.msg_iovlen = count;
+
+			int flags = 0;
+#	ifdef MSG_NOSIGNAL
+			flags |= MSG_NOSIGNAL;
+#	endif
+			auto result = sendmsg(this->socket, &message, flags);
+			if (result < 0) {
+				auto error = lastSocketError();
+				if (!isWouldBlock(error)) {
+					this->disconnect(socketErrorString(error));
+				}
+				// Otherwise waitForData polls for POLLOUT
+				return;
+			}
+			bytesSent = (size_t)result;
+#endif
+
+			// Retire what went out
+			this->txQueueBytes -= bytesSent;
+			while (bytesSent > 0) {
+				auto remaining = this->txQueue.front().size() - this->txQueueOffset;
+				if (bytesSent >= remaining) {
+					bytesSent -= remaining;
+					this->txQueue.pop_front();
+					this->txQueueOffset = 0;
+				}
+				else {
+					this->txQueueOffset += bytesSent;
+					bytesSent = 0;
+				}
+			}
 		}
 	}
 
@@ -2,31 +2,116 @@
 
 #include "IDevice.h"
 #include "ListedDevice.h"
-#include "ofxNetwork.h"
+#include "WakeSignal.h"
+
+#ifdef TARGET_WIN32
+#	include <winsock2.h>
+#	include <ws2tcpip.h>
+#else
+#	include <sys/socket.h>
+#endif
 
 #define TCP_DEFAULT_PORT 4196
 #define TCP_DEFAULT_TIMEOUT_S 1
 
 namespace SerialDevices {
+	/// <summary>
+	/// An RS485-over-Ethernet gateway, on a non-blocking socket serviced by the serial thread.
+	///
+	/// Frames passed to transmit are queued and go out together in one scatter-gather send when the serial thread
+	/// flushes or waits, so a burst of no-ACK broadcasts (e.g. keyframe blocks) leaves the host as one segment.
+	/// Reads land in a reusable receive ring.
+	///
+	/// Connecting never blocks the caller. If the gateway drops (or can't be reached) the device stays open and
+	/// reconnects from the serial thread. Frames are only queued whilst connected (up to maxQueuedBytes), anything
+	/// transmitted or still queued whilst the connection is down is dropped rather than replayed on reconnect.
+	///
+	/// Settings are read from the json (e.g. { "deviceType" : "TCP", "address" : "192.168.1.201", "noDelay" : true }).
+	/// </summary>
 	class TCP : public IDevice
 	{
 	public:
+		struct Settings {
+			string address;
+			int port = TCP_DEFAULT_PORT;
+			int timeout_s = TCP_DEFAULT_TIMEOUT_S; // for each connection attempt
+			int retryPeriod_ms = 1000;
+			bool noDelay = true; // TCP_NODELAY
+		};
+
+		TCP();
 		~TCP();
 		string getTypeName() const override;
 		string getAddressString() override;
 
 		bool open(const nlohmann::json&) override;
 		bool open(string address, int port, int timeout_s);
+		bool open(const Settings&);
 		void close() override;
 		bool isConnected() override;
 
 		size_t transmit(const Buffer&) override;
+		void flush() override;
 
 		bool hasDataIncoming() override;
-		Buffer receiveBytes() override;
+		size_t receiveBytes(uint8_t* buffer, size_t size) override;
+
+		bool waitForData(chrono::microseconds timeout) override;
+		void wake() override;
 
 		static vector<ListedDevice> listDevices();
 	protected:
-		ofxTCPClient tcpClient;
+#ifdef TARGET_WIN32
+		typedef SOCKET Socket;
+#else
+		typedef int Socket;
+#endif
+
+		enum class State {
+			Closed,
+			Connecting,
+			Connected,
+			WaitingToReconnect
+		};
+
+		void updateConnection();
+		void startConnecting();
+		void onConnected();
+		void disconnect(const string& reason);
+		void closeSocket();
+
+		void readSocket();
+		void writeSocket();
+
+		Settings settings;
+		std::atomic<State> state{ State::Closed };
+
+		sockaddr_storage socketAddress;
+		socklen_t socketAddressLength = 0;
+		Socket socket;
+#ifdef TARGET_WIN32
+		WSAEVENT socketEvent;
+#endif
+
+		chrono::steady_clock::time_point connectStart;
+		chrono::steady_clock::time_point nextConnectAttempt;
+
+		// Since we were last connected (so that each outage is reported once)
+		size_t connectFailures = 0;
+		size_t framesDropped = 0;
+
+		struct {
+			vector<uint8_t> buffer = vector<uint8_t>(1 << 16);
+			size_t readIndex = 0;
+			size_t size = 0;
+		} rxRing;
+
+		// Frames waiting to be sent on the current connection. The front one may be partly sent already
+		static const size_t maxQueuedBytes = 1 << 16;
+		deque<Buffer> txQueue;
+		size_t txQueueOffset = 0;
+		size_t txQueueBytes = 0;
+
+		WakeSignal wakeSignal;
 	};
 }
\ No newline at end of file
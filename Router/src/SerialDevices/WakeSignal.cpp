@@ -0,0 +1,87 @@
+#include "pch_App.h"
+#include "WakeSignal.h"
+
+#ifndef TARGET_WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	ifdef TARGET_LINUX
+#		include <sys/eventfd.h>
+#	endif
+#endif
+
+namespace SerialDevices {
+	//----------
+	WakeSignal::WakeSignal()
+	{
+#ifdef TARGET_WIN32
+		this->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+#elif defined(TARGET_LINUX)
+		this->fds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		this->fds[1] = this->fds[0];
+#else
+		if (pipe(this->fds) == 0) {
+			for (auto fd : this->fds) {
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				fcntl(fd, F_SETFD, FD_CLOEXEC);
+			}
+		}
+#endif
+	}
+
+	//----------
+	WakeSignal::~WakeSignal()
+	{
+#ifdef TARGET_WIN32
+		CloseHandle(this->event);
+#else
+		if (this->fds[1] >= 0 && this->fds[1] != this->fds[0]) {
+			::close(this->fds[1]);
+		}
+		if (this->fds[0] >= 0) {
+			::close(this->fds[0]);
+		}
+#endif
+	}
+
+	//----------
+	void
+		WakeSignal::signal()
+	{
+#ifdef TARGET_WIN32
+		SetEvent(this->event);
+#else
+#	ifdef TARGET_LINUX
+		uint64_t value = 1;
+#	else
+		uint8_t value = 1;
+#	endif
+		auto result = ::write(this->fds[1], &value, sizeof(value));
+		(void)result;
+#endif
+	}
+
+#ifdef TARGET_WIN32
+	//----------
+	HANDLE
+		WakeSignal::getHandle() const
+	{
+		return this->event;
+	}
+#else
+	//----------
+	int
+		WakeSignal::getFD() const
+	{
+		return this->fds[0];
+	}
+
+	//----------
+	void
+		WakeSignal::clear()
+	{
+		// 8 bytes from an eventfd, or however many were written to the pipe
+		uint8_t drain[64];
+		while (::read(this->fds[0], drain, sizeof(drain)) > 0) { }
+	}
+#endif
+}
\ No newline at end of file
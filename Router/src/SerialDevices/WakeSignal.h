@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+namespace SerialDevices {
+	/// <summary>
+	/// Set from any thread to end a device's wait early. It can be waited on alongside the device's own handle.
+	/// It is an auto-reset event on Windows, an eventfd on Linux and a pipe on other POSIX systems. A signal
+	/// with nobody waiting is kept for the next wait.
+	/// </summary>
+	class WakeSignal
+	{
+	public:
+		WakeSignal();
+		~WakeSignal();
+
+		void signal();
+
+#ifdef TARGET_WIN32
+		// Signalled until a wait on it returns
+		HANDLE getHandle() const;
+#else
+		// Readable until clear() is called
+		int getFD() const;
+		void clear();
+#endif
+	protected:
+#ifdef TARGET_WIN32
+		HANDLE event = NULL;
+#else
+		// [0] is polled, [1] is written by signal() (the same eventfd on Linux)
+		int fds[2] = { -1, -1 };
+#endif
+	};
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Serial.h"
 #include "TCP.h"
+#include "Simulated.h"
 
 namespace SerialDevices {
 	vector<ListedDevice>
@@ -22,6 +23,12 @@ namespace SerialDevices {
 			listedDevices.insert(listedDevices.end(), devices.begin(), devices.end());
 		}
 
+		// Simulated
+		{
+			auto devices = Simulated::listDevices();
+			listedDevices.insert(listedDevices.end(), devices.begin(), devices.end());
+		}
+
 		return listedDevices;
 	}
 }
\ No newline at end of file
@@ -54,6 +54,13 @@ namespace Utils {
 
 		T value;
 
+		// For values which arrive outside of a json report (e.g. the compact status report)
+		void set(const T& value)
+		{
+			this->value = value;
+			this->hasBeenReported = true;
+		}
+
 		void processIncoming(const nlohmann::json& json) override
 		{
 			if (json.contains(this->name)) {
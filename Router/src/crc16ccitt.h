@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection, xorout 0x0000.
+// This must stay byte-identical to the running CRC in the firmware's COBSRWStream
+// (see protocol-hardening.md §3). Check value for ASCII "123456789" is 0x29B1.
+inline uint16_t
+	crc16ccitt(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF)
+{
+	for (size_t i = 0; i < size; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000)
+				? (uint16_t)((crc << 1) ^ 0x1021)
+				: (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}